@@ -0,0 +1,1309 @@
+// A.ASM replacement using C
+// Mainly by Ken Silverman, with things melded with my port by
+// Jonathon Fowler (jf@jonof.id.au)
+//
+// "Build Engine & Tools" Copyright (c) 1993-1997 Ken Silverman
+// Ken Silverman's official web site: "http://www.advsys.net/ken"
+// See the included license file "BUILDLIC.TXT" for license info.
+//
+// This file has been modified from Ken Silverman's original release
+// by Jonathon Fowler (jf@jonof.id.au)
+// by the EDuke32 team (development@voidpoint.com)
+
+#include "a.h"
+#include "build_cpuid.h"
+#include "pragmas.h"
+
+#ifdef ENGINE_USING_A_C
+
+// SIMD column kernels. The SSE2 and AVX2 ones are selected at runtime from the
+// CPUID feature bits, NEON is used whenever the compiler targets it.
+//
+// mvlineasm4(), tvlineasm1(), tvlineasm2(), spritevline() and slopevlin() have
+// one. They step the texture coordinates and build the blend table indices of
+// four pixels at once and skip rows of transparent texels with one compare; the
+// texel, palookup and translucency fetches stay scalar loads. The AVX2 kernels
+// of mvlineasm4() and tvlineasm1() do those fetches with gathers as well. Each
+// kernel draws whole batches of rows and leaves the rest to the C loop.
+#if defined EDUKE32_CPU_X86 && (defined __GNUC__ || defined _MSC_VER)
+# define A_C_SIMD_SSE2
+# include <immintrin.h>
+# ifdef __GNUC__
+#  define A_C_TARGET_SSE2 __attribute__((target("sse2")))
+#  define A_C_TARGET_AVX2 __attribute__((target("avx2")))
+# else
+#  define A_C_TARGET_SSE2
+#  define A_C_TARGET_AVX2
+# endif
+# define A_C_TARGET_SIMD A_C_TARGET_SSE2
+#elif defined EDUKE32_CPU_ARM && defined __ARM_NEON
+# define A_C_SIMD_NEON
+# include <arm_neon.h>
+# define A_C_TARGET_SIMD
+#endif
+
+#define BITSOFPRECISION 3
+#define BITSOFPRECISIONPOW 8
+
+// Compile code to saturate vplc for sprites to prevent stray lines at the
+// bottom of non-y-flipped ones?
+#define USE_SATURATE_VPLC
+// Also for translucent masks?
+//#define USE_SATURATE_VPLC_TRANS
+
+extern intptr_t asm1, asm2, asm3, asm4;
+extern int32_t globalx3, globaly3;
+
+static int32_t bpl, transmode = 0;
+static char *gbuf;
+static int32_t glogx, glogy;
+int32_t gpinc;
+static int32_t gbxinc, gbyinc;
+static char *gpal, *ghlinepal, *gtrans;
+static char *gpal2;
+
+//Global variable functions
+void setvlinebpl(int32_t dabpl) { bpl = dabpl;}
+void fixtransluscence(intptr_t datransoff)
+{
+    gtrans = (char *)datransoff;
+}
+void settransnormal(void) { transmode = 0; }
+void settransreverse(void) { transmode = 1; }
+
+static int32_t vlinekernel = VLINE_KERNEL_BEST;
+
+// Selects the column kernels, falling back to the best one available below the
+// requested one. Returns the kernel actually used.
+int32_t setvlinekernel(int32_t kernel)
+{
+#if defined A_C_SIMD_SSE2
+    if (kernel >= VLINE_KERNEL_AVX2 && cpu.features.avx2)
+        return vlinekernel = VLINE_KERNEL_AVX2;
+    if (kernel >= VLINE_KERNEL_SIMD && cpu.features.sse2)
+        return vlinekernel = VLINE_KERNEL_SIMD;
+#elif defined A_C_SIMD_NEON
+    if (kernel >= VLINE_KERNEL_SIMD)
+        return vlinekernel = VLINE_KERNEL_SIMD;
+#else
+    UNREFERENCED_PARAMETER(kernel);
+#endif
+
+    return vlinekernel = VLINE_KERNEL_C;
+}
+
+#if defined A_C_SIMD_SSE2
+static FORCE_INLINE bool vline_simd(void) { return vlinekernel >= VLINE_KERNEL_SIMD && cpu.features.sse2; }
+static FORCE_INLINE bool vline_avx2(void) { return vlinekernel >= VLINE_KERNEL_AVX2 && cpu.features.avx2; }
+
+typedef __m128i vline4_t;
+
+A_C_TARGET_SSE2 static FORCE_INLINE vline4_t vline4_set(uint32_t a, uint32_t b, uint32_t c, uint32_t d) { return _mm_setr_epi32(a, b, c, d); }
+A_C_TARGET_SSE2 static FORCE_INLINE vline4_t vline4_dup(uint32_t a) { return _mm_set1_epi32(a); }
+A_C_TARGET_SSE2 static FORCE_INLINE vline4_t vline4_load(const void *p) { return _mm_loadu_si128((__m128i const *)p); }
+A_C_TARGET_SSE2 static FORCE_INLINE void vline4_store(void *p, vline4_t a) { _mm_storeu_si128((__m128i *)p, a); }
+A_C_TARGET_SSE2 static FORCE_INLINE vline4_t vline4_add(vline4_t a, vline4_t b) { return _mm_add_epi32(a, b); }
+A_C_TARGET_SSE2 static FORCE_INLINE vline4_t vline4_shr(vline4_t a, int32_t n) { return _mm_srl_epi32(a, _mm_cvtsi32_si128(n)); }
+A_C_TARGET_SSE2 static FORCE_INLINE vline4_t vline4_shl(vline4_t a, int32_t n) { return _mm_sll_epi32(a, _mm_cvtsi32_si128(n)); }
+A_C_TARGET_SSE2 static FORCE_INLINE vline4_t vline4_sar(vline4_t a, int32_t n) { return _mm_sra_epi32(a, _mm_cvtsi32_si128(n)); }
+
+// low halves of the 32x32 products, SSE2 has no _mm_mullo_epi32()
+A_C_TARGET_SSE2 static FORCE_INLINE vline4_t vline4_mul(vline4_t a, vline4_t b)
+{
+    __m128i const even = _mm_mul_epu32(a, b);
+    __m128i const odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+    return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)), _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+}
+
+// ourmulscale32() on all four lanes: high halves of the 32x32->64 products
+A_C_TARGET_SSE2 static FORCE_INLINE vline4_t vline4_mulscale32(vline4_t a, vline4_t b)
+{
+    __m128i const even = _mm_srli_epi64(_mm_mul_epu32(a, b), 32);
+    __m128i const odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), b);
+    return _mm_or_si128(even, _mm_and_si128(odd, _mm_set_epi32(-1, 0, -1, 0)));
+}
+
+// vplc |= saturate & -(vplc < vinc), unsigned. SSE2 only compares signed, so both sides are biased.
+A_C_TARGET_SSE2 static FORCE_INLINE vline4_t vline4_saturate(vline4_t vplc, vline4_t vinc, vline4_t saturate)
+{
+    __m128i const bias = _mm_set1_epi32(INT32_MIN);
+    return _mm_or_si128(vplc, _mm_and_si128(saturate, _mm_cmpgt_epi32(_mm_xor_si128(vinc, bias), _mm_xor_si128(vplc, bias))));
+}
+
+// 0xff in every byte of the four texels that is 255 (transparent)
+A_C_TARGET_SSE2 static FORCE_INLINE uint32_t vline4_transmask(uint32_t tex)
+{
+    return _mm_cvtsi128_si32(_mm_cmpeq_epi8(_mm_cvtsi32_si128(tex), _mm_set1_epi8((char)255)));
+}
+
+// Translucency table indices of four pixels: (dst<<8)|col, or dst|(col<<8) when reversed
+A_C_TARGET_SSE2 static FORCE_INLINE void vline4_blendindex(uint16_t *idx, uint32_t dst, uint32_t col, int32_t reverse)
+{
+    __m128i const d = _mm_cvtsi32_si128(dst), c = _mm_cvtsi32_si128(col);
+    _mm_storel_epi64((__m128i *)idx, reverse ? _mm_unpacklo_epi8(d, c) : _mm_unpacklo_epi8(c, d));
+}
+#elif defined A_C_SIMD_NEON
+static FORCE_INLINE bool vline_simd(void) { return vlinekernel >= VLINE_KERNEL_SIMD; }
+
+typedef uint32x4_t vline4_t;
+
+static FORCE_INLINE vline4_t vline4_set(uint32_t a, uint32_t b, uint32_t c, uint32_t d)
+{
+    uint32_t const v[4] = { a, b, c, d };
+    return vld1q_u32(v);
+}
+static FORCE_INLINE vline4_t vline4_dup(uint32_t a) { return vdupq_n_u32(a); }
+static FORCE_INLINE vline4_t vline4_load(const void *p) { return vld1q_u32((uint32_t const *)p); }
+static FORCE_INLINE void vline4_store(void *p, vline4_t a) { vst1q_u32((uint32_t *)p, a); }
+static FORCE_INLINE vline4_t vline4_add(vline4_t a, vline4_t b) { return vaddq_u32(a, b); }
+static FORCE_INLINE vline4_t vline4_shr(vline4_t a, int32_t n) { return vshlq_u32(a, vdupq_n_s32(-n)); }
+static FORCE_INLINE vline4_t vline4_shl(vline4_t a, int32_t n) { return vshlq_u32(a, vdupq_n_s32(n)); }
+static FORCE_INLINE vline4_t vline4_sar(vline4_t a, int32_t n) { return vreinterpretq_u32_s32(vshlq_s32(vreinterpretq_s32_u32(a), vdupq_n_s32(-n))); }
+static FORCE_INLINE vline4_t vline4_mul(vline4_t a, vline4_t b) { return vmulq_u32(a, b); }
+
+static FORCE_INLINE vline4_t vline4_mulscale32(vline4_t a, vline4_t b)
+{
+    uint32x2_t const lo = vshrn_n_u64(vmull_u32(vget_low_u32(a), vget_low_u32(b)), 32);
+    uint32x2_t const hi = vshrn_n_u64(vmull_u32(vget_high_u32(a), vget_high_u32(b)), 32);
+    return vcombine_u32(lo, hi);
+}
+
+static FORCE_INLINE vline4_t vline4_saturate(vline4_t vplc, vline4_t vinc, vline4_t saturate)
+{
+    return vorrq_u32(vplc, vandq_u32(saturate, vcltq_u32(vplc, vinc)));
+}
+
+static FORCE_INLINE uint32_t vline4_transmask(uint32_t tex)
+{
+    return vget_lane_u32(vreinterpret_u32_u8(vceq_u8(vreinterpret_u8_u32(vdup_n_u32(tex)), vdup_n_u8(255))), 0);
+}
+
+static FORCE_INLINE void vline4_blendindex(uint16_t *idx, uint32_t dst, uint32_t col, int32_t reverse)
+{
+    uint8x8_t const d = vreinterpret_u8_u32(vdup_n_u32(dst)), c = vreinterpret_u8_u32(vdup_n_u32(col));
+    vst1_u16(idx, vreinterpret_u16_u8((reverse ? vzip_u8(d, c) : vzip_u8(c, d)).val[0]));
+}
+#endif
+
+#if defined A_C_SIMD_SSE2 || defined A_C_SIMD_NEON
+// Texel row of each lane: vplc>>logy, or ourmulscale32(vplc, tilesizy) for
+// non-power-of-two tiles (logy == 0)
+A_C_TARGET_SIMD static FORCE_INLINE vline4_t vline4_texrow(vline4_t vplc, int32_t logy, vline4_t tilesizy)
+{
+    return logy ? vline4_shr(vplc, logy) : vline4_mulscale32(vplc, tilesizy);
+}
+
+// Blends the opaque ones of four texels into their destination pixels through the translucency table
+A_C_TARGET_SIMD static FORCE_INLINE void vline4_blend(char *const *dst, const char *const *pal, const char *trans, const uint8_t *tex,
+                                                      uint32_t transmask, int32_t reverse)
+{
+    uint8_t const col[4] = { (uint8_t)pal[0][tex[0]], (uint8_t)pal[1][tex[1]], (uint8_t)pal[2][tex[2]], (uint8_t)pal[3][tex[3]] };
+    uint8_t const old[4] = { (uint8_t)*dst[0], (uint8_t)*dst[1], (uint8_t)*dst[2], (uint8_t)*dst[3] };
+    uint32_t col32, old32;
+    uint16_t idx[4];
+    uint8_t mask[4];
+
+    Bmemcpy(&col32, col, sizeof(uint32_t));
+    Bmemcpy(&old32, old, sizeof(uint32_t));
+    Bmemcpy(mask, &transmask, sizeof(uint32_t));
+    vline4_blendindex(idx, old32, col32, reverse);
+
+    for (int z = 0; z < 4; z++)
+        if (!mask[z])
+            *dst[z] = trans[idx[z]];
+}
+#endif
+
+#ifdef A_C_SIMD_SSE2
+// AVX2 only gathers dwords, so each lane fetches the aligned dword holding its
+// byte. That never reaches into another page and cannot fault, even for the
+// last byte of a tile or palookup allocation.
+A_C_TARGET_AVX2 static FORCE_INLINE __m256i vline8_gather_avx2(const char *base, __m256i idx)
+{
+    __m256i const three = _mm256_set1_epi32(3);
+    __m256i const ofs = _mm256_add_epi32(idx, _mm256_set1_epi32((int32_t)((intptr_t)base & 3)));
+    __m256i const words = _mm256_i32gather_epi32((int const *)((intptr_t)base & ~(intptr_t)3), _mm256_andnot_si256(three, ofs), 1);
+    return _mm256_and_si256(_mm256_srlv_epi32(words, _mm256_slli_epi32(_mm256_and_si256(ofs, three), 3)), _mm256_set1_epi32(255));
+}
+
+// Same for four lanes with a pointer of their own each
+A_C_TARGET_AVX2 static FORCE_INLINE __m128i vline4_gather_avx2(__m256i addr)
+{
+    __m256i const three = _mm256_set1_epi64x(3);
+    __m128i const words = _mm256_i64gather_epi32((int const *)NULL, _mm256_andnot_si256(three, addr), 1);
+    __m128i const ofs = _mm256_castsi256_si128(_mm256_permutevar8x32_epi32(_mm256_and_si256(addr, three), _mm256_setr_epi32(0, 2, 4, 6, 0, 2, 4, 6)));
+    return _mm_and_si128(_mm_srlv_epi32(words, _mm_slli_epi32(ofs, 3)), _mm_set1_epi32(255));
+}
+#endif
+
+
+///// Ceiling/floor horizontal line functions /////
+
+void sethlinesizes(int32_t logx, int32_t logy, intptr_t bufplc)
+{ glogx = logx; glogy = logy; gbuf = (char *)bufplc; }
+void setpalookupaddress(char *paladdr) { ghlinepal = paladdr; }
+void setuphlineasm4(int32_t bxinc, int32_t byinc) { gbxinc = bxinc; gbyinc = byinc; }
+void hlineasm4(bssize_t cnt, int32_t skiploadincs, int32_t paloffs, uint32_t by, uint32_t bx, intptr_t p)
+{
+    Bassert(gbuf);
+
+    if (!skiploadincs) { gbxinc = asm1; gbyinc = asm2; }
+
+    const char *const A_C_RESTRICT palptr = &ghlinepal[paloffs];
+    const char *const A_C_RESTRICT buf = gbuf;
+    const vec2_t inc = { gbxinc, gbyinc };
+    const vec2_t log = { glogx, glogy };
+    const vec2_t log32 = { 32-log.x, 32-log.y };
+    char *pp = (char *)p;
+
+#ifdef CLASSIC_SLICE_BY_4
+    for (; cnt>=4; cnt-=4, pp-=4)
+    {
+#if 1
+        *pp = palptr[buf[((bx>>log32.x)<<log.y)+(by>>log32.y)]];
+        *(pp-1) = palptr[buf[(((bx-inc.x)>>log32.x)<<log.y)+((by-inc.y)>>log32.y)]];
+        *(pp-2) = palptr[buf[(((bx-(inc.x<<1))>>log32.x)<<log.y)+((by-(inc.y<<1))>>log32.y)]];
+        *(pp-3) = palptr[buf[(((bx-(inc.x*3))>>log32.x)<<log.y)+((by-(inc.y*3))>>log32.y)]];
+#else
+        *(int32_t *)(pp-3) = palptr[buf[(((bx-(inc.x*3))>>log32.x)<<log.y)+((by-(inc.y*3))>>log32.y)]] +
+            (palptr[buf[(((bx-(inc.x<<1))>>log32.x)<<log.y)+((by-(inc.y<<1))>>log32.y)]]<<8) +
+            (palptr[buf[(((bx-inc.x)>>log32.x)<<log.y)+((by-inc.y)>>log32.y)]]<<16) +
+            (palptr[buf[((bx>>log32.x)<<log.y)+(by>>log32.y)]]<<24);
+#endif
+        bx -= inc.x<<2;
+        by -= inc.y<<2;
+    }
+#endif
+
+    for (; cnt>=0; cnt--, pp--)
+    {
+        *pp = palptr[buf[((bx>>log32.x)<<log.y)+(by>>log32.y)]];
+        bx -= inc.x;
+        by -= inc.y;
+    }
+}
+
+
+///// Sloped ceiling/floor vertical line functions /////
+#if defined A_C_SIMD_SSE2 || defined A_C_SIMD_NEON
+// Draws the first cnt&~3 pixels and returns how many were drawn
+A_C_TARGET_SIMD static bssize_t slopevlin_simd(char *p, const intptr_t *slopalptr, bssize_t cnt, int32_t bz, int32_t bzinc, int32_t bx, int32_t by)
+{
+    vline4_t bz4 = vline4_set(bz, bz + bzinc, bz + (uint32_t)bzinc*2, bz + (uint32_t)bzinc*3);
+    vline4_t const bzinc4 = vline4_dup((uint32_t)bzinc << 2);
+    vline4_t const half = vline4_dup(HALFSLOPTABLESIZ);
+    vline4_t const xtou = vline4_dup(globalx3), ytov = vline4_dup(globaly3);
+    vline4_t const bx4 = vline4_dup(bx), by4 = vline4_dup(by);
+    const char *const A_C_RESTRICT buf = gbuf;
+    int32_t const logx = glogx, logy = glogy, pinc = gpinc;
+    int32_t slop[4];
+    uint32_t idx[4];
+    bssize_t const n = cnt & ~3;
+
+    for (cnt = n; cnt > 0; cnt -= 4)
+    {
+        vline4_store(slop, vline4_add(vline4_sar(bz4, 6), half));
+
+        vline4_t const i = vline4_set(sloptable[slop[0]], sloptable[slop[1]], sloptable[slop[2]], sloptable[slop[3]]);
+        vline4_t const u = vline4_add(bx4, vline4_mul(xtou, i));
+        vline4_t const v = vline4_add(by4, vline4_mul(ytov, i));
+
+        vline4_store(idx, vline4_add(vline4_shl(vline4_shr(u, 32-logx), logy), vline4_shr(v, 32-logy)));
+
+        p[0]      = *(char *)(slopalptr[0] + buf[idx[0]]);
+        p[pinc]   = *(char *)(slopalptr[-1] + buf[idx[1]]);
+        p[pinc*2] = *(char *)(slopalptr[-2] + buf[idx[2]]);
+        p[pinc*3] = *(char *)(slopalptr[-3] + buf[idx[3]]);
+
+        bz4 = vline4_add(bz4, bzinc4);
+        slopalptr -= 4;
+        p += pinc*4;
+    }
+
+    return n;
+}
+#endif
+
+void slopevlin(intptr_t p, int32_t i, intptr_t slopaloffs, bssize_t cnt, int32_t bx, int32_t by)
+{
+    intptr_t * A_C_RESTRICT slopalptr;
+    int32_t bz, bzinc;
+    uint32_t u, v;
+
+    bz = asm3; bzinc = (asm1>>3);
+    slopalptr = (intptr_t *)slopaloffs;
+
+#if defined A_C_SIMD_SSE2 || defined A_C_SIMD_NEON
+    // shifts by 32 are undefined in C, so a zero logx or logy keeps to the C loop
+    if (vline_simd() && glogx && glogy)
+    {
+        bssize_t const n = slopevlin_simd((char *)p, slopalptr, cnt, bz, bzinc, bx, by);
+        p += n*gpinc;
+        slopalptr -= n;
+        bz += n*bzinc;
+        cnt -= n;
+    }
+#endif
+
+    for (; cnt>0; cnt--)
+    {
+        i = (sloptable[(bz>>6)+HALFSLOPTABLESIZ]); bz += bzinc;
+        u = bx+(inthi_t)globalx3*i;
+        v = by+(inthi_t)globaly3*i;
+        (*(char *)p) = *(char *)(((intptr_t)slopalptr[0])+gbuf[((u>>(32-glogx))<<glogy)+(v>>(32-glogy))]);
+        slopalptr--;
+        p += gpinc;
+    }
+}
+
+
+///// Wall,face sprite/wall sprite vertical line functions /////
+
+
+extern int32_t globaltilesizy;
+
+static inline uint32_t ourmulscale32(uint32_t a, uint32_t b)
+{
+    return ((uint64_t)a*b)>>32;
+}
+
+static inline int32_t getpix(int32_t logy, const char *buf, uint32_t vplc)
+{
+    return logy ? buf[vplc>>logy] : buf[ourmulscale32(vplc,globaltilesizy)];
+}
+
+void setupvlineasm(int32_t neglogy) { glogy = neglogy; }
+// cnt+1 loop iterations!
+// The shift and tile height are passed explicitly so that spans recorded with
+// different textures can be filled later, on any thread.
+int32_t vlineasm1_ex(int32_t vinc, intptr_t paloffs, bssize_t cnt, uint32_t vplc, intptr_t bufplc, intptr_t p, int32_t logy, int32_t tilesizy)
+{
+    const char *const A_C_RESTRICT buf = (char *)bufplc;
+    const char *const A_C_RESTRICT pal = (char *)paloffs;
+    const int32_t ourbpl = bpl;
+    char *pp = (char *)p;
+
+    cnt++;
+
+    if (logy)
+    {
+#ifdef CLASSIC_SLICE_BY_4
+        for (; cnt>=4; cnt-=4)
+        {
+            *pp = pal[buf[vplc>>logy]];
+            *(pp+ourbpl) = pal[buf[(vplc+vinc)>>logy]];
+            *(pp+(ourbpl<<1)) = pal[buf[(vplc+(vinc<<1))>>logy]];
+            *(pp+(ourbpl*3)) = pal[buf[(vplc+(vinc*3))>>logy ]];
+            pp += ourbpl<<2;
+            vplc += vinc<<2;
+        }
+#endif
+        while (cnt--)
+        {
+            *pp = pal[buf[vplc>>logy]];
+            pp += ourbpl;
+            vplc += vinc;
+        }
+    }
+    else
+    {
+#ifdef CLASSIC_SLICE_BY_4
+        for (; cnt>=4; cnt-=4)
+        {
+            *pp = pal[buf[ourmulscale32(vplc, tilesizy)]];
+            *(pp+ourbpl) = pal[buf[ourmulscale32((vplc+vinc),tilesizy)]];
+            *(pp+(ourbpl<<1)) = pal[buf[ourmulscale32((vplc+(vinc<<1)), tilesizy)]];
+            *(pp+(ourbpl*3)) = pal[buf[ourmulscale32((vplc+(vinc*3)), tilesizy)]];
+            pp += ourbpl<<2;
+            vplc += vinc<<2;
+        }
+#endif
+        while (cnt--)
+        {
+            *pp = pal[buf[ourmulscale32(vplc,tilesizy)]], pp += ourbpl;
+            vplc += vinc;
+        }
+    }
+    return vplc;
+}
+
+// cnt+1 loop iterations!
+int32_t vlineasm1(int32_t vinc, intptr_t paloffs, bssize_t cnt, uint32_t vplc, intptr_t bufplc, intptr_t p)
+{
+    return vlineasm1_ex(vinc, paloffs, cnt, vplc, bufplc, p, glogy, globaltilesizy);
+}
+
+
+extern intptr_t palookupoffse[4];
+extern uint32_t vplce[4];
+extern int32_t vince[4];
+extern intptr_t bufplce[4];
+
+#if (EDUKE32_GCC_PREREQ(4,7) || __has_extension(attribute_ext_vector_type)) && defined BITNESS64
+// XXX: The "Ubuntu clang version 3.5-1ubuntu1 (trunk) (based on LLVM 3.5)"
+// does not compile us with USE_VECTOR_EXT. Maybe a newer one does?
+# if !defined __clang__
+#  define USE_VECTOR_EXT
+# endif
+#endif
+
+#ifdef USE_VECTOR_EXT
+typedef uint32_t uint32_vec4 __attribute__ ((vector_size (16)));
+#endif
+
+#ifdef USE_SATURATE_VPLC
+# define saturate_vplc(vplc, vinc) vplc |= g_saturate & -(vplc < (uint32_t)vinc)
+// NOTE: the vector types yield -1 for logical "true":
+# define saturate_vplc_vec(vplc, vinc) vplc |= g_saturate & (vplc < vinc)
+# ifdef USE_SATURATE_VPLC_TRANS
+#  define saturate_vplc_trans(vplc, vinc) saturate_vplc(vplc, vinc)
+# else
+#  define saturate_vplc_trans(vplc, vinc)
+# endif
+#else
+# define saturate_vplc(vplc, vinc)
+# define saturate_vplc_vec(vplc, vinc)
+# define saturate_vplc_trans(vplc, vinc)
+#endif
+
+#ifdef CLASSIC_NONPOW2_YSIZE_WALLS
+// cnt >= 1
+static void vlineasm4nlogy(bssize_t cnt, char *p, char *const A_C_RESTRICT * pal, char *const A_C_RESTRICT * buf,
+# ifdef USE_VECTOR_EXT
+    uint32_vec4 vplc, const uint32_vec4 vinc,
+# else
+    uint32_t * vplc, const int32_t *vinc,
+# endif
+    uint32_t *vplcout, int32_t tilesizy)
+{
+    const int32_t ourbpl = bpl;
+
+    do
+    {
+        p[0] = pal[0][buf[0][ourmulscale32(vplc[0], tilesizy)]];
+        p[1] = pal[1][buf[1][ourmulscale32(vplc[1], tilesizy)]];
+        p[2] = pal[2][buf[2][ourmulscale32(vplc[2], tilesizy)]];
+        p[3] = pal[3][buf[3][ourmulscale32(vplc[3], tilesizy)]];
+
+# if defined USE_VECTOR_EXT
+        vplc += vinc;
+# else
+        vplc[0] += vinc[0];
+        vplc[1] += vinc[1];
+        vplc[2] += vinc[2];
+        vplc[3] += vinc[3];
+# endif
+        p += ourbpl;
+    } while (--cnt);
+
+    Bmemcpy(vplcout, &vplc[0], sizeof(uint32_t) * 4);
+}
+#endif
+
+// cnt >= 1
+// Column state is passed explicitly so that several threads can fill disjoint
+// column bands at once; vplcs is updated with the final texture coordinates.
+void vlineasm4_ex(bssize_t cnt, char *p, const intptr_t *paloffs, const intptr_t *bufplcs, uint32_t *vplcs, const int32_t *vincs,
+                  int32_t logy, int32_t tilesizy)
+{
+    char * const A_C_RESTRICT pal[4] = {(char *)paloffs[0], (char *)paloffs[1], (char *)paloffs[2], (char *)paloffs[3]};
+    char * const A_C_RESTRICT buf[4] = {(char *)bufplcs[0], (char *)bufplcs[1], (char *)bufplcs[2], (char *)bufplcs[3]};
+#ifdef USE_VECTOR_EXT
+    uint32_vec4 vinc = {(uint32_t)vincs[0], (uint32_t)vincs[1], (uint32_t)vincs[2], (uint32_t)vincs[3]};
+    uint32_vec4 vplc = {vplcs[0], vplcs[1], vplcs[2], vplcs[3]};
+#else
+    const int32_t vinc[4] = {vincs[0], vincs[1], vincs[2], vincs[3]};
+    uint32_t vplc[4] = {vplcs[0], vplcs[1], vplcs[2], vplcs[3]};
+#endif
+    const int32_t ourbpl = bpl;
+
+#ifdef CLASSIC_NONPOW2_YSIZE_WALLS
+    if (EDUKE32_PREDICT_FALSE(!logy))
+    {
+        // This should only happen when 'globalshiftval = 0' has been set in engine.c.
+        vlineasm4nlogy(cnt, p, pal, buf, vplc, vinc, vplcs, tilesizy);
+        return;
+    }
+#else
+    assert(logy);
+#endif
+
+    // just fucking shoot me
+#ifdef CLASSIC_SLICE_BY_4
+    for (; cnt>=4;cnt-=4)
+    {
+        p[0]                = pal[0][buf[0][ vplc[0]>>logy ]];
+        p[1]                = pal[1][buf[1][ vplc[1]>>logy ]];
+        p[2]                = pal[2][buf[2][ vplc[2]>>logy ]];
+        p[3]                = pal[3][buf[3][ vplc[3]>>logy ]];
+        (p+ourbpl)[0]       = pal[0][buf[0][ (vplc[0]+vinc[0])>>logy ]];
+        (p+ourbpl)[1]       = pal[1][buf[1][ (vplc[1]+vinc[1])>>logy ]];
+        (p+ourbpl)[2]       = pal[2][buf[2][ (vplc[2]+vinc[2])>>logy ]];
+        (p+ourbpl)[3]       = pal[3][buf[3][ (vplc[3]+vinc[3])>>logy ]];
+        (p+(ourbpl<<1))[0]  = pal[0][buf[0][ (vplc[0]+(vinc[0]<<1))>>logy ]];
+        (p+(ourbpl<<1))[1]  = pal[1][buf[1][ (vplc[1]+(vinc[1]<<1))>>logy ]];
+        (p+(ourbpl<<1))[2]  = pal[2][buf[2][ (vplc[2]+(vinc[2]<<1))>>logy ]];
+        (p+(ourbpl<<1))[3]  = pal[3][buf[3][ (vplc[3]+(vinc[3]<<1))>>logy ]];
+        (p+(ourbpl*3))[0]   = pal[0][buf[0][ (vplc[0]+(vinc[0]*3))>>logy ]];
+        (p+(ourbpl*3))[1]   = pal[1][buf[1][ (vplc[1]+(vinc[1]*3))>>logy ]];
+        (p+(ourbpl*3))[2]   = pal[2][buf[2][ (vplc[2]+(vinc[2]*3))>>logy ]];
+        (p+(ourbpl*3))[3]   = pal[3][buf[3][ (vplc[3]+(vinc[3]*3))>>logy ]];
+
+#if defined USE_VECTOR_EXT
+        vplc += vinc<<2;
+#else
+        vplc[0] += vinc[0]<<2;
+        vplc[1] += vinc[1]<<2;
+        vplc[2] += vinc[2]<<2;
+        vplc[3] += vinc[3]<<2;
+#endif
+        p += ourbpl<<2;
+    }
+#endif
+
+    while (cnt--)
+    {
+        p[0] = pal[0][buf[0][vplc[0]>>logy]];
+        p[1] = pal[1][buf[1][vplc[1]>>logy]];
+        p[2] = pal[2][buf[2][vplc[2]>>logy]];
+        p[3] = pal[3][buf[3][vplc[3]>>logy]];
+
+#if defined USE_VECTOR_EXT
+        vplc += vinc;
+#else
+        vplc[0] += vinc[0];
+        vplc[1] += vinc[1];
+        vplc[2] += vinc[2];
+        vplc[3] += vinc[3];
+#endif
+        p += ourbpl;
+    }
+
+    Bmemcpy(vplcs, &vplc[0], sizeof(uint32_t) * 4);
+}
+
+// cnt >= 1
+void vlineasm4(bssize_t cnt, char *p)
+{
+    vlineasm4_ex(cnt, p, palookupoffse, bufplce, vplce, vince, glogy, globaltilesizy);
+}
+
+#ifdef USE_SATURATE_VPLC
+static int32_t g_saturate;  // -1 if saturating vplc is requested, 0 else
+# define set_saturate(dosaturate) g_saturate = -(int)!!dosaturate
+#else
+# define set_saturate(dosaturate) UNREFERENCED_PARAMETER(dosaturate)
+#endif
+
+void setupmvlineasm(int32_t neglogy, int32_t dosaturate)
+{
+    glogy = neglogy;
+    set_saturate(dosaturate);
+}
+
+// cnt+1 loop iterations!
+int32_t mvlineasm1(int32_t vinc, intptr_t paloffs, bssize_t cnt, uint32_t vplc, intptr_t bufplc, intptr_t p)
+{
+    char ch;
+
+    const char *const A_C_RESTRICT buf = (char *)bufplc;
+    const char *const A_C_RESTRICT pal = (char *)paloffs;
+    const int32_t logy = glogy, ourbpl = bpl;
+    char *pp = (char *)p;
+
+    cnt++;
+
+    if (!logy)
+    {
+        do
+        {
+            ch = buf[ourmulscale32(vplc,globaltilesizy)];
+            if (ch != 255) *pp = pal[ch];
+            pp += ourbpl;
+            vplc += vinc;
+            saturate_vplc(vplc, vinc);
+        }
+        while (--cnt);
+
+        return vplc;
+    }
+
+    do
+    {
+
+        if (buf[vplc>>logy] != 255)
+            *pp = pal[buf[vplc>>logy]];
+        pp += ourbpl;
+        vplc += vinc;
+        saturate_vplc(vplc, vinc);
+    }
+    while (--cnt);
+
+    return vplc;
+}
+
+// cnt >= 1
+static void mvlineasm4_c(bssize_t cnt, char *p)
+{
+    char *const A_C_RESTRICT pal[4] = {(char *)palookupoffse[0], (char *)palookupoffse[1], (char *)palookupoffse[2], (char *)palookupoffse[3]};
+    char *const A_C_RESTRICT buf[4] = {(char *)bufplce[0], (char *)bufplce[1], (char *)bufplce[2], (char *)bufplce[3]};
+#ifdef USE_VECTOR_EXT
+    uint32_vec4 vinc = {(uint32_t)vince[0], (uint32_t)vince[1], (uint32_t)vince[2], (uint32_t)vince[3]};
+    uint32_vec4 vplc = {vplce[0], vplce[1], vplce[2], vplce[3]};
+#else
+    const int32_t vinc[4] = {vince[0], vince[1], vince[2], vince[3]};
+    uint32_t vplc[4] = {vplce[0], vplce[1], vplce[2], vplce[3]};
+#endif
+    const int32_t logy = glogy, ourbpl = bpl;
+    char ch;
+
+    if (logy)
+    {
+        do
+        {
+            ch = buf[0][vplc[0]>>logy];
+            if (ch != 255) p[0] = pal[0][ch];
+            ch = buf[1][vplc[1]>>logy];
+            if (ch != 255) p[1] = pal[1][ch];
+            ch = buf[2][vplc[2]>>logy];
+            if (ch != 255) p[2] = pal[2][ch];
+            ch = buf[3][vplc[3]>>logy];
+            if (ch != 255) p[3] = pal[3][ch];
+
+#if !defined USE_VECTOR_EXT
+            vplc[0] += vinc[0];
+            vplc[1] += vinc[1];
+            vplc[2] += vinc[2];
+            vplc[3] += vinc[3];
+            saturate_vplc(vplc[0], vinc[0]);
+            saturate_vplc(vplc[1], vinc[1]);
+            saturate_vplc(vplc[2], vinc[2]);
+            saturate_vplc(vplc[3], vinc[3]);
+#else
+            vplc += vinc;
+            saturate_vplc_vec(vplc, vinc);
+#endif
+            p += ourbpl;
+        }
+        while (--cnt);
+    }
+    else
+    {
+        do
+        {
+            ch = buf[0][ourmulscale32(vplc[0],globaltilesizy)];
+            if (ch != 255) p[0] = pal[0][ch];
+            ch = buf[1][ourmulscale32(vplc[1],globaltilesizy)];
+            if (ch != 255) p[1] = pal[1][ch];
+            ch = buf[2][ourmulscale32(vplc[2],globaltilesizy)];
+            if (ch != 255) p[2] = pal[2][ch];
+            ch = buf[3][ourmulscale32(vplc[3],globaltilesizy)];
+            if (ch != 255) p[3] = pal[3][ch];
+
+#if !defined USE_VECTOR_EXT
+            vplc[0] += vinc[0];
+            vplc[1] += vinc[1];
+            vplc[2] += vinc[2];
+            vplc[3] += vinc[3];
+            saturate_vplc(vplc[0], vinc[0]);
+            saturate_vplc(vplc[1], vinc[1]);
+            saturate_vplc(vplc[2], vinc[2]);
+            saturate_vplc(vplc[3], vinc[3]);
+#else
+            vplc += vinc;
+            saturate_vplc_vec(vplc, vinc);
+#endif
+            p += ourbpl;
+        }
+        while (--cnt);
+    }
+
+    Bmemcpy(&vplce[0], &vplc[0], sizeof(uint32_t) * 4);
+}
+
+#if defined A_C_SIMD_SSE2 || defined A_C_SIMD_NEON
+// Fetches one row of texels for the four columns and writes the opaque ones
+// with a single 32-bit read-modify-write instead of four conditional stores.
+// transmask has 0xff in every byte whose texel is 255 (transparent).
+static FORCE_INLINE void mvline4_texels(char *const A_C_RESTRICT * buf, const uint32_t *idx, uint8_t *tex)
+{
+    tex[0] = buf[0][idx[0]];
+    tex[1] = buf[1][idx[1]];
+    tex[2] = buf[2][idx[2]];
+    tex[3] = buf[3][idx[3]];
+}
+
+static FORCE_INLINE void mvline4_write(char *p, uint32_t src, uint32_t transmask)
+{
+    uint32_t dst;
+
+    Bmemcpy(&dst, p, sizeof(uint32_t));
+    dst = (dst & transmask) | (src & ~transmask);
+    Bmemcpy(p, &dst, sizeof(uint32_t));
+}
+
+static FORCE_INLINE void mvline4_store(char *p, char *const A_C_RESTRICT * pal, const uint8_t *tex, uint32_t transmask)
+{
+    uint8_t const col[4] = { (uint8_t)pal[0][tex[0]], (uint8_t)pal[1][tex[1]], (uint8_t)pal[2][tex[2]], (uint8_t)pal[3][tex[3]] };
+    uint32_t src;
+
+    Bmemcpy(&src, col, sizeof(uint32_t));
+    mvline4_write(p, src, transmask);
+}
+
+A_C_TARGET_SIMD static void mvlineasm4_simd(bssize_t cnt, char *p, char *const A_C_RESTRICT * pal, char *const A_C_RESTRICT * buf,
+                                            uint32_t *vplcs, const int32_t *vincs, int32_t logy, int32_t ourbpl)
+{
+    vline4_t vplc = vline4_load(vplcs);
+    vline4_t const vinc = vline4_load(vincs);
+    vline4_t const tilesizy = vline4_dup(globaltilesizy);
+#ifdef USE_SATURATE_VPLC
+    vline4_t const saturate = vline4_dup(g_saturate);
+#endif
+    uint32_t idx[4];
+    uint8_t tex[4];
+    uint32_t tex32;
+
+    do
+    {
+        vline4_store(idx, vline4_texrow(vplc, logy, tilesizy));
+        mvline4_texels(buf, idx, tex);
+        Bmemcpy(&tex32, tex, sizeof(uint32_t));
+
+        uint32_t const transmask = vline4_transmask(tex32);
+
+        if (transmask != 0xffffffffu)
+            mvline4_store(p, pal, tex, transmask);
+
+        vplc = vline4_add(vplc, vinc);
+#ifdef USE_SATURATE_VPLC
+        vplc = vline4_saturate(vplc, vinc, saturate);
+#endif
+        p += ourbpl;
+    }
+    while (--cnt);
+
+    vline4_store(vplcs, vplc);
+}
+#endif
+
+#ifdef A_C_SIMD_SSE2
+A_C_TARGET_AVX2 static void mvlineasm4_avx2(bssize_t cnt, char *p, char *const A_C_RESTRICT * pal, char *const A_C_RESTRICT * buf,
+                                            uint32_t *vplcs, const int32_t *vincs, int32_t logy, int32_t ourbpl)
+{
+    __m256i const bufs = _mm256_setr_epi64x((intptr_t)buf[0], (intptr_t)buf[1], (intptr_t)buf[2], (intptr_t)buf[3]);
+    __m256i const pals = _mm256_setr_epi64x((intptr_t)pal[0], (intptr_t)pal[1], (intptr_t)pal[2], (intptr_t)pal[3]);
+    __m128i vplc = _mm_loadu_si128((__m128i const *)vplcs);
+    __m128i const vinc = _mm_loadu_si128((__m128i const *)vincs);
+    __m128i const tilesizy = _mm_set1_epi32(globaltilesizy);
+    __m128i const transparent = _mm_set1_epi32(255);
+    // low byte of each lane
+    __m128i const packbytes = _mm_setr_epi8(0, 4, 8, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+#ifdef USE_SATURATE_VPLC
+    __m128i const saturate = _mm_set1_epi32(g_saturate);
+#endif
+
+    do
+    {
+        __m128i const tex = vline4_gather_avx2(_mm256_add_epi64(bufs, _mm256_cvtepu32_epi64(vline4_texrow(vplc, logy, tilesizy))));
+        uint32_t const transmask = _mm_cvtsi128_si32(_mm_shuffle_epi8(_mm_cmpeq_epi32(tex, transparent), packbytes));
+
+        if (transmask != 0xffffffffu)
+        {
+            __m128i const col = vline4_gather_avx2(_mm256_add_epi64(pals, _mm256_cvtepu32_epi64(tex)));
+            mvline4_write(p, _mm_cvtsi128_si32(_mm_shuffle_epi8(col, packbytes)), transmask);
+        }
+
+        vplc = _mm_add_epi32(vplc, vinc);
+#ifdef USE_SATURATE_VPLC
+        vplc = vline4_saturate(vplc, vinc, saturate);
+#endif
+        p += ourbpl;
+    }
+    while (--cnt);
+
+    _mm_storeu_si128((__m128i *)vplcs, vplc);
+}
+#endif
+
+// cnt >= 1
+void mvlineasm4(bssize_t cnt, char *p)
+{
+#if defined A_C_SIMD_SSE2 || defined A_C_SIMD_NEON
+    char *const A_C_RESTRICT pal[4] = {(char *)palookupoffse[0], (char *)palookupoffse[1], (char *)palookupoffse[2], (char *)palookupoffse[3]};
+    char *const A_C_RESTRICT buf[4] = {(char *)bufplce[0], (char *)bufplce[1], (char *)bufplce[2], (char *)bufplce[3]};
+
+# ifdef A_C_SIMD_SSE2
+    if (vline_avx2())
+    {
+        mvlineasm4_avx2(cnt, p, pal, buf, vplce, vince, glogy, bpl);
+        return;
+    }
+# endif
+
+    if (vline_simd())
+    {
+        mvlineasm4_simd(cnt, p, pal, buf, vplce, vince, glogy, bpl);
+        return;
+    }
+#endif
+
+    mvlineasm4_c(cnt, p);
+}
+
+void setuptvlineasm(int32_t neglogy, int32_t dosaturate)
+{
+    glogy = neglogy;
+    set_saturate(dosaturate);
+}
+
+// The SIMD kernels below step vplc linearly, which saturating it would break
+#if (defined A_C_SIMD_SSE2 || defined A_C_SIMD_NEON) && !defined USE_SATURATE_VPLC_TRANS
+# define A_C_SIMD_TVLINE
+#endif
+
+#ifdef A_C_SIMD_TVLINE
+// Draws the first cnt&~3 pixels and returns how many were drawn
+A_C_TARGET_SIMD static bssize_t tvlineasm1_simd(int32_t vinc, const char *pal, bssize_t cnt, uint32_t vplc, const char *buf, char *p,
+                                                int32_t logy, int32_t ourbpl, int32_t reverse)
+{
+    vline4_t vplc4 = vline4_set(vplc, vplc + vinc, vplc + (uint32_t)vinc*2, vplc + (uint32_t)vinc*3);
+    vline4_t const vinc4 = vline4_dup((uint32_t)vinc << 2);
+    vline4_t const tilesizy = vline4_dup(globaltilesizy);
+    const char *const pals[4] = { pal, pal, pal, pal };
+    uint32_t idx[4];
+    uint8_t tex[4];
+    uint32_t tex32;
+    bssize_t const n = cnt & ~3;
+
+    for (cnt = n; cnt > 0; cnt -= 4)
+    {
+        vline4_store(idx, vline4_texrow(vplc4, logy, tilesizy));
+
+        uint8_t const shift = reverse<<3;
+        for (int z = 0; z < 4; z++)
+        {
+            uint8_t const ch = buf[idx[z]];
+            char *const d = p + ourbpl*z;
+            if (ch != 255) *d = gtrans[((uint8_t)*d<<(8-shift))|((uint8_t)pal[ch]<<shift)];
+        }
+
+        vplc4 = vline4_add(vplc4, vinc4);
+        p += ourbpl*4;
+    }
+
+    return n;
+}
+
+// Eight pixels at a time, with the texel, palookup, destination and translucency fetches gathered
+A_C_TARGET_AVX2 static bssize_t tvlineasm1_avx2(int32_t vinc, const char *pal, bssize_t cnt, uint32_t vplc, const char *buf, char *p,
+                                                int32_t logy, int32_t ourbpl, int32_t reverse)
+{
+    __m256i const lane = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    __m256i vplc8 = _mm256_add_epi32(_mm256_set1_epi32(vplc), _mm256_mullo_epi32(_mm256_set1_epi32(vinc), lane));
+    __m256i const vinc8 = _mm256_set1_epi32((uint32_t)vinc << 3);
+    __m256i const rows = _mm256_mullo_epi32(_mm256_set1_epi32(ourbpl), lane);
+    __m256i const tilesizy = _mm256_set1_epi32(globaltilesizy);
+    __m256i const transparent = _mm256_set1_epi32(255);
+    __m128i const dstshift = _mm_cvtsi32_si128(reverse ? 0 : 8), colshift = _mm_cvtsi32_si128(reverse ? 8 : 0);
+    __m128i const shift = _mm_cvtsi32_si128(logy);
+    uint32_t out[8];
+    bssize_t const n = cnt & ~7;
+
+    for (cnt = n; cnt > 0; cnt -= 8)
+    {
+        __m256i idx;
+
+        if (logy)
+            idx = _mm256_srl_epi32(vplc8, shift);
+        else
+        {
+            // ourmulscale32() on all eight lanes
+            __m256i const even = _mm256_srli_epi64(_mm256_mul_epu32(vplc8, tilesizy), 32);
+            __m256i const odd = _mm256_mul_epu32(_mm256_srli_epi64(vplc8, 32), tilesizy);
+            idx = _mm256_blend_epi32(even, odd, 0xAA);
+        }
+
+        __m256i const tex = vline8_gather_avx2(buf, idx);
+        int const transmask = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(tex, transparent)));
+
+        if (transmask != 0xff)
+        {
+            __m256i const col = vline8_gather_avx2(pal, tex);
+            __m256i const dst = vline8_gather_avx2(p, rows);
+            __m256i const blend = _mm256_or_si256(_mm256_sll_epi32(dst, dstshift), _mm256_sll_epi32(col, colshift));
+
+            _mm256_storeu_si256((__m256i *)out, vline8_gather_avx2(gtrans, blend));
+
+            for (int z = 0; z < 8; z++)
+                if (!(transmask & (1 << z)))
+                    p[ourbpl*z] = (char)out[z];
+        }
+
+        vplc8 = _mm256_add_epi32(vplc8, vinc8);
+        p += ourbpl*8;
+    }
+
+    return n;
+}
+#endif
+
+// cnt+1 loop iterations!
+int32_t tvlineasm1(int32_t vinc, intptr_t paloffs, bssize_t cnt, uint32_t vplc, intptr_t bufplc, intptr_t p)
+{
+    char ch;
+
+    const char *const A_C_RESTRICT buf = (char *)bufplc;
+    const char *const A_C_RESTRICT pal = (char *)paloffs;
+    const char *const A_C_RESTRICT trans = (char *)gtrans;
+    const int32_t logy = glogy, ourbpl = bpl, transm = transmode;
+    char *pp = (char *)p;
+
+    cnt++;
+
+#ifdef A_C_SIMD_TVLINE
+    if (vline_simd())
+    {
+        bssize_t n = 0;
+# ifdef A_C_SIMD_SSE2
+        if (vline_avx2())
+            n = tvlineasm1_avx2(vinc, pal, cnt, vplc, buf, pp, logy, ourbpl, transm);
+        else
+# endif
+            n = tvlineasm1_simd(vinc, pal, cnt, vplc, buf, pp, logy, ourbpl, transm);
+
+        vplc += n*vinc;
+        pp += n*ourbpl;
+        cnt -= n;
+
+        if (!cnt)
+            return vplc;
+    }
+#endif
+
+    uint8_t const shift = transm<<3;
+
+    do
+    {
+        ch = getpix(logy, buf, vplc);
+        if (ch != 255) *pp = trans[((*pp)<<(8-shift))|(pal[ch]<<shift)];
+        pp += ourbpl;
+        vplc += vinc;
+        saturate_vplc_trans(vplc, vinc);
+    }
+    while (--cnt);
+
+    return vplc;
+}
+
+void setuptvlineasm2(int32_t neglogy, intptr_t paloffs1, intptr_t paloffs2)
+{
+    glogy = neglogy;
+    gpal = (char *)paloffs1;
+    gpal2 = (char *)paloffs2;
+}
+
+#ifdef A_C_SIMD_TVLINE
+// Draws the first cnt&~1 rows of both columns, two rows at a time, and returns how many were drawn
+A_C_TARGET_SIMD static bssize_t tvlineasm2_simd(bssize_t cnt, uint32_t vplc1, int32_t vinc1, const char *buf1, uint32_t vplc2, int32_t vinc2,
+                                                const char *buf2, char *p, int32_t logy, int32_t ourbpl, int32_t reverse)
+{
+    vline4_t vplc4 = vline4_set(vplc1, vplc2, vplc1 + vinc1, vplc2 + vinc2);
+    vline4_t const vinc4 = vline4_set((uint32_t)vinc1 << 1, (uint32_t)vinc2 << 1, (uint32_t)vinc1 << 1, (uint32_t)vinc2 << 1);
+    vline4_t const tilesizy = vline4_dup(globaltilesizy);
+    const char *const pals[4] = { gpal, gpal2, gpal, gpal2 };
+    uint32_t idx[4];
+    uint8_t tex[4];
+    uint32_t tex32;
+    bssize_t const n = cnt & ~1;
+
+    for (cnt = n; cnt > 0; cnt -= 2)
+    {
+        vline4_store(idx, vline4_texrow(vplc4, logy, tilesizy));
+
+        tex[0] = buf1[idx[0]];
+        tex[1] = buf2[idx[1]];
+        tex[2] = buf1[idx[2]];
+        tex[3] = buf2[idx[3]];
+        Bmemcpy(&tex32, tex, sizeof(uint32_t));
+
+        uint32_t const transmask = vline4_transmask(tex32);
+
+        if (transmask != 0xffffffffu)
+        {
+            char *const dst[4] = { p, p + 1, p + ourbpl, p + ourbpl + 1 };
+            vline4_blend(dst, pals, gtrans, tex, transmask, reverse);
+        }
+
+        vplc4 = vline4_add(vplc4, vinc4);
+        p += ourbpl*2;
+    }
+
+    return n;
+}
+#endif
+
+// Pass: asm1=vinc2, asm2=pend
+// Return: asm1=vplc1, asm2=vplc2
+void tvlineasm2(uint32_t vplc2, int32_t vinc1, intptr_t bufplc1, intptr_t bufplc2, uint32_t vplc1, intptr_t p)
+{
+    char ch;
+
+    bssize_t cnt = tabledivide32(asm2-p-1, bpl);  // >= 1
+    const int32_t vinc2 = asm1;
+
+    const char *const A_C_RESTRICT buf1 = (char *)bufplc1;
+    const char *const A_C_RESTRICT buf2 = (char *)bufplc2;
+    const int32_t logy = glogy, ourbpl = bpl, transm = transmode;
+
+    char *pp = (char *)p;
+
+    cnt++;
+
+#ifdef A_C_SIMD_TVLINE
+    if (vline_simd())
+    {
+        bssize_t const n = tvlineasm2_simd(cnt, vplc1, vinc1, buf1, vplc2, vinc2, buf2, pp, logy, ourbpl, transm);
+
+        vplc1 += n*vinc1;
+        vplc2 += n*vinc2;
+        pp += n*ourbpl;
+        cnt -= n;
+
+        if (!cnt)
+        {
+            asm1 = vplc1;
+            asm2 = vplc2;
+            return;
+        }
+    }
+#endif
+
+    uint8_t const shift = transm<<3;
+
+    do
+    {
+        ch = getpix(logy, buf1, vplc1);
+        if (ch != 255) pp[0] = gtrans[(pp[0]<<(8-shift))|(gpal[ch]<<shift)];
+        vplc1 += vinc1;
+        saturate_vplc_trans(vplc1, vinc1);
+
+        ch = getpix(logy, buf2, vplc2);
+        if (ch != 255) pp[1] = gtrans[(pp[1]<<(8-shift))|(gpal2[ch]<<shift)];
+        vplc2 += vinc2;
+        saturate_vplc_trans(vplc2, vinc2);
+
+        pp += ourbpl;
+    }
+    while (--cnt > 0);
+
+    asm1 = vplc1;
+    asm2 = vplc2;
+}
+
+//Floor sprite horizontal line functions
+void msethlineshift(int32_t logx, int32_t logy) { glogx = logx; glogy = logy; }
+// cntup16>>16 + 1 iterations
+void mhline(intptr_t bufplc, uint32_t bx, int32_t cntup16, int32_t junk, uint32_t by, intptr_t p)
+{
+    char ch;
+
+    const int32_t xinc = asm1, yinc = asm2;
+
+    UNREFERENCED_PARAMETER(junk);
+
+    gbuf = (char *)bufplc;
+    gpal = (char *)asm3;
+
+    cntup16>>=16;
+    cntup16++;
+    do
+    {
+        ch = gbuf[((bx>>(32-glogx))<<glogy)+(by>>(32-glogy))];
+        if (ch != 255) *((char *)p) = gpal[ch];
+        bx += xinc;
+        by += yinc;
+        p++;
+    }
+    while (--cntup16);
+}
+
+void tsethlineshift(int32_t logx, int32_t logy) { glogx = logx; glogy = logy; }
+// cntup16>>16 + 1 iterations
+void thline(intptr_t bufplc, uint32_t bx, int32_t cntup16, int32_t junk, uint32_t by, intptr_t p)
+{
+    char ch;
+
+    const int32_t xinc = asm1, yinc = asm2;
+
+    UNREFERENCED_PARAMETER(junk);
+
+    gbuf = (char *)bufplc;
+    gpal = (char *)asm3;
+
+    cntup16>>=16;
+    cntup16++;
+
+    uint8_t const shift = transmode<<3;
+
+    do
+    {
+        ch = gbuf[((bx>>(32-glogx))<<glogy)+(by>>(32-glogy))];
+        if (ch != 255) *((char *)p) = gtrans[((*((char *)p))<<(8-shift))|(gpal[ch]<<shift)];
+        bx += xinc;
+        by += yinc;
+        p++;
+    }
+    while (--cntup16);
+}
+
+
+//Rotatesprite vertical line functions
+void setupspritevline(intptr_t paloffs, int32_t bxinc, int32_t byinc, int32_t ysiz)
+{
+    gpal = (char *)paloffs;
+    gbxinc = bxinc;
+    gbyinc = byinc;
+    glogy = ysiz;
+}
+
+#if defined A_C_SIMD_SSE2 || defined A_C_SIMD_NEON
+// Draws the first cnt&~3 pixels and returns how many were drawn
+A_C_TARGET_SIMD static bssize_t spritevline_simd(int32_t bx, int32_t by, bssize_t cnt, const char *buf, char *p)
+{
+    vline4_t bx4 = vline4_set(bx, bx + gbxinc, bx + (uint32_t)gbxinc*2, bx + (uint32_t)gbxinc*3);
+    vline4_t by4 = vline4_set(by, by + gbyinc, by + (uint32_t)gbyinc*2, by + (uint32_t)gbyinc*3);
+    vline4_t const bxinc4 = vline4_dup((uint32_t)gbxinc << 2), byinc4 = vline4_dup((uint32_t)gbyinc << 2);
+    vline4_t const ysiz = vline4_dup(glogy);
+    const char *const A_C_RESTRICT pal = gpal;
+    int32_t const ourbpl = bpl;
+    int32_t idx[4];
+    bssize_t const n = cnt & ~3;
+
+    for (cnt = n; cnt > 0; cnt -= 4)
+    {
+        vline4_store(idx, vline4_add(vline4_mul(vline4_sar(bx4, 16), ysiz), vline4_sar(by4, 16)));
+
+        p[0]        = pal[(uint8_t)buf[idx[0]]];
+        p[ourbpl]   = pal[(uint8_t)buf[idx[1]]];
+        p[ourbpl*2] = pal[(uint8_t)buf[idx[2]]];
+        p[ourbpl*3] = pal[(uint8_t)buf[idx[3]]];
+
+        bx4 = vline4_add(bx4, bxinc4);
+        by4 = vline4_add(by4, byinc4);
+        p += ourbpl*4;
+    }
+
+    return n;
+}
+#endif
+
+void spritevline(int32_t bx, int32_t by, bssize_t cnt, intptr_t bufplc, intptr_t p)
+{
+    gbuf = (char *)bufplc;
+
+#if defined A_C_SIMD_SSE2 || defined A_C_SIMD_NEON
+    if (vline_simd() && cnt > 1)
+    {
+        // the C loop below draws cnt-1 pixels
+        bssize_t const n = spritevline_simd(bx, by, cnt-1, gbuf, (char *)p);
+        bx += n*gbxinc;
+        by += n*gbyinc;
+        p += n*bpl;
+        cnt -= n;
+    }
+#endif
+
+    for (; cnt>1; cnt--)
+    {
+        (*(char *)p) = gpal[gbuf[(bx>>16)*glogy+(by>>16)]];
+        bx += gbxinc;
+        by += gbyinc;
+        p += bpl;
+    }
+}
+
+//Rotatesprite vertical line functions
+void msetupspritevline(intptr_t paloffs, int32_t bxinc, int32_t byinc, int32_t ysiz)
+{
+    gpal = (char *)paloffs;
+    gbxinc = bxinc;
+    gbyinc = byinc;
+    glogy = ysiz;
+}
+void mspritevline(int32_t bx, int32_t by, bssize_t cnt, intptr_t bufplc, intptr_t p)
+{
+    char ch;
+
+    gbuf = (char *)bufplc;
+    for (; cnt>1; cnt--)
+    {
+        ch = gbuf[(bx>>16)*glogy+(by>>16)];
+        if (ch != 255) (*(char *)p) = gpal[ch];
+        bx += gbxinc;
+        by += gbyinc;
+        p += bpl;
+    }
+}
+
+void tsetupspritevline(intptr_t paloffs, int32_t bxinc, int32_t byinc, int32_t ysiz)
+{
+    gpal = (char *)paloffs;
+    gbxinc = bxinc;
+    gbyinc = byinc;
+    glogy = ysiz;
+}
+void tspritevline(int32_t bx, int32_t by, bssize_t cnt, intptr_t bufplc, intptr_t p)
+{
+    char ch;
+
+    gbuf = (char *)bufplc;
+
+    uint8_t const shift = transmode<<3;
+
+    for (; cnt>1; cnt--)
+    {
+        ch = gbuf[(bx>>16)*glogy+(by>>16)];
+        if (ch != 255) *((char *)p) =  gtrans[((*((char *)p))<<(8-shift))+(gpal[ch]<<shift)];
+        bx += gbxinc;
+        by += gbyinc;
+        p += bpl;
+    }
+}
+
+void setupdrawslab(int32_t dabpl, intptr_t pal)
+{
+    bpl  = dabpl;
+    gpal = (char *)pal;
+}
+
+void drawslab(int32_t dx, int32_t v, int32_t dy, int32_t vi, intptr_t vptr, intptr_t p)
+{
+    do
+    {
+        char const c = gpal[(int32_t)(*(char *)((v>>16)+vptr))];
+        for (int x=0; x < dx; x++)
+            ((char*)p)[x] = c;
+        p += bpl;
+        v += vi;
+    }
+    while (--dy);
+}
+
+#if 0
+void stretchhline(intptr_t p0, int32_t u, bssize_t cnt, int32_t uinc, intptr_t rptr, intptr_t p)
+{
+    p0 = p-(cnt<<2);
+    do
+    {
+        p--;
+        *(char *)p = *(char *)((u>>16)+rptr); u -= uinc;
+    }
+    while (p > p0);
+}
+#endif
+
+#endif
+/*
+ * vim:ts=4:
+ */
@@ -0,0 +1,31 @@
+#include "compat.h"
+#include "a.h"
+#include "build_cpuid.h"
+#include "pragmas.h"
+#include <chrono>
+#include <stdio.h>
+#define BENCH_KERNELBPL 64
+#define BENCH_KERNELROWS 256
+#define BENCH_KERNELTILE 65536
+#define LOG_F(lvl, ...) (fprintf(stderr, __VA_ARGS__), fputc('\n', stderr))
+intptr_t asm1, asm2, asm3, asm4, palookupoffse[4], bufplce[4];
+uint32_t vplce[4]; int32_t vince[4];
+int32_t globaltilesizy, globalx3, globaly3;
+int32_t sloptable[SLOPTABLESIZ];
+uint64_t timerGetNanoTicks(void) { return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count(); }
+uint64_t timerGetNanoTickRate(void) { return 1000000000ull; }
+static int benchNumObjects;
+static void benchOpenObject(FILE *fp, char const *name) { fprintf(fp, "%s  \"%s\": {\n", benchNumObjects++ ? ",\n" : "", name); }
+static uint32_t benchRand(uint32_t &seed) { seed = seed * 1664525 + 1013904223; return seed >> 8; }
+#define Xmalloc malloc
+#define Xfree free
+#include "kh_body.inc"
+int main(int argc, char **argv)
+{
+    initdivtables();
+    sysReadCPUID();
+    fprintf(stdout, "{\n");
+    int e = benchRunKernels(stdout, argc > 1 ? atoi(argv[1]) : 20000);
+    fprintf(stdout, "\n}\n");
+    return e ? 2 : 0;
+}
@@ -0,0 +1 @@
+namespace loguru { int current_verbosity_cutoff() { return -10; } void log(int, char const*, unsigned, char const*, ...) {} }
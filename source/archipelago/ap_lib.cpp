@@ -1,7 +1,11 @@
 #include "ap_lib.h"
 #include "Archipelago.h"
 #include "compat.h"
+#include "libasync_config.h"
+#include "timer.h"
+#include <atomic>
 #include <chrono>
+#include <mutex>
 #include <thread>
 
 ap_init_state_t ap_global_state = AP_UNINIT;
@@ -12,10 +16,12 @@ ap_location_state_t ap_locations[AP_MAX_LOCATION];
 ap_state_t ap_game_state = { 
     std::map<ap_net_id_t, uint16_t>(), 
     std::map<ap_net_id_t, uint16_t>(),
-    std::vector<std::pair<ap_net_id_t, bool>>(),
+    std::deque<ap_queued_item_t>(),
+    std::deque<ap_queued_item_t>(),
     Json::Value(),
     false
 };
+ap_item_queue_stats_t ap_item_queue_stats = {};
 std::map<ap_net_id_t, Json::Value> ap_item_info;
 
 std::map<std::string, Json::Value> ap_game_settings;
@@ -27,51 +33,70 @@ Json::FastWriter ap_writer;
 
 std::vector<std::string> ap_message_queue;
 
+ap_mock_settings_t ap_mock_settings = { 0, AP_MOCK_OK };
 
-static void init_location_table(Json::Value& locations)
-{
-    Bmemset(ap_locations, 0, AP_MAX_LOCATION * sizeof(ap_location_state_t));
+// Set while running against the in-process mock server instead of a real connection
+static bool ap_mock = false;
 
-    // Iterate through the game config data to set the relevant flags for all known locations
-    for (std::string level_name : locations.getMemberNames())
-    {
-        for (std::string sprite_id : locations[level_name]["sprites"].getMemberNames())
-        {
-            if (locations[level_name]["sprites"][sprite_id]["id"].isInt64())
-            {
-                int location_id = locations[level_name]["sprites"][sprite_id]["id"].asInt64();
-                if (location_id >= 0)
-                    ap_locations[AP_SHORT_LOCATION(location_id)].state |= (AP_LOC_PICKUP);
-            }
-        }
-    }
 
-    for (std::string level_name : locations.getMemberNames())
+// Upper bound for sprite, sector and exit indices referenced by the game config
+#define AP_MAX_MAP_INDEX (16384)
+
+std::map<std::string, ap_map_locations_t> ap_map_locations;
+
+/*
+  Compiles one location category of a map into a table indexed by the numeric
+  key (sprite number, sector number or exit tag), and flags the referenced locations.
+*/
+static void compile_location_category(Json::Value& category, std::vector<ap_location_t>& table, uint32_t flag)
+{
+    table.clear();
+    for (std::string key : category.getMemberNames())
     {
-        for (std::string sector_id : locations[level_name]["sectors"].getMemberNames())
+        char* end;
+        long index = strtol(key.c_str(), &end, 10);
+        if (*end != 0 || index < 0 || index >= AP_MAX_MAP_INDEX)
+            continue;
+
+        ap_location_t location = AP_LOCATION_NONE;
+        if (category[key]["id"].isInt64())
         {
-            if (locations[level_name]["sectors"][sector_id]["id"].isInt64())
+            int location_id = category[key]["id"].asInt64();
+            if (location_id >= 0)
             {
-                int location_id = locations[level_name]["sectors"][sector_id]["id"].asInt64();
-                if (location_id >= 0)
-                    ap_locations[AP_SHORT_LOCATION(location_id)].state |= (AP_LOC_SECRET);
+                location = AP_SHORT_LOCATION(location_id);
+                ap_locations[location].state |= flag;
             }
+            else
+                location = AP_LOCATION_DISABLED;
         }
+
+        if ((size_t)index >= table.size())
+            table.resize(index + 1, AP_LOCATION_NONE);
+        table[index] = location;
     }
+}
+
+static void init_location_table(Json::Value& locations)
+{
+    Bmemset(ap_locations, 0, AP_MAX_LOCATION * sizeof(ap_location_state_t));
+    ap_map_locations.clear();
 
+    // Iterate through the game config data once to set the relevant flags for all known locations,
+    // and build the per map lookup tables used on map load and during play
     for (std::string level_name : locations.getMemberNames())
     {
-        for (std::string exit_tag : locations[level_name]["exits"].getMemberNames())
-        {
-            if (locations[level_name]["exits"][exit_tag]["id"].isInt64())
-            {
-                int location_id = locations[level_name]["exits"][exit_tag]["id"].asInt64();
-                if (location_id >= 0)
-                    ap_locations[AP_SHORT_LOCATION(location_id)].state |= (AP_LOC_EXIT);
-            }
-        }
+        ap_map_locations_t& map_locations = ap_map_locations[level_name];
+        compile_location_category(locations[level_name]["sprites"], map_locations.sprites, AP_LOC_PICKUP);
+        compile_location_category(locations[level_name]["sectors"], map_locations.sectors, AP_LOC_SECRET);
+        compile_location_category(locations[level_name]["exits"], map_locations.exits, AP_LOC_EXIT);
     }
+}
 
+const ap_map_locations_t* AP_GetMapLocations(std::string map)
+{
+    auto iter = ap_map_locations.find(map);
+    return iter != ap_map_locations.end() ? &iter->second : NULL;
 }
 
 static void init_item_table(Json::Value& items)
@@ -116,7 +141,8 @@ static void set_available_locations(std::string json)
         }
     }
     // Send out a location scout package for them so we can see which ones are progressive
-    AP_SendLocationScouts(scout_reqs, FALSE);
+    if (!ap_mock)
+        AP_SendLocationScouts(scout_reqs, FALSE);
 }
 
 static void set_used_levels(std::string json)
@@ -154,9 +180,96 @@ static void set_settings(std::string json)
 
 static bool reached_goal = false;
 
-static void initialize_save_data(Json::Value& init_data)
+/*
+  Save data layout: dynamic_player is flattened two levels deep, so syncs can update just
+  the entries that changed. Members of object sections are stored under
+  "dynamic.<section>/<member>", any other section under "dynamic.<section>". '~' and '/'
+  in names are escaped as "~0" and "~1", like in a JSON pointer. Older saves kept the
+  whole dynamic_player tree in "player", which is still read as the base state.
+*/
+#define AP_SAVE_SECTION_PREFIX "dynamic."
+
+// Save data as last written to the server, in the flattened layout
+static Json::Value synced_save_data = Json::objectValue;
+// Set if the server holds keys the flattened layout doesn't produce, like the legacy "player" tree
+static bool save_data_needs_rewrite = false;
+
+static std::string escape_save_key(const std::string& name)
 {
-    ap_game_state.dynamic_player.copy(init_data["player"]);
+    std::string escaped;
+    for (char c : name)
+    {
+        if (c == '~')
+            escaped += "~0";
+        else if (c == '/')
+            escaped += "~1";
+        else
+            escaped += c;
+    }
+    return escaped;
+}
+
+static std::string unescape_save_key(const std::string& key)
+{
+    std::string name;
+    for (size_t i = 0; i < key.length(); i++)
+    {
+        if (key[i] == '~' && i + 1 < key.length())
+            name += (key[++i] == '1') ? '/' : '~';
+        else
+            name += key[i];
+    }
+    return name;
+}
+
+static Json::Value flatten_save_data(const Json::Value& dynamic_player)
+{
+    Json::Value flat = Json::objectValue;
+    for (const std::string& section : dynamic_player.getMemberNames())
+    {
+        const Json::Value& value = dynamic_player[section];
+        std::string const key = AP_SAVE_SECTION_PREFIX + escape_save_key(section);
+        if (value.isObject() && !value.empty())
+        {
+            for (const std::string& member : value.getMemberNames())
+                flat[key + "/" + escape_save_key(member)] = value[member];
+        }
+        else
+            flat[key] = value;
+    }
+    return flat;
+}
+
+static void initialize_save_data(const Json::Value& init_data)
+{
+    const Json::Value* legacy_player = init_data.isObject() ? init_data.find("player", "player" + 6) : NULL;
+    ap_game_state.dynamic_player = legacy_player ? *legacy_player : Json::Value();
+
+    std::string const prefix = AP_SAVE_SECTION_PREFIX;
+    std::vector<std::string> keys = init_data.isObject() ? init_data.getMemberNames() : std::vector<std::string>();
+    // Whole sections first, so that the members stored on their own end up on top
+    for (const std::string& key : keys)
+    {
+        if (key.compare(0, prefix.length(), prefix) == 0 && key.find('/', prefix.length()) == std::string::npos)
+            ap_game_state.dynamic_player[unescape_save_key(key.substr(prefix.length()))] = init_data[key];
+    }
+    for (const std::string& key : keys)
+    {
+        size_t const split = key.compare(0, prefix.length(), prefix) == 0 ? key.find('/', prefix.length()) : std::string::npos;
+        if (split == std::string::npos)
+            continue;
+        std::string const section = unescape_save_key(key.substr(prefix.length(), split - prefix.length()));
+        std::string const member = unescape_save_key(key.substr(split + 1));
+        Json::Value& section_value = ap_game_state.dynamic_player[section];
+        if (!section_value.isObject())
+            section_value = Json::objectValue;
+        section_value[member] = init_data[key];
+    }
+
+    // Anything on the server that isn't exactly the flattened state gets rewritten on the next sync
+    synced_save_data = flatten_save_data(ap_game_state.dynamic_player);
+    save_data_needs_rewrite = init_data.isObject() ? !(init_data == synced_save_data) : !synced_save_data.empty();
+
     reached_goal = ap_game_state.dynamic_player["victory"].asBool();
 }
 
@@ -168,10 +281,15 @@ int32_t AP_CheckLocation(ap_location_t loc)
     // Check if we already have this location confirmed as checked.
     if (AP_LOCATION_CHECKED(loc))
         return 0;
+    ap_locations[loc].state |= AP_LOC_CHECKED;
+    if (ap_mock)
+    {
+        AP_Printf("New Check: %d", loc);
+        return 1;
+    }
     // Forward check to AP server
     ap_net_id_t net_loc = AP_NET_ID(loc);
     AP_SendItem(AP_NET_ID(net_loc));
-    ap_locations[loc].state |= AP_LOC_CHECKED;
     // And note the location check in the console
     AP_Printf(("New Check: " + AP_GetLocationName(net_loc)).c_str());
     return 1;
@@ -181,14 +299,35 @@ int32_t AP_CheckLocation(ap_location_t loc)
 void AP_ClearAllItems()
 {
    ap_game_state.ap_item_queue.clear();
+   ap_game_state.ap_item_queue_global.clear();
    ap_game_state.persistent.clear();
 }
 
 void AP_ItemReceived(int64_t item_id, int slot, bool notify)
 {
-    if (!ap_item_info.count(item_id)) return;  // Don't know anything about this type of item, ignore it
-    // Push item and notification flag to queue
-    ap_game_state.ap_item_queue.push_back(std::make_pair(item_id, notify));
+    static uint32_t item_seq = 0;
+
+    auto item_info = ap_item_info.find(item_id);
+    if (item_info == ap_item_info.end()) return;  // Don't know anything about this type of item, ignore it
+
+    ap_queued_item_t queued = { item_id, notify, AP_ITEM_CLASS_OTHER, item_seq++ };
+    std::string item_type = item_info->second["type"].asString();
+    if (item_type == "map")
+        queued.item_class = AP_ITEM_CLASS_MAP;
+    else if (item_type == "key")
+        queued.item_class = AP_ITEM_CLASS_KEY;
+    else if (item_type == "trap")
+        queued.item_class = AP_ITEM_CLASS_TRAP;
+
+    // Silent items, maps, keys and traps don't need the player to be in game
+    if (!notify || queued.item_class != AP_ITEM_CLASS_OTHER)
+        ap_game_state.ap_item_queue_global.push_back(queued);
+    else
+        ap_game_state.ap_item_queue.push_back(queued);
+
+    uint32_t depth = ap_game_state.ap_item_queue.size() + ap_game_state.ap_item_queue_global.size();
+    if (depth > ap_item_queue_stats.max_depth)
+        ap_item_queue_stats.max_depth = depth;
 }
 
 void AP_ExtLocationCheck(int64_t location_id)
@@ -224,52 +363,130 @@ void AP_LocationInfo(std::vector<AP_NetworkItem> scouted_items)
     }
 }
 
-bool sync_wait_for_data(uint32_t timeout)
+/* Background initialization */
+
+#define AP_CONNECT_TIMEOUT (10000)
+
+static async::task<bool> init_task;
+static std::atomic<bool> init_abort(false);
+static uint64_t init_start_time;
+static void (*init_callback)(void) = NULL;
+
+// Written by the initialization task, only read on the main thread once it has finished
+static std::string serialized_save_data;
+static AP_GetServerDataRequest save_req;
+
+// The OSD is not thread safe, so errors from the initialization task are queued
+// here and printed by AP_PollInitialize on the main thread
+static std::mutex init_errors_lock;
+static std::vector<std::string> init_errors;
+
+static void init_error(const char* msg)
 {
-    Json::Value save_data;
-    std::string serialized_save_data;
+    std::lock_guard<std::mutex> lock(init_errors_lock);
+    init_errors.push_back(msg);
+}
+
+static void print_init_errors(void)
+{
+    std::lock_guard<std::mutex> lock(init_errors_lock);
+    for (const std::string& msg : init_errors)
+        AP_Errorf("%s", msg.c_str());
+    init_errors.clear();
+}
+
+// Sleeps in short steps until the condition is met. Returns true on timeout or abort
+template <typename F>
+static bool wait_for(F condition, std::chrono::steady_clock::time_point start_time, uint32_t timeout)
+{
+    while (!condition())
+    {
+        if (init_abort || std::chrono::steady_clock::now() - start_time > std::chrono::milliseconds(timeout))
+            return TRUE;
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    return FALSE;
+}
+
+/*
+  Stands in for the server side of the connection: after the configured latency it
+  delivers slot data that enables every location and level in the game config.
+*/
+static void mock_server_connect(const ap_mock_settings_t& mock)
+{
+    Json::Value locations = Json::arrayValue;
+    for (unsigned int i = 0; i < AP_MAX_LOCATION; i++)
+    {
+        if (ap_locations[i].state & (AP_LOC_PICKUP | AP_LOC_SECRET | AP_LOC_EXIT))
+            locations.append(Json::Int64(AP_NET_ID(i)));
+    }
 
+    Json::Value levels = Json::arrayValue;
+    Json::Value& episodes = ap_game_config["episodes"];
+    for (std::string ep_id : episodes.getMemberNames())
+    {
+        for (std::string lev_id : episodes[ep_id]["levels"].getMemberNames())
+            levels.append(Json::Int64(AP_NET_ID(episodes[ep_id]["levels"][lev_id]["unlock"].asInt64())));
+    }
+
+    Json::Value checksum = (mock.result == AP_MOCK_CHECKSUM_MISMATCH) ? "mock" : ap_game_config["checksum"].asString();
+
+    set_goals("{}");
+    set_available_locations(ap_writer.write(locations));
+    set_settings("{}");
+    set_used_levels(ap_writer.write(levels));
+    set_id_checksums(ap_writer.write(checksum));
+    serialized_save_data = "";
+}
+
+// Runs on a worker thread. Returns true if initialization failed. The mock settings
+// are a copy taken when the connect started, as the cvars may change meanwhile.
+static bool sync_wait_for_data(uint32_t timeout, ap_mock_settings_t mock)
+{
     // Wait for server connection and data package exchange to occur
     auto start_time = std::chrono::steady_clock::now();
-    while (AP_GetDataPackageStatus() != AP_DataPackageSyncStatus::Synced)
+
+    if (ap_mock)
     {
-        std::this_thread::sleep_for(std::chrono::milliseconds(100));
-        if (std::chrono::steady_clock::now() - start_time > std::chrono::milliseconds(timeout))
+        uint32_t latency = (mock.result == AP_MOCK_TIMEOUT) ? UINT32_MAX : mock.latency;
+        auto connect_time = start_time + std::chrono::milliseconds(latency);
+        if (wait_for([&]() { return std::chrono::steady_clock::now() >= connect_time; }, start_time, timeout))
         {
-            AP_Errorf("Timed out connecting to server.");
+            init_error("Timed out connecting to server.");
             return TRUE;
         }
+        mock_server_connect(mock);
     }
+    else
+    {
+        if (wait_for([]() { return AP_GetDataPackageStatus() == AP_DataPackageSyncStatus::Synced; }, start_time, timeout))
+        {
+            init_error("Timed out connecting to server.");
+            return TRUE;
+        }
 
-    // Now fetch our save data
-    AP_GetServerDataRequest save_req = {
-        AP_RequestStatus::Pending,
-        AP_GetPrivateServerDataPrefix() + "_save_data",
-        (void *)&serialized_save_data,
-        AP_DataType::Raw
-    };
-    AP_GetServerData(&save_req);
+        // Now fetch our save data
+        save_req = {
+            AP_RequestStatus::Pending,
+            AP_GetPrivateServerDataPrefix() + "_save_data",
+            (void *)&serialized_save_data,
+            AP_DataType::Raw
+        };
+        AP_GetServerData(&save_req);
 
-    while (save_req.status != AP_RequestStatus::Done)
-    {
-        std::this_thread::sleep_for(std::chrono::milliseconds(100));
-        if (std::chrono::steady_clock::now() - start_time > std::chrono::milliseconds(timeout))
+        if (wait_for([]() { return save_req.status == AP_RequestStatus::Done; }, start_time, timeout))
         {
-            AP_Errorf("Timed out fetching save data from server.");
+            init_error("Timed out fetching save data from server.");
             return TRUE;
         }
     }
 
     // Should have the id checksum from slot data by now, verify it matches our loaded ap_config.json
     if (strcmp(ap_game_config["checksum"].asCString(), remote_id_checksum.c_str())) {
-        AP_Errorf("Remote server item/location IDs don't match locally loaded configuration.");
+        init_error("Remote server item/location IDs don't match locally loaded configuration.");
         return TRUE;
     }
 
-    ap_reader.parse(serialized_save_data, save_data);
-
-    initialize_save_data(save_data);
-
     return FALSE;
 }
 
@@ -306,60 +523,190 @@ void AP_Initialize(Json::Value game_config, ap_connection_settings_t connection)
     init_item_table(game_config["items"]);
     ap_game_config = game_config;
 
+    ap_mock = (connection.mode == AP_LOCAL);
     if (connection.mode == AP_SERVER)
+    {
         AP_Init(connection.ip, connection.game, connection.player, connection.password);
-    else
+        AP_SetItemClearCallback(&AP_ClearAllItems);
+        AP_SetItemRecvCallback(&AP_ItemReceived);
+        AP_SetLocationCheckedCallback(&AP_ExtLocationCheck);
+        AP_SetLocationInfoCallback(&AP_LocationInfo);
+        AP_RegisterSlotDataRawCallback("goal", &set_goals);
+        AP_RegisterSlotDataRawCallback("locations", &set_available_locations);
+        AP_RegisterSlotDataRawCallback("settings", &set_settings);
+        AP_RegisterSlotDataRawCallback("levels", &set_used_levels);
+        AP_RegisterSlotDataRawCallback("checksum", &set_id_checksums);
+        AP_Start();
+    }
+    else if (!ap_mock)
         return;
-    AP_SetItemClearCallback(&AP_ClearAllItems);
-    AP_SetItemRecvCallback(&AP_ItemReceived);
-    AP_SetLocationCheckedCallback(&AP_ExtLocationCheck);
-    AP_SetLocationInfoCallback(&AP_LocationInfo);
-    AP_RegisterSlotDataRawCallback("goal", &set_goals);
-    AP_RegisterSlotDataRawCallback("locations", &set_available_locations);
-    AP_RegisterSlotDataRawCallback("settings", &set_settings);
-    AP_RegisterSlotDataRawCallback("levels", &set_used_levels);
-    AP_RegisterSlotDataRawCallback("checksum", &set_id_checksums);
-    AP_Start();
-
-    if(sync_wait_for_data(10000))
+
+    // Connecting, syncing the data package and fetching our save data happens in the
+    // background. AP_PollInitialize picks up the result on the main thread.
+    init_abort = false;
+    init_start_time = timerGetNanoTicks();
+    ap_global_state = AP_CONNECTING;
+    ap_mock_settings_t const mock = ap_mock_settings;
+    init_task = async::spawn([mock]() -> bool
     {
-        AP_Shutdown();
+        return sync_wait_for_data(AP_CONNECT_TIMEOUT, mock);
+    });
+}
+
+void AP_SetInitializedCallback(void (*callback)(void))
+{
+    init_callback = callback;
+}
+
+bool AP_PollInitialize(bool wait)
+{
+    if (ap_global_state != AP_CONNECTING) return false;
+    if (!wait && !init_task.ready()) return false;
+
+    bool const failed = init_task.get();
+    print_init_errors();
+
+    if (failed)
+    {
+        if (!ap_mock)
+            AP_Shutdown();
         // ToDo Just abort entirely?
-        return;
+        ap_global_state = AP_UNINIT;
+        return false;
     }
 
+    Json::Value save_data;
+    ap_reader.parse(serialized_save_data, save_data);
+    initialize_save_data(save_data);
+
     ap_global_state = AP_INITIALIZED;
+    AP_Printf("Connected in %.1f ms.", (timerGetNanoTicks() - init_start_time) * 1000.0 / timerGetNanoTickRate());
+
+    if (init_callback)
+        init_callback();
+
+    return true;
 }
 
 void AP_LibShutdown(void)
 {
-    AP_SyncProgress();
-    AP_Shutdown();
+    if (ap_global_state == AP_CONNECTING)
+    {
+        // Stop the background connect before tearing down the client it is waiting on
+        init_abort = true;
+        init_task.wait();
+        print_init_errors();
+        ap_global_state = AP_UNINIT;
+    }
+    else
+        AP_FlushProgress();
+    if (!ap_mock)
+        AP_Shutdown();
 }
 
-void AP_SyncProgress(void)
+static void (*sync_callback)(Json::Value& dynamic_player) = NULL;
+
+void AP_SetSyncCallback(void (*callback)(Json::Value& dynamic_player))
+{
+    sync_callback = callback;
+}
+
+// Minimum time between two syncs, changes in between are coalesced
+#define AP_SYNC_INTERVAL (2000)
+
+ap_sync_stats_t ap_sync_stats = {};
+
+static std::chrono::steady_clock::time_point last_sync_time;
+
+static void sync_progress(bool force)
 {
-    if (!ap_game_state.need_sync) return;
     // Wait until initialization is done before writing back, only then things are consistent
-    if (!ap_global_state == AP_INITIALIZED) return;
+    if (!AP) return;
 
-    Json::Value save_data;
+    // APCpp drops writes while the socket is down, and the last write before a disconnect
+    // may not have arrived either. Keep the changes pending and replace the whole save
+    // data once the connection is back.
+    if (!ap_mock && AP_GetConnectionStatus() != AP_ConnectionStatus::Authenticated)
+    {
+        save_data_needs_rewrite = true;
+        return;
+    }
+
+    if (!ap_game_state.need_sync) return;
 
-    save_data["player"] = ap_game_state.dynamic_player;
+    auto const now = std::chrono::steady_clock::now();
+    if (!force && now - last_sync_time < std::chrono::milliseconds(AP_SYNC_INTERVAL)) return;
 
-    std::string serialized = ap_writer.write(save_data);
+    // Let the game serialize state it keeps outside of dynamic_player
+    if (sync_callback)
+        sync_callback(ap_game_state.dynamic_player);
 
-    AP_SetServerDataRequest req;
-    req.key = AP_GetPrivateServerDataPrefix() + "_save_data";
-    AP_DataStorageOperation op = { "replace", &serialized };
-    req.operations.push_back(op);
-    req.type = AP_DataType::Raw;
-    std::string default_value = "";
-    req.default_value = &default_value;
+    Json::Value flat = flatten_save_data(ap_game_state.dynamic_player);
 
-    AP_SetServerData(&req);
+    // Keys that went away can't be expressed by an update, the whole save data is
+    // replaced then. This also drops the legacy "player" tree from older saves.
+    bool rewrite = save_data_needs_rewrite;
+    for (const std::string& key : synced_save_data.getMemberNames())
+    {
+        if (!flat.isMember(key))
+        {
+            rewrite = true;
+            break;
+        }
+    }
 
+    // Otherwise only send the entries that changed since the last sync
+    Json::Value update = Json::objectValue;
+    if (!rewrite)
+    {
+        for (const std::string& key : flat.getMemberNames())
+        {
+            const Json::Value* synced = synced_save_data.find(key.data(), key.data() + key.length());
+            if (synced == NULL || !(*synced == flat[key]))
+                update[key] = flat[key];
+        }
+    }
+
+    if (rewrite || !update.empty())
+    {
+        std::string serialized = ap_writer.write(rewrite ? flat : update);
+
+        ap_sync_stats.syncs++;
+        if (rewrite)
+            ap_sync_stats.rewrites++;
+        ap_sync_stats.last_bytes = serialized.length();
+        ap_sync_stats.total_bytes += serialized.length();
+
+        if (!ap_mock)
+        {
+            AP_SetServerDataRequest req;
+            req.key = AP_GetPrivateServerDataPrefix() + "_save_data";
+            AP_DataStorageOperation op = { rewrite ? "replace" : "update", &serialized };
+            req.operations.push_back(op);
+            req.type = AP_DataType::Raw;
+            std::string default_value = "{}";
+            req.default_value = &default_value;
+            req.want_reply = false;
+
+            AP_SetServerData(&req);
+        }
+    }
+
+    // The server has the new state now, later syncs are relative to it
     ap_game_state.need_sync = false;
+    last_sync_time = now;
+    synced_save_data = flat;
+    save_data_needs_rewrite = false;
+}
+
+void AP_SyncProgress(void)
+{
+    sync_progress(false);
+}
+
+void AP_FlushProgress(void)
+{
+    sync_progress(true);
 }
 
 bool AP_CheckVictory(void)
@@ -383,7 +730,8 @@ bool AP_CheckVictory(void)
         ap_game_state.dynamic_player["victory"] = Json::booleanValue;
         ap_game_state.dynamic_player["victory"] = true;
         ap_game_state.need_sync = true;
-        AP_StoryComplete();
+        if (!ap_mock)
+            AP_StoryComplete();
     }
 
     return reached_goal;
@@ -402,6 +750,8 @@ void AP_QueueMessage(std::string msg)
 
 void AP_ProcessMessages()
 {
+    if (ap_mock) return;
+
     // Fetch remaining messages from the AP Server
     while (AP_IsMessagePending())
     {
@@ -9,6 +9,7 @@
 
 #include "stdint.h"
 #include <json/json.h>
+#include <deque>
 #include "ap_log.h"
 
 #ifdef __cplusplus
@@ -55,6 +56,26 @@ typedef struct {
 
 extern ap_location_state_t ap_locations[AP_MAX_LOCATION];  // All location states for a shuffle
 
+/* Compiled per map location lookup tables, built once from ap_config.json */
+
+#define AP_LOCATION_NONE (-1)  // Index is not described in the game config
+#define AP_LOCATION_DISABLED (-2)  // Index is described, but with a negative location id
+
+typedef struct {
+    std::vector<ap_location_t> sprites;  // Sprite number -> location id
+    std::vector<ap_location_t> sectors;  // Sector number -> location id
+    std::vector<ap_location_t> exits;  // Exit tag -> location id
+} ap_map_locations_t;
+
+extern std::map<std::string, ap_map_locations_t> ap_map_locations;  // All compiled location tables by map name
+
+extern const ap_map_locations_t* AP_GetMapLocations(std::string map);  // Returns NULL if the map has no locations
+
+static inline ap_location_t AP_MapLocation(const std::vector<ap_location_t>& table, int32_t index)
+{
+    return (index >= 0 && (size_t)index < table.size()) ? table[index] : AP_LOCATION_NONE;
+}
+
 #define AP_LOCATION_CHECK_MASK(x, y) (AP_VALID_LOCATION_ID(x) && ((ap_locations[x].state & y) == y))
 #define AP_VALID_LOCATION(x) (AP_LOCATION_CHECK_MASK(x, AP_LOC_USED))
 #define AP_LOCATION_CHECKED(x) (AP_LOCATION_CHECK_MASK(x, (AP_LOC_USED | AP_LOC_CHECKED)))
@@ -63,6 +84,7 @@ extern ap_location_state_t ap_locations[AP_MAX_LOCATION];  // All location state
 typedef enum
 {
     AP_UNINIT,
+    AP_CONNECTING,  // Connection and save data fetch are running in the background
     AP_INITIALIZED,
     AP_CONNECTED,
     AP_CONNECTION_LOST,
@@ -70,7 +92,8 @@ typedef enum
 
 extern ap_init_state_t ap_global_state;
 
-#define AP (ap_global_state > AP_UNINIT)
+#define AP (ap_global_state >= AP_INITIALIZED)
+#define APConnecting (ap_global_state == AP_CONNECTING)
 #define APConnected (ap_global_state == AP_CONNECTED)
 
 extern Json::Value ap_game_config;  // Only valid if ap_global_state != AP_DISABLED
@@ -90,20 +113,61 @@ typedef struct {
     const char* password;
 } ap_connection_settings_t;
 
-extern void AP_Initialize(Json::Value game_config, ap_connection_settings_t connection);
+/* Settings for the in-process mock server used in AP_LOCAL mode */
+typedef enum
+{
+    AP_MOCK_OK,
+    AP_MOCK_TIMEOUT,  // Never finish connecting
+    AP_MOCK_CHECKSUM_MISMATCH,  // Report an id checksum that does not match the game config
+} ap_mock_result_t;
+
+typedef struct {
+    uint32_t latency;  // Simulated connect latency in ms
+    ap_mock_result_t result;
+} ap_mock_settings_t;
+
+extern ap_mock_settings_t ap_mock_settings;
+
+extern void AP_Initialize(Json::Value game_config, ap_connection_settings_t connection);  // Starts connecting in the background
+extern void AP_SetInitializedCallback(void (*callback)(void));  // Called on the main thread once initialization succeeded
+extern bool AP_PollInitialize(bool wait);  // Finishes a pending initialization. Returns true if it completed with this call
 extern void AP_LibShutdown(void);
 
 /* Player state */
 
+typedef enum
+{
+    AP_ITEM_CLASS_OTHER,
+    AP_ITEM_CLASS_MAP,
+    AP_ITEM_CLASS_KEY,
+    AP_ITEM_CLASS_TRAP,
+} ap_item_class_t;
+
+typedef struct {
+    ap_net_id_t id;
+    bool notify;
+    ap_item_class_t item_class;  // Classified from the item type when received
+    uint32_t seq;  // Arrival order across both queues
+} ap_queued_item_t;
+
+typedef struct {
+    uint32_t max_depth;  // Highest combined queue depth seen
+    uint32_t last_applied;  // Items applied in the last tic that had any
+    uint64_t last_apply_time;  // Time spent applying them, in timerGetNanoTicks units
+    uint64_t max_apply_time;  // Longest apply time of any tic
+} ap_item_queue_stats_t;
+
 typedef struct {
     std::map<ap_net_id_t, uint16_t> persistent;  // Counts of all items received. Do not modify, this is the progression state!
     std::map<ap_net_id_t, uint16_t> progressive;  // Counts for each progressive item applied. Can be safely cleared when reapplying all items to keep track again
-    std::vector<std::pair<ap_net_id_t, bool>> ap_item_queue;  // Queue of items to be provided to the player whenever he's in-game
+    std::deque<ap_queued_item_t> ap_item_queue;  // Queue of items to be provided to the player whenever he's in-game
+    std::deque<ap_queued_item_t> ap_item_queue_global;  // Silent items, maps, keys and traps. Can be applied outside of the game as well
     Json::Value dynamic_player;  // Game specific dynamic state. This should be conserved, but contains no progression relevant information
     bool need_sync;  // Flag specifying relevant data was changed. If set, will be synced to the AP Server on next opportunity
 } ap_state_t;
 
 extern ap_state_t ap_game_state;
+extern ap_item_queue_stats_t ap_item_queue_stats;
 
 extern std::map<ap_net_id_t, Json::Value> ap_item_info;  // All item descriptions for a game data
 
@@ -114,7 +178,18 @@ extern uint16_t AP_ItemCount(ap_net_id_t id);
 extern uint16_t AP_ProgressiveItem(ap_net_id_t id);
 
 extern int32_t AP_CheckLocation(ap_location_t loc);
-extern void AP_SyncProgress(void);  // Syncs ap_game_state to server
+extern void AP_SyncProgress(void);  // Syncs changes in ap_game_state to server, rate limited
+extern void AP_FlushProgress(void);  // Syncs changes in ap_game_state to server immediately
+
+typedef struct {
+    uint32_t syncs;  // Number of syncs that sent data
+    uint32_t rewrites;  // Syncs that replaced the whole save data because keys were removed
+    uint32_t last_bytes;  // Payload size of the last sync
+    uint64_t total_bytes;  // Payload size of all syncs
+} ap_sync_stats_t;
+
+extern ap_sync_stats_t ap_sync_stats;
+extern void AP_SetSyncCallback(void (*callback)(Json::Value& dynamic_player));  // Called to write game side state into dynamic_player before each sync
 
 extern std::map<std::string, std::pair<ap_net_id_t, uint16_t>> ap_goals;
 
@@ -132,6 +132,14 @@ static FORCE_INLINE int FX_Pan3D(int handle, int angle, int distance)
 {
     return FX_CheckMVErr(MV_Pan3D(handle, angle, distance));
 }
+static FORCE_INLINE int FX_SetPanBatch(MV_PanUpdate const *updates, int count)
+{
+    return FX_CheckMVErr(MV_SetPanBatch(updates, count));
+}
+static FORCE_INLINE int FX_Pan3DBatch(MV_Pan3DUpdate const *updates, int count)
+{
+    return FX_CheckMVErr(MV_Pan3DBatch(updates, count));
+}
 static FORCE_INLINE int FX_SoundActive(int handle) { return MV_VoicePlaying(handle); }
 static FORCE_INLINE int FX_SoundValidAndActive(int handle) { return handle > 0 && MV_VoicePlaying(handle); }
 static FORCE_INLINE int FX_SoundsPlaying(void) { return MV_VoicesPlaying(); }
@@ -68,6 +68,18 @@ enum MV_Errors
 
 const char *MV_ErrorString(int ErrorNumber);
 
+typedef struct
+{
+    int handle;
+    int vol, left, right;
+} MV_PanUpdate;
+
+typedef struct
+{
+    int handle;
+    int angle, distance;
+} MV_Pan3DUpdate;
+
 extern thread_local int MV_Locked;
 static FORCE_INLINE void MV_Lock(void)
 {
@@ -97,6 +109,8 @@ int  MV_PauseVoice(int handle, int pause);
 int  MV_EndLooping(int handle);
 int  MV_SetPan(int handle, int vol, int left, int right);
 int  MV_Pan3D(int handle, int angle, int distance);
+int  MV_SetPanBatch(MV_PanUpdate const *updates, int count);
+int  MV_Pan3DBatch(MV_Pan3DUpdate const *updates, int count);
 void MV_SetReverb(int reverb);
 int  MV_GetMaxReverbDelay(void);
 int  MV_GetReverbDelay(void);
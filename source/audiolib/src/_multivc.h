@@ -62,6 +62,9 @@ extern fix16_t MV_VolumeSmoothFactor;
 
 static FORCE_INLINE fix16_t SMOOTH_VOLUME(fix16_t const volume, fix16_t const dest) { return volume + fix16_fast_trunc_mul(dest - volume, MV_VolumeSmoothFactor); }
 
+// once smoothing stops moving a volume it never will again, so the rest of a block can be mixed at a constant gain
+static FORCE_INLINE bool VOLUME_SETTLED(fix16_t const volume, fix16_t const dest) { return SMOOTH_VOLUME(volume, dest) == volume; }
+
 template <typename T> static inline conditional_t<is_signed<T>::value, make_unsigned_t<T>, make_signed_t<T>> FLIP_SIGN(T src)
 {
     static constexpr make_unsigned_t<T> msb = ((make_unsigned_t<T>)1) << (sizeof(T) * CHAR_BIT - 1u);
@@ -86,11 +89,6 @@ template <> inline int CONVERT_LE_SAMPLE_TO_SIGNED<int16_t, int16_t>(int16_t src
 template <typename T> static int CLAMP_SAMPLE(int src);
 template <> inline int CLAMP_SAMPLE<int16_t>(int src) { return clamp(src, INT16_MIN, INT16_MAX); }
 
-template <typename T> static T MIX_SAMPLES(int signed_sample, T untouched_sample)
-{
-    return CONVERT_SAMPLE_FROM_SIGNED<T>(CLAMP_SAMPLE<T>(signed_sample + CONVERT_SAMPLE_TO_SIGNED<T>(untouched_sample)));
-}
-
 struct split16_t
 {
     explicit split16_t(uint16_t x) : v{x} {}
@@ -178,6 +176,8 @@ typedef struct VoiceNode
     int handle;
     int priority;
 
+    struct PCMCacheEntry *pcm;  // cache entry being recorded or played from, see pcmcache.cpp
+
     async::task<int> task;
 } VoiceNode;
 
@@ -265,13 +265,29 @@ template <typename S, typename D> uint32_t MV_MixMono(struct VoiceNode * const v
 template <typename S, typename D> uint32_t MV_MixStereo(struct VoiceNode * const voice, uint32_t length);
 template <typename T> void MV_Reverb(char const *src, char * const dest, const fix16_t volume, int count);
 
+enum
+{
+    MV_MIXKERNEL_C,
+    MV_MIXKERNEL_SSE2,
+    MV_MIXKERNEL_AVX2,
+    MV_MIXKERNEL_BEST = MV_MIXKERNEL_AVX2,
+};
+
+// Voices are summed into a 32-bit accumulator and clamped to the output format once per buffer.
+// MV_ScaleAccumulate adds SCALE_SAMPLE(src[i], gain) for count samples, using the left gain for
+// even and the right gain for odd samples so interleaved stereo is a single call.
+extern void (*MV_ScaleAccumulate)(int32_t *acc, int16_t const *src, int count, fix16_t left, fix16_t right);
+extern void (*MV_SaturateAccumulator)(int16_t *dest, int32_t const *acc, int count);
+
+// selects the widest kernels up to the given level that the CPU supports and returns the level used
+int MV_SetMixKernel(int kernel);
+
 // implemented in mixst.c
 template <typename S, typename D> uint32_t MV_MixMonoStereo(struct VoiceNode * const voice, uint32_t length);
 template <typename S, typename D> uint32_t MV_MixStereoStereo(struct VoiceNode * const voice, uint32_t length);
 
-extern char *MV_MixDestination;  // pointer to the next output sample
+extern int32_t *MV_MixDestination;  // pointer to the next sample in the mix accumulator
 extern int MV_SampleSize;
-extern int MV_RightChannelOffset;
 
 #define loopStartTagCount 3
 extern const char *loopStartTags[loopStartTagCount];
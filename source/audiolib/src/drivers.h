@@ -45,6 +45,9 @@ void SoundDriver_PCM_StopPlayback(void);
 void SoundDriver_PCM_Lock(void);
 void SoundDriver_PCM_Unlock(void);
 
+// times the PCM lock has been acquired, counted while it is held
+extern unsigned int SoundDriver_PCM_LockCount;
+
 int  SoundDriver_MIDI_Init(midifuncs *);
 void SoundDriver_MIDI_Shutdown(void);
 int  SoundDriver_MIDI_StartPlayback(void);
@@ -36,6 +36,7 @@
 
 #include "_multivc.h"
 #include "multivoc.h"
+#include "pcmcache.h"
 #include "pitch.h"
 #include "pragmas.h"
 
@@ -425,6 +426,14 @@ int MV_PlayFLAC(char *ptr, uint32_t length, int loopstart, int loopend, int pitc
     if (!MV_Installed)
         return MV_SetErrorCode(MV_NotInstalled);
 
+    if (loopstart < 0)
+    {
+        int const handle = MV_PlayCachedPCM(ptr, length, pitchoffset, vol, left, right, priority, volume, callbackval);
+
+        if (handle != 0)
+            return handle;
+    }
+
     // Request a voice from the voice pool
     auto voice = MV_AllocVoice(priority, sizeof(flac_data));
     if (voice == nullptr)
@@ -462,6 +471,8 @@ int MV_PlayFLAC(char *ptr, uint32_t length, int loopstart, int loopend, int pitc
 
     voice->Loop = { nullptr, nullptr, 0, loopstart >= 0 };
 
+    MV_RecordPCM(voice, ptr, length);
+
     // parse metadata
     // loop parsing designed with multiple repetitions in mind
     // In retrospect, it may be possible to MV_GetVorbisCommentLoops(voice, (vorbis_comment *)
@@ -31,6 +31,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #include "multivoc.h"
 #include "music.h"
 #include "osd.h"
+#include "pcmcache.h"
 
 #ifdef _WIN32
 # include "driver_winmm.h"
@@ -93,6 +94,8 @@ static int osdcmd_cvar_set_audiolib(osdcmdptr_t parm)
         MIDI_Restart();
     else if (!Bstrcasecmp(parm->name, "mus_al_stereo"))
         AL_SetStereo(AL_Stereo);
+    else if (!Bstrcasecmp(parm->name, "snd_pcmcache"))
+        MV_TrimPCMCache();
 #ifdef HAVE_XMP
     else if (!Bstrcasecmp(parm->name, "mus_xmp_interpolation"))
         MV_SetXMPInterpolation(MV_XMPInterpolation);
@@ -140,11 +143,14 @@ void FX_InitCvars(void)
           (void *)SDLAudioDriverName, CVAR_STRING | CVAR_FUNCPTR, 0, sizeof(SDLAudioDriverName) - 1 },
 #endif
         { "snd_lazyalloc", "use lazy sound allocations", (void*) &MV_LazyAlloc, CVAR_BOOL, 0, 1 },
+        { "snd_pcmcache", "megabytes of decoded Vorbis/FLAC/XA sound effects to keep in memory (0: disabled)", (void*) &MV_PCMCacheSize, CVAR_INT | CVAR_FUNCPTR, 0, 512 },
     };
 
     for (auto& i : cvars_audiolib)
         OSD_RegisterCvar(&i, (i.flags & CVAR_FUNCPTR) ? osdcmd_cvar_set_audiolib : osdcmd_cvar_set);
 
+    OSD_RegisterFunction("snd_pcmcache_stats", "decoded sound effect cache statistics", MV_PrintPCMCacheStats);
+
 #ifdef _WIN32
     OSD_RegisterFunction("mus_mme_debuginfo", "Windows MME MIDI buffer debug information", WinMMDrv_MIDI_PrintBufferInfo);
 #endif
@@ -19,6 +19,19 @@
  */
 
 #include "_multivc.h"
+#include "build_cpuid.h"
+
+#if defined EDUKE32_CPU_X86 && (defined __GNUC__ || defined _MSC_VER)
+# define MV_MIX_X86
+# include <immintrin.h>
+# ifdef __GNUC__
+#  define MV_TARGET_SSE2 __attribute__((target("sse2")))
+#  define MV_TARGET_AVX2 __attribute__((target("avx2")))
+# else
+#  define MV_TARGET_SSE2
+#  define MV_TARGET_AVX2
+# endif
+#endif
 
 template uint32_t MV_MixMono<uint8_t, int16_t>(struct VoiceNode * const voice, uint32_t length);
 template uint32_t MV_MixStereo<uint8_t, int16_t>(struct VoiceNode * const voice, uint32_t length);
@@ -33,31 +46,48 @@ template void MV_Reverb<int16_t>(char const *src, char * const dest, const fix16
  volume = direct volume adjustment, 1.0 = no change
  */
 
+/*
+ The mixers step through the source one output sample at a time only while the
+ panned volume is still being smoothed towards its goal. The rest of the block is
+ resampled into a scratch buffer and handed to MV_ScaleAccumulate at a constant gain.
+ */
+
 // mono source, mono output
 template <typename S, typename D>
 uint32_t MV_MixMono(struct VoiceNode * const voice, uint32_t length)
 {
     auto const * __restrict source = (S const *)voice->sound;
-    auto       * __restrict dest   = (D *)MV_MixDestination;
+    auto       * __restrict dest   = MV_MixDestination;
 
     uint32_t       position = voice->position;
     uint32_t const rate     = voice->RateScale;
     fix16_t const  volume   = fix16_fast_trunc_mul(voice->volume, MV_GlobalVolume);
 
-    do
+    for (; length && !VOLUME_SETTLED(voice->PannedVolume.Left, voice->GoalVolume.Left); --length)
     {
         auto const isample0 = CONVERT_LE_SAMPLE_TO_SIGNED<S, D>(source[position >> 16]);
 
         position += rate;
 
-        *dest = MIX_SAMPLES<D>(SCALE_SAMPLE(isample0, fix16_fast_trunc_mul(volume, voice->PannedVolume.Left)), *dest);
-        dest++;
+        *dest++ += SCALE_SAMPLE(isample0, fix16_fast_trunc_mul(volume, voice->PannedVolume.Left));
 
         voice->PannedVolume.Left = SMOOTH_VOLUME(voice->PannedVolume.Left, voice->GoalVolume.Left);
     }
-    while (--length);
 
-    MV_MixDestination = (char *)dest;
+    if (length)
+    {
+        int16_t samples[MV_MIXBUFFERSIZE];
+
+        for (uint32_t i = 0; i < length; i++, position += rate)
+            samples[i] = CONVERT_LE_SAMPLE_TO_SIGNED<S, D>(source[position >> 16]);
+
+        fix16_t const gain = fix16_fast_trunc_mul(volume, voice->PannedVolume.Left);
+
+        MV_ScaleAccumulate(dest, samples, length, gain, gain);
+        dest += length;
+    }
+
+    MV_MixDestination = dest;
 
     return position;
 }
@@ -67,28 +97,39 @@ template <typename S, typename D>
 uint32_t MV_MixStereo(struct VoiceNode * const voice, uint32_t length)
 {
     auto const * __restrict source = (S const *)voice->sound;
-    auto       * __restrict dest   = (D *)MV_MixDestination;
+    auto       * __restrict dest   = MV_MixDestination;
 
     uint32_t       position = voice->position;
     uint32_t const rate     = voice->RateScale;
     fix16_t  const volume   = fix16_fast_trunc_mul(voice->volume, MV_GlobalVolume);
 
-    do
+    for (; length && !(VOLUME_SETTLED(voice->PannedVolume.Left, voice->GoalVolume.Left)
+                       && VOLUME_SETTLED(voice->PannedVolume.Right, voice->GoalVolume.Right)); --length)
     {
         auto const isample0 = CONVERT_LE_SAMPLE_TO_SIGNED<S, D>(source[position >> 16]);
 
         position += rate;
 
-        *dest = MIX_SAMPLES<D>(SCALE_SAMPLE(isample0, fix16_fast_trunc_mul(volume, voice->PannedVolume.Left)), *dest);
-        *(dest + (MV_RightChannelOffset / sizeof(*dest)))
-            = MIX_SAMPLES<D>(SCALE_SAMPLE(isample0, fix16_fast_trunc_mul(volume, voice->PannedVolume.Right)), *(dest + (MV_RightChannelOffset / sizeof(*dest))));
+        dest[0] += SCALE_SAMPLE(isample0, fix16_fast_trunc_mul(volume, voice->PannedVolume.Left));
+        dest[1] += SCALE_SAMPLE(isample0, fix16_fast_trunc_mul(volume, voice->PannedVolume.Right));
         dest += 2;
 
         voice->PannedVolume = { SMOOTH_VOLUME(voice->PannedVolume.Left, voice->GoalVolume.Left), SMOOTH_VOLUME(voice->PannedVolume.Right, voice->GoalVolume.Right) };
     }
-    while (--length);
 
-    MV_MixDestination = (char *)dest;
+    if (length)
+    {
+        int16_t samples[MV_MIXBUFFERSIZE << 1];
+
+        for (uint32_t i = 0; i < length; i++, position += rate)
+            samples[i << 1] = samples[(i << 1) + 1] = CONVERT_LE_SAMPLE_TO_SIGNED<S, D>(source[position >> 16]);
+
+        MV_ScaleAccumulate(dest, samples, length << 1, fix16_fast_trunc_mul(volume, voice->PannedVolume.Left),
+                           fix16_fast_trunc_mul(volume, voice->PannedVolume.Right));
+        dest += length << 1;
+    }
+
+    MV_MixDestination = dest;
 
     return position;
 }
@@ -106,3 +147,164 @@ void MV_Reverb(char const *src, char * const dest, const fix16_t volume, int cou
     }
     while (--count > 0);
 }
+
+static void MV_ScaleAccumulate_C(int32_t * __restrict acc, int16_t const * __restrict src, int count, fix16_t left, fix16_t right)
+{
+    int i = 0;
+
+    for (; i < count - 1; i += 2)
+    {
+        acc[i]   += SCALE_SAMPLE<int>(src[i], left);
+        acc[i+1] += SCALE_SAMPLE<int>(src[i+1], right);
+    }
+
+    if (i < count)
+        acc[i] += SCALE_SAMPLE<int>(src[i], (i & 1) ? right : left);
+}
+
+static void MV_SaturateAccumulator_C(int16_t * __restrict dest, int32_t const * __restrict acc, int count)
+{
+    for (int i = 0; i < count; i++)
+        dest[i] = CLAMP_SAMPLE<int16_t>(acc[i]);
+}
+
+#ifdef MV_MIX_X86
+/*
+ (s * gain) >> 16 is computed exactly in 16-bit lanes by splitting the gain into
+ hi * 65536 + lo with lo taken as a signed 16-bit value: mulhi(s, lo) gives the
+ floored low part and pmaddwd folds in s * hi. Gains whose hi part doesn't fit in
+ 16 bits fall back to the C kernel.
+ */
+static inline bool MV_SplitGain(fix16_t const gain, int16_t &hi, int16_t &lo)
+{
+    int32_t const h = (gain >> 16) + ((gain >> 15) & 1);
+
+    if (h < INT16_MIN || h > INT16_MAX)
+        return false;
+
+    hi = (int16_t)h;
+    lo = (int16_t)(uint16_t)gain;
+    return true;
+}
+
+static MV_TARGET_SSE2 void MV_ScaleAccumulate_SSE2(int32_t * __restrict acc, int16_t const * __restrict src, int count, fix16_t left, fix16_t right)
+{
+    int16_t lhi, llo, rhi, rlo;
+
+    if (!MV_SplitGain(left, lhi, llo) || !MV_SplitGain(right, rhi, rlo))
+    {
+        MV_ScaleAccumulate_C(acc, src, count, left, right);
+        return;
+    }
+
+    __m128i const lo = _mm_setr_epi16(llo, rlo, llo, rlo, llo, rlo, llo, rlo);
+    __m128i const hi = _mm_setr_epi16(lhi, 1, rhi, 1, lhi, 1, rhi, 1);
+
+    int i = 0;
+
+    for (; i <= count - 8; i += 8)
+    {
+        __m128i const s = _mm_loadu_si128((__m128i const *)&src[i]);
+        __m128i const m = _mm_mulhi_epi16(s, lo);
+
+        __m128i const a0 = _mm_madd_epi16(_mm_unpacklo_epi16(s, m), hi);
+        __m128i const a1 = _mm_madd_epi16(_mm_unpackhi_epi16(s, m), hi);
+
+        _mm_storeu_si128((__m128i *)&acc[i],   _mm_add_epi32(_mm_loadu_si128((__m128i const *)&acc[i]), a0));
+        _mm_storeu_si128((__m128i *)&acc[i+4], _mm_add_epi32(_mm_loadu_si128((__m128i const *)&acc[i+4]), a1));
+    }
+
+    if (i < count)
+        MV_ScaleAccumulate_C(acc + i, src + i, count - i, left, right);
+}
+
+static MV_TARGET_SSE2 void MV_SaturateAccumulator_SSE2(int16_t * __restrict dest, int32_t const * __restrict acc, int count)
+{
+    int i = 0;
+
+    for (; i <= count - 8; i += 8)
+    {
+        __m128i const a0 = _mm_loadu_si128((__m128i const *)&acc[i]);
+        __m128i const a1 = _mm_loadu_si128((__m128i const *)&acc[i+4]);
+        _mm_storeu_si128((__m128i *)&dest[i], _mm_packs_epi32(a0, a1));
+    }
+
+    if (i < count)
+        MV_SaturateAccumulator_C(dest + i, acc + i, count - i);
+}
+
+static MV_TARGET_AVX2 void MV_ScaleAccumulate_AVX2(int32_t * __restrict acc, int16_t const * __restrict src, int count, fix16_t left, fix16_t right)
+{
+    int16_t lhi, llo, rhi, rlo;
+
+    if (!MV_SplitGain(left, lhi, llo) || !MV_SplitGain(right, rhi, rlo))
+    {
+        MV_ScaleAccumulate_C(acc, src, count, left, right);
+        return;
+    }
+
+    __m256i const lo = _mm256_setr_epi16(llo, rlo, llo, rlo, llo, rlo, llo, rlo, llo, rlo, llo, rlo, llo, rlo, llo, rlo);
+    __m256i const hi = _mm256_setr_epi16(lhi, 1, rhi, 1, lhi, 1, rhi, 1, lhi, 1, rhi, 1, lhi, 1, rhi, 1);
+
+    int i = 0;
+
+    for (; i <= count - 16; i += 16)
+    {
+        __m256i const s = _mm256_loadu_si256((__m256i const *)&src[i]);
+        __m256i const m = _mm256_mulhi_epi16(s, lo);
+
+        // the unpacks work within 128-bit lanes: a0 holds samples 0-3 and 8-11, a1 holds 4-7 and 12-15
+        __m256i const a0 = _mm256_madd_epi16(_mm256_unpacklo_epi16(s, m), hi);
+        __m256i const a1 = _mm256_madd_epi16(_mm256_unpackhi_epi16(s, m), hi);
+
+        _mm256_storeu_si256((__m256i *)&acc[i],   _mm256_add_epi32(_mm256_loadu_si256((__m256i const *)&acc[i]), _mm256_permute2x128_si256(a0, a1, 0x20)));
+        _mm256_storeu_si256((__m256i *)&acc[i+8], _mm256_add_epi32(_mm256_loadu_si256((__m256i const *)&acc[i+8]), _mm256_permute2x128_si256(a0, a1, 0x31)));
+    }
+
+    if (i < count)
+        MV_ScaleAccumulate_C(acc + i, src + i, count - i, left, right);
+}
+
+static MV_TARGET_AVX2 void MV_SaturateAccumulator_AVX2(int16_t * __restrict dest, int32_t const * __restrict acc, int count)
+{
+    int i = 0;
+
+    for (; i <= count - 16; i += 16)
+    {
+        __m256i const a0 = _mm256_loadu_si256((__m256i const *)&acc[i]);
+        __m256i const a1 = _mm256_loadu_si256((__m256i const *)&acc[i+8]);
+        _mm256_storeu_si256((__m256i *)&dest[i], _mm256_permute4x64_epi64(_mm256_packs_epi32(a0, a1), 0xD8));
+    }
+
+    if (i < count)
+        MV_SaturateAccumulator_C(dest + i, acc + i, count - i);
+}
+#endif
+
+void (*MV_ScaleAccumulate)(int32_t *acc, int16_t const *src, int count, fix16_t left, fix16_t right) = MV_ScaleAccumulate_C;
+void (*MV_SaturateAccumulator)(int16_t *dest, int32_t const *acc, int count) = MV_SaturateAccumulator_C;
+
+int MV_SetMixKernel(int kernel)
+{
+#ifdef MV_MIX_X86
+    if (kernel >= MV_MIXKERNEL_AVX2 && cpu.features.avx2)
+    {
+        MV_ScaleAccumulate     = MV_ScaleAccumulate_AVX2;
+        MV_SaturateAccumulator = MV_SaturateAccumulator_AVX2;
+        return MV_MIXKERNEL_AVX2;
+    }
+
+    if (kernel >= MV_MIXKERNEL_SSE2 && cpu.features.sse2)
+    {
+        MV_ScaleAccumulate     = MV_ScaleAccumulate_SSE2;
+        MV_SaturateAccumulator = MV_SaturateAccumulator_SSE2;
+        return MV_MIXKERNEL_SSE2;
+    }
+#else
+    UNREFERENCED_PARAMETER(kernel);
+#endif
+
+    MV_ScaleAccumulate     = MV_ScaleAccumulate_C;
+    MV_SaturateAccumulator = MV_SaturateAccumulator_C;
+    return MV_MIXKERNEL_C;
+}
@@ -37,27 +37,39 @@ template <typename S, typename D>
 uint32_t MV_MixMonoStereo(struct VoiceNode * const voice, uint32_t length)
 {
     auto const * __restrict source = (S const *)voice->sound;
-    auto       * __restrict dest   = (D *)MV_MixDestination;
+    auto       * __restrict dest   = MV_MixDestination;
 
     uint32_t       position = voice->position;
     uint32_t const rate     = voice->RateScale;
     fix16_t const  volume   = fix16_fast_trunc_mul(voice->volume, MV_GlobalVolume);
 
-    do
+    for (; length && !VOLUME_SETTLED(voice->PannedVolume.Left, voice->GoalVolume.Left); --length)
     {
         auto const isample0 = CONVERT_LE_SAMPLE_TO_SIGNED<S, D>(source[(position >> 16) << 1]);
         auto const isample1 = CONVERT_LE_SAMPLE_TO_SIGNED<S, D>(source[((position >> 16) << 1) + 1]);
 
         position += rate;
 
-        *dest = MIX_SAMPLES<D>((SCALE_SAMPLE((isample0 + isample1) >> 1, fix16_fast_trunc_mul(volume, voice->PannedVolume.Left))), *dest);
-        dest++;
+        *dest++ += SCALE_SAMPLE((isample0 + isample1) >> 1, fix16_fast_trunc_mul(volume, voice->PannedVolume.Left));
 
         voice->PannedVolume.Left = SMOOTH_VOLUME(voice->PannedVolume.Left, voice->GoalVolume.Left);
     }
-    while (--length);
 
-    MV_MixDestination = (char *)dest;
+    if (length)
+    {
+        int16_t samples[MV_MIXBUFFERSIZE];
+
+        for (uint32_t i = 0; i < length; i++, position += rate)
+            samples[i] = (CONVERT_LE_SAMPLE_TO_SIGNED<S, D>(source[(position >> 16) << 1])
+                          + CONVERT_LE_SAMPLE_TO_SIGNED<S, D>(source[((position >> 16) << 1) + 1])) >> 1;
+
+        fix16_t const gain = fix16_fast_trunc_mul(volume, voice->PannedVolume.Left);
+
+        MV_ScaleAccumulate(dest, samples, length, gain, gain);
+        dest += length;
+    }
+
+    MV_MixDestination = dest;
 
     return position;
 }
@@ -67,29 +79,43 @@ template <typename S, typename D>
 uint32_t MV_MixStereoStereo(struct VoiceNode * const voice, uint32_t length)
 {
     auto const * __restrict source = (S const *)voice->sound;
-    auto       * __restrict dest   = (D *)MV_MixDestination;
+    auto       * __restrict dest   = MV_MixDestination;
 
     uint32_t       position = voice->position;
     uint32_t const rate     = voice->RateScale;
     fix16_t const  volume   = fix16_fast_trunc_mul(voice->volume, MV_GlobalVolume);
 
-    do
+    for (; length && !(VOLUME_SETTLED(voice->PannedVolume.Left, voice->GoalVolume.Left)
+                       && VOLUME_SETTLED(voice->PannedVolume.Right, voice->GoalVolume.Right)); --length)
     {
         auto const isample0 = CONVERT_LE_SAMPLE_TO_SIGNED<S, D>(source[(position >> 16) << 1]);
         auto const isample1 = CONVERT_LE_SAMPLE_TO_SIGNED<S, D>(source[((position >> 16) << 1) + 1]);
 
         position += rate;
 
-        *dest = MIX_SAMPLES<D>(SCALE_SAMPLE(isample0, fix16_fast_trunc_mul(volume, voice->PannedVolume.Left)), *dest);
-        *(dest + (MV_RightChannelOffset / sizeof(*dest)))
-            = MIX_SAMPLES<D>(SCALE_SAMPLE(isample1, fix16_fast_trunc_mul(volume, voice->PannedVolume.Right)), *(dest + (MV_RightChannelOffset / sizeof(*dest))));
+        dest[0] += SCALE_SAMPLE(isample0, fix16_fast_trunc_mul(volume, voice->PannedVolume.Left));
+        dest[1] += SCALE_SAMPLE(isample1, fix16_fast_trunc_mul(volume, voice->PannedVolume.Right));
         dest += 2;
 
         voice->PannedVolume = { SMOOTH_VOLUME(voice->PannedVolume.Left, voice->GoalVolume.Left), SMOOTH_VOLUME(voice->PannedVolume.Right, voice->GoalVolume.Right) };
     }
-    while (--length);
 
-    MV_MixDestination = (char *)dest;
+    if (length)
+    {
+        int16_t samples[MV_MIXBUFFERSIZE << 1];
+
+        for (uint32_t i = 0; i < length; i++, position += rate)
+        {
+            samples[i << 1]       = CONVERT_LE_SAMPLE_TO_SIGNED<S, D>(source[(position >> 16) << 1]);
+            samples[(i << 1) + 1] = CONVERT_LE_SAMPLE_TO_SIGNED<S, D>(source[((position >> 16) << 1) + 1]);
+        }
+
+        MV_ScaleAccumulate(dest, samples, length << 1, fix16_fast_trunc_mul(volume, voice->PannedVolume.Left),
+                           fix16_fast_trunc_mul(volume, voice->PannedVolume.Right));
+        dest += length << 1;
+    }
+
+    MV_MixDestination = dest;
 
     return position;
 }
@@ -41,6 +41,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #include "libasync_config.h"
 #include "linklist.h"
 #include "osd.h"
+#include "pcmcache.h"
 #include "pitch.h"
 #include "pragmas.h"
 
@@ -92,9 +93,10 @@ static int MV_MixPage;
 
 static void (*MV_CallBackFunc)(intptr_t);
 
-char *MV_MixDestination;
+int32_t *MV_MixDestination;
 int MV_SampleSize = 1;
-int MV_RightChannelOffset;
+
+static int32_t MV_MixAccumulator[MV_MIXBUFFERSIZE << 1];
 
 int MV_ErrorCode = MV_NotInstalled;
 
@@ -107,7 +109,7 @@ static void (*MV_MusicCallback)(void);
 
 static VoiceNode **MV_Handles;
 
-static bool MV_Mix(VoiceNode * const voice, int const buffer)
+static bool MV_Mix(VoiceNode * const voice)
 {
     if (voice->task.valid())
     {
@@ -135,7 +137,7 @@ static bool MV_Mix(VoiceNode * const voice, int const buffer)
     uint32_t       bufsiz = voice->FixedPointBufferSize;
     uint32_t const rate   = voice->RateScale;
 
-    MV_MixDestination = MV_MixBuffer[buffer];
+    MV_MixDestination = MV_MixAccumulator;
 
     // Add this voice to the mix
     do
@@ -211,6 +213,8 @@ static void MV_CleanupVoice(VoiceNode* voice, bool useCallBack = true)
     if (useCallBack && MV_CallBackFunc)
         MV_CallBackFunc(voice->callbackval);
 
+    MV_ReleasePCMCacheVoice(voice);
+
     switch (voice->wavetype)
     {
 #ifdef HAVE_VORBIS
@@ -286,11 +290,13 @@ static void MV_ServiceVoc(void)
     }
 
     VoiceNode *MusicVoice = nullptr;
+    int const  numsamples = MV_BufferSize >> 1;
 
     if (VoiceList.next && VoiceList.next != &VoiceList)
     {
         auto voice = VoiceList.next;
         VoiceNode *next;
+        bool mixed = false;
 
         do
         {
@@ -305,16 +311,33 @@ static void MV_ServiceVoc(void)
                 continue;
             }
 
+            if (!mixed)
+            {
+                // voices are summed at full precision and clamped once the whole page is mixed
+                auto const page = (int16_t const *)MV_MixBuffer[MV_MixPage];
+
+                if (MV_BufferEmpty[MV_MixPage])
+                    Bmemset(MV_MixAccumulator, 0, numsamples * sizeof(int32_t));
+                else
+                    for (int i = 0; i < numsamples; i++)
+                        MV_MixAccumulator[i] = page[i];
+
+                mixed = true;
+            }
+
             MV_BufferEmpty[ MV_MixPage ] = FALSE;
 
             // Is this voice done?
-            if (!MV_Mix(voice, MV_MixPage))
+            if (!MV_Mix(voice))
             {
                 MV_CleanupVoice(voice);
                 MV_FreeHandle(voice);
             }
         }
         while ((voice = next) != &VoiceList);
+
+        if (mixed)
+            MV_SaturateAccumulator((int16_t *)MV_MixBuffer[MV_MixPage], MV_MixAccumulator, numsamples);
     }
 
     Bmemcpy(MV_MixBuffer[MV_MixPage+MV_NumberOfBuffers], MV_MixBuffer[MV_MixPage], MV_BufferSize);
@@ -328,10 +351,22 @@ static void MV_ServiceVoc(void)
             *dest = clamp(*dest + *source++,INT16_MIN, INT16_MAX);
     }
 
-    if (MusicVoice && !MV_Mix(MusicVoice, MV_MixPage + MV_NumberOfBuffers))
+    if (MusicVoice)
     {
-        MV_CleanupVoice(MusicVoice);
-        MV_FreeHandle(MusicVoice);
+        auto const page = (int16_t *)MV_MixBuffer[MV_MixPage + MV_NumberOfBuffers];
+
+        for (int i = 0; i < numsamples; i++)
+            MV_MixAccumulator[i] = page[i];
+
+        bool const playing = MV_Mix(MusicVoice);
+
+        MV_SaturateAccumulator(page, MV_MixAccumulator, numsamples);
+
+        if (!playing)
+        {
+            MV_CleanupVoice(MusicVoice);
+            MV_FreeHandle(MusicVoice);
+        }
     }
 }
 
@@ -677,6 +712,9 @@ int MV_SetPosition(int handle, int position)
     if (voice == nullptr)
         return MV_Error;
 
+    // a seek would leave a hole in the recording
+    MV_CancelPCMRecording(voice);
+
     switch (voice->wavetype)
     {
 #ifdef HAVE_VORBIS
@@ -723,7 +761,7 @@ int MV_SetPan(int handle, int vol, int left, int right)
     return MV_Ok;
 }
 
-int MV_Pan3D(int handle, int angle, int distance)
+static MV_PanUpdate MV_GetPan3D(int handle, int angle, int distance)
 {
     if (distance < 0)
     {
@@ -735,9 +773,84 @@ int MV_Pan3D(int handle, int angle, int distance)
 
     angle &= MV_MAXPANPOSITION;
 
-    return MV_SetPan(handle, max(0, 255 - distance),
-        MV_PanTable[angle][volume].left,
-        MV_PanTable[angle][volume].right);
+    return { handle, max(0, 255 - distance), MV_PanTable[angle][volume].left, MV_PanTable[angle][volume].right };
+}
+
+int MV_Pan3D(int handle, int angle, int distance)
+{
+    auto const pan = MV_GetPan3D(handle, angle, distance);
+    return MV_SetPan(handle, pan.vol, pan.left, pan.right);
+}
+
+// Decoders still starting up on a worker task are waited out before the lock is taken, then the
+// handles are looked up again under it in case a voice finished in between.
+static void MV_WaitForVoiceTask(int handle)
+{
+    auto voice = MV_GetVoice(handle);
+
+    if (voice != nullptr && voice->task.valid() && !voice->task.ready())
+        voice->task.wait();
+}
+
+int MV_SetPanBatch(MV_PanUpdate const *updates, int count)
+{
+    if (!MV_Installed)
+        return MV_Error;
+
+    for (int i = 0; i < count; i++)
+        MV_WaitForVoiceTask(updates[i].handle);
+
+    int status = MV_Ok;
+
+    MV_Lock();
+
+    for (int i = 0; i < count; i++)
+    {
+        auto voice = MV_GetVoice(updates[i].handle);
+
+        if (voice == nullptr)
+        {
+            status = MV_SetErrorCode(MV_VoiceNotFound);
+            continue;
+        }
+
+        MV_SetVoiceVolume(voice, updates[i].vol, updates[i].left, updates[i].right, voice->volume);
+    }
+
+    MV_Unlock();
+
+    return status;
+}
+
+int MV_Pan3DBatch(MV_Pan3DUpdate const *updates, int count)
+{
+    if (!MV_Installed)
+        return MV_Error;
+
+    for (int i = 0; i < count; i++)
+        MV_WaitForVoiceTask(updates[i].handle);
+
+    int status = MV_Ok;
+
+    MV_Lock();
+
+    for (int i = 0; i < count; i++)
+    {
+        auto voice = MV_GetVoice(updates[i].handle);
+
+        if (voice == nullptr)
+        {
+            status = MV_SetErrorCode(MV_VoiceNotFound);
+            continue;
+        }
+
+        auto const pan = MV_GetPan3D(updates[i].handle, updates[i].angle, updates[i].distance);
+        MV_SetVoiceVolume(voice, pan.vol, pan.left, pan.right, voice->volume);
+    }
+
+    MV_Unlock();
+
+    return status;
 }
 
 void MV_SetReverb(int reverb)
@@ -767,8 +880,6 @@ static int MV_SetMixMode(int numchannels)
     Bassert(isPow2(MV_NumberOfBuffers));
     MV_BufferLength = MV_TOTALBUFFERSIZE;
 
-    MV_RightChannelOffset = MV_SampleSize >> 1;
-
     return MV_Ok;
 }
 
@@ -913,6 +1024,9 @@ int MV_Init(int soundcard, int MixRate, int Voices, int numchannels, void *initd
 
     MV_VolumeSmoothFactor = fix16_from_float(1.f-powf(0.1f, 30.f/MixRate));
 
+    MV_SetMixKernel(MV_MIXKERNEL_BEST);
+    MV_InitPCMCache();
+
     // Start the playback engine
     if (MV_StartPlayback() != MV_Ok)
     {
@@ -0,0 +1,401 @@
+/*
+ Copyright (C) 2020 EDuke32 developers and contributors
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 2
+ of the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+ See the GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+ */
+
+/**
+ * Decoded-PCM cache for compressed sound effects
+ *
+ * A one-shot Vorbis, FLAC or XA voice records the blocks its decoder hands to the
+ * mixer. If it plays through to the end untouched, the recording becomes a cache
+ * entry keyed by a hash of the compressed data, and later plays of the same data
+ * are mixed straight from memory like a RAW voice, with no decoder or worker task.
+ *
+ * Entries are evicted least recently used first once more than snd_pcmcache
+ * megabytes are resident. Entries that voices are still playing from stay put.
+ */
+
+#include "pcmcache.h"
+
+#include "baselayer.h"
+#include "mutex.h"
+#include "xxhash.h"
+
+#define PCMCACHE_HASHSIZE   256
+#define PCMCACHE_HASHSPAN   32768  // larger files are keyed by this many bytes from each end plus their length
+#define PCMCACHE_MINRECORD  65536
+
+struct PCMCacheEntry
+{
+    PCMCacheEntry *hashnext;
+    PCMCacheEntry *prev, *next;  // LRU list, most recently used first
+
+    uint64_t key;
+    uint32_t keylength;
+
+    char    *data;
+    uint32_t size, capacity;
+
+    uint32_t rate;
+    int      bits, channels;
+
+    int  refs;
+    bool recording;
+
+    playbackstatus (*decoder)(VoiceNode *);  // the voice's own GetSound while recording
+};
+
+int MV_PCMCacheSize;
+
+static mutex_t        pcmMutex;
+static PCMCacheEntry *pcmHash[PCMCACHE_HASHSIZE];
+static PCMCacheEntry  pcmLRU;
+static size_t         pcmResident;
+static int            pcmEntries;
+static uint32_t       pcmHits, pcmMisses, pcmEvictions;
+
+void MV_InitPCMCache(void)
+{
+    static bool initDone;
+
+    if (initDone)
+        return;
+
+    mutex_init(&pcmMutex);
+    pcmLRU.prev = pcmLRU.next = &pcmLRU;
+    initDone = true;
+}
+
+static inline size_t MV_PCMCacheBudget(void) { return (size_t)MV_PCMCacheSize << 20; }
+
+static uint64_t MV_PCMCacheKey(char const *ptr, uint32_t length)
+{
+    if (length <= PCMCACHE_HASHSPAN * 2)
+        return XXH3_64bits(ptr, length);
+
+    return XXH3_64bits_withSeed(ptr, PCMCACHE_HASHSPAN, XXH3_64bits(ptr + length - PCMCACHE_HASHSPAN, PCMCACHE_HASHSPAN));
+}
+
+static PCMCacheEntry **MV_FindPCMCacheEntry(uint64_t key, uint32_t keylength)
+{
+    auto e = &pcmHash[key & (PCMCACHE_HASHSIZE - 1)];
+
+    while (*e && ((*e)->key != key || (*e)->keylength != keylength))
+        e = &(*e)->hashnext;
+
+    return e;
+}
+
+static void MV_FreePCMCacheEntry(PCMCacheEntry *e)
+{
+    auto link = MV_FindPCMCacheEntry(e->key, e->keylength);
+
+    while (*link != e)
+        link = &(*link)->hashnext;
+
+    *link = e->hashnext;
+
+    if (!e->recording)
+    {
+        e->prev->next = e->next;
+        e->next->prev = e->prev;
+        pcmResident -= e->size;
+        pcmEntries--;
+    }
+
+    Xfree(e->data);
+    Xfree(e);
+}
+
+// evicts unreferenced entries, oldest first, until size more bytes fit in the budget
+static bool MV_EvictPCMCache(size_t size)
+{
+    size_t const budget = MV_PCMCacheBudget();
+
+    for (auto e = pcmLRU.prev; e != &pcmLRU && pcmResident + size > budget;)
+    {
+        auto const prev = e->prev;
+
+        if (e->refs == 0)
+        {
+            MV_FreePCMCacheEntry(e);
+            pcmEvictions++;
+        }
+
+        e = prev;
+    }
+
+    return pcmResident + size <= budget;
+}
+
+void MV_TrimPCMCache(void)
+{
+    // snd_pcmcache may be set from the config before the mixer is up
+    MV_InitPCMCache();
+
+    mutex_lock(&pcmMutex);
+    MV_EvictPCMCache(0);
+    mutex_unlock(&pcmMutex);
+}
+
+static playbackstatus MV_GetNextCachedPCMBlock(VoiceNode *voice)
+{
+    if (voice->BlockLength == 0)
+        return NoMoreData;
+
+    voice->sound        = voice->NextBlock;
+    voice->position    -= voice->length;
+    voice->length       = min(voice->BlockLength, 0x8000u);
+    voice->NextBlock   += voice->length * (voice->channels * voice->bits / 8);
+    voice->BlockLength -= voice->length;
+    voice->length     <<= 16;
+
+    return KeepPlaying;
+}
+
+int MV_PlayCachedPCM(char const *ptr, uint32_t length, int pitchoffset, int vol, int left, int right, int priority,
+                     fix16_t volume, intptr_t callbackval)
+{
+    if (!MV_PCMCacheSize || !MV_Installed)
+        return 0;
+
+    uint64_t const key = MV_PCMCacheKey(ptr, length);
+
+    mutex_lock(&pcmMutex);
+
+    auto e = *MV_FindPCMCacheEntry(key, length);
+
+    if (e == nullptr || e->recording)
+    {
+        pcmMisses++;
+        mutex_unlock(&pcmMutex);
+        return 0;
+    }
+
+    pcmHits++;
+    e->refs++;
+
+    // move to the front of the LRU list
+    e->prev->next = e->next;
+    e->next->prev = e->prev;
+    e->next = pcmLRU.next;
+    e->prev = &pcmLRU;
+    pcmLRU.next->prev = e;
+    pcmLRU.next = e;
+
+    mutex_unlock(&pcmMutex);
+
+    auto voice = MV_AllocVoice(priority);
+
+    if (voice == nullptr)
+    {
+        mutex_lock(&pcmMutex);
+        e->refs--;
+        mutex_unlock(&pcmMutex);
+        return MV_SetErrorCode(MV_NoVoices);
+    }
+
+    voice->pcm         = e;
+    voice->rawdataptr  = e->data;
+    voice->rawdatasiz  = e->size;
+    voice->wavetype    = FMT_RAW;
+    voice->bits        = e->bits;
+    voice->channels    = e->channels;
+    voice->GetSound    = MV_GetNextCachedPCMBlock;
+    voice->NextBlock   = e->data;
+    voice->position    = 0;
+    voice->BlockLength = e->size / (e->channels * (e->bits >> 3));
+    voice->priority    = priority;
+    voice->callbackval = callbackval;
+    voice->Loop        = {};
+
+    MV_SetVoicePitch(voice, e->rate, pitchoffset);
+    MV_SetVoiceVolume(voice, vol, left, right, volume);
+    MV_PlayVoice(voice);
+
+    return voice->handle;
+}
+
+// Runs on the mixer thread in place of the voice's GetSound while it is being recorded.
+static playbackstatus MV_GetNextRecordedBlock(VoiceNode *voice)
+{
+    auto const e = voice->pcm;
+
+    auto const sound    = voice->sound;
+    auto const length   = voice->length;
+    auto const position = voice->position;
+
+    auto const status = e->decoder(voice);
+
+    if (status != KeepPlaying)
+    {
+        voice->GetSound = e->decoder;
+        voice->pcm      = nullptr;
+
+        if (e->size == 0)
+        {
+            mutex_lock(&pcmMutex);
+            MV_FreePCMCacheEntry(e);
+            mutex_unlock(&pcmMutex);
+            return status;
+        }
+
+        if (e->capacity > e->size)
+            e->data = (char *)Xrealloc(e->data, e->size);
+
+        mutex_lock(&pcmMutex);
+
+        if (MV_EvictPCMCache(e->size))
+        {
+            e->recording = false;
+            e->next = pcmLRU.next;
+            e->prev = &pcmLRU;
+            pcmLRU.next->prev = e;
+            pcmLRU.next = e;
+            pcmResident += e->size;
+            pcmEntries++;
+        }
+        else
+            MV_FreePCMCacheEntry(e);
+
+        mutex_unlock(&pcmMutex);
+
+        return status;
+    }
+
+    // the decoders rewind position whenever they hand over a new block; anything else is a repeat of the last one
+    if (voice->position != 0 || voice->length == 0 || (position == 0 && voice->sound == sound && voice->length == length))
+        return status;
+
+    if (e->size == 0)
+    {
+        e->rate     = voice->SamplingRate;
+        e->bits     = voice->bits;
+        e->channels = voice->channels;
+    }
+
+    uint32_t const bytes = (voice->length >> 16) * voice->channels * (voice->bits >> 3);
+
+    // give up on anything that loops, changes format midway, or won't fit
+    if (voice->Loop.Size > 0 || (e->bits != 8 && e->bits != 16) || e->rate != voice->SamplingRate || e->bits != voice->bits
+        || e->channels != voice->channels || e->size + bytes > (MV_PCMCacheBudget() >> 2))
+    {
+        MV_CancelPCMRecording(voice);
+        return status;
+    }
+
+    if (e->size + bytes > e->capacity)
+    {
+        e->capacity = max(max<uint32_t>(e->capacity << 1, PCMCACHE_MINRECORD), e->size + bytes);
+        e->data     = (char *)Xrealloc(e->data, e->capacity);
+    }
+
+    Bmemcpy(e->data + e->size, voice->sound, bytes);
+    e->size += bytes;
+
+    return status;
+}
+
+void MV_RecordPCM(VoiceNode *voice, char const *ptr, uint32_t length)
+{
+    if (!MV_PCMCacheSize || voice->Loop.Size > 0)
+        return;
+
+    uint64_t const key = MV_PCMCacheKey(ptr, length);
+
+    mutex_lock(&pcmMutex);
+
+    auto link = MV_FindPCMCacheEntry(key, length);
+
+    // another voice is already recording this one
+    if (*link != nullptr)
+    {
+        mutex_unlock(&pcmMutex);
+        return;
+    }
+
+    auto e = (PCMCacheEntry *)Xcalloc(1, sizeof(PCMCacheEntry));
+
+    e->key       = key;
+    e->keylength = length;
+    e->recording = true;
+    e->decoder   = voice->GetSound;
+    *link = e;
+
+    mutex_unlock(&pcmMutex);
+
+    voice->pcm      = e;
+    voice->GetSound = MV_GetNextRecordedBlock;
+}
+
+void MV_CancelPCMRecording(VoiceNode *voice)
+{
+    auto const e = voice->pcm;
+
+    if (e == nullptr || !e->recording)
+        return;
+
+    voice->GetSound = e->decoder;
+    voice->pcm      = nullptr;
+
+    mutex_lock(&pcmMutex);
+    MV_FreePCMCacheEntry(e);
+    mutex_unlock(&pcmMutex);
+}
+
+void MV_ReleasePCMCacheVoice(VoiceNode *voice)
+{
+    auto const e = voice->pcm;
+
+    if (e == nullptr)
+        return;
+
+    if (e->recording)
+    {
+        MV_CancelPCMRecording(voice);
+        return;
+    }
+
+    voice->pcm = nullptr;
+
+    mutex_lock(&pcmMutex);
+    e->refs--;
+    MV_EvictPCMCache(0);
+    mutex_unlock(&pcmMutex);
+}
+
+int MV_PrintPCMCacheStats(osdcmdptr_t UNUSED(parm))
+{
+    UNREFERENCED_CONST_PARAMETER(parm);
+
+    MV_InitPCMCache();
+
+    mutex_lock(&pcmMutex);
+    int const      entries   = pcmEntries;
+    size_t const   resident  = pcmResident;
+    uint32_t const hits      = pcmHits;
+    uint32_t const misses    = pcmMisses;
+    uint32_t const evictions = pcmEvictions;
+    mutex_unlock(&pcmMutex);
+
+    LOG_F(INFO, "Decoded sound cache: %d entries, %.2fM of %dM resident", entries, resident / 1048576.f, MV_PCMCacheSize);
+    LOG_F(INFO, "%u hits, %u misses (%.1f%% hit rate), %u evictions", hits, misses,
+          (hits + misses) ? hits * 100.f / (hits + misses) : 0.f, evictions);
+
+    return OSDCMD_OK;
+}
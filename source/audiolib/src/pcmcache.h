@@ -0,0 +1,44 @@
+/*
+ Copyright (C) 2020 EDuke32 developers and contributors
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 2
+ of the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+ See the GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+ */
+
+#ifndef PCMCACHE_H_
+#define PCMCACHE_H_
+
+#include "_multivc.h"
+#include "osd.h"
+
+extern int MV_PCMCacheSize;  // in megabytes, 0 disables the cache
+
+void MV_InitPCMCache(void);
+
+// Plays a one-shot from the cache. Returns 0 when ptr/length isn't cached, otherwise a voice handle or MV_Error.
+int MV_PlayCachedPCM(char const *ptr, uint32_t length, int pitchoffset, int vol, int left, int right, int priority,
+                     fix16_t volume, intptr_t callbackval);
+
+// Records the blocks the voice's decoder produces; once it plays to the end they become a cache entry.
+void MV_RecordPCM(VoiceNode *voice, char const *ptr, uint32_t length);
+void MV_CancelPCMRecording(VoiceNode *voice);
+
+void MV_ReleasePCMCacheVoice(VoiceNode *voice);
+void MV_TrimPCMCache(void);
+
+int MV_PrintPCMCacheStats(osdcmdptr_t);
+
+#endif
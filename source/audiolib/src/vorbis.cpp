@@ -26,6 +26,7 @@
 #include "_multivc.h"
 
 #include "baselayer.h"
+#include "pcmcache.h"
 
 #ifdef _WIN32
 #include "winbits.h"
@@ -344,6 +345,14 @@ int MV_PlayVorbis(char *ptr, uint32_t length, int loopstart, int loopend, int pi
     if (!MV_Installed)
         return MV_SetErrorCode(MV_NotInstalled);
 
+    if (loopstart < 0)
+    {
+        int const handle = MV_PlayCachedPCM(ptr, length, pitchoffset, vol, left, right, priority, volume, callbackval);
+
+        if (handle != 0)
+            return handle;
+    }
+
     auto voice = MV_AllocVoice(priority, sizeof(vorbis_data));
     if (voice == nullptr)
         return MV_SetErrorCode(MV_NoVoices);
@@ -366,6 +375,8 @@ int MV_PlayVorbis(char *ptr, uint32_t length, int loopstart, int loopend, int pi
     voice->GetSound    = MV_GetNextVorbisBlock;
     voice->Paused      = true;
 
+    MV_RecordPCM(voice, ptr, length);
+
     MV_SetVoiceMixMode(voice);
     MV_SetVoiceVolume(voice, vol, left, right, volume);
 
@@ -7,6 +7,7 @@
 #include "_multivc.h"
 #include "compat.h"
 #include "multivoc.h"
+#include "pcmcache.h"
 #include "pitch.h"
 #include "pragmas.h"
 
@@ -416,6 +417,14 @@ int MV_PlayXA(char *ptr, uint32_t length, int loopstart, int loopend, int pitcho
    if (!MV_Installed)
        return MV_SetErrorCode(MV_NotInstalled);
 
+   if (loopstart < 0)
+   {
+       int const handle = MV_PlayCachedPCM(ptr, length, pitchoffset, vol, left, right, priority, volume, callbackval);
+
+       if (handle != 0)
+           return handle;
+   }
+
    // Request a voice from the voice pool
    auto voice = MV_AllocVoice(priority, sizeof(xa_data));
 
@@ -444,6 +453,8 @@ int MV_PlayXA(char *ptr, uint32_t length, int loopstart, int loopend, int pitcho
 
    voice->Loop = { nullptr, nullptr, 0, loopstart >= 0 };
 
+   MV_RecordPCM(voice, ptr, length);
+
    MV_SetVoiceVolume(voice, vol, left, right, volume);
    MV_PlayVoice(voice);
 
@@ -462,6 +462,13 @@ void PreloadCache(void)
     if (MusicRestartsOnLoadToggle)
         sndTryPlaySpecialMusic(MUS_LOADING);
     PreloadTiles();
+#ifdef USE_OPENGL
+    if (useprecache && videoGetRenderMode() != REND_CLASSIC)
+    {
+        for (int type = 0; type < 2; type++)
+            polymost_prefetch((uint8_t const *)precachehightile[type], type);
+    }
+#endif
     ClockTicks clock = totalclock;
     int cnt = 0;
     int percentDisplayed = -1;
@@ -474,6 +481,7 @@ void PreloadCache(void)
                 tileLoad((int16_t)i);
 
 #ifdef USE_OPENGL
+            polymost_prefetchnext(i);
             PrecacheExtraTextureMaps(i);
 #endif
 
@@ -505,6 +513,9 @@ void PreloadCache(void)
             }
         }
     }
+#ifdef USE_OPENGL
+    polymost_prefetchfree();
+#endif
     memset(gotpic,0,sizeof(gotpic));
 }
 
@@ -517,6 +528,9 @@ void EndLevel(void)
     sfxKillAllSounds();
     ambKillAll();
     seqKillAll();
+
+    LOG_F(INFO, "Resource lookups: %d external override probes, %d skipped", Resource::nExternalProbes, Resource::nExternalSkips);
+    Resource::nExternalProbes = Resource::nExternalSkips = 0;
 }
 
 int G_TryMapHack(const char* mhkfile)
@@ -62,17 +62,17 @@ public:
 EventQueue eventQ;
 void EventQueue::Kill(int a1, int a2)
 {
-    PQueue->Kill([=](const EVENT &nItem)->bool {return (nItem.index == a1 && nItem.type == a2); });
+    PQueue->Kill(EVENT::Key(a1, a2), [=](const EVENT &nItem)->bool {return (nItem.index == a1 && nItem.type == a2); });
 }
 
 void EventQueue::Kill(int idx, int type, int causer)
 {
-    PQueue->Kill([=](const EVENT &nItem)->bool { return (nItem.index == idx && nItem.type == type && nItem.causer == causer); });
+    PQueue->Kill(EVENT::Key(idx, type), [=](const EVENT &nItem)->bool { return (nItem.index == idx && nItem.type == type && nItem.causer == causer); });
 }
 
 void EventQueue::Kill(int a1, int a2, CALLBACK_ID a3)
 {
-    PQueue->Kill([=](const EVENT &nItem)->bool {return (nItem.index == a1 && nItem.type == a2 && nItem.cmd == kCmdCallback && nItem.funcID == (unsigned int)a3); });
+    PQueue->Kill(EVENT::Key(a1, a2), [=](const EVENT &nItem)->bool {return (nItem.index == a1 && nItem.type == a2 && nItem.cmd == kCmdCallback && nItem.funcID == (unsigned int)a3); });
 }
 
 RXBUCKET rxBucket[kChannelMax+1];
@@ -644,10 +644,10 @@ void EventQLoadSave::Load()
 
 void EventQLoadSave::Save()
 {
-    EVENT events[1024];
-    unsigned int eventstime[1024];
     Write(&eventQ, sizeof(eventQ));
     int nEvents = eventQ.PQueue->Size();
+    EVENT *events = new EVENT[nEvents];
+    unsigned int *eventstime = new unsigned int[nEvents];
     Write(&nEvents, sizeof(nEvents));
     for (int i = 0; i < nEvents; i++)
     {
@@ -661,6 +661,8 @@ void EventQLoadSave::Save()
     {
         eventQ.PQueue->Insert(eventstime[i], events[i]);
     }
+    delete[] events;
+    delete[] eventstime;
     Write(rxBucket, sizeof(rxBucket));
     Write(bucketHead, sizeof(bucketHead));
 }
@@ -140,6 +140,10 @@ struct EVENT {
     unsigned int cmd:       8; // cmd
     unsigned int funcID:    8; // callback
     unsigned int causer:    14; // spritenum of object which initiated this event (kCauserGame == initiated by the game)
+
+    // (index, type) pair the event queue indexes events by for evKill()
+    static unsigned int Key(int nIndex, int nType) { return ((unsigned int)nType << 14) | ((unsigned int)nIndex & 0x3fff); }
+    unsigned int Key(void) const { return Key(index, type); }
 };
 
 void evInit(void);
@@ -23,6 +23,8 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #pragma once
 #include <set>
 #include <functional>
+#include <unordered_map>
+#include <vector>
 #include "common_game.h"
 #define kPQueueSize 1024
 
@@ -56,6 +58,7 @@ template <typename T> struct queueItem
     }
 };
 
+// T must provide Key(): Kill() only considers items whose Key() equals nKey.
 template<typename T> class PriorityQueue
 {
 public:
@@ -65,20 +68,30 @@ public:
     virtual void Insert(uint32_t, T) = 0;
     virtual T Remove(void) = 0;
     virtual uint32_t LowestPriority(void) = 0;
-    virtual void Kill(std::function<bool(T)> pMatch) = 0;
+    virtual void Kill(uint32_t nKey, std::function<bool(T)> pMatch) = 0;
 };
 
 template<typename T> class VanillaPriorityQueue : public PriorityQueue<T>
 {
 public:
-    queueItem<T> queueItems[kPQueueSize + 1];
+    queueItem<T> *queueItems;
     uint32_t fNodeCount; // at2008
-    ~VanillaPriorityQueue() {}
+    uint32_t nCapacity;
+    VanillaPriorityQueue()
+    {
+        nCapacity = kPQueueSize;
+        queueItems = (queueItem<T>*)Xcalloc(nCapacity + 1, sizeof(queueItem<T>));
+        fNodeCount = 0;
+    }
+    ~VanillaPriorityQueue()
+    {
+        Xfree(queueItems);
+    }
     uint32_t Size(void) { return fNodeCount; };
     void Clear(void)
     {
         fNodeCount = 0;
-        memset(queueItems, 0, sizeof(queueItems));
+        memset(queueItems, 0, (nCapacity + 1) * sizeof(queueItem<T>));
     }
     void Upheap(void)
     {
@@ -115,7 +128,13 @@ public:
     }
     void Insert(uint32_t a1, T a2)
     {
-        dassert(fNodeCount < kPQueueSize);
+        // the original heap is capped at kPQueueSize, growing keeps the order of
+        // everything that fits in it
+        if (fNodeCount == nCapacity)
+        {
+            nCapacity <<= 1;
+            queueItems = (queueItem<T>*)Xrealloc(queueItems, (nCapacity + 1) * sizeof(queueItem<T>));
+        }
         fNodeCount++;
         queueItems[fNodeCount].at0 = a1;
         queueItems[fNodeCount].at4 = a2;
@@ -133,11 +152,12 @@ public:
         dassert(fNodeCount > 0);
         return queueItems[1].at0;
     }
-    void Kill(std::function<bool(T)> pMatch)
+    void Kill(uint32_t nKey, std::function<bool(T)> pMatch)
     {
+        // must delete in heap order to keep the vanilla tie breaking
         for (unsigned int i = 1; i <= fNodeCount;)
         {
-            if (pMatch(queueItems[i].at4))
+            if (queueItems[i].at4.Key() == nKey && pMatch(queueItems[i].at4))
                 Delete(i);
             else
                 i++;
@@ -145,27 +165,51 @@ public:
     }
 };
 
+// Equal priorities are dispatched in insertion order, as std::multiset inserts
+// at the upper bound of the equal range. Items are also indexed by Key() so
+// Kill() only visits the candidates.
 template<typename T> class StdPriorityQueue : public PriorityQueue<T>
 {
 public:
+    typedef typename std::multiset<queueItem<T>>::iterator queueIter;
     std::multiset<queueItem<T>> stdQueue;
+    std::unordered_map<uint32_t, std::vector<queueIter>> keyIndex;
     ~StdPriorityQueue()
     {
-        stdQueue.clear();
+        Clear();
     }
     uint32_t Size(void) { return stdQueue.size(); };
     void Clear(void)
     {
         stdQueue.clear();
+        keyIndex.clear();
+    }
+    void Unindex(queueIter it)
+    {
+        auto bucket = keyIndex.find(it->at4.Key());
+        dassert(bucket != keyIndex.end());
+        auto &v = bucket->second;
+        for (unsigned int i = 0; i < v.size(); i++)
+        {
+            if (v[i] == it)
+            {
+                v[i] = v.back();
+                v.pop_back();
+                break;
+            }
+        }
+        if (v.empty())
+            keyIndex.erase(bucket);
     }
     void Insert(uint32_t nPriority, T data)
     {
-        stdQueue.insert({ nPriority, data });
+        keyIndex[data.Key()].push_back(stdQueue.insert({ nPriority, data }));
     }
     T Remove(void)
     {
         dassert(stdQueue.size() > 0);
         T data = stdQueue.begin()->at4;
+        Unindex(stdQueue.begin());
         stdQueue.erase(stdQueue.begin());
         return data;
     }
@@ -173,14 +217,24 @@ public:
     {
         return stdQueue.begin()->at0;
     }
-    void Kill(std::function<bool(T)> pMatch)
+    void Kill(uint32_t nKey, std::function<bool(T)> pMatch)
     {
-        for (auto i = stdQueue.begin(); i != stdQueue.end();)
+        auto bucket = keyIndex.find(nKey);
+        if (bucket == keyIndex.end())
+            return;
+        auto &v = bucket->second;
+        for (unsigned int i = 0; i < v.size();)
         {
-            if (pMatch(i->at4))
-                i = stdQueue.erase(i);
+            if (pMatch(v[i]->at4))
+            {
+                stdQueue.erase(v[i]);
+                v[i] = v.back();
+                v.pop_back();
+            }
             else
                 i++;
         }
+        if (v.empty())
+            keyIndex.erase(bucket);
     }
 };
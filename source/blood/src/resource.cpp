@@ -27,6 +27,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #include "crc32.h"
 #include "compat.h"
 #include "cache1d.h"
+#include "hash.h"
 #ifdef WITHKPLIB
 #include "kplib.h"
 #endif
@@ -42,7 +43,43 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #include "sound.h"
 #endif
 
-CACHENODE Resource::purgeHead = { NULL, &purgeHead, &purgeHead, 0 };
+CACHENODE Resource::purgeHead = { NULL, &purgeHead, &purgeHead, 0, false };
+int Resource::nExternalProbes;
+int Resource::nExternalSkips;
+
+// Every file name the virtual filesystem can open, including the mod dir, so
+// that name lookups only probe the filesystem for overrides that may exist.
+// Rebuilt whenever search paths, groups or the mod dir change.
+static hashtable_t h_externalFiles = { 2048, NULL };
+static int32_t nExternalGeneration = -1;
+static char zExternalModDir[BMAX_PATH];
+
+static void ExternalIndexAdd(const char *pzPath)
+{
+    BUILDVFS_FIND_REC *pList = klistpath(pzPath, "*", BUILDVFS_FIND_FILE);
+    for (BUILDVFS_FIND_REC *pRec = pList; pRec; pRec = pRec->next)
+        hash_add(&h_externalFiles, pRec->name, 0, 0);
+    klistfree(pList);
+}
+
+static bool ExternalMayExist(const char *filename)
+{
+    // the index only covers plain names in game filesystem mode
+    if (pathsearchmode || strpbrk(filename, "/\\"))
+        return true;
+
+    if (nExternalGeneration != searchpathgeneration || strcmp(zExternalModDir, g_modDir))
+    {
+        hash_init(&h_externalFiles);
+        ExternalIndexAdd("/");
+        if (g_modDir[0] != '/' || g_modDir[1] != 0)
+            ExternalIndexAdd(g_modDir);
+        nExternalGeneration = searchpathgeneration;
+        Bstrncpyz(zExternalModDir, g_modDir, sizeof(zExternalModDir));
+    }
+
+    return hash_findcase(&h_externalFiles, filename) != -1;
+}
 
 #ifdef USE_QHEAP
 QHeap *Resource::heap;
@@ -56,6 +93,8 @@ Resource::Resource(void)
     count = 0;
     handle = -1;
     crypt = true;
+    mapping = NULL;
+    mappingSize = 0;
 }
 
 Resource::~Resource(void)
@@ -100,6 +139,9 @@ void Resource::Init(const char *filename)
         {
             int nFileLength = kfilelength(handle);
             dassert(nFileLength != -1);
+            mapping = (char *)kview(handle, 0, nFileLength);
+            if (mapping)
+                mappingSize = nFileLength;
             if (kread(handle, &header, sizeof(RFFHeader)) != sizeof(RFFHeader)
                 || memcmp(header.sign, "RFF\x1a", 4))
             {
@@ -239,13 +281,17 @@ void Resource::Flush(CACHENODE *h)
 {
     if (h->ptr)
     {
+        if (!h->mapped)
+        {
 #ifdef USE_QHEAP
-        heap->Free(h->ptr);
+            heap->Free(h->ptr);
 #else
-        delete[] (char*)h->ptr;
+            delete[] (char*)h->ptr;
 #endif
-        
+        }
+
         h->ptr = NULL;
+        h->mapped = false;
         if (h->lockCount == 0)
         {
             RemoveMRU(h);
@@ -384,6 +430,12 @@ void Resource::AddExternalResource(const char *name, const char *type, int id, i
     else
         Bstrncpy(path, filename, BMAX_PATH-1);
 
+    if (!ExternalMayExist(filename))
+    {
+        nExternalSkips++;
+        return;
+    }
+    nExternalProbes++;
     int fhandle = kopen4loadfrommod(filename, 0);
     if (fhandle == -1)
         return;
@@ -595,8 +647,9 @@ void *Resource::Alloc(int nSize)
     {
         dassert(node->lockCount == 0);
         dassert(node->ptr != NULL);
-        int nFree = heap->Free(node->ptr);
+        int nFree = node->mapped ? 0 : heap->Free(node->ptr);
         node->ptr = NULL;
+        node->mapped = false;
         RemoveMRU(node);
         if (nSize <= nFree)
         {
@@ -618,8 +671,10 @@ void *Resource::Alloc(int nSize)
     {
         dassert(node->lockCount == 0);
         dassert(node->ptr != NULL);
-        delete[] (char*)node->ptr;
+        if (!node->mapped)
+            delete[] (char*)node->ptr;
         node->ptr = NULL;
+        node->mapped = false;
         RemoveMRU(node);
         p = new char[nSize];
         if (p)
@@ -694,6 +749,10 @@ void Resource::Read(DICTNODE *n, void *p)
     {
         Bmemcpy(p, n->buffer, n->size);
     }
+    else if (mapping && n->offset <= mappingSize && n->size <= mappingSize - n->offset)
+    {
+        Bmemcpy(p, mapping + n->offset, n->size);
+    }
     else
     {
         int r = klseek(handle, n->offset, SEEK_SET);
@@ -705,6 +764,9 @@ void Resource::Read(DICTNODE *n, void *p)
         {
             ThrowError("Error loading resource!");
         }
+    }
+    if (!(n->flags & (DICT_EXTERNAL | DICT_BUFFER)))
+    {
         if (n->flags & DICT_CRYPT)
         {
             int size;
@@ -796,6 +858,20 @@ void Resource::Read(DICTNODE *n, void *p)
     }
 }
 
+// Points a node straight into the mapped RFF instead of copying it to the heap. Only done
+// for sample data, which is never decrypted or byte swapped; the mapping is copy-on-write,
+// so a caller that does write to it only dirties its own pages.
+bool Resource::View(DICTNODE *h)
+{
+    if (!mapping || (h->flags & (DICT_EXTERNAL | DICT_BUFFER | DICT_CRYPT)) || Bstrcmp(h->type, "RAW")
+        || h->offset > mappingSize || h->size > mappingSize - h->offset)
+        return false;
+
+    h->ptr = mapping + h->offset;
+    h->mapped = true;
+    return true;
+}
+
 void *Resource::Load(DICTNODE *h)
 {
     dassert(h != NULL);
@@ -813,8 +889,11 @@ void *Resource::Load(DICTNODE *h)
     }
     else
     {
-        h->ptr = Alloc(h->size);
-        Read(h);
+        if (!View(h))
+        {
+            h->ptr = Alloc(h->size);
+            Read(h);
+        }
 
         h->prev = purgeHead.prev;
         purgeHead.prev->next = h;
@@ -844,7 +923,7 @@ void *Resource::Lock(DICTNODE *h)
             RemoveMRU(h);
         }
     }
-    else
+    else if (!View(h))
     {
         h->ptr = Alloc(h->size);
         Read(h);
@@ -918,8 +997,10 @@ void Resource::PurgeCache(void)
         {
             dassert(pDict->lockCount == 0);
             dassert(pDict->ptr != NULL);
-            Free(pDict->ptr);
+            if (!pDict->mapped)
+                Free(pDict->ptr);
             pDict->ptr = NULL;
+            pDict->mapped = false;
             RemoveMRU(pDict);
         }
     }
@@ -66,6 +66,7 @@ struct CACHENODE
     CACHENODE *prev;
     CACHENODE *next;
     int lockCount;
+    bool mapped; // ptr points into a copy-on-write file mapping rather than the heap
 };
 
 struct DICTNODE : CACHENODE
@@ -103,6 +104,7 @@ public:
     DICTNODE *Lookup(unsigned int id, const char *type);
     void Read(DICTNODE *n);
     void Read(DICTNODE *n, void *p);
+    bool View(DICTNODE *h);
     void *Load(DICTNODE *h);
     void *Load(DICTNODE *h, void *p);
     void *Lock(DICTNODE *h);
@@ -122,9 +124,15 @@ public:
     unsigned int count;
     int handle;
     bool crypt;
+    char *mapping;
+    unsigned int mappingSize;
 
 #if USE_QHEAP
     static QHeap *heap;
 #endif
     static CACHENODE purgeHead;
+
+    // filesystem probes for external overrides, and lookups that skipped them
+    static int nExternalProbes;
+    static int nExternalSkips;
 };
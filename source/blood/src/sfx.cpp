@@ -452,6 +452,11 @@ void sfxUpdate3DSounds(void)
     earVL.dy = earL.y - earL0.y;
     earVR.dx = earR.x - earR0.x;
     earVR.dy = earR.y - earR0.y;
+
+    // pans are handed to the mixer in batches so it is locked once per batch rather than once per channel
+    MV_PanUpdate pan[64];
+    int nPan = 0;
+
     for (int i = nBonkles - 1; i >= 0; i--)
     {
         BONKLE *pBonkle = BonkleCache[i];
@@ -468,23 +473,26 @@ void sfxUpdate3DSounds(void)
                 pBonkle->sectnum = pBonkle->pSndSpr->sectnum;
             }
             Calc3DValues(pBonkle);
-            // MV_Lock();
+            if (nPan > ARRAY_SSIZE(pan) - 2)
+            {
+                FX_SetPanBatch(pan, nPan);
+                nPan = 0;
+            }
             if (pBonkle->lChan > 0)
             {
                 if (pBonkle->rChan > 0)
                 {
-                    FX_SetPan(pBonkle->lChan, lVol, lVol, 0);
+                    pan[nPan++] = { pBonkle->lChan, lVol, lVol, 0 };
                     FX_SetFrequency(pBonkle->lChan, lPitch);
                 }
                 else
-                    FX_SetPan(pBonkle->lChan, lVol, lVol, rVol);
+                    pan[nPan++] = { pBonkle->lChan, lVol, lVol, rVol };
             }
             if (pBonkle->rChan > 0)
             {
-                FX_SetPan(pBonkle->rChan, rVol, 0, rVol);
+                pan[nPan++] = { pBonkle->rChan, rVol, 0, rVol };
                 FX_SetFrequency(pBonkle->rChan, rPitch);
             }
-            // MV_Unlock();
         }
         else
         {
@@ -494,6 +502,9 @@ void sfxUpdate3DSounds(void)
             BonkleCache[nBonkles] = pBonkle;
         }
     }
+
+    if (nPan)
+        FX_SetPanBatch(pan, nPan);
 }
 
 void sfxSetReverb(bool toggle)
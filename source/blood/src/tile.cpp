@@ -141,15 +141,34 @@ void tileProcessGLVoxels(void)
     if (voxInit)
         return;
     voxInit = true;
+    // Lock every voxel first so that all of them can be meshed in one batch
+    voxloadjob_t *pJobs = (voxloadjob_t*)Xmalloc(kMaxVoxels * sizeof(voxloadjob_t));
+    DICTNODE **pNodes = (DICTNODE**)Xmalloc(kMaxVoxels * sizeof(DICTNODE*));
+    int16_t *pIndex = (int16_t*)Xmalloc(kMaxVoxels * sizeof(int16_t));
+    int nJobs = 0;
     for (int i = 0; i < kMaxVoxels; i++)
     {
         DICTNODE *hVox = gSysRes.Lookup(i, "KVX");
         if (!hVox)
             continue;
-        char *pVox = (char*)gSysRes.Load(hVox);
-        voxmodels[i] = loadkvxfrombuf(pVox, hVox->size);
-        voxvboalloc(voxmodels[i]);
+        char *pVox = (char*)gSysRes.Lock(hVox);
+        if (!pVox)
+            continue;
+        pJobs[nJobs] = { NULL, pVox, (int32_t)hVox->size, NULL };
+        pNodes[nJobs] = hVox;
+        pIndex[nJobs++] = i;
+    }
+    voxloadbatch(pJobs, nJobs);
+    for (int j = 0; j < nJobs; j++)
+    {
+        gSysRes.Unlock(pNodes[j]);
+        voxmodels[pIndex[j]] = pJobs[j].vm;
+        if (pJobs[j].vm)
+            voxvboalloc(pJobs[j].vm);
     }
+    Xfree(pIndex);
+    Xfree(pNodes);
+    Xfree(pJobs);
 }
 #endif
 
@@ -819,6 +819,7 @@ void DragPoint(int nWall, int x, int y)
     viewInterpolateWall(nWall, &wall[nWall]);
     wall[nWall].x = x;
     wall[nWall].y = y;
+    sectorgrid_updatewall(nWall);
 
     int vsi = numwalls;
     int vb = nWall;
@@ -830,6 +831,7 @@ void DragPoint(int nWall, int x, int y)
             viewInterpolateWall(vb, &wall[vb]);
             wall[vb].x = x;
             wall[vb].y = y;
+            sectorgrid_updatewall(vb);
         }
         else
         {
@@ -842,6 +844,7 @@ void DragPoint(int nWall, int x, int y)
                     viewInterpolateWall(vb, &wall[vb]);
                     wall[vb].x = x;
                     wall[vb].y = y;
+                    sectorgrid_updatewall(vb);
                 }
                 else
                     break;
@@ -113,7 +113,10 @@ void slopevlin(intptr_t p, int32_t i, intptr_t slopaloffs, bssize_t cnt, int32_t
 
 void setupvlineasm(int32_t neglogy);
 int32_t vlineasm1(int32_t vinc, intptr_t paloffs, bssize_t cnt, uint32_t vplc, intptr_t bufplc, intptr_t p);
+int32_t vlineasm1_ex(int32_t vinc, intptr_t paloffs, bssize_t cnt, uint32_t vplc, intptr_t bufplc, intptr_t p, int32_t logy, int32_t tilesizy);
 void vlineasm4(bssize_t cnt, char *p);
+void vlineasm4_ex(bssize_t cnt, char *p, const intptr_t *paloffs, const intptr_t *bufplcs, uint32_t *vplcs, const int32_t *vincs,
+                  int32_t logy, int32_t tilesizy);
 
 void setupmvlineasm(int32_t neglogy, int32_t dosaturate);
 int32_t mvlineasm1(int32_t vinc, intptr_t paloffs, bssize_t cnt, uint32_t vplc, intptr_t bufplc, intptr_t p);
@@ -140,6 +143,16 @@ void mspritevline(int32_t bx, int32_t by, bssize_t cnt, intptr_t bufplc, intptr_
 void tsetupspritevline(intptr_t paloffs, int32_t bxinc, int32_t byinc, int32_t ysiz);
 void tspritevline(int32_t bx, int32_t by, bssize_t cnt, intptr_t bufplc, intptr_t p);
 
+// Kernels for mvlineasm4(), spritevline() and slopevlin()
+enum
+{
+    VLINE_KERNEL_C,
+    VLINE_KERNEL_SIMD,  // SSE2 on x86, NEON on ARM
+    VLINE_KERNEL_BEST = VLINE_KERNEL_SIMD,
+};
+
+int32_t setvlinekernel(int32_t kernel);
+
 void setupdrawslab (int32_t dabpl, intptr_t pal);
 void drawslab (int32_t dx, int32_t v, int32_t dy, int32_t vi, intptr_t vptr, intptr_t p);
 void stretchhline (intptr_t p0, int32_t u, bssize_t cnt, int32_t uinc, intptr_t rptr, intptr_t p);
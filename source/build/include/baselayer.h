@@ -59,6 +59,7 @@ extern bool startwin_isopen(void);
 extern int32_t r_rotatespriteinterp;
 extern int32_t r_usenewaspect, newaspect_enable;
 extern int32_t r_fpgrouscan;
+extern int32_t r_classicthreads;
 extern int32_t setaspect_new_use_dimen;
 extern uint32_t r_screenxy;
 extern int32_t xres, yres, bpp, fullscreen, bytesperline;
@@ -1288,6 +1288,7 @@ static FORCE_INLINE int32_t drawrooms(int32_t daposx, int32_t daposy, int32_t da
 }
 
 void   renderDrawMasks(void);
+int32_t renderBenchmarkClassic(int32_t numviews, int32_t numframes);
 void   videoClearViewableArea(int32_t dacol);
 void   videoClearScreen(int32_t dacol);
 void   renderDrawMapView(int32_t dax, int32_t day, int32_t zoome, int16_t ang);
@@ -1361,6 +1362,11 @@ int32_t   inside(int32_t x, int32_t y, int16_t sectnum);
 void   calc_sector_reachability(void);
 int    sectorsareconnected(int const, int const);
 void   dragpoint(int16_t pointhighlight, int32_t dax, int32_t day, uint8_t flags);
+// Game code that moves walls without dragpoint() must report the walls or
+// sectors it moved, or invalidate the grid after replacing wall[] wholesale.
+void   sectorgrid_update(int16_t sectnum);
+void   sectorgrid_updatewall(int16_t wallnum);
+void   sectorgrid_invalidate(void);
 void   setfirstwall(int16_t sectnum, int16_t newfirstwall);
 int32_t try_facespr_intersect(uspriteptr_t const spr, vec3_t const in,
                                      int32_t vx, int32_t vy, int32_t vz,
@@ -1567,6 +1573,13 @@ int32_t polymost_drawtilescreen(int32_t tilex, int32_t tiley, int32_t tilenum, i
                                 int32_t usehitile, uint8_t *loadedhitile);
 void polymost_glreset(void);
 void polymost_precache(int32_t dapicnum, int32_t dapalnum, int32_t datype);
+// Queues the hightile replacements of every tile set in <tilemap> to be decoded
+// on all cores ahead of the polymost_precache() calls for them; <datype> is as above.
+void polymost_prefetch(uint8_t const *tilemap, int32_t datype);
+// Call from the precache loop before precaching <dapicnum>, in ascending tile
+// order: reads the queued files of the tiles just ahead and starts decoding them.
+void polymost_prefetchnext(int32_t dapicnum);
+void polymost_prefetchfree(void);
 
 enum cutsceneflags {
     CUTSCENE_FORCEFILTER = 1,
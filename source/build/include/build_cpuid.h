@@ -21,6 +21,8 @@ struct cpuinfo_t
     struct
     {
         unsigned int invariant_tsc : 1;
+        unsigned int sse2 : 1;
+        unsigned int avx2 : 1;
     } features;
 };
 
@@ -14,12 +14,23 @@
 #define MINCACHEINDEXSIZE 1024
 #define MINCACHEBLOCKSIZE 16
 
+// free blocks are binned by floor(log2(leng / MINCACHEBLOCKSIZE))
+#define CACHE1D_FREECLASSES 32
+// allocation latency buckets: < 1us, < 2us, ... and everything above
+#define CACHE1D_HISTBUCKETS 16
+
+// m_index is a dense pool: entries [0, numBlocks()) are live blocks in no
+// particular order, linked in address order through prev/next. Free blocks
+// are additionally linked into their size class through fprev/fnext.
 typedef struct
 {
     char *    lock;
     intptr_t *hand;
     int32_t   leng;
     int32_t   ovh;
+    int32_t   offs;
+    int32_t   prev, next;
+    int32_t   fprev, fnext;
 } cacheindex_t;
 
 enum cachelock_t : char
@@ -46,6 +57,15 @@ public:
 private:
     void inc_and_check_cacnum(void);
 
+    int  newBlock(int32_t offs, int32_t leng, int after);
+    void removeBlock(int blk, int &track);
+    void linkFree(int blk);
+    void unlinkFree(int blk);
+    int  findFree(int32_t newbytes);
+    int  findEvictable(int32_t newbytes);
+    void insertRemainder(int blk, int32_t leng);
+    void recordLatency(int evicted, uint64_t ticks);
+
     cacheindex_t *m_index{};
 
     intptr_t m_baseAddress{};
@@ -53,6 +73,14 @@ private:
 
     int m_maxBlocks{};
     int m_numBlocks{};
+
+    int m_head{}, m_tail{};
+
+    int      m_freeHead[CACHE1D_FREECLASSES];
+    uint32_t m_freeMask{};
+
+    // [0] served from a free list, [1] had to evict
+    uint32_t m_allocHist[2][CACHE1D_HISTBUCKETS]{};
 };
 
 extern cache1d g_cache;
@@ -64,7 +64,7 @@ void hicsetpalettetint(int32_t palnum, char r, char g, char b, char sr, char sg,
 // flags bitset: 1 = don't compress
 int32_t hicsetsubsttex(int32_t picnum, int32_t palnum, const char *filen, float alphacut,
                        float xscale, float yscale, float specpower, float specfactor, char flags);
-int32_t hicsetskybox(int32_t picnum, int32_t palnum, char *faces[6], int32_t flags);
+int32_t hicsetskybox(int32_t picnum, int32_t palnum, char const *const faces[6], int32_t flags);
 int32_t hicclearsubst(int32_t picnum, int32_t palnum);
 
 static inline int have_basepal_tint(void)
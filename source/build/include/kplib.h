@@ -37,6 +37,7 @@ extern int32_t kprender (const char *, int32_t, intptr_t, int32_t, int32_t, int3
 	//ZIP functions:
 extern int32_t kzaddstack (const char *);
 extern void kzuninit ();
+extern int32_t kzhasfiles ();
 extern intptr_t kzopen (const char *);
 extern int32_t kzread (void *, int32_t);
 extern int32_t kzseek (int32_t, int32_t);
@@ -47,6 +48,16 @@ static inline int32_t kzfilelength(void) { return kzfs.fil ? kzfs.leng : 0; }
 static inline int32_t kzgetc(void) { char ch; return kzread(&ch, 1) ? ch : -1; }
 static inline void kzclose(void) { MAYBE_FCLOSE_AND_NULL(kzfs.fil); }
 
+	//Independent ZIP streams: each has its own file pointer and inflate state,
+	//so several can be read alternately without re-inflating on every switch.
+typedef struct kzstream kzstream;
+extern kzstream *kzsopen (const char *);
+extern void kzsclose (kzstream *);
+extern int32_t kzsread (kzstream *, void *, int32_t);
+extern int32_t kzsseek (kzstream *, int32_t, int32_t);
+extern int32_t kzstell (kzstream const *);
+extern int32_t kzsfilelength (kzstream const *);
+
 extern void kzfindfilestart (const char *); //pass wildcard string
 extern int32_t kzfindfile (char *); //you alloc buf, returns 1:found,0:~found
 
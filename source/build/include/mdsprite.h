@@ -239,6 +239,19 @@ void voxvbofree(voxmodel_t *vm);
 void voxfree(voxmodel_t *m);
 voxmodel_t *voxload(const char *filnam);
 voxmodel_t *loadkvxfrombuf(const char *buffer, int32_t length);
+
+// Either filnam names a .vox/.kvx/.kv6 file, or buffer/length hold a KVX file in memory.
+typedef struct
+{
+    const char *filnam;
+    const char *buffer;
+    int32_t     length;
+    voxmodel_t *vm;  // out: NULL on failure
+} voxloadjob_t;
+
+// Loads several voxels at once, meshing the ones not in the mesh cache on the worker pool.
+// Returns how many came from the cache.
+int32_t voxloadbatch(voxloadjob_t *jobs, int32_t numjobs);
 int32_t polymost_voxdraw(voxmodel_t *m, tspriteptr_t const tspr);
 
 int      md3postload_polymer(md3model_t* m);
@@ -0,0 +1,29 @@
+#pragma once
+
+#ifndef netdelta_h_
+#define netdelta_h_
+
+#include "compat.h"
+
+// Byte-level snapshot deltas.
+//
+// The "from" and "to" buffers are compared 16 bytes at a time. A delta is a
+// sequence of runs: a varint count of unchanged blocks to skip, a varint count
+// of changed blocks that follow, then for each changed block a 16-bit mask of
+// the bytes that differ and those bytes from "to". A run with no changed
+// blocks ends the delta, so several deltas can be written back to back.
+
+#define NETDELTA_BLOCK 16
+
+// worst case for a delta of size bytes: every block changed, with room for the run and end headers
+#define netDeltaBound(size) ((((size) + NETDELTA_BLOCK - 1) / NETDELTA_BLOCK) * (NETDELTA_BLOCK + 2) + 24)
+
+// Writes the delta from "from" to "to" into out, which must hold netDeltaBound(size) bytes.
+// Returns the number of bytes written.
+int32_t netDeltaEncode(void const *from, void const *to, int32_t size, uint8_t *out);
+
+// Patches buf, which holds the "from" bytes, into the "to" bytes. Returns the number of
+// bytes of delta consumed, or -1 if the delta is truncated or runs past the end of buf.
+int32_t netDeltaApply(void *buf, int32_t size, uint8_t const *delta, int32_t deltasize);
+
+#endif
@@ -78,9 +78,6 @@ extern void texcache_setupmemcache(void);
 extern void texcache_checkgarbage(void);
 extern void texcache_setupindex(void);
 
-extern voxmodel_t* voxcache_fetchvoxmodel(const char* const cacheid);
-extern void voxcache_writevoxmodel(const char* const cacheid, voxmodel_t* vm);
-
 #endif
 
 #ifdef __cplusplus
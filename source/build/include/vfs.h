@@ -190,6 +190,10 @@ extern char *kpzbuf;
 extern int32_t kpzbufsiz;
 extern int32_t kpzbufload(const char *);
 
+// Bumped whenever a search path or group file is added or removed, so callers
+// can cache what the virtual filesystem contains.
+extern int32_t searchpathgeneration;
+
 #ifdef USE_PHYSFS
 using buildvfs_kfd = PHYSFS_File *;
 #define buildvfs_kfd_invalid (nullptr)
@@ -199,11 +203,13 @@ extern int32_t pathsearchmode;	// 0 = gamefs mode (default), 1 = localfs mode (e
 #define addsearchpath(a) addsearchpath_user(a, 0)
 static inline int32_t addsearchpath_user(const char *p, int32_t)
 {
+    searchpathgeneration++;
     return PHYSFS_mount(p, NULL, 1) == 0 ? -1 : 0;
 }
 
 static inline int32_t removesearchpath(const char *p)
 {
+    searchpathgeneration++;
     return PHYSFS_unmount(p);
 }
 static inline void removesearchpaths_withuser(int32_t)
@@ -223,6 +229,7 @@ void uninitgroupfile(void);
 
 static inline int initgroupfile(const char *filename)
 {
+    searchpathgeneration++;
     return PHYSFS_mount(filename, NULL, 1) == 0 ? -1 : 0;
 }
 
@@ -247,6 +254,11 @@ static inline void krename(int32_t, int32_t, const char *)
 {
 }
 
+static inline void *kview(buildvfs_kfd, int32_t, int32_t)
+{
+    return nullptr;
+}
+
 #else
 using buildvfs_kfd = int32_t;
 #define buildvfs_kfd_invalid (-1)
@@ -274,9 +286,15 @@ int32_t	klseek(buildvfs_kfd handle, int32_t offset, int32_t whence);
 int32_t	kfilelength(buildvfs_kfd handle);
 int32_t	ktell(buildvfs_kfd handle);
 void	kclose(buildvfs_kfd handle);
+// Pointer to leng bytes at offset within an open file, valid until the handle is closed, or
+// NULL if the file isn't (or can't be) memory mapped. Independent of the read position. The
+// mapping is copy-on-write: writes through it stay private to the process.
+void *kview(buildvfs_kfd handle, int32_t offset, int32_t leng);
 
 void krename(int32_t crcval, int32_t filenum, const char *newname);
 char const * kfileparent(int32_t handle);
+// Name of the i-th group or zip file added with initgroupfile(), or NULL past the last one.
+char const *kgroupfilename(int32_t i);
 #endif
 
 extern int32_t kpzbufloadfil(buildvfs_kfd);
@@ -11,10 +11,37 @@
 // by the EDuke32 team (development@voidpoint.com)
 
 #include "a.h"
+#include "build_cpuid.h"
 #include "pragmas.h"
 
 #ifdef ENGINE_USING_A_C
 
+// SIMD column kernels. The SSE2 ones are selected at runtime from the CPUID
+// feature bits, NEON is used whenever the compiler targets it.
+//
+// mvlineasm4(), spritevline() and slopevlin() have one. They work out the
+// texture coordinates of four pixels at once, and mvlineasm4() also tests four
+// texels for transparency with one compare; the texel and palookup fetches stay
+// scalar loads. tvlineasm1() and tvlineasm2() have none: their time goes into
+// the texel, palookup and translucency table loads, and with the index math and
+// blend table indices done four pixels at a time they ran 15-35% slower than
+// the C loops in ebench -kernels. Neither is there an AVX2 kernel, since
+// gathering those bytes was slower than the scalar loads it replaced.
+#if defined EDUKE32_CPU_X86 && (defined __GNUC__ || defined _MSC_VER)
+# define A_C_SIMD_SSE2
+# include <emmintrin.h>
+# if defined __GNUC__ && !defined __SSE2__
+#  define A_C_TARGET_SSE2 __attribute__((target("sse2")))
+# else
+#  define A_C_TARGET_SSE2
+# endif
+# define A_C_TARGET_SIMD A_C_TARGET_SSE2
+#elif defined EDUKE32_CPU_ARM && defined __ARM_NEON
+# define A_C_SIMD_NEON
+# include <arm_neon.h>
+# define A_C_TARGET_SIMD
+#endif
+
 #define BITSOFPRECISION 3
 #define BITSOFPRECISIONPOW 8
 
@@ -44,6 +71,114 @@ void fixtransluscence(intptr_t datransoff)
 void settransnormal(void) { transmode = 0; }
 void settransreverse(void) { transmode = 1; }
 
+static int32_t vlinekernel = VLINE_KERNEL_BEST;
+
+// Selects the column kernels, falling back to the best one available below the
+// requested one. Returns the kernel actually used.
+int32_t setvlinekernel(int32_t kernel)
+{
+#if defined A_C_SIMD_SSE2
+    if (kernel >= VLINE_KERNEL_SIMD && cpu.features.sse2)
+        return vlinekernel = VLINE_KERNEL_SIMD;
+#elif defined A_C_SIMD_NEON
+    if (kernel >= VLINE_KERNEL_SIMD)
+        return vlinekernel = VLINE_KERNEL_SIMD;
+#else
+    UNREFERENCED_PARAMETER(kernel);
+#endif
+
+    return vlinekernel = VLINE_KERNEL_C;
+}
+
+#if defined A_C_SIMD_SSE2
+static FORCE_INLINE bool vline_simd(void) { return vlinekernel >= VLINE_KERNEL_SIMD && cpu.features.sse2; }
+
+typedef __m128i vline4_t;
+
+A_C_TARGET_SSE2 static FORCE_INLINE vline4_t vline4_set(uint32_t a, uint32_t b, uint32_t c, uint32_t d) { return _mm_setr_epi32(a, b, c, d); }
+A_C_TARGET_SSE2 static FORCE_INLINE vline4_t vline4_dup(uint32_t a) { return _mm_set1_epi32(a); }
+A_C_TARGET_SSE2 static FORCE_INLINE vline4_t vline4_load(const void *p) { return _mm_loadu_si128((__m128i const *)p); }
+A_C_TARGET_SSE2 static FORCE_INLINE void vline4_store(void *p, vline4_t a) { _mm_storeu_si128((__m128i *)p, a); }
+A_C_TARGET_SSE2 static FORCE_INLINE vline4_t vline4_add(vline4_t a, vline4_t b) { return _mm_add_epi32(a, b); }
+A_C_TARGET_SSE2 static FORCE_INLINE vline4_t vline4_shr(vline4_t a, int32_t n) { return _mm_srl_epi32(a, _mm_cvtsi32_si128(n)); }
+A_C_TARGET_SSE2 static FORCE_INLINE vline4_t vline4_shl(vline4_t a, int32_t n) { return _mm_sll_epi32(a, _mm_cvtsi32_si128(n)); }
+A_C_TARGET_SSE2 static FORCE_INLINE vline4_t vline4_sar(vline4_t a, int32_t n) { return _mm_sra_epi32(a, _mm_cvtsi32_si128(n)); }
+
+// low halves of the 32x32 products, SSE2 has no _mm_mullo_epi32()
+A_C_TARGET_SSE2 static FORCE_INLINE vline4_t vline4_mul(vline4_t a, vline4_t b)
+{
+    __m128i const even = _mm_mul_epu32(a, b);
+    __m128i const odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+    return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)), _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+}
+
+// ourmulscale32() on all four lanes: high halves of the 32x32->64 products
+A_C_TARGET_SSE2 static FORCE_INLINE vline4_t vline4_mulscale32(vline4_t a, vline4_t b)
+{
+    __m128i const even = _mm_srli_epi64(_mm_mul_epu32(a, b), 32);
+    __m128i const odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), b);
+    return _mm_or_si128(even, _mm_and_si128(odd, _mm_set_epi32(-1, 0, -1, 0)));
+}
+
+// vplc |= saturate & -(vplc < vinc), unsigned. SSE2 only compares signed, so both sides are biased.
+A_C_TARGET_SSE2 static FORCE_INLINE vline4_t vline4_saturate(vline4_t vplc, vline4_t vinc, vline4_t saturate)
+{
+    __m128i const bias = _mm_set1_epi32(INT32_MIN);
+    return _mm_or_si128(vplc, _mm_and_si128(saturate, _mm_cmpgt_epi32(_mm_xor_si128(vinc, bias), _mm_xor_si128(vplc, bias))));
+}
+
+// 0xff in every byte of the four texels that is 255 (transparent)
+A_C_TARGET_SSE2 static FORCE_INLINE uint32_t vline4_transmask(uint32_t tex)
+{
+    return _mm_cvtsi128_si32(_mm_cmpeq_epi8(_mm_cvtsi32_si128(tex), _mm_set1_epi8((char)255)));
+}
+
+#elif defined A_C_SIMD_NEON
+static FORCE_INLINE bool vline_simd(void) { return vlinekernel >= VLINE_KERNEL_SIMD; }
+
+typedef uint32x4_t vline4_t;
+
+static FORCE_INLINE vline4_t vline4_set(uint32_t a, uint32_t b, uint32_t c, uint32_t d)
+{
+    uint32_t const v[4] = { a, b, c, d };
+    return vld1q_u32(v);
+}
+static FORCE_INLINE vline4_t vline4_dup(uint32_t a) { return vdupq_n_u32(a); }
+static FORCE_INLINE vline4_t vline4_load(const void *p) { return vld1q_u32((uint32_t const *)p); }
+static FORCE_INLINE void vline4_store(void *p, vline4_t a) { vst1q_u32((uint32_t *)p, a); }
+static FORCE_INLINE vline4_t vline4_add(vline4_t a, vline4_t b) { return vaddq_u32(a, b); }
+static FORCE_INLINE vline4_t vline4_shr(vline4_t a, int32_t n) { return vshlq_u32(a, vdupq_n_s32(-n)); }
+static FORCE_INLINE vline4_t vline4_shl(vline4_t a, int32_t n) { return vshlq_u32(a, vdupq_n_s32(n)); }
+static FORCE_INLINE vline4_t vline4_sar(vline4_t a, int32_t n) { return vreinterpretq_u32_s32(vshlq_s32(vreinterpretq_s32_u32(a), vdupq_n_s32(-n))); }
+static FORCE_INLINE vline4_t vline4_mul(vline4_t a, vline4_t b) { return vmulq_u32(a, b); }
+
+static FORCE_INLINE vline4_t vline4_mulscale32(vline4_t a, vline4_t b)
+{
+    uint32x2_t const lo = vshrn_n_u64(vmull_u32(vget_low_u32(a), vget_low_u32(b)), 32);
+    uint32x2_t const hi = vshrn_n_u64(vmull_u32(vget_high_u32(a), vget_high_u32(b)), 32);
+    return vcombine_u32(lo, hi);
+}
+
+static FORCE_INLINE vline4_t vline4_saturate(vline4_t vplc, vline4_t vinc, vline4_t saturate)
+{
+    return vorrq_u32(vplc, vandq_u32(saturate, vcltq_u32(vplc, vinc)));
+}
+
+static FORCE_INLINE uint32_t vline4_transmask(uint32_t tex)
+{
+    return vget_lane_u32(vreinterpret_u32_u8(vceq_u8(vreinterpret_u8_u32(vdup_n_u32(tex)), vdup_n_u8(255))), 0);
+}
+#endif
+
+#if defined A_C_SIMD_SSE2 || defined A_C_SIMD_NEON
+// Texel row of each lane: vplc>>logy, or ourmulscale32(vplc, tilesizy) for
+// non-power-of-two tiles (logy == 0)
+A_C_TARGET_SIMD static FORCE_INLINE vline4_t vline4_texrow(vline4_t vplc, int32_t logy, vline4_t tilesizy)
+{
+    return logy ? vline4_shr(vplc, logy) : vline4_mulscale32(vplc, tilesizy);
+}
+#endif
+
 
 ///// Ceiling/floor horizontal line functions /////
 
@@ -93,6 +228,45 @@ void hlineasm4(bssize_t cnt, int32_t skiploadincs, int32_t paloffs, uint32_t by,
 
 
 ///// Sloped ceiling/floor vertical line functions /////
+#if defined A_C_SIMD_SSE2 || defined A_C_SIMD_NEON
+// Draws the first cnt&~3 pixels and returns how many were drawn
+A_C_TARGET_SIMD static bssize_t slopevlin_simd(char *p, const intptr_t *slopalptr, bssize_t cnt, int32_t bz, int32_t bzinc, int32_t bx, int32_t by)
+{
+    vline4_t bz4 = vline4_set(bz, bz + bzinc, bz + (uint32_t)bzinc*2, bz + (uint32_t)bzinc*3);
+    vline4_t const bzinc4 = vline4_dup((uint32_t)bzinc << 2);
+    vline4_t const half = vline4_dup(HALFSLOPTABLESIZ);
+    vline4_t const xtou = vline4_dup(globalx3), ytov = vline4_dup(globaly3);
+    vline4_t const bx4 = vline4_dup(bx), by4 = vline4_dup(by);
+    const char *const A_C_RESTRICT buf = gbuf;
+    int32_t const logx = glogx, logy = glogy, pinc = gpinc;
+    int32_t slop[4];
+    uint32_t idx[4];
+    bssize_t const n = cnt & ~3;
+
+    for (cnt = n; cnt > 0; cnt -= 4)
+    {
+        vline4_store(slop, vline4_add(vline4_sar(bz4, 6), half));
+
+        vline4_t const i = vline4_set(sloptable[slop[0]], sloptable[slop[1]], sloptable[slop[2]], sloptable[slop[3]]);
+        vline4_t const u = vline4_add(bx4, vline4_mul(xtou, i));
+        vline4_t const v = vline4_add(by4, vline4_mul(ytov, i));
+
+        vline4_store(idx, vline4_add(vline4_shl(vline4_shr(u, 32-logx), logy), vline4_shr(v, 32-logy)));
+
+        p[0]      = *(char *)(slopalptr[0] + buf[idx[0]]);
+        p[pinc]   = *(char *)(slopalptr[-1] + buf[idx[1]]);
+        p[pinc*2] = *(char *)(slopalptr[-2] + buf[idx[2]]);
+        p[pinc*3] = *(char *)(slopalptr[-3] + buf[idx[3]]);
+
+        bz4 = vline4_add(bz4, bzinc4);
+        slopalptr -= 4;
+        p += pinc*4;
+    }
+
+    return n;
+}
+#endif
+
 void slopevlin(intptr_t p, int32_t i, intptr_t slopaloffs, bssize_t cnt, int32_t bx, int32_t by)
 {
     intptr_t * A_C_RESTRICT slopalptr;
@@ -101,6 +275,19 @@ void slopevlin(intptr_t p, int32_t i, intptr_t slopaloffs, bssize_t cnt, int32_t
 
     bz = asm3; bzinc = (asm1>>3);
     slopalptr = (intptr_t *)slopaloffs;
+
+#if defined A_C_SIMD_SSE2 || defined A_C_SIMD_NEON
+    // shifts by 32 are undefined in C, so a zero logx or logy keeps to the C loop
+    if (vline_simd() && glogx && glogy)
+    {
+        bssize_t const n = slopevlin_simd((char *)p, slopalptr, cnt, bz, bzinc, bx, by);
+        p += n*gpinc;
+        slopalptr -= n;
+        bz += n*bzinc;
+        cnt -= n;
+    }
+#endif
+
     for (; cnt>0; cnt--)
     {
         i = (sloptable[(bz>>6)+HALFSLOPTABLESIZ]); bz += bzinc;
@@ -130,11 +317,13 @@ static inline int32_t getpix(int32_t logy, const char *buf, uint32_t vplc)
 
 void setupvlineasm(int32_t neglogy) { glogy = neglogy; }
 // cnt+1 loop iterations!
-int32_t vlineasm1(int32_t vinc, intptr_t paloffs, bssize_t cnt, uint32_t vplc, intptr_t bufplc, intptr_t p)
+// The shift and tile height are passed explicitly so that spans recorded with
+// different textures can be filled later, on any thread.
+int32_t vlineasm1_ex(int32_t vinc, intptr_t paloffs, bssize_t cnt, uint32_t vplc, intptr_t bufplc, intptr_t p, int32_t logy, int32_t tilesizy)
 {
     const char *const A_C_RESTRICT buf = (char *)bufplc;
     const char *const A_C_RESTRICT pal = (char *)paloffs;
-    const int32_t logy = glogy, ourbpl = bpl;
+    const int32_t ourbpl = bpl;
     char *pp = (char *)p;
 
     cnt++;
@@ -164,23 +353,29 @@ int32_t vlineasm1(int32_t vinc, intptr_t paloffs, bssize_t cnt, uint32_t vplc, i
 #ifdef CLASSIC_SLICE_BY_4
         for (; cnt>=4; cnt-=4)
         {
-            *pp = pal[buf[ourmulscale32(vplc, globaltilesizy)]];
-            *(pp+ourbpl) = pal[buf[ourmulscale32((vplc+vinc),globaltilesizy)]];
-            *(pp+(ourbpl<<1)) = pal[buf[ourmulscale32((vplc+(vinc<<1)), globaltilesizy)]];
-            *(pp+(ourbpl*3)) = pal[buf[ourmulscale32((vplc+(vinc*3)), globaltilesizy)]];
+            *pp = pal[buf[ourmulscale32(vplc, tilesizy)]];
+            *(pp+ourbpl) = pal[buf[ourmulscale32((vplc+vinc),tilesizy)]];
+            *(pp+(ourbpl<<1)) = pal[buf[ourmulscale32((vplc+(vinc<<1)), tilesizy)]];
+            *(pp+(ourbpl*3)) = pal[buf[ourmulscale32((vplc+(vinc*3)), tilesizy)]];
             pp += ourbpl<<2;
             vplc += vinc<<2;
         }
 #endif
         while (cnt--)
         {
-            *pp = pal[buf[ourmulscale32(vplc,globaltilesizy)]], pp += ourbpl;
+            *pp = pal[buf[ourmulscale32(vplc,tilesizy)]], pp += ourbpl;
             vplc += vinc;
         }
     }
     return vplc;
 }
 
+// cnt+1 loop iterations!
+int32_t vlineasm1(int32_t vinc, intptr_t paloffs, bssize_t cnt, uint32_t vplc, intptr_t bufplc, intptr_t p)
+{
+    return vlineasm1_ex(vinc, paloffs, cnt, vplc, bufplc, p, glogy, globaltilesizy);
+}
+
 
 extern intptr_t palookupoffse[4];
 extern uint32_t vplce[4];
@@ -218,19 +413,20 @@ typedef uint32_t uint32_vec4 __attribute__ ((vector_size (16)));
 // cnt >= 1
 static void vlineasm4nlogy(bssize_t cnt, char *p, char *const A_C_RESTRICT * pal, char *const A_C_RESTRICT * buf,
 # ifdef USE_VECTOR_EXT
-    uint32_vec4 vplc, const uint32_vec4 vinc)
+    uint32_vec4 vplc, const uint32_vec4 vinc,
 # else
-    uint32_t * vplc, const int32_t *vinc)
+    uint32_t * vplc, const int32_t *vinc,
 # endif
+    uint32_t *vplcout, int32_t tilesizy)
 {
     const int32_t ourbpl = bpl;
 
     do
     {
-        p[0] = pal[0][buf[0][ourmulscale32(vplc[0], globaltilesizy)]];
-        p[1] = pal[1][buf[1][ourmulscale32(vplc[1], globaltilesizy)]];
-        p[2] = pal[2][buf[2][ourmulscale32(vplc[2], globaltilesizy)]];
-        p[3] = pal[3][buf[3][ourmulscale32(vplc[3], globaltilesizy)]];
+        p[0] = pal[0][buf[0][ourmulscale32(vplc[0], tilesizy)]];
+        p[1] = pal[1][buf[1][ourmulscale32(vplc[1], tilesizy)]];
+        p[2] = pal[2][buf[2][ourmulscale32(vplc[2], tilesizy)]];
+        p[3] = pal[3][buf[3][ourmulscale32(vplc[3], tilesizy)]];
 
 # if defined USE_VECTOR_EXT
         vplc += vinc;
@@ -243,29 +439,32 @@ static void vlineasm4nlogy(bssize_t cnt, char *p, char *const A_C_RESTRICT * pal
         p += ourbpl;
     } while (--cnt);
 
-    Bmemcpy(&vplce[0], &vplc[0], sizeof(uint32_t) * 4);
+    Bmemcpy(vplcout, &vplc[0], sizeof(uint32_t) * 4);
 }
 #endif
 
 // cnt >= 1
-void vlineasm4(bssize_t cnt, char *p)
+// Column state is passed explicitly so that several threads can fill disjoint
+// column bands at once; vplcs is updated with the final texture coordinates.
+void vlineasm4_ex(bssize_t cnt, char *p, const intptr_t *paloffs, const intptr_t *bufplcs, uint32_t *vplcs, const int32_t *vincs,
+                  int32_t logy, int32_t tilesizy)
 {
-    char * const A_C_RESTRICT pal[4] = {(char *)palookupoffse[0], (char *)palookupoffse[1], (char *)palookupoffse[2], (char *)palookupoffse[3]};
-    char * const A_C_RESTRICT buf[4] = {(char *)bufplce[0], (char *)bufplce[1], (char *)bufplce[2], (char *)bufplce[3]};
+    char * const A_C_RESTRICT pal[4] = {(char *)paloffs[0], (char *)paloffs[1], (char *)paloffs[2], (char *)paloffs[3]};
+    char * const A_C_RESTRICT buf[4] = {(char *)bufplcs[0], (char *)bufplcs[1], (char *)bufplcs[2], (char *)bufplcs[3]};
 #ifdef USE_VECTOR_EXT
-    uint32_vec4 vinc = {(uint32_t)vince[0], (uint32_t)vince[1], (uint32_t)vince[2], (uint32_t)vince[3]};
-    uint32_vec4 vplc = {vplce[0], vplce[1], vplce[2], vplce[3]};
+    uint32_vec4 vinc = {(uint32_t)vincs[0], (uint32_t)vincs[1], (uint32_t)vincs[2], (uint32_t)vincs[3]};
+    uint32_vec4 vplc = {vplcs[0], vplcs[1], vplcs[2], vplcs[3]};
 #else
-    const int32_t vinc[4] = {vince[0], vince[1], vince[2], vince[3]};
-    uint32_t vplc[4] = {vplce[0], vplce[1], vplce[2], vplce[3]};
+    const int32_t vinc[4] = {vincs[0], vincs[1], vincs[2], vincs[3]};
+    uint32_t vplc[4] = {vplcs[0], vplcs[1], vplcs[2], vplcs[3]};
 #endif
-    const int32_t logy = glogy, ourbpl = bpl;
+    const int32_t ourbpl = bpl;
 
 #ifdef CLASSIC_NONPOW2_YSIZE_WALLS
     if (EDUKE32_PREDICT_FALSE(!logy))
     {
         // This should only happen when 'globalshiftval = 0' has been set in engine.c.
-        vlineasm4nlogy(cnt, p, pal, buf, vplc, vinc);
+        vlineasm4nlogy(cnt, p, pal, buf, vplc, vinc, vplcs, tilesizy);
         return;
     }
 #else
@@ -323,7 +522,13 @@ void vlineasm4(bssize_t cnt, char *p)
         p += ourbpl;
     }
 
-    Bmemcpy(&vplce[0], &vplc[0], sizeof(uint32_t) * 4);
+    Bmemcpy(vplcs, &vplc[0], sizeof(uint32_t) * 4);
+}
+
+// cnt >= 1
+void vlineasm4(bssize_t cnt, char *p)
+{
+    vlineasm4_ex(cnt, p, palookupoffse, bufplce, vplce, vince, glogy, globaltilesizy);
 }
 
 #ifdef USE_SATURATE_VPLC
@@ -381,7 +586,7 @@ int32_t mvlineasm1(int32_t vinc, intptr_t paloffs, bssize_t cnt, uint32_t vplc,
 }
 
 // cnt >= 1
-void mvlineasm4(bssize_t cnt, char *p)
+static void mvlineasm4_c(bssize_t cnt, char *p)
 {
     char *const A_C_RESTRICT pal[4] = {(char *)palookupoffse[0], (char *)palookupoffse[1], (char *)palookupoffse[2], (char *)palookupoffse[3]};
     char *const A_C_RESTRICT buf[4] = {(char *)bufplce[0], (char *)bufplce[1], (char *)bufplce[2], (char *)bufplce[3]};
@@ -459,6 +664,82 @@ void mvlineasm4(bssize_t cnt, char *p)
     Bmemcpy(&vplce[0], &vplc[0], sizeof(uint32_t) * 4);
 }
 
+#if defined A_C_SIMD_SSE2 || defined A_C_SIMD_NEON
+// Fetches one row of texels for the four columns and writes the opaque ones
+// with a single 32-bit read-modify-write instead of four conditional stores.
+// transmask has 0xff in every byte whose texel is 255 (transparent).
+static FORCE_INLINE void mvline4_texels(char *const A_C_RESTRICT * buf, const uint32_t *idx, uint8_t *tex)
+{
+    tex[0] = buf[0][idx[0]];
+    tex[1] = buf[1][idx[1]];
+    tex[2] = buf[2][idx[2]];
+    tex[3] = buf[3][idx[3]];
+}
+
+static FORCE_INLINE void mvline4_store(char *p, char *const A_C_RESTRICT * pal, const uint8_t *tex, uint32_t transmask)
+{
+    uint8_t const col[4] = { (uint8_t)pal[0][tex[0]], (uint8_t)pal[1][tex[1]], (uint8_t)pal[2][tex[2]], (uint8_t)pal[3][tex[3]] };
+    uint32_t dst, src;
+
+    Bmemcpy(&dst, p, sizeof(uint32_t));
+    Bmemcpy(&src, col, sizeof(uint32_t));
+    dst = (dst & transmask) | (src & ~transmask);
+    Bmemcpy(p, &dst, sizeof(uint32_t));
+}
+
+A_C_TARGET_SIMD static void mvlineasm4_simd(bssize_t cnt, char *p, char *const A_C_RESTRICT * pal, char *const A_C_RESTRICT * buf,
+                                            uint32_t *vplcs, const int32_t *vincs, int32_t logy, int32_t ourbpl)
+{
+    vline4_t vplc = vline4_load(vplcs);
+    vline4_t const vinc = vline4_load(vincs);
+    vline4_t const tilesizy = vline4_dup(globaltilesizy);
+#ifdef USE_SATURATE_VPLC
+    vline4_t const saturate = vline4_dup(g_saturate);
+#endif
+    uint32_t idx[4];
+    uint8_t tex[4];
+    uint32_t tex32;
+
+    do
+    {
+        vline4_store(idx, vline4_texrow(vplc, logy, tilesizy));
+        mvline4_texels(buf, idx, tex);
+        Bmemcpy(&tex32, tex, sizeof(uint32_t));
+
+        uint32_t const transmask = vline4_transmask(tex32);
+
+        if (transmask != 0xffffffffu)
+            mvline4_store(p, pal, tex, transmask);
+
+        vplc = vline4_add(vplc, vinc);
+#ifdef USE_SATURATE_VPLC
+        vplc = vline4_saturate(vplc, vinc, saturate);
+#endif
+        p += ourbpl;
+    }
+    while (--cnt);
+
+    vline4_store(vplcs, vplc);
+}
+#endif
+
+// cnt >= 1
+void mvlineasm4(bssize_t cnt, char *p)
+{
+#if defined A_C_SIMD_SSE2 || defined A_C_SIMD_NEON
+    char *const A_C_RESTRICT pal[4] = {(char *)palookupoffse[0], (char *)palookupoffse[1], (char *)palookupoffse[2], (char *)palookupoffse[3]};
+    char *const A_C_RESTRICT buf[4] = {(char *)bufplce[0], (char *)bufplce[1], (char *)bufplce[2], (char *)bufplce[3]};
+
+    if (vline_simd())
+    {
+        mvlineasm4_simd(cnt, p, pal, buf, vplce, vince, glogy, bpl);
+        return;
+    }
+#endif
+
+    mvlineasm4_c(cnt, p);
+}
+
 void setuptvlineasm(int32_t neglogy, int32_t dosaturate)
 {
     glogy = neglogy;
@@ -604,9 +885,54 @@ void setupspritevline(intptr_t paloffs, int32_t bxinc, int32_t byinc, int32_t ys
     gbyinc = byinc;
     glogy = ysiz;
 }
+
+#if defined A_C_SIMD_SSE2 || defined A_C_SIMD_NEON
+// Draws the first cnt&~3 pixels and returns how many were drawn
+A_C_TARGET_SIMD static bssize_t spritevline_simd(int32_t bx, int32_t by, bssize_t cnt, const char *buf, char *p)
+{
+    vline4_t bx4 = vline4_set(bx, bx + gbxinc, bx + (uint32_t)gbxinc*2, bx + (uint32_t)gbxinc*3);
+    vline4_t by4 = vline4_set(by, by + gbyinc, by + (uint32_t)gbyinc*2, by + (uint32_t)gbyinc*3);
+    vline4_t const bxinc4 = vline4_dup((uint32_t)gbxinc << 2), byinc4 = vline4_dup((uint32_t)gbyinc << 2);
+    vline4_t const ysiz = vline4_dup(glogy);
+    const char *const A_C_RESTRICT pal = gpal;
+    int32_t const ourbpl = bpl;
+    int32_t idx[4];
+    bssize_t const n = cnt & ~3;
+
+    for (cnt = n; cnt > 0; cnt -= 4)
+    {
+        vline4_store(idx, vline4_add(vline4_mul(vline4_sar(bx4, 16), ysiz), vline4_sar(by4, 16)));
+
+        p[0]        = pal[buf[idx[0]]];
+        p[ourbpl]   = pal[buf[idx[1]]];
+        p[ourbpl*2] = pal[buf[idx[2]]];
+        p[ourbpl*3] = pal[buf[idx[3]]];
+
+        bx4 = vline4_add(bx4, bxinc4);
+        by4 = vline4_add(by4, byinc4);
+        p += ourbpl*4;
+    }
+
+    return n;
+}
+#endif
+
 void spritevline(int32_t bx, int32_t by, bssize_t cnt, intptr_t bufplc, intptr_t p)
 {
     gbuf = (char *)bufplc;
+
+#if defined A_C_SIMD_SSE2 || defined A_C_SIMD_NEON
+    if (vline_simd() && cnt > 1)
+    {
+        // the C loop below draws cnt-1 pixels
+        bssize_t const n = spritevline_simd(bx, by, cnt-1, gbuf, (char *)p);
+        bx += n*gbxinc;
+        by += n*gbyinc;
+        p += n*bpl;
+        cnt -= n;
+    }
+#endif
+
     for (; cnt>1; cnt--)
     {
         (*(char *)p) = gpal[gbuf[(bx>>16)*glogy+(by>>16)]];
@@ -764,6 +764,21 @@ static int osdcmd_displayindex(osdcmdptr_t parm)
     return OSDCMD_OK;
 }
 
+static int osdfunc_classicbench(osdcmdptr_t parm)
+{
+    int32_t const views  = parm->numparms > 0 ? Batol(parm->parms[0]) : 8;
+    int32_t const frames = parm->numparms > 1 ? Batol(parm->parms[1]) : 16;
+
+    int32_t const mismatches = renderBenchmarkClassic(views, frames);
+
+    if (mismatches < 0)
+        LOG_F(WARNING, "classicbench: requires a loaded map and the software renderer");
+    else if (mismatches > 0)
+        LOG_F(WARNING, "classicbench: %d view(s) were not pixel-identical", mismatches);
+
+    return OSDCMD_OK;
+}
+
 static int osdcmd_cvar_set_baselayer(osdcmdptr_t parm)
 {
     int32_t r = osdcmd_cvar_set(parm);
@@ -800,6 +815,7 @@ int32_t baselayer_init(void)
         { "r_screenaspect","if using r_usenewaspect and in fullscreen, screen aspect ratio in the form XXYY, e.g. 1609 for 16:9",
           (void *) &r_screenxy, SCREENASPECT_CVAR_TYPE, 0, 9999 },
         { "r_fpgrouscan","use floating-point numbers for slope rendering",(void *) &r_fpgrouscan, CVAR_BOOL, 0, 1 },
+        { "r_classicthreads","number of column bands drawn in parallel by the software renderer (1: single-threaded)",(void *) &r_classicthreads, CVAR_INT, 1, 64 },
         { "r_hightile","enable/disable hightile texture rendering",(void *) &usehightile, CVAR_BOOL, 0, 1 },
         { "r_maxspritesonscreen","maximum number of sprites to draw per frame",(void *) &maxspritesonscreen, CVAR_INT, 0, MAXSPRITESONSCREEN },
         { "r_novoxmips","turn off/on the use of mipmaps when rendering 8-bit voxels",(void *) &novoxmips, CVAR_BOOL, 0, 1 },
@@ -825,6 +841,9 @@ int32_t baselayer_init(void)
     for (auto & i : cvars_engine)
         OSD_RegisterCvar(&i, (i.flags & CVAR_FUNCPTR) ? osdcmd_cvar_set_baselayer : osdcmd_cvar_set);
 
+    OSD_RegisterFunction("classicbench","classicbench [views] [frames]: times the software renderer single-threaded and with r_classicthreads",
+                         osdfunc_classicbench);
+
     static osdcvardata_t displayindex = { "r_displayindex","index of output display",(void*)&r_displayindex, CVAR_INT | CVAR_FUNCPTR, 0, 8 };
     OSD_RegisterCvar(&displayindex, osdcmd_displayindex);
 
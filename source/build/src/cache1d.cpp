@@ -41,6 +41,7 @@
 #include "lz4.h"
 #include "osd.h"
 #include "pragmas.h"
+#include "timer.h"
 #include "vfs.h"
 
 static bool g_cacheInit;
@@ -61,14 +62,48 @@ static int osdfunc_cacheinfo(osdcmdptr_t UNUSED(parm))
 
 #define MAXCACHEOBJECTS 16384
 
+static FORCE_INLINE int cache1d_freeclass(int32_t leng)
+{
+    int c = 0;
+    for (uint32_t n = (uint32_t)leng / MINCACHEBLOCKSIZE; n > 1; n >>= 1)
+        c++;
+    return c;
+}
+
+static FORCE_INLINE bool cache1d_isfree(cacheindex_t const &b) { return b.lock == &zerochar; }
+
+// Potential for eviction increases with
+//  - smaller item size
+//  - smaller lock byte value (but in [1 .. 199])
+// Returns -1 for blocks that can't be evicted.
+static FORCE_INLINE int32_t cache1d_evictcost(cacheindex_t const &b)
+{
+    uint8_t const lock = *b.lock;
+
+    if (lock == 0)
+        return 0;
+    else if (lock >= (uint8_t)CACHE1D_LOCKED)
+        return -1;
+
+    return mulscale32(b.leng + 65536, lockrecip[lock]);
+}
+
 void cache1d::reset(void)
 {
     Bmemset(m_index, 0, m_maxBlocks * sizeof(cacheindex_t));
 
+    for (int &head : m_freeHead)
+        head = -1;
+    m_freeMask = 0;
+
     m_index[0].leng = m_totalSize;
     m_index[0].lock = &zerochar;
+    m_index[0].prev = m_index[0].next = -1;
 
+    m_head = m_tail = 0;
     m_numBlocks = 1;
+
+    linkFree(0);
 }
 
 void cache1d::initBuffer(intptr_t dacachestart, uint32_t dacachesize, uint32_t)
@@ -117,111 +152,294 @@ void cache1d::inc_and_check_cacnum(void)
     }
 }
 
-void cache1d::allocateBlock(intptr_t *newhandle, int32_t newbytes, char *newlockptr)
+void cache1d::linkFree(int blk)
 {
-    int i, z, zz, bestz=0, daval, bestval, besto=0, o1, o2, sucklen, suckz;
+    auto &b = m_index[blk];
+    int const c = cache1d_freeclass(b.leng);
 
-    newbytes = ((newbytes+15)& ~15);
+    b.fprev = -1;
+    b.fnext = m_freeHead[c];
 
-    if (EDUKE32_PREDICT_FALSE((unsigned)newbytes > (unsigned)m_totalSize))
+    if (b.fnext >= 0)
+        m_index[b.fnext].fprev = blk;
+
+    m_freeHead[c] = blk;
+    m_freeMask |= 1u << c;
+}
+
+void cache1d::unlinkFree(int blk)
+{
+    auto &b = m_index[blk];
+    int const c = cache1d_freeclass(b.leng);
+
+    if (b.fprev >= 0)
+        m_index[b.fprev].fnext = b.fnext;
+    else if ((m_freeHead[c] = b.fnext) < 0)
+        m_freeMask &= ~(1u << c);
+
+    if (b.fnext >= 0)
+        m_index[b.fnext].fprev = b.fprev;
+}
+
+// Appends a free block after block "after" in address order.
+int cache1d::newBlock(int32_t offs, int32_t leng, int after)
+{
+    int const blk = m_numBlocks;
+
+    inc_and_check_cacnum();
+
+    auto &b = m_index[blk];
+
+    b.lock = &zerochar;
+    b.hand = nullptr;
+    b.offs = offs;
+    b.leng = leng;
+    b.prev = after;
+    b.next = m_index[after].next;
+
+    if (b.next >= 0)
+        m_index[b.next].prev = blk;
+    else
+        m_tail = blk;
+
+    m_index[after].next = blk;
+
+    linkFree(blk);
+
+    return blk;
+}
+
+// Unlinks a block and keeps the pool dense by moving the last entry into its
+// slot; "track" is updated if it referred to the moved entry.
+void cache1d::removeBlock(int blk, int &track)
+{
+    auto &b = m_index[blk];
+
+    if (cache1d_isfree(b))
+        unlinkFree(blk);
+
+    if (b.prev >= 0)
+        m_index[b.prev].next = b.next;
+    else
+        m_head = b.next;
+
+    if (b.next >= 0)
+        m_index[b.next].prev = b.prev;
+    else
+        m_tail = b.prev;
+
+    int const last = --m_numBlocks;
+
+    if (blk != last)
     {
-        LOG_F(ERROR, "Cache size: %d", m_totalSize);
-        LOG_F(ERROR, "*Newhandle: 0x%08" PRIxPTR ", Newbytes: %d, *Newlock: %d", (intptr_t)newhandle, newbytes, *newlockptr);
-        report();
-        fatal_exit("BUFFER TOO BIG TO FIT IN CACHE!");
+        auto const &m = m_index[last];
+
+        if (m.prev >= 0)
+            m_index[m.prev].next = blk;
+        else
+            m_head = blk;
+
+        if (m.next >= 0)
+            m_index[m.next].prev = blk;
+        else
+            m_tail = blk;
+
+        if (cache1d_isfree(m))
+        {
+            if (m.fprev >= 0)
+                m_index[m.fprev].fnext = blk;
+            else
+                m_freeHead[cache1d_freeclass(m.leng)] = blk;
+
+            if (m.fnext >= 0)
+                m_index[m.fnext].fprev = blk;
+        }
+
+        m_index[blk] = m;
+
+        if (track == last)
+            track = blk;
     }
 
-    if (*newlockptr == 0)
+    Bmemset(&m_index[last], 0, sizeof(cacheindex_t));
+}
+
+// Returns a free block of at least newbytes, or -1.
+int cache1d::findFree(int32_t newbytes)
+{
+    uint32_t const n = (uint32_t)newbytes / MINCACHEBLOCKSIZE;
+    int const c = cache1d_freeclass(newbytes);
+
+    // everything in the classes above c fits, so the smallest non-empty one
+    // can be taken from without looking at sizes
+    for (int i = c + ((n & (n - 1)) != 0); i < CACHE1D_FREECLASSES; i++)
+        if (m_freeMask & (1u << i))
+            return m_freeHead[i];
+
+    if (m_freeMask & (1u << c))
     {
-        report();
-        fatal_exit("ALLOCACHE CALLED WITH LOCK OF 0!");
+        for (int i = m_freeHead[c]; i >= 0; i = m_index[i].fnext)
+            if (m_index[i].leng >= newbytes)
+                return i;
     }
 
-    //Find best place
-    bestval = INT32_MAX; o1 = m_totalSize;
-    for (z = m_numBlocks - 1; z >= 0; z--)
+    return -1;
+}
+
+// Returns the first block of the cheapest run of blocks spanning newbytes, or -1
+// if every such run contains a locked block. Lock bytes belong to the callers
+// and change without the cache being told, so the costs can't be kept in a
+// persistent structure; instead the window slides down from the end of the
+// cache once, adding and dropping block costs as it goes. The result is the
+// same run the old per-offset scan picked, in linear rather than quadratic time.
+int cache1d::findEvictable(int32_t newbytes)
+{
+    int64_t bestval = INT64_MAX, daval = 0;
+    int best = -1, numlocked = 0, e = m_tail;
+
+    for (int z = m_tail; z >= 0; z = m_index[z].prev)
     {
-        o1 -= m_index[z].leng;
-        o2 = o1 + newbytes;
-        if (o2 > m_totalSize)
-            continue;
+        int32_t const cost = cache1d_evictcost(m_index[z]);
 
-        daval = 0;
-        for (i = o1, zz = z; i < o2; i += m_index[zz++].leng)
+        if (cost < 0)
+            numlocked++;
+        else
+            daval += cost;
+
+        int32_t const o2 = m_index[z].offs + newbytes;
+
+        while (m_index[e].offs >= o2)
         {
-            if (*m_index[zz].lock == 0)
-                continue;
-            else if (*m_index[zz].lock >= CACHE1D_LOCKED)
-            {
-                daval = INT32_MAX;
-                break;
-            }
+            int32_t const ecost = cache1d_evictcost(m_index[e]);
 
-            // Potential for eviction increases with
-            //  - smaller item size
-            //  - smaller lock byte value (but in [1 .. 199])
-            daval += mulscale32(m_index[zz].leng + 65536, lockrecip[*m_index[zz].lock]);
+            if (ecost < 0)
+                numlocked--;
+            else
+                daval -= ecost;
 
-            if (daval >= bestval)
-                break;
+            e = m_index[e].prev;
         }
+
+        if (o2 > m_totalSize || numlocked)
+            continue;
+
         if (daval < bestval)
         {
             bestval = daval;
-            besto   = o1;
-            bestz   = z;
+            best    = z;
             if (bestval == 0)
                 break;
         }
     }
 
-    //printf("%ld %ld %ld\n",besto,newbytes,*newlockptr);
+    return best;
+}
+
+// Gives the leng bytes following blk back to the free lists.
+void cache1d::insertRemainder(int blk, int32_t leng)
+{
+    int const next = m_index[blk].next;
 
-    if (bestval == INT32_MAX)
+    if (next >= 0 && cache1d_isfree(m_index[next]))
     {
-        report();
-        fatal_exit("CACHE SPACE ALL LOCKED UP!");
+        unlinkFree(next);
+        m_index[next].offs -= leng;
+        m_index[next].leng += leng;
+        linkFree(next);
+        return;
     }
 
-    //Suck things out
-    for(sucklen=-newbytes,suckz=bestz;sucklen<0;sucklen+=m_index[suckz++].leng)
-        if (*m_index[suckz].lock) *m_index[suckz].hand = 0;
+    newBlock(m_index[blk].offs + m_index[blk].leng, leng, blk);
+}
 
-    //Remove all blocks except 1
-    suckz -= (bestz+1);
-    m_numBlocks -= suckz;
-    // Bmemmove(&m_index[bestz], &m_index[bestz + suckz], (m_numBlocks - bestz) * sizeof(cacheindex_t));
-    copybufbyte(&m_index[bestz+suckz],&m_index[bestz],(m_numBlocks-bestz)*sizeof(cacheindex_t));
-    m_index[bestz].hand = newhandle; *newhandle = m_baseAddress+besto;
-    m_index[bestz].leng = newbytes;
-    m_index[bestz].lock = newlockptr;
+void cache1d::recordLatency(int evicted, uint64_t ticks)
+{
+    uint64_t const rate = timerGetNanoTickRate();
 
-    //Add new empty block if necessary
-    if (sucklen <= 0)
+    if (!rate)
         return;
 
-    if (++bestz == m_numBlocks)
+    uint64_t const us = ticks * 1000000 / rate;
+    int bucket = 0;
+
+    while (bucket < CACHE1D_HISTBUCKETS - 1 && (us >> bucket))
+        bucket++;
+
+    m_allocHist[evicted][bucket]++;
+}
+
+void cache1d::allocateBlock(intptr_t *newhandle, int32_t newbytes, char *newlockptr)
+{
+    newbytes = ((newbytes+15)& ~15);
+
+    if (EDUKE32_PREDICT_FALSE((unsigned)newbytes > (unsigned)m_totalSize))
     {
-        inc_and_check_cacnum();
+        LOG_F(ERROR, "Cache size: %d", m_totalSize);
+        LOG_F(ERROR, "*Newhandle: 0x%08" PRIxPTR ", Newbytes: %d, *Newlock: %d", (intptr_t)newhandle, newbytes, *newlockptr);
+        report();
+        fatal_exit("BUFFER TOO BIG TO FIT IN CACHE!");
+    }
 
-        m_index[bestz].leng = sucklen;
-        m_index[bestz].lock = &zerochar;
-        return;
+    if (*newlockptr == 0)
+    {
+        report();
+        fatal_exit("ALLOCACHE CALLED WITH LOCK OF 0!");
     }
 
-    if (*m_index[bestz].lock == 0)
+    uint64_t const t = timerGetNanoTicks();
+    int blk = findFree(newbytes);
+    int const evicted = (blk < 0);
+    int32_t sucklen;
+
+    if (!evicted)
     {
-        m_index[bestz].leng += sucklen;
-        return;
+        unlinkFree(blk);
+        sucklen = m_index[blk].leng - newbytes;
     }
+    else
+    {
+        //Find best place
+        blk = findEvictable(newbytes);
 
-    inc_and_check_cacnum();
+        if (blk < 0)
+        {
+            report();
+            fatal_exit("CACHE SPACE ALL LOCKED UP!");
+        }
+
+        //Suck things out
+        if (cache1d_isfree(m_index[blk]))
+            unlinkFree(blk);
+        else if (*m_index[blk].lock)
+            *m_index[blk].hand = 0;
+
+        // claim it before removeBlock() can move it, so it isn't mistaken for a listed free block
+        m_index[blk].lock = newlockptr;
+
+        //Remove all blocks except 1
+        for (sucklen = m_index[blk].leng - newbytes; sucklen < 0;)
+        {
+            int const z = m_index[blk].next;
+
+            if (*m_index[z].lock)
+                *m_index[z].hand = 0;
+
+            sucklen += m_index[z].leng;
+            removeBlock(z, blk);
+        }
+    }
 
-    for(z=m_numBlocks-1;z>bestz;z--)
-        m_index[z] = m_index[z-1];
+    auto &b = m_index[blk];
 
-    m_index[bestz].leng = sucklen;
-    m_index[bestz].lock = &zerochar;
+    b.hand = newhandle; *newhandle = m_baseAddress + b.offs;
+    b.leng = newbytes;
+    b.lock = newlockptr;
+
+    //Add new empty block if necessary
+    if (sucklen > 0)
+        insertRemainder(blk, sucklen);
+
+    recordLatency(evicted, timerGetNanoTicks() - t);
 }
 
 //void cache1d::suckcache(intptr_t suckptr)
@@ -303,10 +521,10 @@ void cache1d::report(void)
     int constexpr reportLineSize = 128;
     auto buf = (char*)Balloca(reportLineSize);
 
-    for (int i = 0; i < m_numBlocks; i++)
+    for (int i = m_head, n = 0; i >= 0; i = m_index[i].next, n++)
     {
         buf[0] = '\0';
-        int len = Bsnprintf(buf, reportLineSize, "%4d ", i);
+        int len = Bsnprintf(buf, reportLineSize, "%4d ", n);
 
         usedSize += m_index[i].leng;
 
@@ -346,6 +564,32 @@ void cache1d::report(void)
     LOG_F(INFO, "Remaining:   %dKB", (m_totalSize - usedSize) >> 10);
     LOG_F(INFO, "Block count: %d/%d",m_numBlocks, m_maxBlocks);
 
+    static char const *const histNames[2] = { "free list", "evicting" };
+
+    for (int i = 0; i < 2; i++)
+    {
+        uint32_t total = 0;
+
+        for (auto cnt : m_allocHist[i])
+            total += cnt;
+
+        if (!total)
+            continue;
+
+        LOG_F(INFO, "Allocation latency (%s, %u allocations):", histNames[i], total);
+
+        for (int j = 0; j < CACHE1D_HISTBUCKETS; j++)
+        {
+            if (!m_allocHist[i][j])
+                continue;
+
+            if (j < CACHE1D_HISTBUCKETS - 1)
+                LOG_F(INFO, "  < %6uus: %u", 1u << j, m_allocHist[i][j]);
+            else
+                LOG_F(INFO, "  >= %5uus: %u", 1u << (j - 1), m_allocHist[i][j]);
+        }
+    }
+
     inthash_free(&h_blocktotile);
 }
 #else
@@ -16,6 +16,17 @@ cpuinfo_t cpu;
 static char g_cpuVendorIDString[16];
 static char g_cpuBrandString[48];
 
+static uint32_t sysGetXCR0(void)
+{
+#ifdef _WIN32
+    return (uint32_t)_xgetbv(0);
+#else
+    uint32_t eax, edx;
+    __asm__ __volatile__("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+    return eax;
+#endif
+}
+
 void sysReadCPUID()
 {
     int32_t regs[4];
@@ -36,6 +47,31 @@ void sysReadCPUID()
 
     cpu.vendorIDString = g_cpuVendorIDString;
 
+    auto const maxleaf = (unsigned)regs[0];
+
+    if (maxleaf >= 1)
+    {
+#ifdef _WIN32
+        __cpuid(regs, 1);
+#else
+        __cpuid(1, regs[0], regs[1], regs[2], regs[3]);
+#endif
+        cpu.features.sse2 = (regs[3] & (1 << 26)) != 0;
+
+        // AVX2 also needs the OS to save the YMM registers (OSXSAVE, then XCR0 bits 1 and 2)
+        bool const ymm = (regs[2] & (1 << 27)) && (sysGetXCR0() & 6) == 6;
+
+        if (ymm && maxleaf >= 7)
+        {
+#ifdef _WIN32
+            __cpuidex(regs, 7, 0);
+#else
+            __cpuid_count(7, 0, regs[0], regs[1], regs[2], regs[3]);
+#endif
+            cpu.features.avx2 = (regs[1] & (1 << 5)) != 0;
+        }
+    }
+
     //if (!Bstrcmp(g_cpuVendorIDString, "GenuineIntel"))
     //    cpu.type = CPU_INTEL;
     //else if (!Bstrcmp(g_cpuVendorIDString, "AuthenticAMD"))
@@ -19,6 +19,7 @@
 #include "colmatch.h"
 #include "screentext.h"
 #include "vfs.h"
+#include "xxhash.h"
 
 enum scripttoken_t
 {
@@ -148,11 +149,14 @@ static const char *skyfaces[6] =
 };
 
 static int32_t defsparser(scriptfile *script);
+static void Defs_CacheAddDep(char const *fn);
 
 static void defsparser_include(const char *fn, const scriptfile *script, const char *cmdtokptr)
 {
     scriptfile *included;
 
+    Defs_CacheAddDep(fn);
+
     included = scriptfile_fromfile(fn);
     if (EDUKE32_PREDICT_FALSE(!included))
     {
@@ -321,6 +325,903 @@ static int32_t Defs_ImportTileFromTexture(char const * const fn, int32_t const t
     return 0;
 }
 
+// Pre-parsed DEF cache
+//
+// While a DEF tree is parsed, the calls it makes into hightile, the model code and the
+// voxel tables are recorded through the Defs_* wrappers below, along with the size and
+// modification time of every DEF file and every texture, model and voxel file the parse
+// looked for. The next loaddefinitionsfile() of the same tree checks those files in one
+// pass and, if none of them changed, replays the calls instead of parsing. A tree that
+// uses any other command (palettes, tiles, maphacks...) is not cached.
+
+#if defined USE_OPENGL && !defined USE_PHYSFS
+# define USE_DEFCACHE
+#endif
+
+#define DEFCACHE_MAGIC   "Build DEF cache"
+#define DEFCACHE_VERSION 1
+
+enum defcacheop_t
+{
+    DEFOP_END,
+    DEFOP_SUBSTTEX,
+    DEFOP_CLEARSUBST,
+    DEFOP_DUMMYTILE,
+    DEFOP_SKYBOX,
+    DEFOP_TINT,
+    DEFOP_ALPHAHACK,
+    DEFOP_LOADMODEL,
+    DEFOP_MODELFRAME,
+    DEFOP_MODELANIM,
+    DEFOP_MODELSKIN,
+    DEFOP_MODELHUD,
+    DEFOP_MODELMISC,
+    DEFOP_UNDEFMODEL,
+    DEFOP_UNDEFMODELTILE,
+    DEFOP_LOADVOXEL,
+    DEFOP_VOXELTILE,
+    DEFOP_VOXELSCALE,
+    DEFOP_VOXELFLAGS,
+};
+
+typedef struct
+{
+    char   *buf;
+    int32_t size, len;
+} defcachebuf_t;
+
+static defcachebuf_t defcacheops, defcachedeps;
+static hashtable_t h_defcachedeps = { 1024, NULL };
+static int32_t defcacherecording;
+
+static void Defs_CacheWrite(defcachebuf_t *b, void const *data, int32_t len)
+{
+    if (b->len + len > b->size)
+    {
+        b->size = max(max(b->size << 1, b->len + len), 65536);
+        b->buf  = (char *)Xrealloc(b->buf, b->size);
+    }
+
+    Bmemcpy(b->buf + b->len, data, len);
+    b->len += len;
+}
+
+template <typename T> static FORCE_INLINE void Defs_CachePut(T const &v) { Defs_CacheWrite(&defcacheops, &v, sizeof(T)); }
+static void Defs_CachePutString(char const *s) { Defs_CacheWrite(&defcacheops, s, Bstrlen(s) + 1); }
+static FORCE_INLINE void Defs_CachePutOp(uint8_t const op) { Defs_CachePut(op); }
+
+#ifdef USE_DEFCACHE
+// size and modification time of the file fn would be loaded from, or a size of -1 if there is none
+static void Defs_GetFileInfo(char const *fn, int64_t *size, int64_t *mtime)
+{
+    int32_t const opsm = pathsearchmode;
+    char *where;
+
+    *size  = -1;
+    *mtime = 0;
+
+    pathsearchmode = 1;
+
+    if (findfrompath(fn, &where) >= 0)
+    {
+        struct Bstat st;
+
+        if (!Bstat(where, &st))
+        {
+            *size  = st.st_size;
+            *mtime = st.st_mtime;
+        }
+
+        Xfree(where);
+    }
+    else
+    {
+        // inside a group or zip: those are dependencies of their own, see Defs_StartRecording()
+        buildvfs_kfd const fil = kopen4load(fn, 0);
+
+        if (fil != buildvfs_kfd_invalid)
+        {
+            *size = kfilelength(fil);
+            kclose(fil);
+        }
+    }
+
+    pathsearchmode = opsm;
+}
+#endif
+
+static void Defs_CacheAddDep(char const *fn)
+{
+#ifdef USE_DEFCACHE
+    if (!defcacherecording || hash_find(&h_defcachedeps, fn) >= 0)
+        return;
+
+    hash_add(&h_defcachedeps, fn, 0, 0);
+
+    int64_t info[2];
+    Defs_GetFileInfo(fn, &info[0], &info[1]);
+
+    Defs_CacheWrite(&defcachedeps, fn, Bstrlen(fn) + 1);
+    Defs_CacheWrite(&defcachedeps, info, sizeof(info));
+#else
+    UNREFERENCED_PARAMETER(fn);
+#endif
+}
+
+static int32_t Defs_CheckFile(char const *fn)
+{
+    Defs_CacheAddDep(fn);
+    return check_file_exist(fn);
+}
+
+static int32_t Defs_SetSubstTex(int32_t tile, int32_t pal, char const *fn, float alphacut, float xscale, float yscale,
+                                float specpower, float specfactor, char flags)
+{
+    if (defcacherecording)
+    {
+        Defs_CachePutOp(DEFOP_SUBSTTEX);
+        Defs_CachePut(tile);
+        Defs_CachePut(pal);
+        Defs_CachePutString(fn);
+        Defs_CachePut(alphacut);
+        Defs_CachePut(xscale);
+        Defs_CachePut(yscale);
+        Defs_CachePut(specpower);
+        Defs_CachePut(specfactor);
+        Defs_CachePut(flags);
+    }
+
+    return hicsetsubsttex(tile, pal, fn, alphacut, xscale, yscale, specpower, specfactor, flags);
+}
+
+static void Defs_SetupDummyTile(int32_t tile, int32_t xsiz, int32_t ysiz)
+{
+    if (defcacherecording)
+    {
+        Defs_CachePutOp(DEFOP_DUMMYTILE);
+        Defs_CachePut(tile);
+        Defs_CachePut(xsiz);
+        Defs_CachePut(ysiz);
+    }
+
+    tileSetSize(tile, xsiz, ysiz);
+    Bmemset(&picanm[tile], 0, sizeof(picanm_t));
+    tileSetupDummy(tile);
+}
+
+static void Defs_SetPaletteTint(int32_t pal, char r, char g, char b, char sr, char sg, char sb, polytintflags_t flags)
+{
+    if (defcacherecording)
+    {
+        char const rgb[6] = { r, g, b, sr, sg, sb };
+
+        Defs_CachePutOp(DEFOP_TINT);
+        Defs_CachePut(pal);
+        Defs_CachePut(rgb);
+        Defs_CachePut(flags);
+    }
+
+    hicsetpalettetint(pal, r, g, b, sr, sg, sb, flags);
+}
+
+#ifdef USE_OPENGL
+static int32_t Defs_SetSkybox(int32_t tile, int32_t pal, char const *const fn[6], int32_t flags)
+{
+    if (defcacherecording)
+    {
+        Defs_CachePutOp(DEFOP_SKYBOX);
+        Defs_CachePut(tile);
+        Defs_CachePut(pal);
+
+        for (int i = 0; i < 6; i++)
+            Defs_CachePutString(fn[i]);
+
+        Defs_CachePut(flags);
+    }
+
+    return hicsetskybox(tile, pal, fn, flags);
+}
+
+static void Defs_ClearSubstRange(int32_t tile0, int32_t tile1)
+{
+    if (defcacherecording)
+    {
+        Defs_CachePutOp(DEFOP_CLEARSUBST);
+        Defs_CachePut(tile0);
+        Defs_CachePut(tile1);
+    }
+
+    for (int i = tile0; i <= tile1; i++)
+        for (int j = MAXPALOOKUPS-1; j >= 0; j--)
+            hicclearsubst(i, j);
+}
+
+static void Defs_SetAlphaHack(int32_t tile, uint8_t alpha)
+{
+    if (defcacherecording)
+    {
+        Defs_CachePutOp(DEFOP_ALPHAHACK);
+        Defs_CachePut(tile);
+        Defs_CachePut(alpha);
+    }
+
+    alphahackarray[tile] = alpha;
+}
+
+// the model calls below always act on the model loaded last, so the ops don't store its id
+
+static int32_t Defs_LoadModel(char const *fn)
+{
+    Defs_CacheAddDep(fn);
+
+    int32_t const modelid = md_loadmodel(fn);
+
+    if (defcacherecording && modelid >= 0)
+    {
+        Defs_CachePutOp(DEFOP_LOADMODEL);
+        Defs_CachePutString(fn);
+    }
+
+    return modelid;
+}
+
+static int32_t Defs_DefineModelFrame(int32_t modelid, char const *framename, int32_t tile, int32_t skin, float smoothduration, int32_t pal)
+{
+    if (defcacherecording)
+    {
+        Defs_CachePutOp(DEFOP_MODELFRAME);
+        Defs_CachePutString(framename);
+        Defs_CachePut(tile);
+        Defs_CachePut(skin);
+        Defs_CachePut(smoothduration);
+        Defs_CachePut(pal);
+    }
+
+    return md_defineframe(modelid, framename, tile, skin, smoothduration, pal);
+}
+
+static int32_t Defs_DefineModelAnim(int32_t modelid, char const *startframe, char const *endframe, int32_t fps, int32_t flags)
+{
+    if (defcacherecording)
+    {
+        Defs_CachePutOp(DEFOP_MODELANIM);
+        Defs_CachePutString(startframe);
+        Defs_CachePutString(endframe);
+        Defs_CachePut(fps);
+        Defs_CachePut(flags);
+    }
+
+    return md_defineanimation(modelid, startframe, endframe, fps, flags);
+}
+
+static int32_t Defs_DefineModelSkin(int32_t modelid, char const *fn, int32_t pal, int32_t skin, int32_t surf, float param,
+                                    float specpower, float specfactor, int32_t flags)
+{
+    if (defcacherecording)
+    {
+        Defs_CachePutOp(DEFOP_MODELSKIN);
+        Defs_CachePutString(fn);
+        Defs_CachePut(pal);
+        Defs_CachePut(skin);
+        Defs_CachePut(surf);
+        Defs_CachePut(param);
+        Defs_CachePut(specpower);
+        Defs_CachePut(specfactor);
+        Defs_CachePut(flags);
+    }
+
+    return md_defineskin(modelid, fn, pal, skin, surf, param, specpower, specfactor, flags);
+}
+
+static int32_t Defs_DefineModelHud(int32_t modelid, int32_t tile, vec3f_t add, int32_t angadd, int32_t flags, int32_t fov)
+{
+    if (defcacherecording)
+    {
+        Defs_CachePutOp(DEFOP_MODELHUD);
+        Defs_CachePut(tile);
+        Defs_CachePut(add);
+        Defs_CachePut(angadd);
+        Defs_CachePut(flags);
+        Defs_CachePut(fov);
+    }
+
+    return md_definehud(modelid, tile, add, angadd, flags, fov);
+}
+
+static int32_t Defs_SetModelMisc(int32_t modelid, float scale, int32_t shade, float zadd, float yoffset, int32_t flags)
+{
+    if (defcacherecording)
+    {
+        Defs_CachePutOp(DEFOP_MODELMISC);
+        Defs_CachePut(scale);
+        Defs_CachePut(shade);
+        Defs_CachePut(zadd);
+        Defs_CachePut(yoffset);
+        Defs_CachePut(flags);
+    }
+
+    return md_setmisc(modelid, scale, shade, zadd, yoffset, flags);
+}
+
+static int32_t Defs_UndefineModel(int32_t modelid)
+{
+    if (defcacherecording)
+        Defs_CachePutOp(DEFOP_UNDEFMODEL);
+
+    return md_undefinemodel(modelid);
+}
+
+static int32_t Defs_UndefineModelTile(int32_t tile)
+{
+    if (defcacherecording)
+    {
+        Defs_CachePutOp(DEFOP_UNDEFMODELTILE);
+        Defs_CachePut(tile);
+    }
+
+    return md_undefinetile(tile);
+}
+#endif
+
+static int32_t Defs_LoadVoxel(int32_t voxid, char const *fn)
+{
+    Defs_CacheAddDep(fn);
+
+    int32_t const ret = qloadkvx(voxid, fn);
+
+    if (defcacherecording && !ret)
+    {
+        Defs_CachePutOp(DEFOP_LOADVOXEL);
+        Defs_CachePut(voxid);
+        Defs_CachePutString(fn);
+    }
+
+    return ret;
+}
+
+static void Defs_SetVoxelTile(int32_t tile, int32_t voxid)
+{
+    if (defcacherecording)
+    {
+        Defs_CachePutOp(DEFOP_VOXELTILE);
+        Defs_CachePut(tile);
+        Defs_CachePut(voxid);
+    }
+
+    tiletovox[tile] = voxid;
+}
+
+static void Defs_SetVoxelScale(int32_t voxid, double scale)
+{
+    if (defcacherecording)
+    {
+        Defs_CachePutOp(DEFOP_VOXELSCALE);
+        Defs_CachePut(voxid);
+        Defs_CachePut(scale);
+    }
+
+    voxscale[voxid] = (int32_t)(65536*scale);
+#ifdef USE_OPENGL
+    if (voxmodels[voxid])
+        voxmodels[voxid]->scale = scale;
+#endif
+}
+
+static void Defs_SetVoxelFlags(int32_t voxid, uint8_t flags)
+{
+    if (defcacherecording)
+    {
+        Defs_CachePutOp(DEFOP_VOXELFLAGS);
+        Defs_CachePut(voxid);
+        Defs_CachePut(flags);
+    }
+
+    voxflags[voxid] |= flags;
+}
+
+#ifdef USE_DEFCACHE
+// top-level commands whose only lasting effects go through the wrappers above
+static int32_t Defs_IsCacheable(int32_t tokn)
+{
+    switch (tokn)
+    {
+    case T_EOF:
+    case T_ERROR:
+    case T_INCLUDE:
+    case T_INCLUDEDEFAULT:
+    case T_DEFINE:
+    case T_DEFINETEXTURE:
+    case T_DEFINESKYBOX:
+    case T_DEFINETINT:
+    case T_ALPHAHACK:
+    case T_ALPHAHACKRANGE:
+    case T_MODEL:
+    case T_VOXEL:
+    case T_SKYBOX:
+    case T_TINT:
+    case T_TEXTURE:
+    case T_UNDEFMODEL:
+    case T_UNDEFMODELRANGE:
+    case T_UNDEFMODELOF:
+    case T_UNDEFTEXTURE:
+    case T_UNDEFTEXTURERANGE:
+    case T_RFFDEFINEID:
+    case T_STUB_INTEGER:
+    case T_STUB_INTEGER_STRING:
+    case T_STUB_BRACES:
+    case T_STUB_STRING_BRACES:
+        return 1;
+    }
+
+    return 0;
+}
+
+static void Defs_StopRecording(void)
+{
+    defcacherecording = 0;
+
+    hash_free(&h_defcachedeps);
+
+    DO_FREE_AND_NULL(defcacheops.buf);
+    DO_FREE_AND_NULL(defcachedeps.buf);
+    defcacheops.size = defcacheops.len = 0;
+    defcachedeps.size = defcachedeps.len = 0;
+}
+
+static void Defs_StartRecording(char const *fn)
+{
+    Defs_StopRecording();
+    hash_init(&h_defcachedeps);
+    defcacherecording = 1;
+
+    // files inside groups and zips are only checked by length, so check the containers too
+    char const *name;
+
+    for (int i = 0; (name = kgroupfilename(i)) != NULL; i++)
+        if (name[0])
+            Defs_CacheAddDep(name);
+
+    Defs_CacheAddDep(fn);
+}
+
+static uint64_t Defs_CacheKey(char const *fn)
+{
+    int32_t const params[] = { DEFCACHE_VERSION, MAXTILES, MAXUSERTILES, MAXVOXELS, MAXPALOOKUPS, nextvoxid, nextmodelid };
+
+    uint64_t key = XXH3_64bits(params, sizeof(params));
+
+    // voxel slots reserved by the game decide which ids the definitions get
+    key = XXH3_64bits_withSeed(voxflags, sizeof(voxflags), key);
+    key = XXH3_64bits_withSeed(s_buildRev, Bstrlen(s_buildRev), key);
+    key = XXH3_64bits_withSeed(s_buildTimestamp, Bstrlen(s_buildTimestamp), key);
+    key = XXH3_64bits_withSeed(fn, Bstrlen(fn), key);
+    key = XXH3_64bits_withSeed(G_DefaultDefFile(), Bstrlen(G_DefaultDefFile()), key);
+
+    for (char const *m : g_defModules)
+        key = XXH3_64bits_withSeed(m, Bstrlen(m), key);
+
+    return key;
+}
+
+static void Defs_CacheFileName(char const *fn, char *buf, int32_t size)
+{
+    char name[BMAX_PATH];
+
+    Bsnprintf(name, sizeof(name), "%s.cache", fn);
+
+    for (char *p = name; *p; p++)
+        if (*p == '/' || *p == '\\' || *p == ':')
+            *p = '_';
+
+    if (g_modDir[0] != '/')
+        Bsnprintf(buf, size, "%s/%s", g_modDir, name);
+    else
+        Bstrncpyz(buf, name, size);
+}
+
+static void Defs_WriteCache(char const *fn, uint64_t key)
+{
+    char cachefn[BMAX_PATH];
+    Defs_CacheFileName(fn, cachefn, sizeof(cachefn));
+
+    buildvfs_FILE fil = buildvfs_fopen_write(cachefn);
+
+    if (!fil)
+    {
+        LOG_F(WARNING, "Unable to write DEF cache %s", cachefn);
+        return;
+    }
+
+    Defs_CachePutOp(DEFOP_END);
+
+    int32_t const sizes[2] = { defcachedeps.len, defcacheops.len };
+
+    buildvfs_fwrite(DEFCACHE_MAGIC, sizeof(DEFCACHE_MAGIC), 1, fil);
+    buildvfs_fwrite(&key, sizeof(key), 1, fil);
+    buildvfs_fwrite(sizes, sizeof(sizes), 1, fil);
+
+    dfwrite_LZ4(defcachedeps.buf, defcachedeps.len, 1, fil);
+    dfwrite_LZ4(defcacheops.buf, defcacheops.len, 1, fil);
+
+    buildvfs_fclose(fil);
+}
+
+typedef struct
+{
+    char const *ptr, *end;
+    int32_t     error;
+} defcachereader_t;
+
+template <typename T> static T Defs_CacheGet(defcachereader_t *r)
+{
+    T v {};
+
+    if (r->end - r->ptr < (ptrdiff_t)sizeof(T))
+    {
+        r->error = 1;
+        r->ptr   = r->end;
+        return v;
+    }
+
+    Bmemcpy(&v, r->ptr, sizeof(T));
+    r->ptr += sizeof(T);
+
+    return v;
+}
+
+static char const *Defs_CacheGetString(defcachereader_t *r)
+{
+    auto const nul = (char const *)Bmemchr(r->ptr, 0, r->end - r->ptr);
+
+    if (!nul)
+    {
+        r->error = 1;
+        r->ptr   = r->end;
+        return "";
+    }
+
+    char const *s = r->ptr;
+    r->ptr = nul + 1;
+
+    return s;
+}
+
+// With apply == 0 only checks that the ops read back whole. Returns the number of ops, or -1.
+static int32_t Defs_ReplayCache(char const *ops, int32_t len, int32_t apply)
+{
+    defcachereader_t r = { ops, ops + len, 0 };
+    int32_t modelid = -1, numops = 0;
+
+    while (!r.error)
+    {
+        switch (Defs_CacheGet<uint8_t>(&r))
+        {
+        case DEFOP_END:
+            return r.error ? -1 : numops;
+
+        case DEFOP_SUBSTTEX:
+        {
+            int32_t const tile  = Defs_CacheGet<int32_t>(&r);
+            int32_t const pal   = Defs_CacheGet<int32_t>(&r);
+            char const   *fn    = Defs_CacheGetString(&r);
+            float const alphacut   = Defs_CacheGet<float>(&r);
+            float const xscale     = Defs_CacheGet<float>(&r);
+            float const yscale     = Defs_CacheGet<float>(&r);
+            float const specpower  = Defs_CacheGet<float>(&r);
+            float const specfactor = Defs_CacheGet<float>(&r);
+            char const  flags      = Defs_CacheGet<char>(&r);
+
+            if (apply)
+                hicsetsubsttex(tile, pal, fn, alphacut, xscale, yscale, specpower, specfactor, flags);
+            break;
+        }
+
+        case DEFOP_CLEARSUBST:
+        {
+            int32_t const tile0 = Defs_CacheGet<int32_t>(&r);
+            int32_t const tile1 = Defs_CacheGet<int32_t>(&r);
+
+            if ((unsigned)tile0 >= MAXUSERTILES || (unsigned)tile1 >= MAXUSERTILES)
+                r.error = 1;
+            else if (apply)
+                Defs_ClearSubstRange(tile0, tile1);
+            break;
+        }
+
+        case DEFOP_DUMMYTILE:
+        {
+            int32_t const tile = Defs_CacheGet<int32_t>(&r);
+            int32_t const xsiz = Defs_CacheGet<int32_t>(&r);
+            int32_t const ysiz = Defs_CacheGet<int32_t>(&r);
+
+            if ((unsigned)tile >= MAXUSERTILES)
+                r.error = 1;
+            else if (apply)
+                Defs_SetupDummyTile(tile, xsiz, ysiz);
+            break;
+        }
+
+        case DEFOP_SKYBOX:
+        {
+            int32_t const tile = Defs_CacheGet<int32_t>(&r);
+            int32_t const pal  = Defs_CacheGet<int32_t>(&r);
+            char const *fn[6];
+
+            for (auto &face : fn)
+                face = Defs_CacheGetString(&r);
+
+            int32_t const flags = Defs_CacheGet<int32_t>(&r);
+
+            if (apply)
+                hicsetskybox(tile, pal, fn, flags);
+            break;
+        }
+
+        case DEFOP_TINT:
+        {
+            int32_t const pal = Defs_CacheGet<int32_t>(&r);
+            char rgb[6];
+
+            for (auto &c : rgb)
+                c = Defs_CacheGet<char>(&r);
+
+            polytintflags_t const flags = Defs_CacheGet<polytintflags_t>(&r);
+
+            if (apply)
+                hicsetpalettetint(pal, rgb[0], rgb[1], rgb[2], rgb[3], rgb[4], rgb[5], flags);
+            break;
+        }
+
+        case DEFOP_ALPHAHACK:
+        {
+            int32_t const tile  = Defs_CacheGet<int32_t>(&r);
+            uint8_t const alpha = Defs_CacheGet<uint8_t>(&r);
+
+            if ((unsigned)tile >= MAXTILES)
+                r.error = 1;
+            else if (apply)
+                alphahackarray[tile] = alpha;
+            break;
+        }
+
+        case DEFOP_LOADMODEL:
+        {
+            char const *fn = Defs_CacheGetString(&r);
+
+            if (apply && (modelid = md_loadmodel(fn)) < 0)
+                LOG_F(ERROR, "Failed loading MD2/MD3 model %s", fn);
+            break;
+        }
+
+        case DEFOP_MODELFRAME:
+        {
+            char const   *framename = Defs_CacheGetString(&r);
+            int32_t const tile      = Defs_CacheGet<int32_t>(&r);
+            int32_t const skin      = Defs_CacheGet<int32_t>(&r);
+            float const   smooth    = Defs_CacheGet<float>(&r);
+            int32_t const pal       = Defs_CacheGet<int32_t>(&r);
+
+            if (apply)
+                md_defineframe(modelid, framename, tile, skin, smooth, pal);
+            break;
+        }
+
+        case DEFOP_MODELANIM:
+        {
+            char const   *startframe = Defs_CacheGetString(&r);
+            char const   *endframe   = Defs_CacheGetString(&r);
+            int32_t const fps        = Defs_CacheGet<int32_t>(&r);
+            int32_t const flags      = Defs_CacheGet<int32_t>(&r);
+
+            if (apply)
+                md_defineanimation(modelid, startframe, endframe, fps, flags);
+            break;
+        }
+
+        case DEFOP_MODELSKIN:
+        {
+            char const   *fn         = Defs_CacheGetString(&r);
+            int32_t const pal        = Defs_CacheGet<int32_t>(&r);
+            int32_t const skin       = Defs_CacheGet<int32_t>(&r);
+            int32_t const surf       = Defs_CacheGet<int32_t>(&r);
+            float const   param      = Defs_CacheGet<float>(&r);
+            float const   specpower  = Defs_CacheGet<float>(&r);
+            float const   specfactor = Defs_CacheGet<float>(&r);
+            int32_t const flags      = Defs_CacheGet<int32_t>(&r);
+
+            if (apply)
+                md_defineskin(modelid, fn, pal, skin, surf, param, specpower, specfactor, flags);
+            break;
+        }
+
+        case DEFOP_MODELHUD:
+        {
+            int32_t const tile   = Defs_CacheGet<int32_t>(&r);
+            vec3f_t const add    = Defs_CacheGet<vec3f_t>(&r);
+            int32_t const angadd = Defs_CacheGet<int32_t>(&r);
+            int32_t const flags  = Defs_CacheGet<int32_t>(&r);
+            int32_t const fov    = Defs_CacheGet<int32_t>(&r);
+
+            if (apply)
+                md_definehud(modelid, tile, add, angadd, flags, fov);
+            break;
+        }
+
+        case DEFOP_MODELMISC:
+        {
+            float const   scale   = Defs_CacheGet<float>(&r);
+            int32_t const shade   = Defs_CacheGet<int32_t>(&r);
+            float const   zadd    = Defs_CacheGet<float>(&r);
+            float const   yoffset = Defs_CacheGet<float>(&r);
+            int32_t const flags   = Defs_CacheGet<int32_t>(&r);
+
+            if (apply && modelid >= 0)
+            {
+                md_setmisc(modelid, scale, shade, zadd, yoffset, flags);
+
+                if (glrendmode == REND_POLYMER)
+                    md3postload_polymer((md3model_t *)models[modelid]);
+            }
+            break;
+        }
+
+        case DEFOP_UNDEFMODEL:
+            if (apply && modelid >= 0)
+            {
+                md_undefinemodel(modelid);
+                nextmodelid--;
+            }
+            break;
+
+        case DEFOP_UNDEFMODELTILE:
+        {
+            int32_t const tile = Defs_CacheGet<int32_t>(&r);
+
+            if (apply)
+                md_undefinetile(tile);
+            break;
+        }
+
+        case DEFOP_LOADVOXEL:
+        {
+            int32_t const voxid = Defs_CacheGet<int32_t>(&r);
+            char const   *fn    = Defs_CacheGetString(&r);
+
+            if ((unsigned)voxid >= MAXVOXELS)
+                r.error = 1;
+            else if (apply)
+            {
+                if (qloadkvx(voxid, fn))
+                    LOG_F(ERROR, "definevoxel: failed loading %s", fn);
+
+                nextvoxid = voxid + 1;
+            }
+            break;
+        }
+
+        case DEFOP_VOXELTILE:
+        {
+            int32_t const tile  = Defs_CacheGet<int32_t>(&r);
+            int32_t const voxid = Defs_CacheGet<int32_t>(&r);
+
+            if ((unsigned)tile >= MAXTILES || (unsigned)voxid >= MAXVOXELS)
+                r.error = 1;
+            else if (apply)
+                tiletovox[tile] = voxid;
+            break;
+        }
+
+        case DEFOP_VOXELSCALE:
+        {
+            int32_t const voxid = Defs_CacheGet<int32_t>(&r);
+            double const  scale = Defs_CacheGet<double>(&r);
+
+            if ((unsigned)voxid >= MAXVOXELS)
+                r.error = 1;
+            else if (apply)
+                Defs_SetVoxelScale(voxid, scale);
+            break;
+        }
+
+        case DEFOP_VOXELFLAGS:
+        {
+            int32_t const voxid = Defs_CacheGet<int32_t>(&r);
+            uint8_t const flags = Defs_CacheGet<uint8_t>(&r);
+
+            if ((unsigned)voxid >= MAXVOXELS)
+                r.error = 1;
+            else if (apply)
+                voxflags[voxid] |= flags;
+            break;
+        }
+
+        default:
+            r.error = 1;
+            break;
+        }
+
+        numops++;
+    }
+
+    return -1;
+}
+
+// Returns 1 if the cache for fn matched and was replayed.
+static int32_t Defs_LoadCache(char const *fn, uint64_t key)
+{
+    char cachefn[BMAX_PATH];
+    Defs_CacheFileName(fn, cachefn, sizeof(cachefn));
+
+    buildvfs_kfd fil = kopen4load(cachefn, 0);
+
+    if (fil == buildvfs_kfd_invalid)
+        return 0;
+
+    uint32_t const starttime = timerGetTicks();
+
+    char     magic[sizeof(DEFCACHE_MAGIC)];
+    uint64_t filekey;
+    int32_t  sizes[2];
+
+    if (kread_and_test(fil, magic, sizeof(magic)) || Bmemcmp(magic, DEFCACHE_MAGIC, sizeof(magic))
+        || kread_and_test(fil, &filekey, sizeof(filekey)) || filekey != key
+        || kread_and_test(fil, sizes, sizeof(sizes)) || sizes[0] <= 0 || sizes[1] <= 0)
+    {
+        kclose(fil);
+        return 0;
+    }
+
+    auto deps = (char *)Xmalloc(sizes[0]);
+    auto ops  = (char *)Xmalloc(sizes[1]);
+
+    int32_t ok = kdfread_LZ4(deps, sizes[0], 1, fil) == 1 && kdfread_LZ4(ops, sizes[1], 1, fil) == 1;
+
+    kclose(fil);
+
+    // every file the parse looked at has to be where and as it was
+    defcachereader_t r = { deps, deps + sizes[0], 0 };
+    int32_t numdeps = 0;
+
+    while (ok && r.ptr < r.end)
+    {
+        char const *name = Defs_CacheGetString(&r);
+        int64_t const size  = Defs_CacheGet<int64_t>(&r);
+        int64_t const mtime = Defs_CacheGet<int64_t>(&r);
+        int64_t cursize, curmtime;
+
+        if (r.error)
+        {
+            ok = 0;
+            break;
+        }
+
+        Defs_GetFileInfo(name, &cursize, &curmtime);
+
+        if (cursize != size || curmtime != mtime)
+        {
+            VLOG_F(LOG_ENGINE, "%s has changed, parsing %s.", name, fn);
+            ok = 0;
+        }
+
+        numdeps++;
+    }
+
+    int32_t numops = -1;
+
+    if (ok && (numops = Defs_ReplayCache(ops, sizes[1], 0)) >= 0)
+    {
+        Defs_ReplayCache(ops, sizes[1], 1);
+        LOG_F(INFO, "Loaded %s from cache: %d definitions, %d files checked in %ums", fn, numops, numdeps,
+              timerGetTicks() - starttime);
+    }
+
+    Xfree(deps);
+    Xfree(ops);
+
+    return numops >= 0;
+}
+#endif
+
 #undef USE_DEF_PROGRESS
 #if defined _WIN32 || defined HAVE_GTK2
 # define USE_DEF_PROGRESS
@@ -436,6 +1337,10 @@ static int32_t defsparser(scriptfile *script)
         if (quitevent) return 0;
         tokn = getatoken(script,basetokens,ARRAY_SIZE(basetokens));
         cmdtokptr = script->ltextptr;
+#ifdef USE_DEFCACHE
+        if (defcacherecording && !Defs_IsCacheable(tokn))
+            defcacherecording = 0;
+#endif
         switch (tokn)
         {
         case T_ERROR:
@@ -483,11 +1388,11 @@ static int32_t defsparser(scriptfile *script)
             if (scriptfile_getnumber(script,&fnoo)) break; //y-size
             if (scriptfile_getstring(script,&fn))  break;
 
-            if (check_file_exist(fn))
+            if (Defs_CheckFile(fn))
                 break;
 
 #ifdef USE_OPENGL
-            hicsetsubsttex(tile,pal,fn,-1.0,1.0,1.0,1.0,1.0,0);
+            Defs_SetSubstTex(tile,pal,fn,-1.0,1.0,1.0,1.0,1.0,0);
 #endif
         }
         break;
@@ -503,12 +1408,12 @@ static int32_t defsparser(scriptfile *script)
             {
                 if (scriptfile_getstring(script,&fn[i])) break; //grab the 6 faces
 
-                if (check_file_exist(fn[i]))
+                if (Defs_CheckFile(fn[i]))
                     happy = 0;
             }
             if (i < 6 || !happy) break;
 #ifdef USE_OPENGL
-            hicsetskybox(tile,pal,fn, 0);
+            Defs_SetSkybox(tile,pal,fn, 0);
 #endif
         }
         break;
@@ -521,7 +1426,7 @@ static int32_t defsparser(scriptfile *script)
             if (scriptfile_getnumber(script,&g)) break;
             if (scriptfile_getnumber(script,&b)) break;
             if (scriptfile_getnumber(script,&f)) break; //effects
-            hicsetpalettetint(pal,r,g,b,0,0,0,f);
+            Defs_SetPaletteTint(pal,r,g,b,0,0,0,f);
         }
         break;
         case T_ALPHAHACK:
@@ -533,7 +1438,7 @@ static int32_t defsparser(scriptfile *script)
             if (scriptfile_getdouble(script,&alpha)) break;
 #ifdef USE_OPENGL
             if ((uint32_t)tile < MAXTILES)
-                alphahackarray[tile] = Blrintf(alpha * (float)UINT8_MAX);
+                Defs_SetAlphaHack(tile, Blrintf(alpha * (float)UINT8_MAX));
 #endif
         }
         break;
@@ -554,7 +1459,7 @@ static int32_t defsparser(scriptfile *script)
 
 #ifdef USE_OPENGL
             for (i=tilenume1; i<=tilenume2; i++)
-                alphahackarray[i] = Blrintf(alpha * (float)UINT8_MAX);
+                Defs_SetAlphaHack(i, Blrintf(alpha * (float)UINT8_MAX));
 #endif
         }
         break;
@@ -1252,13 +2157,13 @@ static int32_t defsparser(scriptfile *script)
             if (scriptfile_getnumber(script,&shadeoffs)) break;
 
 #ifdef USE_OPENGL
-            lastmodelid = md_loadmodel(modelfn);
+            lastmodelid = Defs_LoadModel(modelfn);
             if (EDUKE32_PREDICT_FALSE(lastmodelid < 0))
             {
                 LOG_F(WARNING, "Failed loading MD2/MD3 model %s", modelfn);
                 break;
             }
-            md_setmisc(lastmodelid,(float)scale, shadeoffs,0.0,0.0,0);
+            Defs_SetModelMisc(lastmodelid,(float)scale, shadeoffs,0.0,0.0,0);
 # ifdef POLYMER
             if (glrendmode == REND_POLYMER)
                 md3postload_polymer((md3model_t *)models[lastmodelid]);
@@ -1294,7 +2199,7 @@ static int32_t defsparser(scriptfile *script)
 #ifdef USE_OPENGL
             for (tilex = ftilenume; tilex <= ltilenume && happy; tilex++)
             {
-                switch (md_defineframe(lastmodelid, framename, tilex, max(0,modelskin), 0.0f,0))
+                switch (Defs_DefineModelFrame(lastmodelid, framename, tilex, max(0,modelskin), 0.0f,0))
                 {
                 case -1:
                     happy = 0; break; // invalid model id!?
@@ -1333,7 +2238,7 @@ static int32_t defsparser(scriptfile *script)
                 break;
             }
 #ifdef USE_OPENGL
-            switch (md_defineanimation(lastmodelid, startframe, endframe, (int32_t)(dfps*(65536.0*.001)), flags))
+            switch (Defs_DefineModelAnim(lastmodelid, startframe, endframe, (int32_t)(dfps*(65536.0*.001)), flags))
             {
             case 0:
                 break;
@@ -1374,7 +2279,7 @@ static int32_t defsparser(scriptfile *script)
             if (seenframe) { modelskin = ++lastmodelskin; }
             seenframe = 0;
 
-            if (check_file_exist(skinfn))
+            if (Defs_CheckFile(skinfn))
                 break;
 
             if (EDUKE32_PREDICT_FALSE(lastmodelid < 0))
@@ -1386,7 +2291,7 @@ static int32_t defsparser(scriptfile *script)
             }
 
 #ifdef USE_OPENGL
-            switch (md_defineskin(lastmodelid, skinfn, palnum, max(0,modelskin), 0, 0.0f, 1.0f, 1.0f, 0))
+            switch (Defs_DefineModelSkin(lastmodelid, skinfn, palnum, max(0,modelskin), 0, 0.0f, 1.0f, 1.0f, 0))
             {
             case 0:
                 break;
@@ -1492,7 +2397,7 @@ static int32_t defsparser(scriptfile *script)
             if (scriptfile_getstring(script,&modelfn)) break;
             if (scriptfile_getbraces(script,&modelend)) break;
 #ifdef USE_OPENGL
-            lastmodelid = md_loadmodel(modelfn);
+            lastmodelid = Defs_LoadModel(modelfn);
             if (EDUKE32_PREDICT_FALSE(lastmodelid < 0))
             {
                 LOG_F(ERROR, "Failed loading MD2/MD3 model %s", modelfn);
@@ -1580,7 +2485,7 @@ static int32_t defsparser(scriptfile *script)
 #ifdef USE_OPENGL
                     for (tilex = ftilenume; tilex <= ltilenume && happy; tilex++)
                     {
-                        framei = md_defineframe(lastmodelid, framename, tilex, max(0,modelskin), smoothduration,pal);
+                        framei = Defs_DefineModelFrame(lastmodelid, framename, tilex, max(0,modelskin), smoothduration,pal);
                         switch (framei)
                         {
                         case -1:
@@ -1659,7 +2564,7 @@ static int32_t defsparser(scriptfile *script)
                         break;
                     }
 #ifdef USE_OPENGL
-                    switch (md_defineanimation(lastmodelid, startframe, endframe, (int32_t)(dfps*(65536.0*.001)), flags))
+                    switch (Defs_DefineModelAnim(lastmodelid, startframe, endframe, (int32_t)(dfps*(65536.0*.001)), flags))
                     {
                     case 0:
                         break;
@@ -1761,7 +2666,7 @@ static int32_t defsparser(scriptfile *script)
                         break;
                     }
 
-                    if (check_file_exist(skinfn))
+                    if (Defs_CheckFile(skinfn))
                         break;
 
                     if (EDUKE32_PREDICT_FALSE(lastmodelid < 0))
@@ -1773,7 +2678,7 @@ static int32_t defsparser(scriptfile *script)
                     }
 
 #ifdef USE_OPENGL
-                    switch (md_defineskin(lastmodelid, skinfn, palnum, max(0,modelskin), surfnum, param, specpower, specfactor, flags))
+                    switch (Defs_DefineModelSkin(lastmodelid, skinfn, palnum, max(0,modelskin), surfnum, param, specpower, specfactor, flags))
                     {
                     case 0:
                         break;
@@ -1869,7 +2774,7 @@ static int32_t defsparser(scriptfile *script)
                     for (tilex = ftilenume; tilex <= ltilenume && happy; tilex++)
                     {
                         vec3f_t const add = { (float)xadd, (float)yadd, (float)zadd };
-                        switch (md_definehud(lastmodelid, tilex, add, angadd, flags, fov))
+                        switch (Defs_DefineModelHud(lastmodelid, tilex, add, angadd, flags, fov))
                         {
                         case 0:
                             break;
@@ -1899,13 +2804,13 @@ static int32_t defsparser(scriptfile *script)
                 if (lastmodelid >= 0)
                 {
                     LOG_F(ERROR, "Model %s (%d) removed due to errors in definition.", modelfn, lastmodelid);
-                    md_undefinemodel(lastmodelid);
+                    Defs_UndefineModel(lastmodelid);
                     nextmodelid--;
                 }
                 break;
             }
 
-            md_setmisc(lastmodelid,(float)scale,shadeoffs,(float)mzadd,(float)myoffset,flags);
+            Defs_SetModelMisc(lastmodelid,(float)scale,shadeoffs,(float)mzadd,(float)myoffset,flags);
 
             // thin out the loaded model by throwing away unused frames
             // FIXME: CURRENTLY DISABLED: interpolation may access frames we consider 'unused'?
@@ -1972,7 +2877,7 @@ static int32_t defsparser(scriptfile *script)
                 break;
             }
 
-            if (EDUKE32_PREDICT_FALSE(qloadkvx(nextvoxid, fn)))
+            if (EDUKE32_PREDICT_FALSE(Defs_LoadVoxel(nextvoxid, fn)))
             {
                 LOG_F(ERROR, "definevoxel: failed loading %s",fn);
                 script->textptr = voxelend + 1;
@@ -1991,7 +2896,7 @@ static int32_t defsparser(scriptfile *script)
                     if (check_tile("voxel", tilex, script, voxeltokptr))
                         break;
 
-                    tiletovox[tilex] = lastvoxid;
+                    Defs_SetVoxelTile(tilex, lastvoxid);
                     break;
 
                 case T_TILE0:
@@ -2005,29 +2910,25 @@ static int32_t defsparser(scriptfile *script)
                         break;
 
                     for (tilex=tile0; tilex<=tile1; tilex++)
-                        tiletovox[tilex] = lastvoxid;
+                        Defs_SetVoxelTile(tilex, lastvoxid);
                     break; //last tile number (inclusive)
 
                 case T_SCALE:
                 {
                     double scale=1.0;
                     scriptfile_getdouble(script,&scale);
-                    voxscale[lastvoxid] = (int32_t)(65536*scale);
-#ifdef USE_OPENGL
-                    if (voxmodels[lastvoxid])
-                        voxmodels[lastvoxid]->scale = scale;
-#endif
+                    Defs_SetVoxelScale(lastvoxid, scale);
                     break;
                 }
 
                 case T_NOTRANS:
-                    voxflags[lastvoxid] |= VF_NOTRANS;
+                    Defs_SetVoxelFlags(lastvoxid, VF_NOTRANS);
                     break;
 
                 // begin downstream
 
                 case T_ROTATE:
-                    voxflags[lastvoxid] |= VF_ROTATE;
+                    Defs_SetVoxelFlags(lastvoxid, VF_ROTATE);
                     break;
 
                 // end downstream
@@ -2112,13 +3013,13 @@ static int32_t defsparser(scriptfile *script)
                     happy = 0;
                 }
                 // FIXME?
-                if (check_file_exist(fn[i]))
+                if (Defs_CheckFile(fn[i]))
                     happy = 0;
             }
             if (!happy) break;
 
 #ifdef USE_OPENGL
-            hicsetskybox(tile,pal,fn, flags);
+            Defs_SetSkybox(tile,pal,fn, flags);
 #endif
         }
         break;
@@ -2170,7 +3071,7 @@ static int32_t defsparser(scriptfile *script)
                 break;
             }
 
-            if (check_file_exist(fn))
+            if (Defs_CheckFile(fn))
                 break;
 
 #ifdef POLYMER
@@ -2269,7 +3170,7 @@ static int32_t defsparser(scriptfile *script)
                 break;
             }
 
-            hicsetpalettetint(pal,red,green,blue,shadered,shadegreen,shadeblue,flags);
+            Defs_SetPaletteTint(pal,red,green,blue,shadered,shadegreen,shadeblue,flags);
         }
         break;
         case T_MAKEPALOOKUP:
@@ -2470,19 +3371,15 @@ static int32_t defsparser(scriptfile *script)
                         break;
                     }
 
-                    if (EDUKE32_PREDICT_FALSE(check_file_exist(fn)))
+                    if (EDUKE32_PREDICT_FALSE(Defs_CheckFile(fn)))
                         break;
 
                     if (xsiz > 0 && ysiz > 0)
-                    {
-                        tileSetSize(tile, xsiz, ysiz);
-                        Bmemset(&picanm[tile], 0, sizeof(picanm_t));
-                        tileSetupDummy(tile);
-                    }
+                        Defs_SetupDummyTile(tile, xsiz, ysiz);
                     xscale = 1.0f / xscale;
                     yscale = 1.0f / yscale;
 
-                    hicsetsubsttex(tile,pal,fn,alphacut,xscale,yscale, specpower, specfactor,flags);
+                    Defs_SetSubstTex(tile,pal,fn,alphacut,xscale,yscale, specpower, specfactor,flags);
                 }
                 break;
                 case T_DETAIL: case T_GLOW: case T_SPECULAR: case T_NORMAL:
@@ -2546,7 +3443,7 @@ static int32_t defsparser(scriptfile *script)
                         break;
                     }
 
-                    if (EDUKE32_PREDICT_FALSE(check_file_exist(fn)))
+                    if (EDUKE32_PREDICT_FALSE(Defs_CheckFile(fn)))
                         break;
 
 #ifdef USE_OPENGL
@@ -2567,7 +3464,7 @@ static int32_t defsparser(scriptfile *script)
                         pal = NORMALPAL;
                         break;
                     }
-                    hicsetsubsttex(tile,pal,fn,-1.0f,xscale,yscale, specpower, specfactor,flags);
+                    Defs_SetSubstTex(tile,pal,fn,-1.0f,xscale,yscale, specpower, specfactor,flags);
 #endif
                 }
                 break;
@@ -2605,7 +3502,7 @@ static int32_t defsparser(scriptfile *script)
             }
 #ifdef USE_OPENGL
             for (; r0 <= r1; r0++)
-                md_undefinetile(r0);
+                Defs_UndefineModelTile(r0);
 #endif
         }
         break;
@@ -2639,9 +3536,6 @@ static int32_t defsparser(scriptfile *script)
         case T_UNDEFTEXTURERANGE:
         {
             int32_t r0,r1;
-#ifdef USE_OPENGL
-            int32_t i;
-#endif
 
             if (EDUKE32_PREDICT_FALSE(scriptfile_getsymbol(script,&r0))) break;
             if (tokn == T_UNDEFTEXTURERANGE)
@@ -2660,9 +3554,7 @@ static int32_t defsparser(scriptfile *script)
             }
 
 #ifdef USE_OPENGL
-            for (; r0 <= r1; r0++)
-                for (i=MAXPALOOKUPS-1; i>=0; i--)
-                    hicclearsubst(r0,i);
+            Defs_ClearSubstRange(r0, r1);
 #endif
         }
         break;
@@ -3922,6 +4814,15 @@ static int32_t defsparser(scriptfile *script)
 
 int32_t loaddefinitionsfile(const char *fn)
 {
+#ifdef USE_DEFCACHE
+    uint64_t const cachekey = Defs_CacheKey(fn);
+
+    if (Defs_LoadCache(fn, cachekey))
+        return 0;
+
+    Defs_StartRecording(fn);
+#endif
+
     scriptfile *script = scriptfile_fromfile(fn);
 
     if (script)
@@ -3936,6 +4837,13 @@ int32_t loaddefinitionsfile(const char *fn)
     if (script)
         scriptfile_close(script);
 
+#ifdef USE_DEFCACHE
+    if (script && !quitevent && defcacherecording)
+        Defs_WriteCache(fn, cachekey);
+
+    Defs_StopRecording();
+#endif
+
     scriptfile_clearsymbols();
 
     DO_FREE_AND_NULL(faketilebuffer);
@@ -21,6 +21,7 @@
 #include "engine_priv.h"
 #include "hightile.h"
 #include "kplib.h"
+#include "libasync_config.h"
 #include "lz4.h"
 #include "microprofile.h"
 #include "osd.h"
@@ -28,6 +29,7 @@
 #include "pragmas.h"
 #include "scriptfile.h"
 #include "softsurface.h"
+#include "timer.h"
 #include "vfs.h"
 
 #ifdef USE_OPENGL
@@ -131,6 +133,7 @@ uint32_t r_screenxy = 0;
 
 int32_t r_rotatespriteinterp = 1;
 int32_t r_fpgrouscan = 1;
+int32_t r_classicthreads = 1;
 int32_t r_displayindex = 0;
 int32_t r_borderless = 2;
 int32_t r_windowpositioning = 1;
@@ -287,6 +290,8 @@ static classicht_t *globalht;
 static uint8_t *reachablesectors;
 int16_t wallsect[MAXWALLS];
 
+static void sectorgrid_free(void);
+
 void initcrc16()
 {
     int i, j, k, a;
@@ -3092,58 +3097,28 @@ static void florscan(int32_t x1, int32_t x2, int32_t sectnum)
 }
 
 
+// Vertical column bands narrower than this are always drawn on the calling thread.
+#define CLASSIC_MINBANDWIDTH 64
+
 //
-// wallscan (internal)
+// wallscan_columns (internal)
 //
-static void wallscan(int32_t x1, int32_t x2,
-                     const int16_t *uwal, const int16_t *dwal,
-                     const int32_t *swal, const int32_t *lwal)
+// Draws the wall columns [x, x2]. All per-column state lives in the arrays
+// passed in so that disjoint column bands may be drawn concurrently.
+//
+static void wallscan_columns(int32_t x, int32_t const x2,
+                             const int16_t *uwal, const int16_t *dwal,
+                             const int32_t *swal, const int32_t *lwal,
+                             intptr_t const fpalookup, vec2_16_t const tsiz,
+                             intptr_t *paloffs, uint32_t *vplcs, int32_t *vincs, intptr_t *bufplcs)
 {
-    int32_t x;
-    intptr_t fpalookup;
     int32_t y1ve[4], y2ve[4];
-    vec2_16_t tsiz;
 #ifdef MULTI_COLUMN_VLINE
     char bad;
     int32_t u4, d4, z;
     uintptr_t p;
 #endif
 
-#ifdef YAX_ENABLE
-    if (g_nodraw)
-        return;
-#endif
-    setgotpic(globalpicnum);
-    if (globalshiftval < 0)
-        return;
-
-    if (x2 >= xdim)
-        x2 = xdim-1;
-    assert((unsigned)x1 < (unsigned)xdim);
-
-    tsiz = tilesiz[globalpicnum];
-
-    if ((tsiz.x <= 0) || (tsiz.y <= 0)) return;
-    if ((uwal[x1] > ydimen) && (uwal[x2] > ydimen)) return;
-    if ((dwal[x1] < 0) && (dwal[x2] < 0)) return;
-
-    vec2_16_t upscale = {};
-    tileLoadScaled(globalpicnum, &upscale);
-
-    tsiz.x <<= upscale.x;
-    tsiz.y <<= upscale.y;
-
-    tweak_tsizes(&tsiz);
-
-    fpalookup = FP_OFF(palookup[globalpal]);
-
-    setupvlineasm(globalshiftval);
-
-
-    x = x1;
-    while ((x <= x2) && (umost[x] > dmost[x]))
-        x++;
-
 #ifdef NONPOW2_YSIZE_ASM
     if (globalshiftval==0)
         goto do_vlineasm1;
@@ -3156,12 +3131,12 @@ static void wallscan(int32_t x1, int32_t x2,
         y2ve[0] = min(dwal[x],dmost[x]);
         if (y2ve[0] <= y1ve[0]) continue;
 
-        palookupoffse[0] = fpalookup + getpalookupsh(mulscale16(swal[x],globvis));
+        paloffs[0] = fpalookup + getpalookupsh(mulscale16(swal[x],globvis));
 
-        calc_bufplc(&bufplce[0], lwal[x], tsiz);
-        calc_vplcinc(&vplce[0], &vince[0], swal, x, y1ve[0]);
+        calc_bufplc(&bufplcs[0], lwal[x], tsiz);
+        calc_vplcinc(&vplcs[0], &vincs[0], swal, x, y1ve[0]);
 
-        vlineasm1(vince[0],palookupoffse[0],y2ve[0]-y1ve[0]-1,vplce[0],bufplce[0],x+frameoffset+ylookup[y1ve[0]]);
+        vlineasm1(vincs[0],paloffs[0],y2ve[0]-y1ve[0]-1,vplcs[0],bufplcs[0],x+frameoffset+ylookup[y1ve[0]]);
     }
     for (; x<=x2-3; x+=4)
     {
@@ -3172,23 +3147,23 @@ static void wallscan(int32_t x1, int32_t x2,
             y2ve[z] = min(dwal[x+z],dmost[x+z])-1;
             if (y2ve[z] < y1ve[z]) { bad += pow2char[z]; continue; }
 
-            calc_bufplc(&bufplce[z], lwal[x+z], tsiz);
-            calc_vplcinc(&vplce[z], &vince[z], swal, x+z, y1ve[z]);
+            calc_bufplc(&bufplcs[z], lwal[x+z], tsiz);
+            calc_vplcinc(&vplcs[z], &vincs[z], swal, x+z, y1ve[z]);
         }
         if (bad == 15) continue;
 
-        palookupoffse[0] = fpalookup + getpalookupsh(mulscale16(swal[x],globvis));
-        palookupoffse[3] = fpalookup + getpalookupsh(mulscale16(swal[x+3],globvis));
+        paloffs[0] = fpalookup + getpalookupsh(mulscale16(swal[x],globvis));
+        paloffs[3] = fpalookup + getpalookupsh(mulscale16(swal[x+3],globvis));
 
-        if ((palookupoffse[0] == palookupoffse[3]) && ((bad&0x9) == 0))
+        if ((paloffs[0] == paloffs[3]) && ((bad&0x9) == 0))
         {
-            palookupoffse[1] = palookupoffse[0];
-            palookupoffse[2] = palookupoffse[0];
+            paloffs[1] = paloffs[0];
+            paloffs[2] = paloffs[0];
         }
         else
         {
-            palookupoffse[1] = fpalookup + getpalookupsh(mulscale16(swal[x+1],globvis));
-            palookupoffse[2] = fpalookup + getpalookupsh(mulscale16(swal[x+2],globvis));
+            paloffs[1] = fpalookup + getpalookupsh(mulscale16(swal[x+1],globvis));
+            paloffs[2] = fpalookup + getpalookupsh(mulscale16(swal[x+2],globvis));
         }
 
         u4 = max(max(y1ve[0],y1ve[1]),max(y1ve[2],y1ve[3]));
@@ -3196,25 +3171,29 @@ static void wallscan(int32_t x1, int32_t x2,
 
         if ((bad != 0) || (u4 >= d4))
         {
-            if (!(bad&1)) prevlineasm1(vince[0],palookupoffse[0],y2ve[0]-y1ve[0],vplce[0],bufplce[0],ylookup[y1ve[0]]+x+frameoffset+0);
-            if (!(bad&2)) prevlineasm1(vince[1],palookupoffse[1],y2ve[1]-y1ve[1],vplce[1],bufplce[1],ylookup[y1ve[1]]+x+frameoffset+1);
-            if (!(bad&4)) prevlineasm1(vince[2],palookupoffse[2],y2ve[2]-y1ve[2],vplce[2],bufplce[2],ylookup[y1ve[2]]+x+frameoffset+2);
-            if (!(bad&8)) prevlineasm1(vince[3],palookupoffse[3],y2ve[3]-y1ve[3],vplce[3],bufplce[3],ylookup[y1ve[3]]+x+frameoffset+3);
+            if (!(bad&1)) prevlineasm1(vincs[0],paloffs[0],y2ve[0]-y1ve[0],vplcs[0],bufplcs[0],ylookup[y1ve[0]]+x+frameoffset+0);
+            if (!(bad&2)) prevlineasm1(vincs[1],paloffs[1],y2ve[1]-y1ve[1],vplcs[1],bufplcs[1],ylookup[y1ve[1]]+x+frameoffset+1);
+            if (!(bad&4)) prevlineasm1(vincs[2],paloffs[2],y2ve[2]-y1ve[2],vplcs[2],bufplcs[2],ylookup[y1ve[2]]+x+frameoffset+2);
+            if (!(bad&8)) prevlineasm1(vincs[3],paloffs[3],y2ve[3]-y1ve[3],vplcs[3],bufplcs[3],ylookup[y1ve[3]]+x+frameoffset+3);
             continue;
         }
 
-        if (u4 > y1ve[0]) vplce[0] = prevlineasm1(vince[0],palookupoffse[0],u4-y1ve[0]-1,vplce[0],bufplce[0],ylookup[y1ve[0]]+x+frameoffset+0);
-        if (u4 > y1ve[1]) vplce[1] = prevlineasm1(vince[1],palookupoffse[1],u4-y1ve[1]-1,vplce[1],bufplce[1],ylookup[y1ve[1]]+x+frameoffset+1);
-        if (u4 > y1ve[2]) vplce[2] = prevlineasm1(vince[2],palookupoffse[2],u4-y1ve[2]-1,vplce[2],bufplce[2],ylookup[y1ve[2]]+x+frameoffset+2);
-        if (u4 > y1ve[3]) vplce[3] = prevlineasm1(vince[3],palookupoffse[3],u4-y1ve[3]-1,vplce[3],bufplce[3],ylookup[y1ve[3]]+x+frameoffset+3);
+        if (u4 > y1ve[0]) vplcs[0] = prevlineasm1(vincs[0],paloffs[0],u4-y1ve[0]-1,vplcs[0],bufplcs[0],ylookup[y1ve[0]]+x+frameoffset+0);
+        if (u4 > y1ve[1]) vplcs[1] = prevlineasm1(vincs[1],paloffs[1],u4-y1ve[1]-1,vplcs[1],bufplcs[1],ylookup[y1ve[1]]+x+frameoffset+1);
+        if (u4 > y1ve[2]) vplcs[2] = prevlineasm1(vincs[2],paloffs[2],u4-y1ve[2]-1,vplcs[2],bufplcs[2],ylookup[y1ve[2]]+x+frameoffset+2);
+        if (u4 > y1ve[3]) vplcs[3] = prevlineasm1(vincs[3],paloffs[3],u4-y1ve[3]-1,vplcs[3],bufplcs[3],ylookup[y1ve[3]]+x+frameoffset+3);
 
+#ifdef ENGINE_USING_A_C
+        if (d4 >= u4) vlineasm4_ex(d4-u4+1, (char *)(ylookup[u4]+x+frameoffset), paloffs, bufplcs, vplcs, vincs, globalshiftval, globaltilesizy);
+#else
         if (d4 >= u4) vlineasm4(d4-u4+1, (char *)(ylookup[u4]+x+frameoffset));
+#endif
 
         p = x+frameoffset+ylookup[d4+1];
-        if (y2ve[0] > d4) prevlineasm1(vince[0],palookupoffse[0],y2ve[0]-d4-1,vplce[0],bufplce[0],p+0);
-        if (y2ve[1] > d4) prevlineasm1(vince[1],palookupoffse[1],y2ve[1]-d4-1,vplce[1],bufplce[1],p+1);
-        if (y2ve[2] > d4) prevlineasm1(vince[2],palookupoffse[2],y2ve[2]-d4-1,vplce[2],bufplce[2],p+2);
-        if (y2ve[3] > d4) prevlineasm1(vince[3],palookupoffse[3],y2ve[3]-d4-1,vplce[3],bufplce[3],p+3);
+        if (y2ve[0] > d4) prevlineasm1(vincs[0],paloffs[0],y2ve[0]-d4-1,vplcs[0],bufplcs[0],p+0);
+        if (y2ve[1] > d4) prevlineasm1(vincs[1],paloffs[1],y2ve[1]-d4-1,vplcs[1],bufplcs[1],p+1);
+        if (y2ve[2] > d4) prevlineasm1(vincs[2],paloffs[2],y2ve[2]-d4-1,vplcs[2],bufplcs[2],p+2);
+        if (y2ve[3] > d4) prevlineasm1(vincs[3],paloffs[3],y2ve[3]-d4-1,vplcs[3],bufplcs[3],p+3);
     }
 #endif
 
@@ -3227,19 +3206,298 @@ do_vlineasm1:
         y2ve[0] = min(dwal[x],dmost[x]);
         if (y2ve[0] <= y1ve[0]) continue;
 
-        palookupoffse[0] = fpalookup + getpalookupsh(mulscale16(swal[x],globvis));
+        paloffs[0] = fpalookup + getpalookupsh(mulscale16(swal[x],globvis));
 
-        calc_bufplc(&bufplce[0], lwal[x], tsiz);
-        calc_vplcinc(&vplce[0], &vince[0], swal, x, y1ve[0]);
+        calc_bufplc(&bufplcs[0], lwal[x], tsiz);
+        calc_vplcinc(&vplcs[0], &vincs[0], swal, x, y1ve[0]);
 
 #ifdef NONPOW2_YSIZE_ASM
         if (globalshiftval==0)
-            vlineasm1nonpow2(vince[0],palookupoffse[0],y2ve[0]-y1ve[0]-1,vplce[0],bufplce[0],x+frameoffset+ylookup[y1ve[0]]);
+            vlineasm1nonpow2(vincs[0],paloffs[0],y2ve[0]-y1ve[0]-1,vplcs[0],bufplcs[0],x+frameoffset+ylookup[y1ve[0]]);
         else
 #endif
-        vlineasm1(vince[0],palookupoffse[0],y2ve[0]-y1ve[0]-1,vplce[0],bufplce[0],x+frameoffset+ylookup[y1ve[0]]);
+        vlineasm1(vincs[0],paloffs[0],y2ve[0]-y1ve[0]-1,vplcs[0],bufplcs[0],x+frameoffset+ylookup[y1ve[0]]);
+    }
+}
+
+#ifdef ENGINE_USING_A_C
+//
+// Queued wall columns
+//
+// With r_classicthreads above 1, wallscan() only resolves the clip range, shade
+// and texture coordinates of each column and queues them. All queued columns of
+// a frame are then filled with a single dispatch at the end of drawrooms: the
+// screen is cut into vertical bands and each worker draws its band of every span.
+// Walls never overlap within drawrooms, so the order of the spans does not matter.
+//
+typedef struct
+{
+    intptr_t pal, buf;
+    uint32_t vplc;
+    int32_t vinc;
+    int16_t y1, y2;
+} wallcolumn_t;
+
+typedef struct
+{
+    int32_t x1, x2, col;
+    int32_t logy, tilesizy;
+    char *lock;
+    char oldlock;
+} wallspan_t;
+
+static wallcolumn_t *wallcolumns;
+static wallspan_t *wallspans;
+static int32_t numwallcolumns, maxwallcolumns;
+static int32_t numwallspans, maxwallspans;
+
+static void wallscan_queue(int32_t x, int32_t const x2,
+                           const int16_t *uwal, const int16_t *dwal,
+                           const int32_t *swal, const int32_t *lwal,
+                           intptr_t const fpalookup, vec2_16_t const tsiz)
+{
+    if (x > x2)
+        return;
+
+    if (numwallspans >= maxwallspans)
+    {
+        maxwallspans = max(256, maxwallspans<<1);
+        wallspans = (wallspan_t *)Xrealloc(wallspans, maxwallspans * sizeof(wallspan_t));
+    }
+
+    if (numwallcolumns + (x2-x+1) > maxwallcolumns)
+    {
+        maxwallcolumns = max(numwallcolumns + (x2-x+1), max(4096, maxwallcolumns<<1));
+        wallcolumns = (wallcolumn_t *)Xrealloc(wallcolumns, maxwallcolumns * sizeof(wallcolumn_t));
+    }
+
+    auto &span = wallspans[numwallspans++];
+
+    span.x1 = x;
+    span.x2 = x2;
+    span.col = numwallcolumns;
+    span.logy = globalshiftval;
+    span.tilesizy = globaltilesizy;
+
+    // The tile has to stay resident until the queued columns have been drawn.
+    span.lock = globalht ? &globalht->lock : &walock[globalpicnum];
+    span.oldlock = *span.lock;
+
+    if ((uint8_t)span.oldlock < CACHE1D_LOCKED)
+        *span.lock = CACHE1D_LOCKED;
+    else
+        span.lock = NULL;
+
+    auto const col = &wallcolumns[span.col];
+
+    for (int32_t i = x; i <= x2; i++)
+    {
+        auto &c = col[i-span.x1];
+
+        c.y1 = max(uwal[i],umost[i]);
+        c.y2 = min(dwal[i],dmost[i]);
+
+        if (c.y2 <= c.y1)
+            continue;
+
+        c.pal = fpalookup + getpalookupsh(mulscale16(swal[i],globvis));
+        calc_bufplc(&c.buf, lwal[i], tsiz);
+        calc_vplcinc(&c.vplc, &c.vinc, swal, i, c.y1);
+    }
+
+    // Share the shade of aligned column quads exactly like wallscan_columns()
+    // does, so that the output does not depend on r_classicthreads.
+    while ((x<=x2)&&((x+frameoffset)&3))
+        x++;
+
+    for (; x<=x2-3; x+=4)
+    {
+        auto const q = &col[x-span.x1];
+
+        if (q[0].y2 > q[0].y1 && q[3].y2 > q[3].y1 && q[0].pal == q[3].pal)
+        {
+            q[1].pal = q[0].pal;
+            q[2].pal = q[0].pal;
+        }
+    }
+
+    numwallcolumns += x2-span.x1+1;
+}
+
+static void wallscan_fillspan(wallspan_t const &span, int32_t x, int32_t const x2)
+{
+    auto const col = &wallcolumns[span.col];
+    int32_t const x0 = span.x1, logy = span.logy, tilesizy = span.tilesizy;
+
+    for (; (x<=x2)&&((x+frameoffset)&3); x++)
+    {
+        auto const &c = col[x-x0];
+        if (c.y2 > c.y1)
+            vlineasm1_ex(c.vinc,c.pal,c.y2-c.y1-1,c.vplc,c.buf,x+frameoffset+ylookup[c.y1],logy,tilesizy);
     }
 
+    for (; x<=x2-3; x+=4)
+    {
+        auto const q = &col[x-x0];
+        int32_t y2ve[4];
+        char bad = 0;
+
+        for (int z=0; z<4; z++)
+        {
+            y2ve[z] = q[z].y2-1;
+            if (y2ve[z] < q[z].y1) bad += pow2char[z];
+        }
+
+        if (bad == 15) continue;
+
+        int32_t const u4 = max(max(q[0].y1,q[1].y1),max(q[2].y1,q[3].y1));
+        int32_t const d4 = min(min(y2ve[0],y2ve[1]),min(y2ve[2],y2ve[3]));
+
+        if ((bad != 0) || (u4 >= d4))
+        {
+            for (int z=0; z<4; z++)
+                if (!(bad & pow2char[z]))
+                    vlineasm1_ex(q[z].vinc,q[z].pal,y2ve[z]-q[z].y1,q[z].vplc,q[z].buf,ylookup[q[z].y1]+x+frameoffset+z,logy,tilesizy);
+            continue;
+        }
+
+        intptr_t paloffs[4], bufplcs[4];
+        uint32_t vplcs[4];
+        int32_t vincs[4];
+
+        for (int z=0; z<4; z++)
+        {
+            paloffs[z] = q[z].pal;
+            bufplcs[z] = q[z].buf;
+            vplcs[z] = q[z].vplc;
+            vincs[z] = q[z].vinc;
+
+            if (u4 > q[z].y1)
+                vplcs[z] = vlineasm1_ex(vincs[z],paloffs[z],u4-q[z].y1-1,vplcs[z],bufplcs[z],ylookup[q[z].y1]+x+frameoffset+z,logy,tilesizy);
+        }
+
+        vlineasm4_ex(d4-u4+1, (char *)(ylookup[u4]+x+frameoffset), paloffs, bufplcs, vplcs, vincs, logy, tilesizy);
+
+        intptr_t const p = x+frameoffset+ylookup[d4+1];
+
+        for (int z=0; z<4; z++)
+            if (y2ve[z] > d4)
+                vlineasm1_ex(vincs[z],paloffs[z],y2ve[z]-d4-1,vplcs[z],bufplcs[z],p+z,logy,tilesizy);
+    }
+
+    for (; x<=x2; x++)
+    {
+        auto const &c = col[x-x0];
+        if (c.y2 > c.y1)
+            vlineasm1_ex(c.vinc,c.pal,c.y2-c.y1-1,c.vplc,c.buf,x+frameoffset+ylookup[c.y1],logy,tilesizy);
+    }
+}
+
+//
+// classicFlushWallColumns (internal)
+//
+// Fills every queued wall column in one parallel dispatch and releases the
+// tiles that were locked for them.
+//
+static void classicFlushWallColumns(void)
+{
+    if (numwallspans == 0)
+        return;
+
+    int32_t const numbands = max(1, min(r_classicthreads, xdim/CLASSIC_MINBANDWIDTH));
+    int32_t const bandwidth = (((xdim+numbands-1)/numbands)+3)&~3;
+
+    auto fillband = [bandwidth](int32_t band)
+    {
+        int32_t const bx1 = band*bandwidth;
+        int32_t const bx2 = bx1+bandwidth-1;
+
+        for (int32_t i = 0; i < numwallspans; i++)
+        {
+            auto const &span = wallspans[i];
+            int32_t const x1 = max(span.x1, bx1), x2 = min(span.x2, bx2);
+
+            if (x1 <= x2)
+                wallscan_fillspan(span, x1, x2);
+        }
+    };
+
+    if (numbands > 1)
+        async::parallel_for(async::irange(0, numbands), fillband);
+    else
+        fillband(0);
+
+    // Restore in reverse so that a tile queued several times gets its original lock back.
+    for (int32_t i = numwallspans-1; i >= 0; i--)
+        if (wallspans[i].lock)
+            *wallspans[i].lock = wallspans[i].oldlock;
+
+    numwallspans = 0;
+    numwallcolumns = 0;
+}
+
+static void classicFreeWallColumns(void)
+{
+    DO_FREE_AND_NULL(wallcolumns);
+    DO_FREE_AND_NULL(wallspans);
+    numwallcolumns = maxwallcolumns = 0;
+    numwallspans = maxwallspans = 0;
+}
+#endif
+
+//
+// wallscan (internal)
+//
+static void wallscan(int32_t x1, int32_t x2,
+                     const int16_t *uwal, const int16_t *dwal,
+                     const int32_t *swal, const int32_t *lwal)
+{
+    int32_t x;
+    intptr_t fpalookup;
+    vec2_16_t tsiz;
+
+#ifdef YAX_ENABLE
+    if (g_nodraw)
+        return;
+#endif
+    setgotpic(globalpicnum);
+    if (globalshiftval < 0)
+        return;
+
+    if (x2 >= xdim)
+        x2 = xdim-1;
+    assert((unsigned)x1 < (unsigned)xdim);
+
+    tsiz = tilesiz[globalpicnum];
+
+    if ((tsiz.x <= 0) || (tsiz.y <= 0)) return;
+    if ((uwal[x1] > ydimen) && (uwal[x2] > ydimen)) return;
+    if ((dwal[x1] < 0) && (dwal[x2] < 0)) return;
+
+    vec2_16_t upscale = {};
+    tileLoadScaled(globalpicnum, &upscale);
+
+    tsiz.x <<= upscale.x;
+    tsiz.y <<= upscale.y;
+
+    tweak_tsizes(&tsiz);
+
+    fpalookup = FP_OFF(palookup[globalpal]);
+
+    setupvlineasm(globalshiftval);
+
+
+    x = x1;
+    while ((x <= x2) && (umost[x] > dmost[x]))
+        x++;
+
+#ifdef ENGINE_USING_A_C
+    if (r_classicthreads > 1)
+        wallscan_queue(x, x2, uwal, dwal, swal, lwal, fpalookup, tsiz);
+    else
+#endif
+        wallscan_columns(x, x2, uwal, dwal, swal, lwal, fpalookup, tsiz, palookupoffse, vplce, vince, bufplce);
+
     faketimerhandler();
 }
 
@@ -9358,6 +9616,12 @@ void engineUnInit(void)
     DO_FREE_AND_NULL(kpzbuf);
     kpzbufsiz = 0;
 
+    sectorgrid_free();
+
+#ifdef ENGINE_USING_A_C
+    classicFreeWallColumns();
+#endif
+
     for (bssize_t i = 0; i < num_usermaphacks; i++)
     {
         Xfree(usermaphacks[i].mhkfile);
@@ -9781,6 +10045,10 @@ int32_t renderDrawRoomsQ16(int32_t daposx, int32_t daposy, int32_t daposz,
         bunchlast[closest] = bunchlast[numbunches];
     }
 
+#ifdef ENGINE_USING_A_C
+    classicFlushWallColumns();
+#endif
+
     videoEndDrawing();   //}}}
 
     return inpreparemirror;
@@ -10469,6 +10737,100 @@ killsprite:
     videoEndDrawing();   //}}}
 }
 
+static uint32_t classicFrameChecksum(void)
+{
+    uint32_t crc = 0;
+
+    videoBeginDrawing();
+    for (bssize_t y = 0; y < ydim; y++)
+        crc = Bcrc32((char *)frameplace + ylookup[y], xdim, crc);
+    videoEndDrawing();
+
+    return crc;
+}
+
+//
+// renderBenchmarkClassic
+//
+// Renders the loaded map from numviews fixed camera positions (the centers of
+// evenly spaced sectors), once single-threaded and once with r_classicthreads
+// column bands, and reports ms/frame for both. Returns the number of views whose
+// multithreaded output differs from the single-threaded one, or -1 on error.
+//
+int32_t renderBenchmarkClassic(int32_t numviews, int32_t numframes)
+{
+    if (videoGetRenderMode() != REND_CLASSIC || numsectors <= 0)
+        return -1;
+
+    int32_t const othreads = r_classicthreads;
+    int32_t const threads[2] = { 1, max(1, othreads) };
+    uint64_t ticks[2] = { 0, 0 };
+    int32_t views = 0, mismatches = 0;
+
+    numviews = max(1, numviews);
+    numframes = max(1, numframes);
+
+    for (bssize_t v = 0; v < numviews; v++)
+    {
+        int16_t const sectnum = (int16_t)((int64_t)v * numsectors / numviews);
+        auto const sec = (usectorptr_t)&sector[sectnum];
+
+        if (sec->wallnum <= 0)
+            continue;
+
+        vec3_t pos = { 0, 0, (sec->ceilingz >> 1) + (sec->floorz >> 1) };
+
+        for (bssize_t w = sec->wallptr; w < sec->wallptr + sec->wallnum; w++)
+            pos.x += wall[w].x, pos.y += wall[w].y;
+
+        pos.x /= sec->wallnum;
+        pos.y /= sec->wallnum;
+
+        if (inside(pos.x, pos.y, sectnum) != 1)
+            continue;
+
+        fix16_t const ang = fix16_from_int((v * 512) & 2047);
+        uint32_t crc[2];
+
+        for (int i = 0; i < 2; i++)
+        {
+            r_classicthreads = threads[i];
+
+            uint64_t const t = timerGetNanoTicks();
+
+            for (bssize_t f = 0; f < numframes; f++)
+            {
+                renderDrawRoomsQ16(pos.x, pos.y, pos.z, ang, fix16_from_int(100), sectnum);
+                renderDrawMasks();
+            }
+
+            ticks[i] += timerGetNanoTicks() - t;
+            crc[i] = classicFrameChecksum();
+        }
+
+        if (crc[0] != crc[1])
+        {
+            LOG_F(WARNING, "classicbench: view %d (sector %d) differs with %d threads", (int)v, sectnum, threads[1]);
+            mismatches++;
+        }
+
+        views++;
+    }
+
+    r_classicthreads = othreads;
+
+    if (!views)
+        return -1;
+
+    double const rate = (double)timerGetNanoTickRate() / 1000.0;
+
+    LOG_F(INFO, "classicbench: %dx%d, %d views, %d frames each", xdim, ydim, views, numframes);
+    for (int i = 0; i < 2; i++)
+        LOG_F(INFO, "classicbench: %d thread(s): %.3f ms/frame", threads[i], (double)ticks[i] / rate / (views * numframes));
+
+    return mismatches;
+}
+
 //
 // drawmapview
 //
@@ -10813,6 +11175,7 @@ static int enginePrepareLoadBoard(buildvfs_kfd fil, vec3_t *dapos, int16_t *daan
     initspritelists();
     mi_collect(true);
     DO_FREE_AND_NULL(reachablesectors);
+    sectorgrid_invalidate();
 
     Bmemset(show2dsector, 0, sizeof(show2dsector));
     Bmemset(show2dsprite, 0, sizeof(show2dsprite));
@@ -10870,6 +11233,8 @@ int sectorsareconnected(int const sect1, int const sect2)
 
 void calc_sector_reachability(void)
 {
+    sectorgrid_invalidate();
+
     if (!numsectors)
         return;
 
@@ -11945,21 +12310,40 @@ static void PolymostProcessVoxels(void)
     LOG_F(INFO, "Generating 3D meshes from voxel model data. This may take a while...");
     videoNextPage();
     double time = timerGetFractionalTicks();
+    auto jobs = (voxloadjob_t *)Xmalloc(MAXVOXELS * sizeof(voxloadjob_t));
+    auto jobvox = (int16_t *)Xmalloc(MAXVOXELS * sizeof(int16_t));
     int cnt = 0;
     for (bssize_t i=0; i<MAXVOXELS; i++)
     {
         if (voxfilenames[i])
         {
-            voxmodels[i] = voxload(voxfilenames[i]);
+            jobs[cnt] = { voxfilenames[i], NULL, 0, NULL };
+            jobvox[cnt++] = i;
+        }
+    }
+
+    int const cached = voxloadbatch(jobs, cnt);
+
+    for (bssize_t j=0; j<cnt; j++)
+    {
+        int const i = jobvox[j];
+
+        if ((voxmodels[i] = jobs[j].vm))
+        {
             voxmodels[i]->scale = voxscale[i]*(1.f/65536.f);
 # ifdef USE_GLEXT
             voxvboalloc(voxmodels[i]);
 # endif
-            DO_FREE_AND_NULL(voxfilenames[i]);
-            cnt++;
         }
+        else
+            LOG_F(ERROR, "Unable to load voxel model %s.", voxfilenames[i]);
+
+        DO_FREE_AND_NULL(voxfilenames[i]);
     }
-    LOG_F(INFO, "Generated 3D meshes for %d voxels in %.2f ms.", cnt, timerGetFractionalTicks() - time);
+
+    Xfree(jobvox);
+    Xfree(jobs);
+    LOG_F(INFO, "Generated 3D meshes for %d voxels (%d from cache) in %.2f ms.", cnt, cached, timerGetFractionalTicks() - time);
 }
 
 static void PolymostFreeVBOs(void)
@@ -13053,6 +13437,227 @@ void neartag(int32_t xs, int32_t ys, int32_t zs, int16_t sectnum, int16_t ange,
 }
 
 
+//
+// sector grid
+//
+// Uniform grid over the map listing, per cell, every sector whose walls may
+// overlap it. The linear fallbacks of updatesector[z]() only need to run
+// inside() on the sectors of the cell containing the point. A sector's cell
+// rectangle never shrinks while the grid is valid, so the lists always stay a
+// superset of the sectors that can contain a point in that cell. Sectors whose
+// loops aren't closed can report points outside their bounds as inside, and
+// are listed in every cell.
+//
+#define SECTORGRID_SIZE 128
+
+typedef struct
+{
+    int16_t *sects;
+    int32_t num, max;
+} sectorgridcell_t;
+
+static struct
+{
+    sectorgridcell_t *cell;
+    vec2_t min, max;
+    int32_t shift;
+    int32_t numsectors, numwalls;
+    walltype const *wall;
+    struct { uint8_t x1, y1, x2, y2; } rect[MAXSECTORS];
+    bool valid;
+} sectorgrid;
+
+static FORCE_INLINE int sectorgrid_cellcoord(int32_t const v, int32_t const min)
+{
+    return (int)clamp<int64_t>(((int64_t)v - min) >> sectorgrid.shift, 0, SECTORGRID_SIZE-1);
+}
+
+static void sectorgrid_addtocell(int const cx, int const cy, int16_t const sectnum)
+{
+    auto &c = sectorgrid.cell[cy * SECTORGRID_SIZE + cx];
+
+    if (c.num == c.max)
+    {
+        c.max = max(c.max << 1, 8);
+        c.sects = (int16_t *)Xrealloc(c.sects, c.max * sizeof(int16_t));
+    }
+
+    c.sects[c.num++] = sectnum;
+}
+
+// Grows the registered cell rectangle of sectnum, adding the sector to the
+// cells it wasn't listed in yet.
+static void sectorgrid_grow(int16_t const sectnum, int const x1, int const y1, int const x2, int const y2)
+{
+    auto &r = sectorgrid.rect[sectnum];
+
+    if (x1 >= r.x1 && y1 >= r.y1 && x2 <= r.x2 && y2 <= r.y2)
+        return;
+
+    int const nx1 = min<int>(x1, r.x1), ny1 = min<int>(y1, r.y1);
+    int const nx2 = max<int>(x2, r.x2), ny2 = max<int>(y2, r.y2);
+
+    for (int cy = ny1; cy <= ny2; cy++)
+        for (int cx = nx1; cx <= nx2; cx++)
+            if (cx < r.x1 || cx > r.x2 || cy < r.y1 || cy > r.y2)
+                sectorgrid_addtocell(cx, cy, sectnum);
+
+    r = { (uint8_t)nx1, (uint8_t)ny1, (uint8_t)nx2, (uint8_t)ny2 };
+}
+
+// Registers (isnew) or grows the cell rectangle of sectnum to cover its wall
+// bounding box.
+static void sectorgrid_insert(int16_t const sectnum, bool const isnew)
+{
+    auto const sec = (usectorptr_t)&sector[sectnum];
+    int const startwall = sec->wallptr, endwall = sec->wallptr + sec->wallnum;
+    bool closed = (sec->wallnum > 0 && startwall >= 0 && endwall <= numwalls);
+    vec2_t bmin = { INT32_MAX, INT32_MAX }, bmax = { INT32_MIN, INT32_MIN };
+
+    if (closed)
+    {
+        // every loop is closed iff point2 permutes the sector's walls
+        static uint8_t seen[bitmap_size(MAXWALLS)];
+        Bmemset(seen, 0, bitmap_size(sec->wallnum));
+
+        for (int w = startwall; w < endwall; w++)
+        {
+            int const p2 = wall[w].point2 - startwall;
+
+            if ((unsigned)p2 >= (unsigned)sec->wallnum || bitmap_test(seen, p2))
+            {
+                closed = false;
+                break;
+            }
+
+            bitmap_set(seen, p2);
+
+            auto const wal = (uwallptr_t)&wall[w];
+            bmin.x = min(bmin.x, wal->x), bmax.x = max(bmax.x, wal->x);
+            bmin.y = min(bmin.y, wal->y), bmax.y = max(bmax.y, wal->y);
+        }
+    }
+
+    // inside() may accept points one unit off the bounding box
+    int const x1 = closed ? sectorgrid_cellcoord(bmin.x - 1, sectorgrid.min.x) : 0;
+    int const y1 = closed ? sectorgrid_cellcoord(bmin.y - 1, sectorgrid.min.y) : 0;
+    int const x2 = closed ? sectorgrid_cellcoord(bmax.x + 1, sectorgrid.min.x) : SECTORGRID_SIZE-1;
+    int const y2 = closed ? sectorgrid_cellcoord(bmax.y + 1, sectorgrid.min.y) : SECTORGRID_SIZE-1;
+
+    if (isnew)
+    {
+        for (int cy = y1; cy <= y2; cy++)
+            for (int cx = x1; cx <= x2; cx++)
+                sectorgrid_addtocell(cx, cy, sectnum);
+
+        sectorgrid.rect[sectnum] = { (uint8_t)x1, (uint8_t)y1, (uint8_t)x2, (uint8_t)y2 };
+        return;
+    }
+
+    sectorgrid_grow(sectnum, x1, y1, x2, y2);
+}
+
+static void sectorgrid_build(void)
+{
+    if (!sectorgrid.cell)
+        sectorgrid.cell = (sectorgridcell_t *)Xcalloc(SECTORGRID_SIZE * SECTORGRID_SIZE, sizeof(sectorgridcell_t));
+    else
+    {
+        for (int i = 0; i < SECTORGRID_SIZE * SECTORGRID_SIZE; i++)
+            sectorgrid.cell[i].num = 0;
+    }
+
+    vec2_t bmin = { INT32_MAX, INT32_MAX }, bmax = { INT32_MIN, INT32_MIN };
+
+    auto wal = (uwallptr_t)wall;
+
+    for (int w = 0; w < numwalls; w++, wal++)
+    {
+        bmin.x = min(bmin.x, wal->x), bmax.x = max(bmax.x, wal->x);
+        bmin.y = min(bmin.y, wal->y), bmax.y = max(bmax.y, wal->y);
+    }
+
+    sectorgrid.min = { bmin.x - 1, bmin.y - 1 };
+    sectorgrid.max = { bmax.x + 1, bmax.y + 1 };
+    sectorgrid.shift = 0;
+
+    while ((((int64_t)sectorgrid.max.x - sectorgrid.min.x) >> sectorgrid.shift) >= SECTORGRID_SIZE
+           || (((int64_t)sectorgrid.max.y - sectorgrid.min.y) >> sectorgrid.shift) >= SECTORGRID_SIZE)
+        sectorgrid.shift++;
+
+    for (int i = 0; i < numsectors; i++)
+        sectorgrid_insert(i, true);
+
+    sectorgrid.numsectors = numsectors;
+    sectorgrid.numwalls   = numwalls;
+    sectorgrid.wall       = wall;
+    sectorgrid.valid      = true;
+}
+
+static FORCE_INLINE bool sectorgrid_current(void)
+{
+    return sectorgrid.valid && sectorgrid.wall == wall && sectorgrid.numsectors == numsectors && sectorgrid.numwalls == numwalls;
+}
+
+// Returns the sectors that can contain (x, y), or NULL when every sector has to
+// be tried: in the editor, or outside the grid.
+static int16_t const *sectorgrid_query(int32_t const x, int32_t const y, int32_t *const num)
+{
+    if (editstatus || numsectors <= 0 || numwalls <= 0)
+        return NULL;
+
+    if (!sectorgrid_current())
+        sectorgrid_build();
+
+    if (x < sectorgrid.min.x || x > sectorgrid.max.x || y < sectorgrid.min.y || y > sectorgrid.max.y)
+        return NULL;
+
+    auto const &c = sectorgrid.cell[sectorgrid_cellcoord(y, sectorgrid.min.y) * SECTORGRID_SIZE + sectorgrid_cellcoord(x, sectorgrid.min.x)];
+    *num = c.num;
+    return c.sects;
+}
+
+// Moving a single vertex only needs to grow the rectangle by its new position.
+void sectorgrid_updatewall(int16_t const wallnum)
+{
+    if ((unsigned)wallnum >= (unsigned)numwalls || !sectorgrid_current())
+        return;
+
+    int const sectnum = sectorofwall(wallnum);
+
+    auto const wal = (uwallptr_t)&wall[wallnum];
+
+    if ((unsigned)sectnum < (unsigned)numsectors)
+        sectorgrid_grow(sectnum, sectorgrid_cellcoord(wal->x - 1, sectorgrid.min.x), sectorgrid_cellcoord(wal->y - 1, sectorgrid.min.y),
+                        sectorgrid_cellcoord(wal->x + 1, sectorgrid.min.x), sectorgrid_cellcoord(wal->y + 1, sectorgrid.min.y));
+}
+
+void sectorgrid_update(int16_t const sectnum)
+{
+    if ((unsigned)sectnum < (unsigned)numsectors && sectorgrid_current())
+        sectorgrid_insert(sectnum, false);
+}
+
+void sectorgrid_invalidate(void)
+{
+    sectorgrid.valid = false;
+    sectorgrid.wall  = NULL;
+}
+
+static void sectorgrid_free(void)
+{
+    if (sectorgrid.cell)
+    {
+        for (int i = 0; i < SECTORGRID_SIZE * SECTORGRID_SIZE; i++)
+            Xfree(sectorgrid.cell[i].sects);
+
+        DO_FREE_AND_NULL(sectorgrid.cell);
+    }
+
+    sectorgrid_invalidate();
+}
+
+
 //
 // dragpoint
 //
@@ -13085,6 +13690,7 @@ void dragpoint(int16_t pointhighlight, int32_t dax, int32_t day, uint8_t flags)
 
             wall[w].x = dax;
             wall[w].y = day;
+            sectorgrid_updatewall(w);
             bitmap_set(walbitmap, w);
 
             for (YAX_ITER_WALLS(w, j, tmpcf))
@@ -13164,6 +13770,7 @@ void dragpoint(int16_t pointhighlight, int32_t dax, int32_t day, uint8_t flags)
 
     wall[tempshort].x = dax;
     wall[tempshort].y = day;
+    sectorgrid_updatewall(tempshort);
 
     if (editstatus)
     {
@@ -13182,6 +13789,7 @@ void dragpoint(int16_t pointhighlight, int32_t dax, int32_t day, uint8_t flags)
 
             wall[tempshort].x = dax;
             wall[tempshort].y = day;
+            sectorgrid_updatewall(tempshort);
             editwall[tempshort>>3] |= 1<<(tempshort&7);
         }
         else
@@ -13195,6 +13803,7 @@ void dragpoint(int16_t pointhighlight, int32_t dax, int32_t day, uint8_t flags)
                     tempshort = wall[thelastwall].nextwall;
                     wall[tempshort].x = dax;
                     wall[tempshort].y = day;
+                    sectorgrid_updatewall(tempshort);
                     editwall[tempshort>>3] |= 1<<(tempshort&7);
                 }
                 else
@@ -13313,6 +13922,39 @@ int findwallbetweensectors(int sect1, int sect2)
 int16_t updatesectorneighborlist[MAXSECTORS];
 uint8_t updatesectorneighbormap[bitmap_size(MAXSECTORS)];
 
+// The fallback scans below walk outwards from sect, alternating ++highsect and
+// --lowsect, and return the first sector containing the point. Given the grid
+// candidates, return the one that walk would have reached first.
+template <typename Pred>
+static int sectorgrid_nearest(int16_t const *const cands, int32_t const num, int const sect, Pred &&isinside)
+{
+    int best = -1, bestkey = INT32_MAX;
+
+    for (int i = 0; i < num; i++)
+    {
+        int const s = cands[i];
+        int const key = (s > sect) ? ((s - sect) << 1) - 1 : (sect - s) << 1;
+
+        if (s != sect && key < bestkey && isinside(s))
+            best = s, bestkey = key;
+    }
+
+    return best;
+}
+
+// The compat scans return the highest numbered sector containing the point.
+template <typename Pred>
+static int sectorgrid_highest(int16_t const *const cands, int32_t const num, Pred &&isinside)
+{
+    int best = -1;
+
+    for (int i = 0; i < num; i++)
+        if (cands[i] > best && isinside(cands[i]))
+            best = cands[i];
+
+    return best;
+}
+
 void updatesector_compat(int32_t const x, int32_t const y, int16_t* const sectnum)
 {
     if (inside_p(x, y, *sectnum))
@@ -13335,6 +13977,10 @@ void updatesector_compat(int32_t const x, int32_t const y, int16_t* const sectnu
 
     // we need to support passing in a sectnum of -1, unfortunately
 
+    int32_t numcands;
+    if (auto const cands = sectorgrid_query(x, y, &numcands))
+        SET_AND_RETURN(*sectnum, sectorgrid_highest(cands, numcands, [&](int const s) { return inside_p(x, y, s); }));
+
     for (int i = numsectors - 1; i >= 0; --i)
         if (inside_p(x, y, i))
             SET_AND_RETURN(*sectnum, i);
@@ -13354,6 +14000,10 @@ void updatesector_tryremaining(int32_t const x, int32_t const y, int16_t *const
     if (inside_exclude_p(x, y, sect, updatesectorneighbormap))
         SET_AND_RETURN(*sectnum, sect);
 
+    int32_t numcands;
+    if (auto const cands = sect < numsectors ? sectorgrid_query(x, y, &numcands) : NULL)
+        SET_AND_RETURN(*sectnum, sectorgrid_nearest(cands, numcands, sect, [&](int const s) { return inside_exclude_p(x, y, s, updatesectorneighbormap); }));
+
     int16_t highsect = sect, lowsect = sect;
 
     do
@@ -13377,6 +14027,10 @@ void updatesectorz_tryremaining(int32_t const x, int32_t const y, int32_t const
     if (inside_exclude_z_p(x, y, z, sect, updatesectorneighbormap))
         SET_AND_RETURN(*sectnum, sect);
 
+    int32_t numcands;
+    if (auto const cands = sect < numsectors ? sectorgrid_query(x, y, &numcands) : NULL)
+        SET_AND_RETURN(*sectnum, sectorgrid_nearest(cands, numcands, sect, [&](int const s) { return inside_exclude_z_p(x, y, z, s, updatesectorneighbormap); }));
+
     int16_t highsect = sect, lowsect = sect;
 
     do
@@ -13429,6 +14083,11 @@ void updatesectorexclude(int32_t const x, int32_t const y, int16_t * const sectn
     }
 
     int16_t const sect = *sectnum == -1 ? numsectors >> 1 : *sectnum;
+
+    int32_t numcands;
+    if (auto const cands = sect < numsectors ? sectorgrid_query(x, y, &numcands) : NULL)
+        SET_AND_RETURN(*sectnum, sectorgrid_nearest(cands, numcands, sect, [&](int const s) { return inside_exclude_p(x, y, s, excludesectbitmap); }));
+
     int trycnt = max<int>(numsectors - sect, sect);
     int16_t highsect = sect, lowsect = sect;
 
@@ -13511,6 +14170,10 @@ void updatesectorz_compat(int32_t const x, int32_t const y, int32_t const z, int
     }
 
     // we need to support passing in a sectnum of -1, unfortunately
+    int32_t numcands;
+    if (auto const cands = sectorgrid_query(x, y, &numcands))
+        SET_AND_RETURN(*sectnum, sectorgrid_highest(cands, numcands, [&](int const s) { return inside_z_p(x, y, z, s); }));
+
     for (int i = numsectors - 1; i >= 0; --i)
         if (inside_z_p(x, y, z, i))
             SET_AND_RETURN(*sectnum, i);
@@ -199,7 +199,7 @@ int32_t hicsetsubsttex(int32_t picnum, int32_t palnum, const char *filen, float
 // hicsetskybox(picnum,pal,faces[6])
 //   Specifies a graphic files making up a skybox.
 //
-int32_t hicsetskybox( int32_t picnum, int32_t palnum, char *faces[6], int32_t flags )
+int32_t hicsetskybox( int32_t picnum, int32_t palnum, char const *const faces[6], int32_t flags )
 {
     hicreplctyp *hr, *hrn;
     int32_t j;
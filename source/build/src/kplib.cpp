@@ -54,9 +54,6 @@ static FORCE_INLINE CONSTEXPR int32_t klrotl(int32_t i, int sh) { return (i >> (
 #define ASMNAME(x)
 #endif
 
-static intptr_t kp_frameplace;
-static int32_t kp_bytesperline, kp_xres, kp_yres;
-
 static CONSTEXPR const int32_t pow2mask[32] =
 {
     0x00000000,0x00000001,0x00000003,0x00000007,
@@ -80,10 +77,6 @@ static CONSTEXPR const int32_t pow2long[32] =
     0x10000000,0x20000000,0x40000000,(int32_t)0x80000000,
 };
 
-//Hack for peekbits,getbits,suckbits (to prevent lots of duplicate code)
-//   0: PNG: do 12-byte chunk_header removal hack
-// !=0: ZIP: use 64K buffer (olinbuf)
-static int32_t zipfilmode;
 kzfilestate kzfs;
 
 // GCC 4.6 LTO build fix
@@ -105,9 +98,145 @@ kzfilestate kzfs;
 //   pow2mask     128*
 //   dcflagor      64
 
-B_KPLIB_STATIC int32_t ATTRIBUTE((used)) palcol[256] ASMNAME("palcol");
-static int32_t paleng, bakcol, numhufblocks, zlibcompflags;
-static int8_t kcoltype, filtype, bitdepth;
+B_KPLIB_STATIC int32_t ATTRIBUTE((used)) abstab10[1024] ASMNAME("abstab10");
+static int32_t hxbit[59][2];
+static CONSTEXPR const int32_t ccind[19] = {16,17,18,0,8,7,9,6,10,5,11,4,12,3,13,2,14,1,15};
+
+#define LOGQHUFSIZ0 9
+#define LOGQHUFSIZ1 6
+
+//Deflated ZIP entries remember the inflate state at the first block boundary
+//past every KZCHECKPOINTSPACING bytes of output. Seeking backwards (or forwards
+//over data that was inflated before) then resumes from the nearest checkpoint
+//instead of re-inflating from the start of the entry.
+#define KZCHECKPOINTSPACING (1<<20)
+#define KZMAXCHECKPOINTS 64
+
+struct kzcheckpoint
+{
+    int64_t compbit; //Bit offset into the compressed stream
+    int32_t uncomp;  //gslidew at the block boundary
+    int32_t slider;  //gslider at the block boundary
+    uint8_t window[32768];
+};
+
+//All state written while decoding a picture (or inflating a ZIP entry) lives
+//here, so kprender() can run on several threads at once: each call decodes
+//into its own kpdecoder. The tables above are read-only once kpinittables()
+//has run.
+struct kpdecoder
+{
+    intptr_t kp_frameplace;
+    int32_t kp_bytesperline, kp_xres, kp_yres;
+
+    //Hack for peekbits,getbits,suckbits (to prevent lots of duplicate code)
+    //   0: PNG: do 12-byte chunk_header removal hack
+    // !=0: ZIP: use 64K buffer (olinbuf)
+    int32_t zipfilmode;
+
+    int32_t palcol[256];
+    int32_t paleng, bakcol, numhufblocks, zlibcompflags;
+    int8_t kcoltype, filtype, bitdepth;
+
+    //.PNG specific variables:
+    int32_t bakr, bakg, bakb;
+    int32_t gslidew, gslider, xm, xmn[4], xr0, xr1, xplc, yplc;
+    intptr_t nfplace;
+    int32_t clen[320], cclen[19], bitpos, filt, xsiz, ysiz;
+    int32_t xsizbpl, ixsiz, ixoff, iyoff, ixstp, iystp, intlac, nbpl;
+    int32_t trnsrgb;
+    int32_t ibuf0[288], nbuf0[32], ibuf1[32], nbuf1[32];
+    const uint8_t *filptr;
+    uint8_t slidebuf[32768], opixbuf0[4], opixbuf1[4];
+    uint8_t olinbuf[131072]; //WARNING:max kp_xres is: 131072/bpp-1
+
+    //Variables to speed up dynamic Huffman decoding:
+    int32_t qhufval0[1<<LOGQHUFSIZ0], qhufval1[1<<LOGQHUFSIZ1];
+    uint8_t qhufbit0[1<<LOGQHUFSIZ0], qhufbit1[1<<LOGQHUFSIZ1];
+
+    uint8_t fakebuf[8];
+    uint8_t const *nfilptr;
+    int32_t nbitpos;
+    int32_t filter1st, filterest;
+
+    //.JPG specific variables:
+    int32_t clipxdim, clipydim;
+    int32_t hufmaxatbit[8][20], hufvalatbit[8][20], hufcnt[8];
+    uint8_t hufnumatbit[8][20], huftable[8][256];
+    int32_t hufquickval[8][1024], hufquickbits[8][1024], hufquickcnt[8];
+    int32_t quantab[4][64], dct[12][64], lastdc[4]; //dct:10=MAX (says spec);+2 for hacks
+    uint8_t gnumcomponents;
+    int32_t gcompid[4], gcomphsamp[4], gcompvsamp[4], gcompquantab[4], gcomphsampshift[4], gcompvsampshift[4];
+    int32_t lnumcomponents, lcompid[4], lcompdc[4], lcompac[4], lcomphsamp[4], lcompvsamp[4], lcompquantab[4];
+    int32_t lcomphvsamp0, lcomphsampshift0, lcompvsampshift0;
+
+    //.GIF specific variables:
+    uint8_t suffix[4100], filbuffer[768], tempstack[4096];
+    int32_t prefix[4100];
+
+    //ZIP output pointer for putbuf4zip()
+    char *gzbufptr;
+
+    //ZIP input: the entry being inflated, the compressed offset of olinbuf[0]
+    //and the checkpoints taken so far
+    kzfilestate *zfs;
+    int32_t zipinbase;
+    kzcheckpoint *zcp;
+    int32_t zcpnum, zcpmax, zcpspacing;
+
+    void suckbitsnextblock();
+    inline int32_t peekbits(int32_t n);
+    inline void suckbits(int32_t n);
+    inline int32_t getbits(int32_t n);
+    int32_t hufgetsym(int32_t *hitab, const int32_t *hbmax);
+    int32_t initpass();
+    inline void rgbhlineasm(int32_t x, int32_t xr1, intptr_t p, int32_t ixstp);
+    inline void pal8hlineasm(int32_t x, int32_t xr1, intptr_t p, int32_t ixstp);
+    void putbuf(const uint8_t *buf, int32_t leng);
+    int32_t kpngrend(const char *kfilebuf, int32_t kfilength,
+                     intptr_t dakpframeplace, int32_t dakpbytesperline, int32_t daxres, int32_t dayres);
+
+    void huffgetval(int32_t index, int32_t curbits, int32_t num, int32_t *daval, int32_t *dabits);
+    void yrbrend(int32_t x, int32_t y, int32_t *ldct);
+    int32_t kpegrend(const char *kfilebuf, int32_t kfilength,
+                     intptr_t dakpframeplace, int32_t dakpbytesperline, int32_t daxres, int32_t dayres);
+
+    int32_t kgifrend(const char *kfilebuf, int32_t kfilelength,
+                     intptr_t dakpframeplace, int32_t dakpbytesperline, int32_t daxres, int32_t dayres);
+#ifdef KPCEL
+    int32_t kcelrend(const char *buf, int32_t fleng,
+                     intptr_t dakpframeplace, int32_t dakpbytesperline, int32_t daxres, int32_t dayres);
+#endif
+    int32_t ktgarend(const char *header, int32_t fleng,
+                     intptr_t dakpframeplace, int32_t dakpbytesperline, int32_t daxres, int32_t dayres);
+    int32_t kbmprend(const char *buf, int32_t fleng,
+                     intptr_t dakpframeplace, int32_t dakpbytesperline, int32_t daxres, int32_t dayres);
+    int32_t kpcxrend(const char *buf, int32_t fleng,
+                     intptr_t dakpframeplace, int32_t dakpbytesperline, int32_t daxres, int32_t dayres);
+#ifdef KPDDS
+    int32_t kddsrend(const char *buf, int32_t leng,
+                     intptr_t frameptr, int32_t bpl, int32_t xdim, int32_t ydim, int32_t xoff, int32_t yoff);
+#endif
+    int32_t kprender(const char *buf, int32_t leng, intptr_t frameptr, int32_t bpl,
+                     int32_t xdim, int32_t ydim);
+
+    void putbuf4zip(const uint8_t *buf, int32_t uncomp0, int32_t uncomp1);
+    void kzinit(kzfilestate *fs);
+    void kzaddcheckpoint();
+    kzcheckpoint const *kzfindcheckpoint();
+    void kzrestorecheckpoint(kzcheckpoint const *cp);
+    int32_t kzread(void *buffer, int32_t leng);
+};
+
+//kzopen()/kzread()/kzseek() work on the single global stream kzfs and keep one
+//decoder around for it; kzstreams each carry their own.
+static kpdecoder kzdecoder;
+
+struct kzstream
+{
+    kzfilestate fs;
+    kpdecoder *dec; //Only allocated for deflated entries
+};
 
 //============================ KPNGILIB begins ===============================
 
@@ -119,27 +248,6 @@ static int8_t kcoltype, filtype, bitdepth;
 //   * 16-bit color depth
 //   * Some useless ancillary chunks, like: gAMA(gamma) & pHYs(aspect ratio)
 
-//.PNG specific variables:
-static int32_t bakr = 0x80, bakg = 0x80, bakb = 0x80; //this used to be public...
-static int32_t gslidew = 0, gslider = 0, xm, xmn[4], xr0, xr1, xplc, yplc;
-static intptr_t nfplace;
-static int32_t clen[320], cclen[19], bitpos, filt, xsiz, ysiz;
-int32_t xsizbpl, ixsiz, ixoff, iyoff, ixstp, iystp, intlac, nbpl;
-B_KPLIB_STATIC int32_t ATTRIBUTE((used)) trnsrgb ASMNAME("trnsrgb");
-static int32_t ccind[19] = {16,17,18,0,8,7,9,6,10,5,11,4,12,3,13,2,14,1,15};
-static int32_t hxbit[59][2], ibuf0[288], nbuf0[32], ibuf1[32], nbuf1[32];
-static const uint8_t *filptr;
-static uint8_t slidebuf[32768], opixbuf0[4], opixbuf1[4];
-static uint8_t pnginited = 0;
-B_KPLIB_STATIC uint8_t olinbuf[131072] ASMNAME("olinbuf"); //WARNING:max kp_xres is: 131072/bpp-1
-B_KPLIB_STATIC int32_t ATTRIBUTE((used)) abstab10[1024] ASMNAME("abstab10");
-
-//Variables to speed up dynamic Huffman decoding:
-#define LOGQHUFSIZ0 9
-#define LOGQHUFSIZ1 6
-static int32_t qhufval0[1<<LOGQHUFSIZ0], qhufval1[1<<LOGQHUFSIZ1];
-static uint8_t qhufbit0[1<<LOGQHUFSIZ0], qhufbit1[1<<LOGQHUFSIZ1];
-
 #if defined(_MSC_VER) && !defined(NOASM)
 
 static inline int32_t bitrev(int32_t b, int32_t c)
@@ -178,18 +286,16 @@ static inline int32_t bitrev(int32_t b, int32_t c)
 
 #endif
 
-static uint8_t fakebuf[8];
-static uint8_t const *nfilptr;
-static int32_t nbitpos;
-static void suckbitsnextblock()
+void kpdecoder::suckbitsnextblock()
 {
     if (zipfilmode)
     {
         //NOTE: should only read bytes inside compsize, not 64K!!! :/
         B_BUF32(&olinbuf[0], B_UNBUF32(&olinbuf[sizeof(olinbuf)-4]));
-        uint32_t n = min<uint32_t>(kzfs.compleng-kzfs.comptell, sizeof(olinbuf)-4);
-        buildvfs_fread(&olinbuf[4], n, 1, kzfs.fil);
-        kzfs.comptell += n;
+        uint32_t n = min<uint32_t>(zfs->compleng-zfs->comptell, sizeof(olinbuf)-4);
+        buildvfs_fread(&olinbuf[4], n, 1, zfs->fil);
+        zfs->comptell += n;
+        zipinbase += sizeof(olinbuf)-4;
         bitpos -= ((sizeof(olinbuf)-4)<<3);
         return;
     }
@@ -214,11 +320,11 @@ static void suckbitsnextblock()
     filptr = &fakebuf[4]; bitpos -= 32;
 }
 
-static inline int32_t peekbits(int32_t n) { return (B_LITTLE32(B_UNBUF32(&filptr[bitpos>>3]))>>(bitpos&7))&pow2mask[n]; }
-static inline void suckbits(int32_t n) { bitpos += n; if (bitpos < 0) return; suckbitsnextblock(); }
-static inline int32_t getbits(int32_t n) { int32_t i = peekbits(n); suckbits(n); return i; }
+inline int32_t kpdecoder::peekbits(int32_t n) { return (B_LITTLE32(B_UNBUF32(&filptr[bitpos>>3]))>>(bitpos&7))&pow2mask[n]; }
+inline void kpdecoder::suckbits(int32_t n) { bitpos += n; if (bitpos < 0) return; suckbitsnextblock(); }
+inline int32_t kpdecoder::getbits(int32_t n) { int32_t i = peekbits(n); suckbits(n); return i; }
 
-static int32_t hufgetsym(int32_t *hitab, const int32_t *hbmax)
+int32_t kpdecoder::hufgetsym(int32_t *hitab, const int32_t *hbmax)
 {
     int32_t v, n;
 
@@ -314,7 +420,7 @@ static void hufgencode(const int32_t *inbuf, int32_t inum, int32_t *hitab, int32
     for (i=0; i<inum; i++) if (inbuf[i]) hitab[hbmax[inbuf[i]]++] = i;
 }
 
-static int32_t initpass()  //Interlaced images have 7 "passes", non-interlaced have 1
+int32_t kpdecoder::initpass()  //Interlaced images have 7 "passes", non-interlaced have 1
 {
     int32_t i, j, k;
 
@@ -410,73 +516,6 @@ static inline int32_t Paeth686(int32_t a, int32_t b, int32_t c)
     }
 }
 
-static inline void rgbhlineasm(int32_t c, int32_t d, int32_t t, int32_t b)
-{
-    _asm
-    {
-        push ebx
-        push edi
-
-        mov ecx, c
-        mov edx, d
-        mov edi, t
-        mov ebx, b
-        sub ecx, edx
-        jle short endit
-        add edx, offset olinbuf
-        cmp dword ptr trnsrgb, 0
-        jz short begit2
-        begit:
-        mov eax, dword ptr [ecx+edx]
-        or eax, 0xff000000
-        cmp eax, dword ptr trnsrgb
-        jne short skipit
-        and eax, 0xffffff
-        skipit:
-        sub ecx, 3
-        mov [edi], eax
-        lea edi, [edi+ebx]
-        jnz short begit
-        jmp short endit
-        begit2:
-        mov eax, dword ptr [ecx+edx]
-        or eax, 0xff000000
-        sub ecx, 3
-        mov [edi], eax
-        lea edi, [edi+ebx]
-        jnz short begit2
-        endit:
-        pop edi
-        pop ebx
-    }
-}
-
-static inline void pal8hlineasm(int32_t c, int32_t d, int32_t t, int32_t b)
-{
-    _asm
-    {
-        mov ecx, c
-        mov edx, d
-        sub ecx, edx
-        jle short endit
-
-        push ebx
-        push edi
-        mov edi, t
-        mov ebx, b
-        add edx, offset olinbuf
-        begit:movzx eax, byte ptr [ecx+edx]
-        mov eax, dword ptr palcol[eax*4]
-        sub ecx, 1
-        mov [edi], eax
-        lea edi, [edi+ebx]
-        jnz short begit
-        pop edi
-        pop ebx
-        endit:
-    }
-}
-
 #elif defined(__GNUC__) && defined(__i386__) && !defined(NOASM)
 
 static inline int32_t Paeth686(int32_t a, int32_t b, int32_t c)
@@ -498,53 +537,6 @@ static inline int32_t Paeth686(int32_t a, int32_t b, int32_t c)
     return c;
 }
 
-//Note: "cmove eax,?" may be faster than "jne ?:and eax,?" but who cares
-static inline void rgbhlineasm(int32_t c, int32_t d, int32_t t, int32_t b)
-{
-    __asm__ __volatile__(
-        "subl %%edx, %%ecx \n"
-        "jle 3f \n"
-        "addl $olinbuf, %%edx \n"
-        "cmpl $0, trnsrgb(,1) \n"
-        "jz 2f \n"
-        "0: movl (%%ecx,%%edx,1), %%eax \n"
-        "orl $0xff000000, %%eax \n"
-        "cmpl trnsrgb(,1), %%eax \n"
-        "jne 1f \n"
-        "andl $0xffffff, %%eax \n"
-        "1: subl $3, %%ecx \n"
-        "movl %%eax, (%%edi) \n"
-        "leal (%%edi,%%ebx,1), %%edi \n"
-        "jnz 0b \n"
-        "jmp 3f \n"
-        "2: movl (%%ecx,%%edx,1), %%eax \n"
-        "orl $0xff000000, %%eax \n"
-        "subl $3, %%ecx \n"
-        "movl %%eax, (%%edi) \n"
-        "leal (%%edi,%%ebx,1), %%edi \n"
-        "jnz 2b \n"
-        "3: \n"
-        : "+c"(c), "+d"(d), "+D"(t) : "b"(b) : "eax","memory","cc"
-    );
-}
-
-static inline void pal8hlineasm(int32_t c, int32_t d, int32_t t, int32_t b)
-{
-    __asm__ __volatile__(
-        "subl %%edx, %%ecx \n"
-        "jle 1f \n"
-        "addl $olinbuf, %%edx \n"
-        "0: movzbl (%%ecx,%%edx,1), %%eax \n"
-        "movl palcol(,%%eax,4), %%eax \n"
-        "subl $1, %%ecx \n"
-        "movl %%eax, (%%edi) \n"
-        "leal (%%edi,%%ebx,1), %%edi \n"
-        "jnz 0b \n"
-        "1: \n"
-        : "+c"(c), "+d"(d), "+D"(t) : "b"(b) : "eax","memory","cc"
-    );
-}
-
 #else
 
 static inline int32_t Paeth686(int32_t const a, int32_t const b, int32_t c)
@@ -556,7 +548,9 @@ static inline int32_t Paeth686(int32_t const a, int32_t const b, int32_t c)
     return (edi < *(ptr + a)) ? c : a;
 }
 
-static inline void rgbhlineasm(int32_t x, int32_t xr1, intptr_t p, int32_t ixstp)
+#endif
+
+inline void kpdecoder::rgbhlineasm(int32_t x, int32_t xr1, intptr_t p, int32_t ixstp)
 {
     if (!trnsrgb)
     {
@@ -571,13 +565,11 @@ static inline void rgbhlineasm(int32_t x, int32_t xr1, intptr_t p, int32_t ixstp
     }
 }
 
-static inline void pal8hlineasm(int32_t x, int32_t xr1, intptr_t p, int32_t ixstp)
+inline void kpdecoder::pal8hlineasm(int32_t x, int32_t xr1, intptr_t p, int32_t ixstp)
 {
     for (; x>xr1; p+=ixstp,x--) B_BUF32((void *) p, palcol[olinbuf[x]]);
 }
 
-#endif
-
 //Autodetect filter
 //    /f0: 0000000...
 //    /f1: 1111111...
@@ -586,8 +578,7 @@ static inline void pal8hlineasm(int32_t x, int32_t xr1, intptr_t p, int32_t ixst
 //    /f3: 3333333...
 //    /f4: 4444444...
 //    /f5: 0142321...
-static int32_t filter1st, filterest;
-static void putbuf(const uint8_t *buf, int32_t leng)
+void kpdecoder::putbuf(const uint8_t *buf, int32_t leng)
 {
     int32_t i;
     intptr_t p;
@@ -710,8 +701,8 @@ static void initpngtables()
     for (i=0; i<512; i++) abstab10[512+i] = abstab10[512-i] = i;
 }
 
-static int32_t kpngrend(const char *kfilebuf, int32_t kfilength,
-                        intptr_t dakpframeplace, int32_t dakpbytesperline, int32_t daxres, int32_t dayres)
+int32_t kpdecoder::kpngrend(const char *kfilebuf, int32_t kfilength,
+                            intptr_t dakpframeplace, int32_t dakpbytesperline, int32_t daxres, int32_t dayres)
 {
     int32_t i, j, k, bfinal, btype, hlit, hdist, leng;
     int32_t slidew, slider;
@@ -719,8 +710,6 @@ static int32_t kpngrend(const char *kfilebuf, int32_t kfilength,
 
     UNREFERENCED_PARAMETER(kfilength);
 
-    if (!pnginited) { pnginited = 1; initpngtables(); }
-
     if ((B_UNBUF32(&kfilebuf[0]) != B_LITTLE32(0x474e5089u)) || (B_UNBUF32(&kfilebuf[4]) != B_LITTLE32(0x0a1a0a0du)))
         return -1; //"Invalid PNG file signature"
     filptr = (uint8_t const *)&kfilebuf[8];
@@ -965,17 +954,8 @@ kpngrend_goodret:
 //   All non 32-bit color drawing was removed
 //   "Motion" JPG code was removed
 //   A lot of parameters were added to kpeg() for library usage
-static int32_t kpeginited = 0;
-static int32_t clipxdim, clipydim;
-
-static int32_t hufmaxatbit[8][20], hufvalatbit[8][20], hufcnt[8];
-static uint8_t hufnumatbit[8][20], huftable[8][256];
-static int32_t hufquickval[8][1024], hufquickbits[8][1024], hufquickcnt[8];
-static int32_t quantab[4][64], dct[12][64], lastdc[4], unzig[64], zigit[64]; //dct:10=MAX (says spec);+2 for hacks
-static uint8_t gnumcomponents, dcflagor[64];
-static int32_t gcompid[4], gcomphsamp[4], gcompvsamp[4], gcompquantab[4], gcomphsampshift[4], gcompvsampshift[4];
-static int32_t lnumcomponents, lcompid[4], lcompdc[4], lcompac[4], lcomphsamp[4], lcompvsamp[4], lcompquantab[4];
-static int32_t lcomphvsamp0, lcomphsampshift0, lcompvsampshift0;
+static int32_t unzig[64], zigit[64];
+static uint8_t dcflagor[64];
 static int32_t colclip[1024], colclipup8[1024], colclipup16[1024];
 /*static uint8_t pow2char[8] = {1,2,4,8,16,32,64,128};*/
 
@@ -1074,11 +1054,9 @@ static void initkpeg()
         cbmul[(i<<1)+0] = j*-360857; //-0.34414*1048576
         cbmul[(i<<1)+1] = j*1858077; //1.772*1048576
     }
-
-    Bmemset((void *)&dct[10][0],0,64*2*sizeof(dct[0][0]));
 }
 
-static void huffgetval(int32_t index, int32_t curbits, int32_t num, int32_t *daval, int32_t *dabits)
+void kpdecoder::huffgetval(int32_t index, int32_t curbits, int32_t num, int32_t *daval, int32_t *dabits)
 {
     int32_t b, v, pow2, *hmax;
 
@@ -1146,7 +1124,7 @@ static void invdct8x8(int32_t *dc, uint8_t dcflag)
     while (dc < edc);
 }
 
-static void yrbrend(int32_t x, int32_t y, int32_t *ldct)
+void kpdecoder::yrbrend(int32_t x, int32_t y, int32_t *ldct)
 {
     int32_t i, j, ox, oy, xx, yy, xxx, yyy, xxxend, yyyend, yv, cr = 0, cb = 0, *odc, *dc, *dc2;
     intptr_t p, pp;
@@ -1235,7 +1213,6 @@ static void yrbrend(int32_t x, int32_t y, int32_t *ldct)
         }
     }
 }
-void (*kplib_yrbrend_func)(int32_t,int32_t,int32_t *) = yrbrend;
 
 #define KPEG_GETBITS(curbits, minbits, num, kfileptr, kfileend)\
     while (curbits < minbits)\
@@ -1245,8 +1222,8 @@ void (*kplib_yrbrend_func)(int32_t,int32_t,int32_t *) = yrbrend;
     }
 
 
-static int32_t kpegrend(const char *kfilebuf, int32_t kfilength,
-                        intptr_t dakpframeplace, int32_t dakpbytesperline, int32_t daxres, int32_t dayres)
+int32_t kpdecoder::kpegrend(const char *kfilebuf, int32_t kfilength,
+                            intptr_t dakpframeplace, int32_t dakpbytesperline, int32_t daxres, int32_t dayres)
 {
     int32_t i, j, v, leng = 0, xdim = 0, ydim = 0, index, prec, restartcnt, restartinterval;
     int32_t x, y, z, xx, yy, zz, *dc = NULL, num, curbits, c, daval, dabits, *hqval, *hqbits, hqcnt, *quanptr = NULL;
@@ -1256,8 +1233,6 @@ static int32_t kpegrend(const char *kfilebuf, int32_t kfilength,
     uint8_t ch, marker, dcflag;
     const uint8_t *kfileptr, *kfileend;
 
-    if (!kpeginited) { kpeginited = 1; initkpeg(); }
-
     kfileptr = (uint8_t const *)kfilebuf;
     kfileend = &kfileptr[kfilength];
 
@@ -1556,7 +1531,7 @@ static int32_t kpegrend(const char *kfilebuf, int32_t kfilength,
                             }
                     }
 
-                    if (!dctbuf) kplib_yrbrend_func(x,y,&dct[0][0]);
+                    if (!dctbuf) yrbrend(x,y,&dct[0][0]);
 
                     restartcnt--;
                     if (!restartcnt)
@@ -1604,7 +1579,7 @@ static int32_t kpegrend(const char *kfilebuf, int32_t kfilength,
                         for (z=0; z<64; z++) dc[z] = ((int32_t)dcs[zigit[z]])*quanptr[z];
                         invdct8x8(dc,0xff);
                     }
-            kplib_yrbrend_func(x,y,&dct[0][0]);
+            yrbrend(x,y,&dct[0][0]);
         }
 
     Xfree(dctbuf); return 0;
@@ -1613,11 +1588,8 @@ static int32_t kpegrend(const char *kfilebuf, int32_t kfilength,
 //==============================  KPEGILIB ends ==============================
 //================================ GIF begins ================================
 
-static uint8_t suffix[4100], filbuffer[768], tempstack[4096];
-static int32_t prefix[4100];
-
-static int32_t kgifrend(const char *kfilebuf, int32_t kfilelength,
-                        intptr_t dakpframeplace, int32_t dakpbytesperline, int32_t daxres, int32_t dayres)
+int32_t kpdecoder::kgifrend(const char *kfilebuf, int32_t kfilelength,
+                            intptr_t dakpframeplace, int32_t dakpbytesperline, int32_t daxres, int32_t dayres)
 {
     int32_t i, x, y, xsiz, ysiz, yinc, xend, xspan, yspan, currstr, numbitgoal;
     int32_t lzcols, dat, blocklen, bitcnt, xoff, transcol;
@@ -1744,8 +1716,8 @@ static int32_t kgifrend(const char *kfilebuf, int32_t kfilelength,
 //int32_t imagebytes, filler[4];
 //char pal6bit[256][3], image[ydim][xdim];
 #ifdef KPCEL
-static int32_t kcelrend(const char *buf, int32_t fleng,
-                        intptr_t dakpframeplace, int32_t dakpbytesperline, int32_t daxres, int32_t dayres)
+int32_t kpdecoder::kcelrend(const char *buf, int32_t fleng,
+                            intptr_t dakpframeplace, int32_t dakpbytesperline, int32_t daxres, int32_t dayres)
 {
     int32_t i, x, y, x0, x1, y0, y1, xsiz, ysiz;
     const char *cptr;
@@ -1782,8 +1754,8 @@ static int32_t kcelrend(const char *buf, int32_t fleng,
 //===============================  CEL ends ==================================
 //=============================  TARGA begins ================================
 
-static int32_t ktgarend(const char *header, int32_t fleng,
-                        intptr_t dakpframeplace, int32_t dakpbytesperline, int32_t daxres, int32_t dayres)
+int32_t kpdecoder::ktgarend(const char *header, int32_t fleng,
+                            intptr_t dakpframeplace, int32_t dakpbytesperline, int32_t daxres, int32_t dayres)
 {
     int32_t i = 0, x, y, pi, xi, yi, x0, x1, y0, y1, xsiz, ysiz, rlestat, colbyte, pixbyte;
     intptr_t p;
@@ -1882,8 +1854,8 @@ static int32_t ktgarend(const char *header, int32_t fleng,
 //+---------------------+---------------+---------+------------------------------------+
 //                      | rastoff(?): bitmap data |
 //                      +-------------------------+
-static int32_t kbmprend(const char *buf, int32_t fleng,
-                        intptr_t dakpframeplace, int32_t dakpbytesperline, int32_t daxres, int32_t dayres)
+int32_t kpdecoder::kbmprend(const char *buf, int32_t fleng,
+                            intptr_t dakpframeplace, int32_t dakpbytesperline, int32_t daxres, int32_t dayres)
 {
     int32_t i, j, x, y, x0, x1, y0, y1, rastoff, headsiz, xsiz, ysiz, cdim, comp, cptrinc, *lptr;
     const char *cptr;
@@ -1994,8 +1966,8 @@ static int32_t kbmprend(const char *buf, int32_t fleng,
 //===============================  BMP ends ==================================
 //==============================  PCX begins =================================
 //Note: currently only supports 8 and 24 bit PCX
-static int32_t kpcxrend(const char *buf, int32_t fleng,
-                        intptr_t dakpframeplace, int32_t dakpbytesperline, int32_t daxres, int32_t dayres)
+int32_t kpdecoder::kpcxrend(const char *buf, int32_t fleng,
+                            intptr_t dakpframeplace, int32_t dakpbytesperline, int32_t daxres, int32_t dayres)
 {
     int32_t  j, x, y, nplanes, x0, x1, y0, y1, bpl, xsiz, ysiz;
     intptr_t p,i;
@@ -2080,8 +2052,8 @@ static int32_t kpcxrend(const char *buf, int32_t fleng,
 //Note:currently supports: DXT1,DXT2,DXT3,DXT4,DXT5,A8R8G8B8
 
 #ifdef KPDDS
-static int32_t kddsrend(const char *buf, int32_t leng,
-                        intptr_t frameptr, int32_t bpl, int32_t xdim, int32_t ydim, int32_t xoff, int32_t yoff)
+int32_t kpdecoder::kddsrend(const char *buf, int32_t leng,
+                            intptr_t frameptr, int32_t bpl, int32_t xdim, int32_t ydim, int32_t xoff, int32_t yoff)
 {
     int32_t x, y, z = 0, xx, yy, xsiz, ysiz, dxt, al[2], ai, k, v, c0, c1, stride;
     intptr_t j;
@@ -2293,8 +2265,8 @@ void kpgetdim(const char *buf, int32_t leng, int32_t *xsiz, int32_t *ysiz)
     }
 }
 
-int32_t kprender(const char *buf, int32_t leng, intptr_t frameptr, int32_t bpl,
-                 int32_t xdim, int32_t ydim)
+int32_t kpdecoder::kprender(const char *buf, int32_t leng, intptr_t frameptr, int32_t bpl,
+                            int32_t xdim, int32_t ydim)
 {
     uint8_t const *ubuf = (uint8_t const *)buf;
 
@@ -2327,6 +2299,25 @@ int32_t kprender(const char *buf, int32_t leng, intptr_t frameptr, int32_t bpl,
     }
 }
 
+static void kpinittables()
+{
+    //Thread-safe: kprender() may be called from several threads at once
+    static bool inited = (initpngtables(), initkpeg(), true);
+    UNREFERENCED_PARAMETER(inited);
+}
+
+int32_t kprender(const char *buf, int32_t leng, intptr_t frameptr, int32_t bpl,
+                 int32_t xdim, int32_t ydim)
+{
+    kpinittables();
+
+    auto dec = (kpdecoder *)Xcalloc(1, sizeof(kpdecoder));
+    int32_t const ret = dec->kprender(buf, leng, frameptr, bpl, xdim, ydim);
+    Xfree(dec);
+
+    return ret;
+}
+
 //==================== External picture interface ends =======================
 
 //Brute-force case-insensitive, slash-insensitive, * and ? wildcard matcher
@@ -2434,6 +2425,8 @@ static int32_t kzcheckhash(const char *filnam, char **zipnam, int32_t *fileoffs,
     return 0;
 }
 
+int32_t kzhasfiles() { return kzhashbuf && kzlastfnam >= 0; }
+
 void kzuninit()
 {
     DO_FREE_AND_NULL(kzhashbuf);
@@ -2557,24 +2550,24 @@ void kzsetfil(buildvfs_FILE fil)
     kzfs.i = 0;
 }
 
-intptr_t kzopen(const char *filnam)
+static intptr_t kzopenfs(kzfilestate &fs, const char *filnam)
 {
     buildvfs_FILE fil{};
     int32_t i, fileoffs, fileleng;
     char tempbuf[46+260], *zipnam, iscomp;
 
-    //kzfs.fil = 0;
+    //fs.fil = 0;
     if (filnam[0] != '|') //Search standalone file first
     {
-        kzfs.fil = buildvfs_fopen_read(filnam);
-        if (kzfs.fil)
+        fs.fil = buildvfs_fopen_read(filnam);
+        if (fs.fil)
         {
-            kzfs.comptyp = 0;
-            kzfs.seek0 = 0;
-            kzfs.leng = buildvfs_flength(kzfs.fil);
-            kzfs.pos = 0;
-            kzfs.i = 0;
-            return (intptr_t)kzfs.fil;
+            fs.comptyp = 0;
+            fs.seek0 = 0;
+            fs.leng = buildvfs_flength(fs.fil);
+            fs.pos = 0;
+            fs.i = 0;
+            return (intptr_t)fs.fil;
         }
     }
     if (kzcheckhash(filnam,&zipnam,&fileoffs,&fileleng,&iscomp)) //Then check mounted ZIP/GRP files
@@ -2583,13 +2576,13 @@ intptr_t kzopen(const char *filnam)
         buildvfs_fseek_abs(fil,fileoffs);
         if (!iscomp) //Must be from GRP file
         {
-            kzfs.fil = fil;
-            kzfs.comptyp = 0;
-            kzfs.seek0 = fileoffs;
-            kzfs.leng = fileleng;
-            kzfs.pos = 0;
-            kzfs.i = 0;
-            return (intptr_t)kzfs.fil;
+            fs.fil = fil;
+            fs.comptyp = 0;
+            fs.seek0 = fileoffs;
+            fs.leng = fileleng;
+            fs.pos = 0;
+            fs.i = 0;
+            return (intptr_t)fs.fil;
         }
         else
         {
@@ -2597,24 +2590,19 @@ intptr_t kzopen(const char *filnam)
             if (B_UNBUF32(&tempbuf[0]) != B_LITTLE32(0x04034b50u)) { buildvfs_fclose(fil); return 0; }
             buildvfs_fseek_rel(fil,B_LITTLE16(B_UNBUF16(&tempbuf[26]))+B_LITTLE16(B_UNBUF16(&tempbuf[28])));
 
-            kzfs.fil = fil;
-            kzfs.comptyp = B_LITTLE16(B_UNBUF16(&tempbuf[8]));
-            kzfs.seek0 = buildvfs_ftell(fil);
-            kzfs.leng = B_LITTLE32(B_UNBUF32(&tempbuf[22]));
-            kzfs.pos = 0;
-            switch (kzfs.comptyp) //Compression method
+            fs.fil = fil;
+            fs.comptyp = B_LITTLE16(B_UNBUF16(&tempbuf[8]));
+            fs.seek0 = buildvfs_ftell(fil);
+            fs.leng = B_LITTLE32(B_UNBUF32(&tempbuf[22]));
+            fs.pos = 0;
+            switch (fs.comptyp) //Compression method
             {
-            case 0: kzfs.i = 0; return (intptr_t)kzfs.fil;
+            case 0: fs.i = 0; return (intptr_t)fs.fil;
             case 8:
-                    if (!pnginited) { pnginited = 1; initpngtables(); }
-                kzfs.comptell = 0;
-                kzfs.compleng = B_LITTLE32(B_UNBUF32(&tempbuf[18]));
-
-                //WARNING: No file in ZIP can be > 2GB-32K bytes
-                gslidew = 0x7fffffff; //Force reload at beginning
-
-                return (intptr_t)kzfs.fil;
-            default: buildvfs_fclose(kzfs.fil); kzfs.fil = 0; return 0;
+                fs.comptell = 0;
+                fs.compleng = B_LITTLE32(B_UNBUF32(&tempbuf[18]));
+                return (intptr_t)fs.fil;
+            default: buildvfs_fclose(fs.fil); fs.fil = 0; return 0;
             }
         }
     }
@@ -2635,21 +2623,78 @@ intptr_t kzopen(const char *filnam)
             strcat(tempbuf,"/");
 #endif
         strcat(tempbuf,filnam);
-        kzfs.fil = buildvfs_fopen_read(tempbuf);
-        if (kzfs.fil)
+        fs.fil = buildvfs_fopen_read(tempbuf);
+        if (fs.fil)
         {
-            kzfs.comptyp = 0;
-            kzfs.seek0 = 0;
-            kzfs.leng = buildvfs_flength(fil);
-            kzfs.pos = 0;
-            kzfs.i = 0;
-            return (intptr_t)kzfs.fil;
+            fs.comptyp = 0;
+            fs.seek0 = 0;
+            fs.leng = buildvfs_flength(fs.fil);
+            fs.pos = 0;
+            fs.i = 0;
+            return (intptr_t)fs.fil;
         }
     }
 
     return 0;
 }
 
+void kpdecoder::kzinit(kzfilestate *fs)
+{
+    kpinittables();
+
+    zfs = fs;
+    zcpnum = 0;
+    zcpspacing = max<int32_t>(KZCHECKPOINTSPACING, fs->leng/KZMAXCHECKPOINTS+1);
+
+    //WARNING: No file in ZIP can be > 2GB-32K bytes
+    gslidew = 0x7fffffff; //Force reload at beginning
+}
+
+intptr_t kzopen(const char *filnam)
+{
+    intptr_t const fil = kzopenfs(kzfs, filnam);
+
+    if (fil && kzfs.comptyp == 8)
+        kzdecoder.kzinit(&kzfs);
+
+    return fil;
+}
+
+kzstream *kzsopen(const char *filnam)
+{
+    kzfilestate fs{};
+
+    if (!kzopenfs(fs, filnam))
+        return nullptr;
+
+    auto zs = (kzstream *)Xcalloc(1, sizeof(kzstream));
+    zs->fs = fs;
+
+    if (fs.comptyp == 8)
+    {
+        zs->dec = (kpdecoder *)Xcalloc(1, sizeof(kpdecoder));
+        zs->dec->kzinit(&zs->fs);
+    }
+
+    return zs;
+}
+
+void kzsclose(kzstream *zs)
+{
+    if (!zs)
+        return;
+
+    MAYBE_FCLOSE_AND_NULL(zs->fs.fil);
+
+    if (zs->dec)
+    {
+        Xfree(zs->dec->zcp);
+        Xfree(zs->dec);
+    }
+
+    Xfree(zs);
+}
+
 #ifndef USE_PHYSFS
 // --------------------------------------------------------------------------
 
@@ -2806,234 +2851,302 @@ int32_t kzfindfile(char *filnam)
 
 // --------------------------------------------------------------------------
 
-static char *gzbufptr;
-static void putbuf4zip(const uint8_t *buf, int32_t uncomp0, int32_t uncomp1)
+void kpdecoder::putbuf4zip(const uint8_t *buf, int32_t uncomp0, int32_t uncomp1)
 {
     int32_t i0, i1;
     //              uncomp0 ... uncomp1
-    //  &gzbufptr[kzfs.pos] ... &gzbufptr[kzfs.endpos];
-    i0 = max(uncomp0,kzfs.pos);
-    i1 = min(uncomp1,kzfs.endpos);
+    //  &gzbufptr[zfs->pos] ... &gzbufptr[zfs->endpos];
+    i0 = max(uncomp0,zfs->pos);
+    i1 = min(uncomp1,zfs->endpos);
     if (i0 < i1) Bmemcpy(&gzbufptr[i0],&buf[i0-uncomp0],i1-i0);
 }
 
+void kpdecoder::kzaddcheckpoint()
+{
+    if (zcpnum >= zcpmax)
+    {
+        zcpmax = min(max(zcpmax<<1, 4), KZMAXCHECKPOINTS);
+        zcp = (kzcheckpoint *)Xrealloc(zcp, zcpmax*sizeof(kzcheckpoint));
+    }
+
+    auto &cp = zcp[zcpnum++];
+
+    cp.compbit = (((int64_t)zipinbase+(int32_t)sizeof(olinbuf)-4)<<3) + bitpos;
+    cp.uncomp = gslidew;
+    cp.slider = gslider;
+    Bmemcpy(cp.window, slidebuf, sizeof(slidebuf));
+}
+
+//Returns the last checkpoint zfs->pos can be reached from, if resuming there
+//beats both carrying on from the current state and going back to the start.
+kzcheckpoint const *kpdecoder::kzfindcheckpoint()
+{
+    kzcheckpoint const *best = nullptr;
+
+    for (int32_t i = 0; i < zcpnum && zcp[i].uncomp-32768 <= zfs->pos; i++)
+        best = &zcp[i];
+
+    if (best && (zfs->pos < gslidew-32768 || best->uncomp > gslidew))
+        return best;
+
+    return nullptr;
+}
+
+void kpdecoder::kzrestorecheckpoint(kzcheckpoint const *cp)
+{
+    gslidew = cp->uncomp; gslider = cp->slider;
+    Bmemcpy(slidebuf, cp->window, sizeof(slidebuf));
+    zfs->jmpplc = 0;
+
+    //Refill the FIFO from the byte holding the checkpoint's first bit
+    zipinbase = (int32_t)(cp->compbit>>3);
+    buildvfs_fseek_abs(zfs->fil,zfs->seek0+zipinbase);
+    zfs->comptell = zipinbase + min<int32_t>(zfs->compleng-zipinbase,sizeof(olinbuf));
+    buildvfs_fread(&olinbuf[0],zfs->comptell-zipinbase,1,zfs->fil);
+    bitpos = -(((int32_t)sizeof(olinbuf)-4)<<3) + (int32_t)(cp->compbit&7);
+    filptr = &olinbuf[sizeof(olinbuf)-4];
+}
+
 //returns number of bytes copied
-int32_t kzread(void *buffer, int32_t leng)
+static int32_t kzreadfs(kzfilestate &fs, kpdecoder *dec, void *buffer, int32_t leng)
 {
-    int32_t i, j, k, bfinal, btype, hlit, hdist;
+    if ((!fs.fil) || (leng <= 0)) return 0;
 
-    if ((!kzfs.fil) || (leng <= 0)) return 0;
+    if (fs.comptyp == 8)
+        return dec->kzread(buffer, leng);
 
-    if (kzfs.comptyp == 0)
+    if (fs.comptyp == 0)
     {
-        if (kzfs.pos != kzfs.i) //Seek only when position changes
-            { buildvfs_fseek_abs(kzfs.fil,kzfs.seek0+kzfs.pos); kzfs.i = kzfs.pos; }
-        i = min(kzfs.leng-kzfs.pos,leng);
-        buildvfs_fread(buffer,i,1,kzfs.fil);
-        kzfs.i += i; //kzfs.i is a local copy of buildvfs_ftell(kzfs.fil);
+        //Stored data goes straight from the file into the caller's buffer
+        if (fs.pos != fs.i) //Seek only when position changes
+            { buildvfs_fseek_abs(fs.fil,fs.seek0+fs.pos); fs.i = fs.pos; }
+        int32_t const i = min(fs.leng-fs.pos,leng);
+        buildvfs_fread(buffer,i,1,fs.fil);
+        fs.i += i; //fs.i is a local copy of buildvfs_ftell(fs.fil);
     }
-    else if (kzfs.comptyp == 8)
+
+    int32_t const i = fs.pos;
+    fs.pos += leng; if (fs.pos > fs.leng) fs.pos = fs.leng;
+    return fs.pos-i;
+}
+
+int32_t kzread(void *buffer, int32_t leng) { return kzreadfs(kzfs, &kzdecoder, buffer, leng); }
+int32_t kzsread(kzstream *zs, void *buffer, int32_t leng) { return kzreadfs(zs->fs, zs->dec, buffer, leng); }
+
+int32_t kpdecoder::kzread(void *buffer, int32_t leng)
+{
+    int32_t i, j, k, bfinal, btype, hlit, hdist;
+
+    zipfilmode = 1;
+
+    //Initialize for putbuf4zip
+    gzbufptr = (char *)buffer; gzbufptr = &gzbufptr[-zfs->pos];
+    zfs->endpos = min(zfs->pos+leng,zfs->leng);
+    if (zfs->endpos == zfs->pos) return 0; //Guard against reading 0 length
+
+    if (auto const cp = kzfindcheckpoint())
+        kzrestorecheckpoint(cp);
+    else if (zfs->pos < gslidew-32768) // Must go back to start :(
     {
-        zipfilmode = 1;
+        if (zfs->comptell) buildvfs_fseek_abs(zfs->fil,zfs->seek0);
 
-        //Initialize for putbuf4zip
-        gzbufptr = (char *)buffer; gzbufptr = &gzbufptr[-kzfs.pos];
-        kzfs.endpos = min(kzfs.pos+leng,kzfs.leng);
-        if (kzfs.endpos == kzfs.pos) return 0; //Guard against reading 0 length
+        gslidew = 0; gslider = 16384;
+        zfs->jmpplc = 0;
 
-        if (kzfs.pos < gslidew-32768) // Must go back to start :(
-        {
-            if (kzfs.comptell) buildvfs_fseek_abs(kzfs.fil,kzfs.seek0);
-
-            gslidew = 0; gslider = 16384;
-            kzfs.jmpplc = 0;
-
-            //Initialize for suckbits/peekbits/getbits
-            kzfs.comptell = min<int32_t>(kzfs.compleng,sizeof(olinbuf));
-            buildvfs_fread(&olinbuf[0],kzfs.comptell,1,kzfs.fil);
-            //Make it re-load when there are < 32 bits left in FIFO
-            bitpos = -(((int32_t)sizeof(olinbuf)-4)<<3);
-            //Identity: filptr + (bitpos>>3) = &olinbuf[0]
-            filptr = &olinbuf[-(bitpos>>3)];
-        }
-        else
-        {
-            i = max(gslidew-32768,0); j = gslider-16384;
+        //Initialize for suckbits/peekbits/getbits
+        zfs->comptell = min<int32_t>(zfs->compleng,sizeof(olinbuf));
+        buildvfs_fread(&olinbuf[0],zfs->comptell,1,zfs->fil);
+        zipinbase = 0;
+        //Make it re-load when there are < 32 bits left in FIFO
+        bitpos = -(((int32_t)sizeof(olinbuf)-4)<<3);
+        //Identity: filptr + (bitpos>>3) = &olinbuf[0]
+        filptr = &olinbuf[-(bitpos>>3)];
+    }
 
-            //HACK: Don't unzip anything until you have to...
-            //   (keeps file pointer as low as possible)
-            if (kzfs.endpos <= gslidew) j = kzfs.endpos;
+    i = max(gslidew-32768,0); j = gslider-16384;
 
-            //write uncompoffs on slidebuf from: i to j
-            if (!((i^j)&32768))
-                putbuf4zip(&slidebuf[i&32767],i,j);
-            else
-            {
-                putbuf4zip(&slidebuf[i&32767],i,j&~32767);
-                putbuf4zip(slidebuf,j&~32767,j);
-            }
+    //HACK: Don't unzip anything until you have to...
+    //   (keeps file pointer as low as possible)
+    if (zfs->endpos <= gslidew) j = zfs->endpos;
 
-            //HACK: Don't unzip anything until you have to...
-            //   (keeps file pointer as low as possible)
-            if (kzfs.endpos <= gslidew) goto retkzread;
-        }
+    //write uncompoffs on slidebuf from: i to j
+    if (!((i^j)&32768))
+        putbuf4zip(&slidebuf[i&32767],i,j);
+    else
+    {
+        putbuf4zip(&slidebuf[i&32767],i,j&~32767);
+        putbuf4zip(slidebuf,j&~32767,j);
+    }
 
-        switch (kzfs.jmpplc)
-        {
-        case 0: goto kzreadplc0;
-        case 1: goto kzreadplc1;
-        case 2: goto kzreadplc2;
-        case 3: goto kzreadplc3;
-        }
-        kzreadplc0:;
-        do
-        {
-            bfinal = getbits(1); btype = getbits(2);
+    //HACK: Don't unzip anything until you have to...
+    //   (keeps file pointer as low as possible)
+    if (zfs->endpos <= gslidew) goto retkzread;
+
+    switch (zfs->jmpplc)
+    {
+    case 0: goto kzreadplc0;
+    case 1: goto kzreadplc1;
+    case 2: goto kzreadplc2;
+    case 3: goto kzreadplc3;
+    }
+    kzreadplc0:;
+    do
+    {
+        //Only the window and the input position carry over a block boundary
+        if (gslidew >= (zcpnum ? zcp[zcpnum-1].uncomp : 0)+zcpspacing && zcpnum < KZMAXCHECKPOINTS)
+            kzaddcheckpoint();
+
+        bfinal = getbits(1); btype = getbits(2);
 
 #if 0
-            //Display Huffman block offsets&lengths of input file - for debugging only!
+        //Display Huffman block offsets&lengths of input file - for debugging only!
+        {
+            static int32_t ouncomppos = 0, ocomppos = 0;
+            if (zfs->comptell == sizeof(olinbuf)) i = 0;
+            else if (zfs->comptell < zfs->compleng) i = zfs->comptell-(sizeof(olinbuf)-4);
+            else i = zfs->comptell-(zfs->comptell%(sizeof(olinbuf)-4));
+            i += ((int32_t)&filptr[bitpos>>3])-((int32_t)(&olinbuf[0]));
+            i = (i<<3)+(bitpos&7)-3;
+            if (gslidew) printf(" ULng:0x%08x CLng:0x%08x.%x",gslidew-ouncomppos,(i-ocomppos)>>3,((i-ocomppos)&7)<<1);
+            printf("\ntype:%d, Uoff:0x%08x Coff:0x%08x.%x",btype,gslidew,i>>3,(i&7)<<1);
+            if (bfinal)
             {
-                static int32_t ouncomppos = 0, ocomppos = 0;
-                if (kzfs.comptell == sizeof(olinbuf)) i = 0;
-                else if (kzfs.comptell < kzfs.compleng) i = kzfs.comptell-(sizeof(olinbuf)-4);
-                else i = kzfs.comptell-(kzfs.comptell%(sizeof(olinbuf)-4));
-                i += ((int32_t)&filptr[bitpos>>3])-((int32_t)(&olinbuf[0]));
-                i = (i<<3)+(bitpos&7)-3;
-                if (gslidew) printf(" ULng:0x%08x CLng:0x%08x.%x",gslidew-ouncomppos,(i-ocomppos)>>3,((i-ocomppos)&7)<<1);
-                printf("\ntype:%d, Uoff:0x%08x Coff:0x%08x.%x",btype,gslidew,i>>3,(i&7)<<1);
-                if (bfinal)
-                {
-                    printf(" ULng:0x%08x CLng:0x%08x.%x",kzfs.leng-gslidew,((kzfs.compleng<<3)-i)>>3,(((kzfs.compleng<<3)-i)&7)<<1);
-                    printf("\n        Uoff:0x%08x Coff:0x%08x.0",kzfs.leng,kzfs.compleng);
-                    ouncomppos = ocomppos = 0;
-                }
-                else { ouncomppos = gslidew; ocomppos = i; }
+                printf(" ULng:0x%08x CLng:0x%08x.%x",zfs->leng-gslidew,((zfs->compleng<<3)-i)>>3,(((zfs->compleng<<3)-i)&7)<<1);
+                printf("\n        Uoff:0x%08x Coff:0x%08x.0",zfs->leng,zfs->compleng);
+                ouncomppos = ocomppos = 0;
             }
+            else { ouncomppos = gslidew; ocomppos = i; }
+        }
 #endif
 
-            if (btype == 0)
+        if (btype == 0)
+        {
+            //Raw (uncompressed)
+            suckbits((-bitpos)&7);  //Synchronize to start of next byte
+            i = getbits(16); if ((getbits(16)^i) != 0xffff) return -1;
+            for (; i; i--)
             {
-                //Raw (uncompressed)
-                suckbits((-bitpos)&7);  //Synchronize to start of next byte
-                i = getbits(16); if ((getbits(16)^i) != 0xffff) return -1;
-                for (; i; i--)
+                if (gslidew >= gslider)
                 {
-                    if (gslidew >= gslider)
+                    putbuf4zip(&slidebuf[(gslider-16384)&32767],gslider-16384,gslider); gslider += 16384;
+                    if (gslider-16384 >= zfs->endpos)
                     {
-                        putbuf4zip(&slidebuf[(gslider-16384)&32767],gslider-16384,gslider); gslider += 16384;
-                        if (gslider-16384 >= kzfs.endpos)
-                        {
-                            kzfs.jmpplc = 1; kzfs.i = i; kzfs.bfinal = bfinal;
-                            goto retkzread;
-                            kzreadplc1:;         i = kzfs.i; bfinal = kzfs.bfinal;
-                        }
+                        zfs->jmpplc = 1; zfs->i = i; zfs->bfinal = bfinal;
+                        goto retkzread;
+                        kzreadplc1:;         i = zfs->i; bfinal = zfs->bfinal;
                     }
-                    slidebuf[(gslidew++)&32767] = (uint8_t)getbits(8);
                 }
-                continue;
+                slidebuf[(gslidew++)&32767] = (uint8_t)getbits(8);
             }
-            if (btype == 3) continue;
+            continue;
+        }
+        if (btype == 3) continue;
 
-            if (btype == 1) //Fixed Huffman
-            {
-                hlit = 288; hdist = 32; i = 0;
-                for (; i<144; i++) clen[i] = 8; //Fixed bit sizes (literals)
-                for (; i<256; i++) clen[i] = 9; //Fixed bit sizes (literals)
-                for (; i<280; i++) clen[i] = 7; //Fixed bit sizes (EOI,lengths)
-                for (; i<288; i++) clen[i] = 8; //Fixed bit sizes (lengths)
-                for (; i<320; i++) clen[i] = 5; //Fixed bit sizes (distances)
-            }
-            else  //Dynamic Huffman
-            {
-                hlit = getbits(5)+257; hdist = getbits(5)+1; j = getbits(4)+4;
-                for (i=0; i<j; i++) cclen[ccind[i]] = getbits(3);
-                for (; i<19; i++) cclen[ccind[i]] = 0;
-                hufgencode(cclen,19,ibuf0,nbuf0);
+        if (btype == 1) //Fixed Huffman
+        {
+            hlit = 288; hdist = 32; i = 0;
+            for (; i<144; i++) clen[i] = 8; //Fixed bit sizes (literals)
+            for (; i<256; i++) clen[i] = 9; //Fixed bit sizes (literals)
+            for (; i<280; i++) clen[i] = 7; //Fixed bit sizes (EOI,lengths)
+            for (; i<288; i++) clen[i] = 8; //Fixed bit sizes (lengths)
+            for (; i<320; i++) clen[i] = 5; //Fixed bit sizes (distances)
+        }
+        else  //Dynamic Huffman
+        {
+            hlit = getbits(5)+257; hdist = getbits(5)+1; j = getbits(4)+4;
+            for (i=0; i<j; i++) cclen[ccind[i]] = getbits(3);
+            for (; i<19; i++) cclen[ccind[i]] = 0;
+            hufgencode(cclen,19,ibuf0,nbuf0);
 
-                j = 0; k = hlit+hdist;
-                while (j < k)
+            j = 0; k = hlit+hdist;
+            while (j < k)
+            {
+                i = hufgetsym(ibuf0,nbuf0);
+                if (i < 16) { clen[j++] = i; continue; }
+                if (i == 16)
+                    { for (i=getbits(2)+3; i; i--) { clen[j] = clen[j-1]; j++; } }
+                else
                 {
-                    i = hufgetsym(ibuf0,nbuf0);
-                    if (i < 16) { clen[j++] = i; continue; }
-                    if (i == 16)
-                        { for (i=getbits(2)+3; i; i--) { clen[j] = clen[j-1]; j++; } }
-                    else
-                    {
-                        if (i == 17) i = getbits(3)+3; else i = getbits(7)+11;
-                        for (; i; i--) clen[j++] = 0;
-                    }
+                    if (i == 17) i = getbits(3)+3; else i = getbits(7)+11;
+                    for (; i; i--) clen[j++] = 0;
                 }
             }
+        }
 
-            hufgencode(clen,hlit,ibuf0,nbuf0);
-            qhufgencode(ibuf0,nbuf0,qhufval0,qhufbit0,LOGQHUFSIZ0);
+        hufgencode(clen,hlit,ibuf0,nbuf0);
+        qhufgencode(ibuf0,nbuf0,qhufval0,qhufbit0,LOGQHUFSIZ0);
 
-            hufgencode(&clen[hlit],hdist,ibuf1,nbuf1);
-            qhufgencode(ibuf1,nbuf1,qhufval1,qhufbit1,LOGQHUFSIZ1);
+        hufgencode(&clen[hlit],hdist,ibuf1,nbuf1);
+        qhufgencode(ibuf1,nbuf1,qhufval1,qhufbit1,LOGQHUFSIZ1);
 
-            while (1)
+        while (1)
+        {
+            if (gslidew >= gslider)
             {
-                if (gslidew >= gslider)
+                putbuf4zip(&slidebuf[(gslider-16384)&32767],gslider-16384,gslider); gslider += 16384;
+                if (gslider-16384 >= zfs->endpos)
                 {
-                    putbuf4zip(&slidebuf[(gslider-16384)&32767],gslider-16384,gslider); gslider += 16384;
-                    if (gslider-16384 >= kzfs.endpos)
-                    {
-                        kzfs.jmpplc = 2; kzfs.bfinal = bfinal; goto retkzread;
-                        kzreadplc2:;      bfinal = kzfs.bfinal;
-                    }
+                    zfs->jmpplc = 2; zfs->bfinal = bfinal; goto retkzread;
+                    kzreadplc2:;      bfinal = zfs->bfinal;
                 }
+            }
 
-                k = peekbits(LOGQHUFSIZ0);
-                if (qhufbit0[k]) { i = qhufval0[k]; suckbits((int32_t)qhufbit0[k]); }
-                else i = hufgetsym(ibuf0,nbuf0);
+            k = peekbits(LOGQHUFSIZ0);
+            if (qhufbit0[k]) { i = qhufval0[k]; suckbits((int32_t)qhufbit0[k]); }
+            else i = hufgetsym(ibuf0,nbuf0);
 
-                if (i < 256) { slidebuf[(gslidew++)&32767] = (uint8_t)i; continue; }
-                if (i == 256) break;
-                i = getbits(hxbit[i+30-257][0]) + hxbit[i+30-257][1];
+            if (i < 256) { slidebuf[(gslidew++)&32767] = (uint8_t)i; continue; }
+            if (i == 256) break;
+            i = getbits(hxbit[i+30-257][0]) + hxbit[i+30-257][1];
 
-                k = peekbits(LOGQHUFSIZ1);
-                if (qhufbit1[k]) { j = qhufval1[k]; suckbits((int32_t)qhufbit1[k]); }
-                else j = hufgetsym(ibuf1,nbuf1);
+            k = peekbits(LOGQHUFSIZ1);
+            if (qhufbit1[k]) { j = qhufval1[k]; suckbits((int32_t)qhufbit1[k]); }
+            else j = hufgetsym(ibuf1,nbuf1);
 
-                j = getbits(hxbit[j][0]) + hxbit[j][1];
-                for (; i; i--,gslidew++) slidebuf[gslidew&32767] = slidebuf[(gslidew-j)&32767];
-            }
+            j = getbits(hxbit[j][0]) + hxbit[j][1];
+            for (; i; i--,gslidew++) slidebuf[gslidew&32767] = slidebuf[(gslidew-j)&32767];
         }
-        while (!bfinal);
+    }
+    while (!bfinal);
 
-        gslider -= 16384;
-        if (!((gslider^gslidew)&32768))
-            putbuf4zip(&slidebuf[gslider&32767],gslider,gslidew);
-        else
-        {
-            putbuf4zip(&slidebuf[gslider&32767],gslider,gslidew&~32767);
-            putbuf4zip(slidebuf,gslidew&~32767,gslidew);
-        }
-        kzreadplc3:; kzfs.jmpplc = 3;
+    gslider -= 16384;
+    if (!((gslider^gslidew)&32768))
+        putbuf4zip(&slidebuf[gslider&32767],gslider,gslidew);
+    else
+    {
+        putbuf4zip(&slidebuf[gslider&32767],gslider,gslidew&~32767);
+        putbuf4zip(slidebuf,gslidew&~32767,gslidew);
     }
+    kzreadplc3:; zfs->jmpplc = 3;
 
     retkzread:;
-    i = kzfs.pos;
-    kzfs.pos += leng; if (kzfs.pos > kzfs.leng) kzfs.pos = kzfs.leng;
-    return kzfs.pos-i;
+    i = zfs->pos;
+    zfs->pos += leng; if (zfs->pos > zfs->leng) zfs->pos = zfs->leng;
+    return zfs->pos-i;
 }
 
 //WARNING: kzseek(<-32768,SEEK_CUR); or:
-//         kzseek(0,SEEK_END);       can make next kzread very slow!!!
-int32_t kzseek(int32_t offset, int32_t whence)
+//         kzseek(0,SEEK_END);       can make next kzread slow (bounded by
+//         KZCHECKPOINTSPACING once the entry has been inflated that far)
+static int32_t kzseekfs(kzfilestate &fs, int32_t offset, int32_t whence)
 {
-    if (!kzfs.fil) return -1;
+    if (!fs.fil) return -1;
     switch (whence)
     {
-    case SEEK_CUR: kzfs.pos += offset; break;
-    case SEEK_END: kzfs.pos = kzfs.leng+offset; break;
-    case SEEK_SET: default: kzfs.pos = offset;
+    case SEEK_CUR: fs.pos += offset; break;
+    case SEEK_END: fs.pos = fs.leng+offset; break;
+    case SEEK_SET: default: fs.pos = offset;
     }
-    if (kzfs.pos < 0) kzfs.pos = 0;
-    if (kzfs.pos > kzfs.leng) kzfs.pos = kzfs.leng;
-    return kzfs.pos;
+    if (fs.pos < 0) fs.pos = 0;
+    if (fs.pos > fs.leng) fs.pos = fs.leng;
+    return fs.pos;
 }
 
+int32_t kzseek(int32_t offset, int32_t whence) { return kzseekfs(kzfs, offset, whence); }
+int32_t kzsseek(kzstream *zs, int32_t offset, int32_t whence) { return kzseekfs(zs->fs, offset, whence); }
+int32_t kzstell(kzstream const *zs) { return zs->fs.pos; }
+int32_t kzsfilelength(kzstream const *zs) { return zs->fs.leng; }
+
 //====================== ZIP decompression code ends =========================
 //===================== HANDY PICTURE function begins ========================
 #include "cache1d.h"
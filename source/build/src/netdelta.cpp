@@ -0,0 +1,197 @@
+// Byte-level snapshot deltas, see netdelta.h for the format.
+
+#include "compat.h"
+#include "netdelta.h"
+
+#if defined BITNESS64 && (defined __SSE2__ || defined _MSC_VER) && !defined(_M_ARM64)
+# include <emmintrin.h>
+# define NETDELTA_SSE2
+#endif
+
+static FORCE_INLINE uint8_t *netDeltaPutVarint(uint8_t *p, uint32_t v)
+{
+    while (v >= 0x80)
+    {
+        *p++ = v | 0x80;
+        v >>= 7;
+    }
+
+    *p++ = v;
+    return p;
+}
+
+static FORCE_INLINE uint8_t const *netDeltaGetVarint(uint8_t const *p, uint8_t const *end, uint32_t *v)
+{
+    uint32_t val = 0;
+
+    for (int shift = 0; p < end && shift < 35; shift += 7)
+    {
+        val |= (uint32_t)(*p & 0x7f) << shift;
+
+        if (!(*p++ & 0x80))
+        {
+            *v = val;
+            return p;
+        }
+    }
+
+    return nullptr;
+}
+
+// mask of the bytes that differ between two 16-byte blocks
+static FORCE_INLINE uint32_t netDeltaCompareBlock(uint8_t const *from, uint8_t const *to)
+{
+#ifdef NETDELTA_SSE2
+    __m128i const a = _mm_loadu_si128((__m128i const *)from);
+    __m128i const b = _mm_loadu_si128((__m128i const *)to);
+    return ~_mm_movemask_epi8(_mm_cmpeq_epi8(a, b)) & 0xffff;
+#else
+    uint64_t a[2], b[2];
+    Bmemcpy(a, from, sizeof(a));
+    Bmemcpy(b, to, sizeof(b));
+
+    if (a[0] == b[0] && a[1] == b[1])
+        return 0;
+
+    uint32_t mask = 0;
+    for (int i = 0; i < NETDELTA_BLOCK; i++)
+        mask |= (uint32_t)(from[i] != to[i]) << i;
+    return mask;
+#endif
+}
+
+static FORCE_INLINE uint32_t netDeltaCompareTail(uint8_t const *from, uint8_t const *to, int32_t len)
+{
+    uint32_t mask = 0;
+    for (int i = 0; i < len; i++)
+        mask |= (uint32_t)(from[i] != to[i]) << i;
+    return mask;
+}
+
+int32_t netDeltaEncode(void const *from, void const *to, int32_t size, uint8_t *out)
+{
+    auto const src = (uint8_t const *)from;
+    auto const dst = (uint8_t const *)to;
+
+    int32_t const numblocks = (size + NETDELTA_BLOCK - 1) / NETDELTA_BLOCK;
+    int32_t const fullblocks = size / NETDELTA_BLOCK;
+
+    auto p = out;
+    int32_t block = 0, lastblock = 0;
+
+    while (block < numblocks)
+    {
+        // find the next changed block
+        uint32_t mask = 0;
+
+        for (; block < numblocks; block++)
+        {
+            int32_t const ofs = block * NETDELTA_BLOCK;
+
+            mask = block < fullblocks ? netDeltaCompareBlock(src + ofs, dst + ofs) : netDeltaCompareTail(src + ofs, dst + ofs, size - ofs);
+
+            if (mask)
+                break;
+        }
+
+        if (block == numblocks)
+            break;
+
+        // the run header is written once its length is known
+        uint8_t header[10];
+        auto hp = netDeltaPutVarint(header, block - lastblock);
+        auto const runstart = p + (hp - header) + 5;
+        auto rp = runstart;
+        int32_t count = 0;
+
+        do
+        {
+            int32_t const ofs = block * NETDELTA_BLOCK;
+
+            *rp++ = mask;
+            *rp++ = mask >> 8;
+
+            for (uint32_t m = mask, i = 0; m; m >>= 1, i++)
+                if (m & 1)
+                    *rp++ = dst[ofs + i];
+
+            count++;
+
+            if (++block == numblocks)
+                break;
+
+            int32_t const nofs = block * NETDELTA_BLOCK;
+            mask = block < fullblocks ? netDeltaCompareBlock(src + nofs, dst + nofs) : netDeltaCompareTail(src + nofs, dst + nofs, size - nofs);
+        }
+        while (mask);
+
+        hp = netDeltaPutVarint(hp, count);
+
+        int32_t const headerlen = hp - header;
+        int32_t const runlen = rp - runstart;
+
+        Bmemcpy(p, header, headerlen);
+        Bmemmove(p + headerlen, runstart, runlen);
+        p += headerlen + runlen;
+
+        lastblock = block;
+    }
+
+    // terminator: no skip, no changed blocks
+    *p++ = 0;
+    *p++ = 0;
+
+    return p - out;
+}
+
+int32_t netDeltaApply(void *buf, int32_t size, uint8_t const *delta, int32_t deltasize)
+{
+    auto const dst = (uint8_t *)buf;
+    auto p = delta;
+    auto const end = delta + deltasize;
+
+    int32_t const numblocks = (size + NETDELTA_BLOCK - 1) / NETDELTA_BLOCK;
+    int32_t block = 0;
+
+    while (1)
+    {
+        uint32_t skip, count;
+
+        if ((p = netDeltaGetVarint(p, end, &skip)) == nullptr || (p = netDeltaGetVarint(p, end, &count)) == nullptr)
+            return -1;
+
+        if (count == 0)
+            return p - delta;
+
+        if (skip > (uint32_t)(numblocks - block) || count > (uint32_t)(numblocks - block) - skip)
+            return -1;
+
+        block += skip;
+
+        for (; count > 0; count--, block++)
+        {
+            if (end - p < 2)
+                return -1;
+
+            uint32_t const mask = p[0] | (p[1] << 8);
+            p += 2;
+
+            int32_t const ofs = block * NETDELTA_BLOCK;
+            int32_t const len = min(size - ofs, NETDELTA_BLOCK);
+
+            if (mask >> len)
+                return -1;
+
+            for (uint32_t m = mask, i = 0; m; m >>= 1, i++)
+            {
+                if (m & 1)
+                {
+                    if (p == end)
+                        return -1;
+
+                    dst[ofs + i] = *p++;
+                }
+            }
+        }
+    }
+}
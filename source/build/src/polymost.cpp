@@ -20,6 +20,10 @@ Ken Silverman's official web site: http://www.advsys.net/ken
 #include "colmatch.h"
 #include "texcache.h"
 #include "hash.h"
+#include "libasync_config.h"
+#include "timer.h"
+
+#include <algorithm>
 
 #ifdef POLYMOST2
 int32_t r_enablepolymost2 = 0;
@@ -44,6 +48,7 @@ int32_t r_polygonmode;     // 0:GL_FILL,1:GL_LINE,2:GL_POINT //FUK
 int32_t r_polymostDebug;
 int32_t r_shadeinterpolate = 1;
 int32_t r_skyzbufferhack;
+int32_t r_texprefetch = 1;
 int32_t r_useindexedcolortextures = 1;
 int32_t r_usenewshading = 4;
 int32_t r_usesamplerobjects = 1;
@@ -2326,6 +2331,296 @@ void gloadtile_art(int32_t dapic, int32_t dapal, int32_t tintpalnum, int32_t das
     }
 }
 
+// Hightile replacements decoded ahead of the GL uploads of a precache loop.
+// polymost_prefetch() queues what polymost_precache() is going to ask for, and
+// polymost_prefetchnext() keeps the files of the tiles just ahead of the loop
+// read (on the calling thread) and decoding (on the worker pool). Each decoded
+// picture is handed to the first gloadtruecolortile_mdloadskin_shared() call
+// that asks for it, which waits for the decode if it hasn't finished yet.
+#define HIPREFETCH_MAXBYTES (256 << 20)  // decoded pictures in flight
+#define HIPREFETCH_MAXAHEAD 64           // files read ahead of the loop
+
+enum
+{
+    HIPREFETCH_QUEUED,
+    HIPREFETCH_DECODING,
+    HIPREFETCH_DONE,  // taken, released, or nothing to decode
+};
+
+typedef struct
+{
+    char const *fn;
+    int32_t   tilenum, dapalnum, dameth;
+    polytintflags_t effect;
+
+    char     *filebuf;
+    int32_t   filelen;
+    vec2_t    tsiz, siz;
+    coltype  *pic;
+    async::task<void> *task;
+    int32_t   state;
+} hiprefetch_t;
+
+static hashtable_t h_hiprefetch = { 1024, NULL };
+static hiprefetch_t *hiprefetch;
+static int32_t hiprefetchnum, hiprefetchalloc;
+static int32_t hiprefetchnext, hiprefetchpending, hiprefetchdecoded;
+static size_t hiprefetchbytes;
+static uint64_t hiprefetchwaitticks;
+
+static inline size_t hiprefetch_bytes(hiprefetch_t const &p) { return (size_t)p.siz.x * p.siz.y * sizeof(coltype); }
+
+static void hiprefetch_wait(hiprefetch_t &p)
+{
+    if (p.task == nullptr)
+        return;
+
+    uint64_t const t = timerGetNanoTicks();
+    p.task->get();
+    hiprefetchwaitticks += timerGetNanoTicks() - t;
+
+    delete p.task;
+    p.task = nullptr;
+}
+
+// drops a queued or decoded entry nobody is going to ask for
+static void hiprefetch_release(hiprefetch_t &p)
+{
+    if (p.state == HIPREFETCH_DECODING)
+    {
+        hiprefetch_wait(p);
+        hiprefetchbytes -= hiprefetch_bytes(p);
+        hiprefetchpending--;
+    }
+
+    DO_FREE_AND_NULL(p.pic);
+    DO_FREE_AND_NULL(p.filebuf);
+    p.state = HIPREFETCH_DONE;
+}
+
+static coltype *hiprefetch_take(char const *fn, vec2_t *tsiz, vec2_t *siz)
+{
+    if (!hiprefetchnum)
+        return nullptr;
+
+    int32_t const i = hash_find(&h_hiprefetch, fn);
+
+    if (i < 0)
+        return nullptr;
+
+    hiprefetch_t &p = hiprefetch[i];
+
+    if (p.state != HIPREFETCH_DECODING)
+    {
+        // never read ahead: the regular path loads it
+        p.state = HIPREFETCH_DONE;
+        return nullptr;
+    }
+
+    hiprefetch_wait(p);
+
+    coltype *pic = p.pic;
+    p.pic = nullptr;
+
+    *tsiz = p.tsiz;
+    *siz  = p.siz;
+
+    hiprefetch_release(p);
+    return pic;
+}
+
+static void hiprefetch_add(char const *fn, int32_t tilenum, int32_t dapalnum, int32_t dameth, polytintflags_t effect)
+{
+    if (hash_find(&h_hiprefetch, fn) >= 0)
+        return;
+
+    if (hiprefetchnum >= hiprefetchalloc)
+    {
+        hiprefetchalloc = max(hiprefetchalloc << 1, 256);
+        hiprefetch = (hiprefetch_t *)Xrealloc(hiprefetch, hiprefetchalloc * sizeof(hiprefetch_t));
+    }
+
+    hiprefetch[hiprefetchnum] = { fn, tilenum, dapalnum, dameth, effect, nullptr, 0, { 0, 0 }, { 0, 0 }, nullptr, nullptr, HIPREFETCH_QUEUED };
+    hash_add(&h_hiprefetch, fn, hiprefetchnum++, 0);
+}
+
+// the I/O stage: runs on the precache loop's thread, then hands the file to a worker to decode
+static void hiprefetch_issue(int32_t const i)
+{
+    hiprefetch_t &p = hiprefetch[i];
+
+    p.state = HIPREFETCH_DONE;
+
+    buildvfs_kfd filh = kopen4load(p.fn, 0);
+    if (filh == buildvfs_kfd_invalid)
+        return;
+
+    int32_t const filelen = kfilelength(filh);
+
+    // already in the texture cache: gloadtile_hi() won't decode it
+    texcacheheader cachead;
+    char texcacheid[BMAX_PATH];
+    texcache_calcid(texcacheid, p.fn, filelen+(p.dapalnum<<8), DAMETH_NARROW_MASKPROPS(p.dameth), p.effect & HICTINT_IN_MEMORY);
+
+    if (filelen <= 0 || texcache_readtexheader(texcacheid, &cachead, 0))
+    {
+        kclose(filh);
+        return;
+    }
+
+    auto filebuf = (char *)Xmalloc(filelen);
+    int32_t const readlen = kread(filh, filebuf, filelen);
+    kclose(filh);
+
+    vec2_t tsiz = { 0, 0 }, siz;
+
+    if (readlen == filelen)
+        kpgetdim(filebuf, filelen, &tsiz.x, &tsiz.y);
+
+    // ART-format replacements are cheap to convert and are left to the regular path
+    if (tsiz.x <= 0 || tsiz.y <= 0)
+    {
+        Xfree(filebuf);
+        return;
+    }
+
+    if (!glinfo.texnpot)
+    {
+        for (siz.x = 1; siz.x < tsiz.x; siz.x += siz.x) {}
+        for (siz.y = 1; siz.y < tsiz.y; siz.y += siz.y) {}
+    }
+    else
+        siz = tsiz;
+
+    p.filebuf = filebuf;
+    p.filelen = filelen;
+    p.tsiz    = tsiz;
+    p.siz     = siz;
+    p.state   = HIPREFETCH_DECODING;
+
+    hiprefetchbytes += hiprefetch_bytes(p);
+    hiprefetchpending++;
+    hiprefetchdecoded++;
+
+    // the array doesn't move once the loop has started, but look the entry up by index anyway
+    p.task = new async::task<void>(async::spawn([i]() {
+        hiprefetch_t &p = hiprefetch[i];
+        int32_t const bytesperline = p.siz.x * sizeof(coltype);
+
+        p.pic = (coltype *)Xcalloc(p.siz.y, bytesperline);
+
+        if (kprender(p.filebuf, p.filelen, (intptr_t)p.pic, bytesperline, p.siz.x, p.siz.y))
+            DO_FREE_AND_NULL(p.pic);
+
+        DO_FREE_AND_NULL(p.filebuf);
+    }));
+}
+
+// the palettes the games' precache loops pass to polymost_precache()
+static bool hiprefetch_wantpal(int32_t dapalnum)
+{
+    if (dapalnum < MAXPALOOKUPS - RESERVEDPALS - 1)
+        return palookup[dapalnum] != NULL;
+#ifdef USE_GLEXT
+    return (dapalnum == DETAILPAL && r_detailmapping) || (dapalnum == GLOWPAL && r_glowmapping);
+#else
+    return false;
+#endif
+}
+
+void polymost_prefetch(uint8_t const *tilemap, int32_t datype)
+{
+#ifdef WITHKPLIB
+    // the queue is fixed once polymost_prefetchnext() has started on it
+    if (!usehightile || !r_texprefetch || hiprefetchnext > 0)
+        return;
+
+    if (!h_hiprefetch.items)
+        hash_init(&h_hiprefetch);
+
+    int32_t const dameth = (datype & 1)*(DAMETH_CLAMPED|DAMETH_MASK);
+
+    // mirror what polymost_precache() will ask texcache_fetch() for
+    for (int i = 0; i < MAXTILES; i++)
+    {
+        if (!bitmap_test(tilemap, i) || !hicreplc[i])
+            continue;
+
+        for (int j = 0; j < MAXPALOOKUPS; j++)
+        {
+            if (!hiprefetch_wantpal(j))
+                continue;
+
+            polytintflags_t const tintflags = hictinting[j].f;
+            hicreplctyp const *si = hicfindsubst(i, j, tintflags & HICTINT_ALWAYSUSEART);
+
+            if (!si || !si->filename)
+                continue;
+
+            int32_t const checktintpal = (tintflags & HICTINT_APPLYOVERALTPAL) ? 0 : si->palnum;
+            hiprefetch_add(si->filename, i, j, dameth, (checktintpal > 0) ? 0 : tintflags);
+        }
+    }
+#else
+    UNREFERENCED_PARAMETER(tilemap);
+    UNREFERENCED_PARAMETER(datype);
+#endif
+}
+
+void polymost_prefetchnext(int32_t dapicnum)
+{
+    if (hiprefetchnext >= hiprefetchnum)
+        return;
+
+    if (hiprefetchnext == 0)
+    {
+        // both datypes were queued one after the other; the loops go tile by tile
+        std::stable_sort(hiprefetch, hiprefetch + hiprefetchnum,
+                         [](hiprefetch_t const &a, hiprefetch_t const &b) { return a.tilenum < b.tilenum; });
+
+        hash_free(&h_hiprefetch);
+        hash_init(&h_hiprefetch);
+
+        for (int i = 0; i < hiprefetchnum; i++)
+            hash_add(&h_hiprefetch, hiprefetch[i].fn, i, 0);
+    }
+
+    // whatever the loop has gone past without asking for won't be asked for
+    for (int i = 0; i < hiprefetchnext && hiprefetch[i].tilenum < dapicnum; i++)
+        if (hiprefetch[i].state != HIPREFETCH_DONE)
+            hiprefetch_release(hiprefetch[i]);
+
+    for (; hiprefetchnext < hiprefetchnum; hiprefetchnext++)
+    {
+        hiprefetch_t const &p = hiprefetch[hiprefetchnext];
+
+        if (p.tilenum > dapicnum && (hiprefetchpending >= HIPREFETCH_MAXAHEAD || hiprefetchbytes >= HIPREFETCH_MAXBYTES))
+            break;
+
+        if (p.state == HIPREFETCH_QUEUED)
+            hiprefetch_issue(hiprefetchnext);
+    }
+}
+
+void polymost_prefetchfree(void)
+{
+    for (int i = 0; i < hiprefetchnum; i++)
+        hiprefetch_release(hiprefetch[i]);
+
+    if (hiprefetchdecoded)
+        LOG_F(INFO, "Decoded %d hightile replacements ahead of upload, %.2f ms spent waiting for them.", hiprefetchdecoded,
+              (double)hiprefetchwaitticks * 1000.0 / (double)timerGetNanoTickRate());
+
+    DO_FREE_AND_NULL(hiprefetch);
+    hiprefetchnum = hiprefetchalloc = 0;
+    hiprefetchnext = hiprefetchpending = hiprefetchdecoded = 0;
+    hiprefetchbytes = 0;
+    hiprefetchwaitticks = 0;
+
+    if (h_hiprefetch.items)
+        hash_free(&h_hiprefetch);
+}
+
 int gloadtile_willprint;
 
 static bool gloadtile_mdloadskin_check(char *fn, int32_t picfillen, vec2_t *const tsiz, vec2_t *const siz, int *isart)
@@ -2419,18 +2714,21 @@ uint8_t *gloadindexedtile_mdloadskin_shared(char *fn, int32_t picfillen, vec2_t
 coltype *gloadtruecolortile_mdloadskin_shared(char *fn, int32_t picfillen, vec2_t *const tsiz, vec2_t *const siz, char *const onebitalpha, polytintflags_t effect,
                                              int32_t dapalnum, char *const al)
 {
-    int32_t isart;
-    if (!gloadtile_mdloadskin_check(fn, picfillen, tsiz, siz, &isart))
+    // a prefetched picture comes with its dimensions, so the file doesn't need loading again
+    coltype *prefetched = hiprefetch_take(fn, tsiz, siz);
+    int32_t isart = 0;
+
+    if (!prefetched && !gloadtile_mdloadskin_check(fn, picfillen, tsiz, siz, &isart))
         return nullptr;
 
     int32_t const bytesperline = siz->x * sizeof(coltype);
-    coltype* pic = (coltype*)Xcalloc(siz->y, bytesperline);
+    coltype* pic = prefetched ? prefetched : (coltype*)Xcalloc(siz->y, bytesperline);
 
     static coltype* lastpic = NULL;
     static char* lastfn = NULL;
     static int32_t lastsize = 0;
 
-    if (lastpic && lastfn && !Bstrcmp(lastfn, fn))
+    if (!prefetched && lastpic && lastfn && !Bstrcmp(lastfn, fn))
     {
         gloadtile_willprint = 1;
         Bmemcpy(pic, lastpic, siz->x * siz->y * sizeof(coltype));
@@ -2442,7 +2740,7 @@ coltype *gloadtruecolortile_mdloadskin_shared(char *fn, int32_t picfillen, vec2_
             artConvertRGB((palette_t*)pic, (uint8_t*)&kpzbuf[ARTv1_UNITOFFSET], siz->x, tsiz->x, tsiz->y);
         }
 #ifdef WITHKPLIB
-        else
+        else if (!prefetched)
         {
             if (kprender(kpzbuf, picfillen, (intptr_t)pic, bytesperline, siz->x, siz->y))
             {
@@ -10092,6 +10390,7 @@ void polymost_initosdfuncs(void)
         { "r_spritedepth","depth offset for sprites",(void*)&r_spritedepth, CVAR_FLOAT|CVAR_NOSAVE, 1, 10 },
         { "r_spritedepthmul","depth offset multiplier for sprites",(void*)&r_spritedepthmul, CVAR_FLOAT|CVAR_NOSAVE, 0, 1 },
         { "r_texcompr","enable/disable OpenGL texture compression: 0: off  1: hightile only  2: ART and hightile",(void *) &glusetexcompr, CVAR_INT, 0, 2 },
+        { "r_texprefetch","enable/disable decoding hightile replacements on all cores while precaching",(void *) &r_texprefetch, CVAR_BOOL, 0, 1 },
         { "r_texturemaxsize","changes the maximum OpenGL texture size limit",(void *) &gltexmaxsize, CVAR_INT | CVAR_NOSAVE, 0, 4096 },
         { "r_texturemiplevel","changes the highest OpenGL mipmap level used",(void *) &gltexmiplevel, CVAR_INT, 0, 6 },
         { "r_useindexedcolortextures", "enable/disable indexed color texture rendering (disabled by r_texfilter, disables r_anisotropy)", (void *) &r_useindexedcolortextures, CVAR_BOOL|CVAR_RESTARTVID|CVAR_INVALIDATEART, 0, 1 },
@@ -15,6 +15,11 @@
 #include "vfs.h"
 #include "cache1d.h"
 
+#ifndef _WIN32
+# include <sys/mman.h>
+# include <sys/stat.h>
+#endif
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -45,7 +50,7 @@ char toupperlookup[256] =
 
 //Insert '|' in front of filename
 //Doing this tells kzopen to load the file only if inside a .ZIP file
-static intptr_t kzipopen(const char *filnam)
+static kzstream *kzipopen(const char *filnam)
 {
     uint32_t i;
     char newst[BMAX_PATH+8];
@@ -53,7 +58,7 @@ static intptr_t kzipopen(const char *filnam)
     newst[0] = '|';
     for (i=0; i < BMAX_PATH+4 && filnam[i]; i++) newst[i+1] = filnam[i];
     newst[i+1] = 0;
-    return kzopen(newst);
+    return kzsopen(newst);
 }
 
 #endif
@@ -98,6 +103,7 @@ int32_t numgroupfiles;
 void uninitgroupfile(void)
 {
     PHYSFS_deinit();
+    searchpathgeneration++;
 }
 
 #include <sys/stat.h>
@@ -129,6 +135,7 @@ typedef struct _searchpath
 static searchpath_t *searchpathhead = NULL;
 static size_t maxsearchpathlen = 0;
 int32_t pathsearchmode = 0;
+int32_t searchpathgeneration = 0;
 
 #ifndef USE_PHYSFS
 
@@ -186,6 +193,7 @@ int32_t addsearchpath_user(const char *p, int32_t user)
     Bcorrectfilename(srch->path,0);
 
     srch->user = user;
+    searchpathgeneration++;
 
     LOG_F(INFO, "Using directory %s", srch->path);
 
@@ -236,6 +244,7 @@ int32_t removesearchpath(const char *p)
 
             Xfree(srch->path);
             Xfree(srch);
+            searchpathgeneration++;
             break;
         }
     }
@@ -273,6 +282,7 @@ void removesearchpaths_withuser(int32_t usermask)
 
             Xfree(srch->path);
             Xfree(srch);
+            searchpathgeneration++;
         }
     }
 }
@@ -453,12 +463,83 @@ EDUKE32_STATIC_ASSERT(MAXGROUPFILES <= GRP_RESERVED_ID_START);
 int32_t numgroupfiles = 0;
 static int32_t gnumfiles[MAXGROUPFILES];
 static intptr_t groupfil[MAXGROUPFILES] = {-1,-1,-1,-1,-1,-1,-1,-1};
-static int32_t groupfilpos[MAXGROUPFILES];
 static uint8_t groupfilgrp[MAXGROUPFILES];
 static char *gfilelist[MAXGROUPFILES];
 static char *groupname[MAXGROUPFILES];
 static int32_t *gfileoffs[MAXGROUPFILES];
 
+// member reads go through the root group's mapping or pread, so the only position a group
+// needs is this cursor while initgroupfile() walks its directory
+static int32_t groupdirpos;
+
+// zips handed to initgroupfile(), which stay on the kplib stack for good
+static char **zipgroupname;
+static int32_t numzipgroups;
+
+// Whole-file private mapping. Pages are shared with the page cache until something writes to
+// them, at which point the OS gives the process its own copy; the file itself never changes.
+struct kmapping
+{
+    char *ptr;
+    size_t len;
+
+    bool is_mapped(void) const { return ptr != nullptr; }
+    char *data(void) const { return ptr; }
+    size_t size(void) const { return len; }
+
+    void map(intptr_t fd)
+    {
+#ifdef _WIN32
+        HANDLE const file = (HANDLE)_get_osfhandle(fd);
+        LARGE_INTEGER filesize;
+
+        if (file == INVALID_HANDLE_VALUE || !GetFileSizeEx(file, &filesize) || filesize.QuadPart <= 0)
+            return;
+
+        HANDLE const mapping = CreateFileMapping(file, NULL, PAGE_WRITECOPY, 0, 0, NULL);
+
+        if (!mapping)
+            return;
+
+        ptr = (char *)MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0);
+        CloseHandle(mapping);
+
+        if (ptr)
+            len = (size_t)filesize.QuadPart;
+#else
+        struct stat st;
+
+        if (fstat(fd, &st) || st.st_size <= 0)
+            return;
+
+        void *const p = mmap(NULL, st.st_size, PROT_READ|PROT_WRITE, MAP_PRIVATE, fd, 0);
+
+        if (p == MAP_FAILED)
+            return;
+
+        ptr = (char *)p;
+        len = st.st_size;
+#endif
+    }
+
+    void unmap(void)
+    {
+        if (!ptr)
+            return;
+#ifdef _WIN32
+        UnmapViewOfFile(ptr);
+#else
+        munmap(ptr, len);
+#endif
+        ptr = nullptr;
+        len = 0;
+    }
+};
+
+// Group files opened straight from the filesystem are mapped whole when possible. Member
+// reads then become copies out of the mapping, and kview() can hand out pointers into it.
+static kmapping groupfilmap[MAXGROUPFILES];
+
 static uint8_t filegrp[MAXOPENFILES];
 static int32_t filepos[MAXOPENFILES];
 static intptr_t filehan[MAXOPENFILES] =
@@ -470,9 +551,6 @@ static intptr_t filehan[MAXOPENFILES] =
 };
 
 #ifdef WITHKPLIB
-static char filenamsav[MAXOPENFILES][260];
-static int32_t kzcurhand = -1;
-
 int32_t cache1d_file_fromzip(buildvfs_kfd fil)
 {
     return (filegrp[fil] == GRP_ZIP);
@@ -484,6 +562,59 @@ static int32_t kread_grp(int32_t handle, void *buffer, int32_t leng);
 static int32_t klseek_grp(int32_t handle, int32_t offset, int32_t whence);
 static void kclose_grp(int32_t handle);
 
+// plain files mapped on demand by kview()
+static kmapping filemap[MAXOPENFILES];
+
+// Positional read that leaves the descriptor's file offset alone, so members of the same
+// group can be read through different handles, or from different threads, without seeking
+// a shared descriptor back and forth.
+static int32_t kpread(intptr_t fd, void *buffer, int32_t leng, int32_t offset)
+{
+#ifdef _WIN32
+    OVERLAPPED ov = {};
+    ov.Offset = offset;
+
+    DWORD nread;
+    if (!ReadFile((HANDLE)_get_osfhandle(fd), buffer, leng, &nread, &ov))
+        return GetLastError() == ERROR_HANDLE_EOF ? 0 : -1;
+
+    return nread;
+#else
+    return pread(fd, buffer, leng, offset);
+#endif
+}
+
+// Walks nested groups down to the one opened from the filesystem and returns the offset of
+// a member's data within that file.
+static int32_t kgroupoffset(int32_t groupnum, int32_t filenum, int32_t *rootgroupnum)
+{
+    int32_t i = gfileoffs[groupnum][filenum];
+
+    while (groupfilgrp[groupnum] != GRP_FILESYSTEM)
+    {
+        i += gfileoffs[groupfilgrp[groupnum]][groupfil[groupnum]];
+        groupnum = groupfilgrp[groupnum];
+    }
+
+    *rootgroupnum = groupnum;
+    return i;
+}
+
+static int32_t kaddgroup(const char *filename)
+{
+    if (groupfilgrp[numgroupfiles] == GRP_FILESYSTEM)
+    {
+        groupfilmap[numgroupfiles].map(groupfil[numgroupfiles]);
+
+        if (!groupfilmap[numgroupfiles].is_mapped())
+            LOG_F(WARNING, "Unable to map %s, falling back to reading it.", filename);
+    }
+
+    groupname[numgroupfiles] = Xstrdup(filename);
+    searchpathgeneration++;
+    return numgroupfiles++;
+}
+
 int initgroupfile(const char *filename)
 {
     char buf[70];
@@ -501,7 +632,7 @@ int initgroupfile(const char *filename)
 
     char *zfn = NULL;
 
-    if (kopen_internal(filename, &zfn, 0, 0, 0, numgroupfiles, groupfilgrp, groupfil, groupfilpos) < 0)
+    if (kopen_internal(filename, &zfn, 0, 0, 0, 0, &groupfilgrp[numgroupfiles], &groupfil[numgroupfiles], &groupdirpos) < 0)
         return -1;
 
 #ifdef WITHKPLIB
@@ -514,7 +645,10 @@ int initgroupfile(const char *filename)
             kclose_grp(numgroupfiles);
 
             kzaddstack(zfn);
-            Xfree(zfn);
+
+            zipgroupname = (char **)Xrealloc(zipgroupname, (numzipgroups + 1) * sizeof(char *));
+            zipgroupname[numzipgroups++] = zfn;
+            searchpathgeneration++;
             return MAXGROUPFILES;
         }
         klseek_grp(numgroupfiles,0,BSEEK_SET);
@@ -545,8 +679,7 @@ int initgroupfile(const char *filename)
             j += k;
         }
         gfileoffs[numgroupfiles][gnumfiles[numgroupfiles]] = j;
-        groupname[numgroupfiles] = Xstrdup(filename);
-        return numgroupfiles++;
+        return kaddgroup(filename);
     }
     klseek_grp(numgroupfiles, 0, BSEEK_SET);
 
@@ -648,8 +781,7 @@ int initgroupfile(const char *filename)
             klseek_grp(numgroupfiles, 104, BSEEK_CUR);
         }
         gfileoffs[numgroupfiles][gnumfiles[numgroupfiles]] = j;
-        groupname[numgroupfiles] = Xstrdup(filename);
-        return numgroupfiles++;
+        return kaddgroup(filename);
     }
 
     kclose_grp(numgroupfiles);
@@ -667,10 +799,12 @@ void uninitgroupfile(void)
             DO_FREE_AND_NULL(gfileoffs[i]);
             DO_FREE_AND_NULL(groupname[i]);
 
+            groupfilmap[i].unmap();
             Bclose(groupfil[i]);
             groupfil[i] = -1;
         }
     numgroupfiles = 0;
+    searchpathgeneration++;
 
     // JBF 20040111: "close" any files open in groups
     for (i=0; i<MAXOPENFILES; i++)
@@ -775,20 +909,12 @@ static int32_t kopen_internal(const char *filename, char **lastpfn, char searchf
 #ifdef WITHKPLIB
     if (tryzip)
     {
-        intptr_t i;
-        if ((kzcurhand != newhandle) && (kztell() >= 0))
+        kzstream *zs;
+        if (searchfirst != 1 && (zs = kzipopen(filename)) != nullptr)
         {
-            if (kzcurhand >= 0) arraypos[kzcurhand] = kztell();
-            kzclose();
-            kzcurhand = -1;
-        }
-        if (searchfirst != 1 && (i = kzipopen(filename)) != 0)
-        {
-            kzcurhand = newhandle;
             arraygrp[newhandle] = GRP_ZIP;
-            arrayhan[newhandle] = i;
+            arrayhan[newhandle] = (intptr_t)zs;
             arraypos[newhandle] = 0;
-            strcpy(filenamsav[newhandle],filename);
             return newhandle;
         }
     }
@@ -832,6 +958,16 @@ void krename(int32_t crcval, int32_t filenum, const char *newname)
     Bstrncpy((char *)&gfilelist[crcval][filenum<<4], newname, 12);
 }
 
+char const *kgroupfilename(int32_t i)
+{
+    if ((unsigned)i < (unsigned)numgroupfiles)
+        return groupname[i] ? groupname[i] : "";
+
+    i -= numgroupfiles;
+
+    return (unsigned)i < (unsigned)numzipgroups ? zipgroupname[i] : NULL;
+}
+
 char const * kfileparent(int32_t const handle)
 {
     int32_t const groupnum = filegrp[handle];
@@ -892,40 +1028,31 @@ int32_t kread_internal(int32_t handle, void *buffer, int32_t leng, const uint8_t
     if (groupnum == GRP_FILESYSTEM) return Bread(filenum,buffer,leng);
 #ifdef WITHKPLIB
     else if (groupnum == GRP_ZIP)
-    {
-        if (kzcurhand != handle)
-        {
-            if (kztell() >= 0) { arraypos[kzcurhand] = kztell(); kzclose(); }
-            kzcurhand = handle;
-            kzipopen(filenamsav[handle]);
-            kzseek(arraypos[handle],SEEK_SET);
-        }
-        return kzread(buffer,leng);
-    }
+        return kzsread((kzstream *)arrayhan[handle],buffer,leng);
 #endif
 
     if (EDUKE32_PREDICT_FALSE(groupfil[groupnum] == -1))
         return 0;
 
-    int32_t rootgroupnum = groupnum;
-    int32_t i = 0;
-    while (groupfilgrp[rootgroupnum] != GRP_FILESYSTEM)
-    {
-        i += gfileoffs[groupfilgrp[rootgroupnum]][groupfil[rootgroupnum]];
-        rootgroupnum = groupfilgrp[rootgroupnum];
-    }
+    int32_t rootgroupnum;
+    int32_t const i = kgroupoffset(groupnum, filenum, &rootgroupnum) + arraypos[handle];
+
     if (EDUKE32_PREDICT_TRUE(groupfil[rootgroupnum] != -1))
     {
-        i += gfileoffs[groupnum][filenum]+arraypos[handle];
-        if (i != groupfilpos[rootgroupnum])
-        {
-            Blseek(groupfil[rootgroupnum],i,BSEEK_SET);
-            groupfilpos[rootgroupnum] = i;
-        }
         leng = min(leng,(gfileoffs[groupnum][filenum+1]-gfileoffs[groupnum][filenum])-arraypos[handle]);
-        leng = Bread(groupfil[rootgroupnum],buffer,leng);
-        arraypos[handle] += leng;
-        groupfilpos[rootgroupnum] += leng;
+        if (leng <= 0)
+            return 0;
+
+        auto const &map = groupfilmap[rootgroupnum];
+
+        if (map.is_mapped() && (size_t)i + leng <= map.size())
+            Bmemcpy(buffer, map.data() + i, leng);
+        else
+            leng = kpread(groupfil[rootgroupnum], buffer, leng, i);
+
+        if (leng > 0)
+            arraypos[handle] += leng;
+
         return leng;
     }
 
@@ -939,16 +1066,7 @@ int32_t klseek_internal(int32_t handle, int32_t offset, int32_t whence, const ui
     if (groupnum == GRP_FILESYSTEM) return Blseek(arrayhan[handle],offset,whence);
 #ifdef WITHKPLIB
     else if (groupnum == GRP_ZIP)
-    {
-        if (kzcurhand != handle)
-        {
-            if (kztell() >= 0) { arraypos[kzcurhand] = kztell(); kzclose(); }
-            kzcurhand = handle;
-            kzipopen(filenamsav[handle]);
-            kzseek(arraypos[handle],SEEK_SET);
-        }
-        return kzseek(offset,whence);
-    }
+        return kzsseek((kzstream *)arrayhan[handle],offset,whence);
 #endif
 
     if (groupfil[groupnum] != -1)
@@ -973,6 +1091,8 @@ int32_t klseek_internal(int32_t handle, int32_t offset, int32_t whence, const ui
 
 int32_t kfilelength_internal(int32_t handle, const uint8_t *arraygrp, intptr_t *arrayhan, int32_t *arraypos)
 {
+    UNREFERENCED_PARAMETER(arraypos);
+
     int32_t const groupnum = arraygrp[handle];
     if (groupnum == GRP_FILESYSTEM)
     {
@@ -980,16 +1100,7 @@ int32_t kfilelength_internal(int32_t handle, const uint8_t *arraygrp, intptr_t *
     }
 #ifdef WITHKPLIB
     else if (groupnum == GRP_ZIP)
-    {
-        if (kzcurhand != handle)
-        {
-            if (kztell() >= 0) { arraypos[kzcurhand] = kztell(); kzclose(); }
-            kzcurhand = handle;
-            kzipopen(filenamsav[handle]);
-            kzseek(arraypos[handle],SEEK_SET);
-        }
-        return kzfilelength();
-    }
+        return kzsfilelength((kzstream *)arrayhan[handle]);
 #endif
     int32_t const i = arrayhan[handle];
     return gfileoffs[groupnum][i+1]-gfileoffs[groupnum][i];
@@ -1002,16 +1113,7 @@ int32_t ktell_internal(int32_t handle, const uint8_t *arraygrp, intptr_t *arrayh
     if (groupnum == GRP_FILESYSTEM) return Blseek(arrayhan[handle],0,BSEEK_CUR);
 #ifdef WITHKPLIB
     else if (groupnum == GRP_ZIP)
-    {
-        if (kzcurhand != handle)
-        {
-            if (kztell() >= 0) { arraypos[kzcurhand] = kztell(); kzclose(); }
-            kzcurhand = handle;
-            kzipopen(filenamsav[handle]);
-            kzseek(arraypos[handle],SEEK_SET);
-        }
-        return kztell();
-    }
+        return kzstell((kzstream *)arrayhan[handle]);
 #endif
     if (groupfil[groupnum] != -1)
         return arraypos[handle];
@@ -1024,10 +1126,7 @@ void kclose_internal(int32_t handle, const uint8_t *arraygrp, intptr_t *arrayhan
     if (arraygrp[handle] == GRP_FILESYSTEM) Bclose(arrayhan[handle]);
 #ifdef WITHKPLIB
     else if (arraygrp[handle] == GRP_ZIP)
-    {
-        kzclose();
-        kzcurhand = -1;
-    }
+        kzsclose((kzstream *)arrayhan[handle]);
 #endif
     arrayhan[handle] = -1;
 }
@@ -1050,16 +1149,57 @@ int32_t ktell(int32_t handle)
 }
 void kclose(int32_t handle)
 {
+    if (handle >= 0)
+        filemap[handle].unmap();
+
     return kclose_internal(handle, filegrp, filehan);
 }
 
+void *kview(int32_t handle, int32_t offset, int32_t leng)
+{
+    if ((unsigned)handle >= MAXOPENFILES || filehan[handle] == -1 || offset < 0 || leng < 0)
+        return nullptr;
+
+    int32_t const groupnum = filegrp[handle];
+
+    if (groupnum == GRP_FILESYSTEM)
+    {
+        auto &map = filemap[handle];
+
+        if (!map.is_mapped())
+            map.map(filehan[handle]);
+
+        if (!map.is_mapped() || (size_t)offset + leng > map.size())
+            return nullptr;
+
+        return map.data() + offset;
+    }
+
+    if (groupnum >= MAXGROUPFILES || groupfil[groupnum] == -1)
+        return nullptr;
+
+    int32_t const filenum = filehan[handle];
+
+    if (offset + leng > gfileoffs[groupnum][filenum+1]-gfileoffs[groupnum][filenum])
+        return nullptr;
+
+    int32_t rootgroupnum;
+    int32_t const i = kgroupoffset(groupnum, filenum, &rootgroupnum) + offset;
+    auto const &map = groupfilmap[rootgroupnum];
+
+    if (!map.is_mapped() || (size_t)i + leng > map.size())
+        return nullptr;
+
+    return map.data() + i;
+}
+
 static int32_t kread_grp(int32_t handle, void *buffer, int32_t leng)
 {
-    return kread_internal(handle, buffer, leng, groupfilgrp, groupfil, groupfilpos);
+    return kread_internal(0, buffer, leng, &groupfilgrp[handle], &groupfil[handle], &groupdirpos);
 }
 static int32_t klseek_grp(int32_t handle, int32_t offset, int32_t whence)
 {
-    return klseek_internal(handle, offset, whence, groupfilgrp, groupfil, groupfilpos);
+    return klseek_internal(0, offset, whence, &groupfilgrp[handle], &groupfil[handle], &groupdirpos);
 }
 static void kclose_grp(int32_t handle)
 {
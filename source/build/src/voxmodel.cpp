@@ -10,29 +10,53 @@
 #include "glad/glad.h"
 #include "hightile.h"
 #include "kplib.h"
+#include "libasync_config.h"
+#include "lz4.h"
 #include "mdsprite.h"
 #include "palette.h"
 #include "polymost.h"
 #include "pragmas.h"
 #include "texcache.h"
 #include "vfs.h"
+#include "xxhash.h"
 
-//For loading/conversion only
-static vec3_t voxsiz;
-static int32_t yzsiz, *vbit = 0; //vbit: 1 bit per voxel: 0=air,1=solid
-static vec3f_t voxpiv;
-
-static int32_t *vcolhashead = 0, vcolhashsizm1;
+//For loading/conversion only. Every voxel being meshed has its own, so several
+//can be meshed at once on the worker pool.
 typedef struct { int32_t p, c, n; } voxcol_t;
-static voxcol_t *vcol = 0; int32_t vnum = 0, vmax = 0;
 
-static vec2_u16_t *shp;
-static int32_t *shcntmal, *shcnt = 0, shcntp;
+typedef struct
+{
+    vec3_t voxsiz;
+    int32_t yzsiz, *vbit; //vbit: 1 bit per voxel: 0=air,1=solid
+    vec3f_t voxpiv;
+
+    int32_t *vcolhashead, vcolhashsizm1;
+    voxcol_t *vcol;
+    int32_t vnum, vmax;
+
+    vec2_u16_t *shp;
+    int32_t *shcntmal, *shcnt, shcntp;
 
-static int32_t mytexo5, *zbit, gmaxx, gmaxy, garea, pow2m1[33];
-static voxmodel_t *gvox;
-static voxrect_t *gquad;
-static int32_t gqfacind[7];
+    int32_t mytexo5, *zbit, gmaxx, gmaxy, garea;
+    voxmodel_t *gvox;
+    voxrect_t *gquad;
+    int32_t gqfacind[7];
+
+    uint32_t randseed; //rand() for the atlas packing isn't safe on the workers
+} voxconv_t;
+
+static int32_t const pow2m1[33] =
+{
+    0x0, 0x1, 0x3, 0x7, 0xf, 0x1f, 0x3f, 0x7f, 0xff, 0x1ff, 0x3ff, 0x7ff, 0xfff, 0x1fff, 0x3fff, 0x7fff,
+    0xffff, 0x1ffff, 0x3ffff, 0x7ffff, 0xfffff, 0x1fffff, 0x3fffff, 0x7fffff, 0xffffff, 0x1ffffff, 0x3ffffff,
+    0x7ffffff, 0xfffffff, 0x1fffffff, 0x3fffffff, 0x7fffffff, -1
+};
+
+static inline int32_t voxrand(voxconv_t *vc)
+{
+    vc->randseed = vc->randseed * 214013 + 2531011;
+    return (vc->randseed >> 16) & 32767;
+}
 
 
 //pitch must equal xsiz*4
@@ -119,30 +143,30 @@ uint32_t gloadtex(const int32_t *picbuf, int32_t xsiz, int32_t ysiz, int32_t is8
     return rtexid;
 }
 
-static int32_t getvox(int32_t x, int32_t y, int32_t z)
+static int32_t getvox(voxconv_t const *vc, int32_t x, int32_t y, int32_t z)
 {
-    z += x*yzsiz + y*voxsiz.z;
+    z += x*vc->yzsiz + y*vc->voxsiz.z;
 
-    for (x=vcolhashead[(z*214013LL)&vcolhashsizm1]; x>=0; x=vcol[x].n)
-        if (vcol[x].p == z)
-            return vcol[x].c;
+    for (x=vc->vcolhashead[(z*214013LL)&vc->vcolhashsizm1]; x>=0; x=vc->vcol[x].n)
+        if (vc->vcol[x].p == z)
+            return vc->vcol[x].c;
 
     return 0x808080;
 }
 
-static void putvox(int32_t x, int32_t y, int32_t z, int32_t col)
+static void putvox(voxconv_t *vc, int32_t x, int32_t y, int32_t z, int32_t col)
 {
-    if (vnum >= vmax)
+    if (vc->vnum >= vc->vmax)
     {
-        vmax = max(vmax<<1, 4096);
-        vcol = (voxcol_t *)Xrealloc(vcol, vmax*sizeof(voxcol_t));
+        vc->vmax = max(vc->vmax<<1, 4096);
+        vc->vcol = (voxcol_t *)Xrealloc(vc->vcol, vc->vmax*sizeof(voxcol_t));
     }
 
-    z += x*yzsiz + y*voxsiz.z;
+    z += x*vc->yzsiz + y*vc->voxsiz.z;
 
-    vcol[vnum].p = z; z = (z*214013LL)&vcolhashsizm1;
-    vcol[vnum].c = col;
-    vcol[vnum].n = vcolhashead[z]; vcolhashead[z] = vnum++;
+    vc->vcol[vc->vnum].p = z; z = (z*214013LL)&vc->vcolhashsizm1;
+    vc->vcol[vc->vnum].c = col;
+    vc->vcol[vc->vnum].n = vc->vcolhashead[z]; vc->vcolhashead[z] = vc->vnum++;
 }
 
 //Set all bits in vbit from (x,y,z0) to (x,y,z1-1) to 0's
@@ -170,9 +194,9 @@ static void setzrange1(int32_t *lptr, int32_t z0, int32_t z1)
     lptr[z] |= m1;
 }
 
-static bool isrectfree(int32_t x0, int32_t y0, int32_t dx, int32_t dy)
+static bool isrectfree(voxconv_t const *vc, int32_t x0, int32_t y0, int32_t dx, int32_t dy)
 {
-    int32_t i = y0*mytexo5 + (x0>>5);
+    int32_t i = y0*vc->mytexo5 + (x0>>5);
     dx += x0-1;
     const int32_t c = (dx>>5) - (x0>>5);
 
@@ -181,32 +205,32 @@ static bool isrectfree(int32_t x0, int32_t y0, int32_t dx, int32_t dy)
 
     if (!c)
     {
-        for (m &= m1; dy; dy--, i += mytexo5)
-            if (zbit[i]&m)
+        for (m &= m1; dy; dy--, i += vc->mytexo5)
+            if (vc->zbit[i]&m)
                 return 0;
     }
     else
     {
-        for (; dy; dy--, i += mytexo5)
+        for (; dy; dy--, i += vc->mytexo5)
         {
-            if (zbit[i]&m)
+            if (vc->zbit[i]&m)
                 return 0;
 
             int32_t x;
             for (x=1; x<c; x++)
-                if (zbit[i+x])
+                if (vc->zbit[i+x])
                     return 0;
 
-            if (zbit[i+x]&m1)
+            if (vc->zbit[i+x]&m1)
                 return 0;
         }
     }
     return 1;
 }
 
-static void setrect(int32_t x0, int32_t y0, int32_t dx, int32_t dy)
+static void setrect(voxconv_t *vc, int32_t x0, int32_t y0, int32_t dx, int32_t dy)
 {
-    int32_t i = y0*mytexo5 + (x0>>5);
+    int32_t i = y0*vc->mytexo5 + (x0>>5);
     dx += x0-1;
     const int32_t c = (dx>>5) - (x0>>5);
 
@@ -215,25 +239,25 @@ static void setrect(int32_t x0, int32_t y0, int32_t dx, int32_t dy)
 
     if (!c)
     {
-        for (m &= m1; dy; dy--, i += mytexo5)
-            zbit[i] |= m;
+        for (m &= m1; dy; dy--, i += vc->mytexo5)
+            vc->zbit[i] |= m;
     }
     else
     {
-        for (; dy; dy--, i += mytexo5)
+        for (; dy; dy--, i += vc->mytexo5)
         {
-            zbit[i] |= m;
+            vc->zbit[i] |= m;
 
             int32_t x;
             for (x=1; x<c; x++)
-                zbit[i+x] = -1;
+                vc->zbit[i+x] = -1;
 
-            zbit[i+x] |= m1;
+            vc->zbit[i+x] |= m1;
         }
     }
 }
 
-static void cntquad(int32_t x0, int32_t y0, int32_t z0, int32_t x1, int32_t y1, int32_t z1,
+static void cntquad(voxconv_t *vc, int32_t x0, int32_t y0, int32_t z0, int32_t x1, int32_t y1, int32_t z1,
                     int32_t x2, int32_t y2, int32_t z2, int32_t face)
 {
     UNREFERENCED_PARAMETER(x1);
@@ -250,18 +274,19 @@ static void cntquad(int32_t x0, int32_t y0, int32_t z0, int32_t x1, int32_t y1,
 
     if (x < y) { z = x; x = y; y = z; }
 
-    shcnt[y*shcntp+x]++;
+    vc->shcnt[y*vc->shcntp+x]++;
 
-    if (x > gmaxx) gmaxx = x;
-    if (y > gmaxy) gmaxy = y;
+    if (x > vc->gmaxx) vc->gmaxx = x;
+    if (y > vc->gmaxy) vc->gmaxy = y;
 
-    garea += (x+(VOXBORDWIDTH<<1)) * (y+(VOXBORDWIDTH<<1));
-    gvox->qcnt++;
+    vc->garea += (x+(VOXBORDWIDTH<<1)) * (y+(VOXBORDWIDTH<<1));
+    vc->gvox->qcnt++;
 }
 
-static void addquad(int32_t x0, int32_t y0, int32_t z0, int32_t x1, int32_t y1, int32_t z1,
+static void addquad(voxconv_t *vc, int32_t x0, int32_t y0, int32_t z0, int32_t x1, int32_t y1, int32_t z1,
                     int32_t x2, int32_t y2, int32_t z2, int32_t face)
 {
+    voxmodel_t *const gvox = vc->gvox;
     int32_t i;
     int32_t x = labs(x2-x0), y = labs(y2-y0), z = labs(z2-z0);
 
@@ -271,9 +296,9 @@ static void addquad(int32_t x0, int32_t y0, int32_t z0, int32_t x1, int32_t y1,
 
     if (x < y) { z = x; x = y; y = z; i += 3; }
 
-    z = shcnt[y*shcntp+x]++;
-    int32_t *lptr = &gvox->mytex[(shp[z].y+VOXBORDWIDTH)*gvox->mytexx +
-                                 (shp[z].x+VOXBORDWIDTH)];
+    z = vc->shcnt[y*vc->shcntp+x]++;
+    int32_t *lptr = &gvox->mytex[(vc->shp[z].y+VOXBORDWIDTH)*gvox->mytexx +
+                                 (vc->shp[z].x+VOXBORDWIDTH)];
     int32_t nx = 0, ny = 0, nz = 0;
 
     switch (face)
@@ -323,14 +348,14 @@ static void addquad(int32_t x0, int32_t y0, int32_t z0, int32_t x1, int32_t y1,
                 break;
             }
 
-            lptr[xx] = getvox(nx, ny, nz);
+            lptr[xx] = getvox(vc, nx, ny, nz);
         }
 
     //Extend borders horizontally
     for (int xx=0; xx<VOXBORDWIDTH; xx++)
         for (int yy=VOXBORDWIDTH; yy<y+VOXBORDWIDTH; yy++)
         {
-            lptr = &gvox->mytex[(shp[z].y+yy)*gvox->mytexx + shp[z].x];
+            lptr = &gvox->mytex[(vc->shp[z].y+yy)*gvox->mytexx + vc->shp[z].x];
             lptr[xx] = lptr[VOXBORDWIDTH];
             lptr[xx+x+VOXBORDWIDTH] = lptr[x-1+VOXBORDWIDTH];
         }
@@ -338,15 +363,15 @@ static void addquad(int32_t x0, int32_t y0, int32_t z0, int32_t x1, int32_t y1,
     //Extend borders vertically
     for (int yy=0; yy<VOXBORDWIDTH; yy++)
     {
-        Bmemcpy(&gvox->mytex[(shp[z].y+yy)*gvox->mytexx + shp[z].x],
-                &gvox->mytex[(shp[z].y+VOXBORDWIDTH)*gvox->mytexx + shp[z].x],
+        Bmemcpy(&gvox->mytex[(vc->shp[z].y+yy)*gvox->mytexx + vc->shp[z].x],
+                &gvox->mytex[(vc->shp[z].y+VOXBORDWIDTH)*gvox->mytexx + vc->shp[z].x],
                 (x+(VOXBORDWIDTH<<1))<<2);
-        Bmemcpy(&gvox->mytex[(shp[z].y+y+yy+VOXBORDWIDTH)*gvox->mytexx + shp[z].x],
-                &gvox->mytex[(shp[z].y+y-1+VOXBORDWIDTH)*gvox->mytexx + shp[z].x],
+        Bmemcpy(&gvox->mytex[(vc->shp[z].y+y+yy+VOXBORDWIDTH)*gvox->mytexx + vc->shp[z].x],
+                &gvox->mytex[(vc->shp[z].y+y-1+VOXBORDWIDTH)*gvox->mytexx + vc->shp[z].x],
                 (x+(VOXBORDWIDTH<<1))<<2);
     }
 
-    voxrect_t *const qptr = &gquad[gvox->qcnt];
+    voxrect_t *const qptr = &vc->gquad[gvox->qcnt];
 
     qptr->v[0].x = x0; qptr->v[0].y = y0; qptr->v[0].z = z0;
     qptr->v[1].x = x1; qptr->v[1].y = y1; qptr->v[1].z = z1;
@@ -355,7 +380,7 @@ static void addquad(int32_t x0, int32_t y0, int32_t z0, int32_t x1, int32_t y1,
     constexpr vec2_u16_t vbw = { VOXBORDWIDTH, VOXBORDWIDTH };
 
     for (int j=0; j<3; j++)
-        qptr->v[j].uv = shp[z]+vbw;
+        qptr->v[j].uv = vc->shp[z]+vbw;
 
     if (i < 3)
         qptr->v[1].u += x;
@@ -368,25 +393,25 @@ static void addquad(int32_t x0, int32_t y0, int32_t z0, int32_t x1, int32_t y1,
     qptr->v[3].uv  = qptr->v[0].uv  - qptr->v[1].uv  + qptr->v[2].uv;
     qptr->v[3].xyz = qptr->v[0].xyz - qptr->v[1].xyz + qptr->v[2].xyz;
 
-    if (gqfacind[face] < 0)
-        gqfacind[face] = gvox->qcnt;
+    if (vc->gqfacind[face] < 0)
+        vc->gqfacind[face] = gvox->qcnt;
 
     gvox->qcnt++;
 }
 
-static inline int32_t isolid(int32_t x, int32_t y, int32_t z)
+static inline int32_t isolid(voxconv_t const *vc, int32_t x, int32_t y, int32_t z)
 {
-    if (((uint32_t)x >= (uint32_t)voxsiz.x) | ((uint32_t)y >= (uint32_t)voxsiz.y) | ((uint32_t)z >= (uint32_t)voxsiz.z))
+    if (((uint32_t)x >= (uint32_t)vc->voxsiz.x) | ((uint32_t)y >= (uint32_t)vc->voxsiz.y) | ((uint32_t)z >= (uint32_t)vc->voxsiz.z))
         return 0;
 
-    z += x*yzsiz + y*voxsiz.z;
+    z += x*vc->yzsiz + y*vc->voxsiz.z;
 
-    return (vbit[z>>5] & (1<<SHIFTMOD32(z))) != 0;
+    return (vc->vbit[z>>5] & (1<<SHIFTMOD32(z))) != 0;
 }
 
-static FORCE_INLINE int isair(int const i)
+static FORCE_INLINE int isair(voxconv_t const *vc, int const i)
 {
-    return !(vbit[i>>5] & (1<<SHIFTMOD32(i)));
+    return !(vc->vbit[i>>5] & (1<<SHIFTMOD32(i)));
 }
 
 #ifdef USE_GLEXT
@@ -418,12 +443,12 @@ void voxvbofree(voxmodel_t *vm)
 }
 #endif
 
-static voxmodel_t *vox2poly()
+static voxmodel_t *vox2poly(voxconv_t *vc)
 {
-    gvox = (voxmodel_t *)Xcalloc(1, sizeof(voxmodel_t));
+    voxmodel_t *const gvox = vc->gvox = (voxmodel_t *)Xcalloc(1, sizeof(voxmodel_t));
 
     //x is largest dimension, y is 2nd largest dimension
-    int32_t x = voxsiz.x, y = voxsiz.y, z = voxsiz.z;
+    int32_t x = vc->voxsiz.x, y = vc->voxsiz.y, z = vc->voxsiz.z;
 
     if (x < y && x < z)
         x = z;
@@ -437,26 +462,19 @@ static voxmodel_t *vox2poly()
         y = z;
     }
 
-    shcntp = x;
+    vc->shcntp = x;
     int32_t i = x*y*sizeof(int32_t);
 
-    shcntmal = (int32_t *)Xmalloc(i);
-    memset(shcntmal, 0, i);
-    shcnt = &shcntmal[-shcntp-1];
+    vc->shcntmal = (int32_t *)Xmalloc(i);
+    memset(vc->shcntmal, 0, i);
+    vc->shcnt = &vc->shcntmal[-vc->shcntp-1];
 
-    gmaxx = gmaxy = garea = 0;
-
-    if (pow2m1[32] != -1)
-    {
-        for (i=0; i<32; i++)
-            pow2m1[i] = (1u<<i)-1;
-        pow2m1[32] = -1;
-    }
+    vc->gmaxx = vc->gmaxy = vc->garea = 0;
 
     for (i=0; i<7; i++)
-        gqfacind[i] = -1;
+        vc->gqfacind[i] = -1;
 
-    i = (max(voxsiz.y, voxsiz.z)+1)<<2;
+    i = (max(vc->voxsiz.y, vc->voxsiz.z)+1)<<2;
     int32_t *const bx0 = (int32_t *)Xmalloc(i<<1);
     int32_t *const by0 = (int32_t *)(((intptr_t)bx0)+i);
 
@@ -464,23 +482,23 @@ static voxmodel_t *vox2poly()
 
     for (int cnt=0; cnt<2; cnt++)
     {
-        void (*daquad)(int32_t, int32_t, int32_t, int32_t, int32_t, int32_t, int32_t, int32_t, int32_t, int32_t) =
+        void (*daquad)(voxconv_t *, int32_t, int32_t, int32_t, int32_t, int32_t, int32_t, int32_t, int32_t, int32_t, int32_t) =
             cnt == 0 ? cntquad : addquad;
 
         gvox->qcnt = 0;
 
-        memset(by0, -1, (max(voxsiz.y, voxsiz.z)+1)<<2);
+        memset(by0, -1, (max(vc->voxsiz.y, vc->voxsiz.z)+1)<<2);
         int32_t v = 0;
 
         for (i=-1; i<=1; i+=2)
-            for (int y=0; y<voxsiz.y; y++)
-                for (int x=0; x<=voxsiz.x; x++)
-                    for (int z=0; z<=voxsiz.z; z++)
+            for (int y=0; y<vc->voxsiz.y; y++)
+                for (int x=0; x<=vc->voxsiz.x; x++)
+                    for (int z=0; z<=vc->voxsiz.z; z++)
                     {
-                        ov = v; v = (isolid(x, y, z) && (!isolid(x, y+i, z)));
+                        ov = v; v = (isolid(vc, x, y, z) && (!isolid(vc, x, y+i, z)));
                         if ((by0[z] >= 0) && ((by0[z] != oz) || (v >= ov)))
                         {
-                            daquad(bx0[z], y, by0[z], x, y, by0[z], x, y, z, i>=0);
+                            daquad(vc, bx0[z], y, by0[z], x, y, by0[z], x, y, z, i>=0);
                             by0[z] = -1;
                         }
 
@@ -489,14 +507,14 @@ static voxmodel_t *vox2poly()
                     }
 
         for (i=-1; i<=1; i+=2)
-            for (int z=0; z<voxsiz.z; z++)
-                for (int x=0; x<=voxsiz.x; x++)
-                    for (int y=0; y<=voxsiz.y; y++)
+            for (int z=0; z<vc->voxsiz.z; z++)
+                for (int x=0; x<=vc->voxsiz.x; x++)
+                    for (int y=0; y<=vc->voxsiz.y; y++)
                     {
-                        ov = v; v = (isolid(x, y, z) && (!isolid(x, y, z-i)));
+                        ov = v; v = (isolid(vc, x, y, z) && (!isolid(vc, x, y, z-i)));
                         if ((by0[y] >= 0) && ((by0[y] != oz) || (v >= ov)))
                         {
-                            daquad(bx0[y], by0[y], z, x, by0[y], z, x, y, z, (i>=0)+2);
+                            daquad(vc, bx0[y], by0[y], z, x, by0[y], z, x, y, z, (i>=0)+2);
                             by0[y] = -1;
                         }
 
@@ -505,14 +523,14 @@ static voxmodel_t *vox2poly()
                     }
 
         for (i=-1; i<=1; i+=2)
-            for (int x=0; x<voxsiz.x; x++)
-                for (int y=0; y<=voxsiz.y; y++)
-                    for (int z=0; z<=voxsiz.z; z++)
+            for (int x=0; x<vc->voxsiz.x; x++)
+                for (int y=0; y<=vc->voxsiz.y; y++)
+                    for (int z=0; z<=vc->voxsiz.z; z++)
                     {
-                        ov = v; v = (isolid(x, y, z) && (!isolid(x-i, y, z)));
+                        ov = v; v = (isolid(vc, x, y, z) && (!isolid(vc, x-i, y, z)));
                         if ((by0[z] >= 0) && ((by0[z] != oz) || (v >= ov)))
                         {
-                            daquad(x, bx0[z], by0[z], x, y, by0[z], x, y, z, (i>=0)+4);
+                            daquad(vc, x, bx0[z], by0[z], x, y, by0[z], x, y, z, (i>=0)+4);
                             by0[z] = -1;
                         }
 
@@ -522,30 +540,30 @@ static voxmodel_t *vox2poly()
 
         if (!cnt)
         {
-            shp = (vec2_u16_t *)Xmalloc(gvox->qcnt*sizeof(vec2_u16_t));
+            vc->shp = (vec2_u16_t *)Xmalloc(gvox->qcnt*sizeof(vec2_u16_t));
 
             int32_t sc = 0;
 
-            for (int y=gmaxy; y; y--)
-                for (int x=gmaxx; x>=y; x--)
+            for (int y=vc->gmaxy; y; y--)
+                for (int x=vc->gmaxx; x>=y; x--)
                 {
-                    i = shcnt[y*shcntp+x]; shcnt[y*shcntp+x] = sc; //shcnt changes from counter to head index
+                    i = vc->shcnt[y*vc->shcntp+x]; vc->shcnt[y*vc->shcntp+x] = sc; //shcnt changes from counter to head index
 
                     for (; i>0; i--)
                     {
-                        shp[sc].x = x;
-                        shp[sc].y = y;
+                        vc->shp[sc].x = x;
+                        vc->shp[sc].y = y;
                         sc++;
                     }
                 }
 
-            for (gvox->mytexx=32; gvox->mytexx<(gmaxx+(VOXBORDWIDTH<<1)); gvox->mytexx<<=1)
+            for (gvox->mytexx=32; gvox->mytexx<(vc->gmaxx+(VOXBORDWIDTH<<1)); gvox->mytexx<<=1)
                 /* do nothing */;
 
-            for (gvox->mytexy=32; gvox->mytexy<(gmaxy+(VOXBORDWIDTH<<1)); gvox->mytexy<<=1)
+            for (gvox->mytexy=32; gvox->mytexy<(vc->gmaxy+(VOXBORDWIDTH<<1)); gvox->mytexy<<=1)
                 /* do_nothing */;
 
-            while (gvox->mytexx*gvox->mytexy*8 < garea*9) //This should be sufficient to fit most skins...
+            while (gvox->mytexx*gvox->mytexy*8 < vc->garea*9) //This should be sufficient to fit most skins...
             {
 skindidntfit:
                 if (gvox->mytexx <= gvox->mytexy)
@@ -554,18 +572,18 @@ skindidntfit:
                     gvox->mytexy <<= 1;
             }
 
-            mytexo5 = gvox->mytexx>>5;
+            vc->mytexo5 = gvox->mytexx>>5;
 
             i = ((gvox->mytexx*gvox->mytexy+31)>>5)<<2;
-            zbit = (int32_t *)Xmalloc(i);
-            memset(zbit, 0, i);
+            vc->zbit = (int32_t *)Xmalloc(i);
+            memset(vc->zbit, 0, i);
 
             v = gvox->mytexx*gvox->mytexy;
             constexpr vec2_u16_t vbw = { (VOXBORDWIDTH<<1), (VOXBORDWIDTH<<1) };
 
             for (int z=0; z<sc; z++)
             {
-                auto d = shp[z] + vbw;
+                auto d = vc->shp[z] + vbw;
                 i = v;
 
                 int32_t x0, y0;
@@ -573,29 +591,29 @@ skindidntfit:
                 do
                 {
 #if (VOXUSECHAR != 0)
-                    x0 = ((rand()&32767)*(min(gvox->mytexx, 255)-d.x))>>15;
-                    y0 = ((rand()&32767)*(min(gvox->mytexy, 255)-d.y))>>15;
+                    x0 = (voxrand(vc)*(min(gvox->mytexx, 255)-d.x))>>15;
+                    y0 = (voxrand(vc)*(min(gvox->mytexy, 255)-d.y))>>15;
 #else
-                    x0 = ((rand()&32767)*(gvox->mytexx+1-d.x))>>15;
-                    y0 = ((rand()&32767)*(gvox->mytexy+1-d.y))>>15;
+                    x0 = (voxrand(vc)*(gvox->mytexx+1-d.x))>>15;
+                    y0 = (voxrand(vc)*(gvox->mytexy+1-d.y))>>15;
 #endif
                     i--;
                     if (i < 0) //Time-out! Very slow if this happens... but at least it still works :P
                     {
-                        Xfree(zbit);
+                        Xfree(vc->zbit);
 
-                        //Re-generate shp[].x/y (box sizes) from shcnt (now head indices) for next pass :/
+                        //Re-generate vc->shp[].x/y (box sizes) from vc->shcnt (now head indices) for next pass :/
                         int j = 0;
 
-                        for (int y=gmaxy; y; y--)
-                            for (int x=gmaxx; x>=y; x--)
+                        for (int y=vc->gmaxy; y; y--)
+                            for (int x=vc->gmaxx; x>=y; x--)
                             {
-                                i = shcnt[y*shcntp+x];
+                                i = vc->shcnt[y*vc->shcntp+x];
 
                                 for (; j<i; j++)
                                 {
-                                    shp[j].x = x0;
-                                    shp[j].y = y0;
+                                    vc->shp[j].x = x0;
+                                    vc->shp[j].y = y0;
                                 }
 
                                 x0 = x;
@@ -604,30 +622,30 @@ skindidntfit:
 
                         for (; j<sc; j++)
                         {
-                            shp[j].x = x0;
-                            shp[j].y = y0;
+                            vc->shp[j].x = x0;
+                            vc->shp[j].y = y0;
                         }
 
                         goto skindidntfit;
                     }
-                } while (!isrectfree(x0, y0, d.x, d.y));
+                } while (!isrectfree(vc, x0, y0, d.x, d.y));
 
-                while (y0 && isrectfree(x0, y0-1, d.x, 1))
+                while (y0 && isrectfree(vc, x0, y0-1, d.x, 1))
                     y0--;
-                while (x0 && isrectfree(x0-1, y0, 1, d.y))
+                while (x0 && isrectfree(vc, x0-1, y0, 1, d.y))
                     x0--;
 
-                setrect(x0, y0, d.x, d.y);
-                shp[z].x = x0; shp[z].y = y0; //Overwrite size with top-left location
+                setrect(vc, x0, y0, d.x, d.y);
+                vc->shp[z].x = x0; vc->shp[z].y = y0; //Overwrite size with top-left location
             }
 
-            gquad = (voxrect_t *)Xrealloc(gquad, gvox->qcnt*sizeof(voxrect_t));
+            vc->gquad = (voxrect_t *)Xrealloc(vc->gquad, gvox->qcnt*sizeof(voxrect_t));
             gvox->mytex = (int32_t *)Xmalloc(gvox->mytexx*gvox->mytexy*sizeof(int32_t));
         }
     }
 
-    Xfree(shp);
-    Xfree(zbit);
+    Xfree(vc->shp);
+    Xfree(vc->zbit);
     Xfree(bx0);
 
     const float phack[2] = { 0, 1.f / 256.f };
@@ -640,7 +658,7 @@ skindidntfit:
 
     for (int i = 0; i < gvox->qcnt; i++)
     {
-        auto const vptr = &gquad[i].v[0];
+        auto const vptr = &vc->gquad[i].v[0];
         auto const vsum = vptr[0].xyz + vptr[2].xyz;
 
         for (int j=0; j<4; j++)
@@ -662,305 +680,283 @@ skindidntfit:
         gvox->index[((i<<1)+1)*3+2] = (i<<2)+3;
     }
 
-    DO_FREE_AND_NULL(gquad);
+    DO_FREE_AND_NULL(vc->gquad);
 
     return gvox;
 }
 
-static void alloc_vcolhashead(void)
+static void alloc_vcolhashead(voxconv_t *vc)
 {
-    vcolhashead = (int32_t *)Xmalloc((vcolhashsizm1+1)*sizeof(int32_t));
-    memset(vcolhashead, -1, (vcolhashsizm1+1)*sizeof(int32_t));
+    vc->vcolhashead = (int32_t *)Xmalloc((vc->vcolhashsizm1+1)*sizeof(int32_t));
+    memset(vc->vcolhashead, -1, (vc->vcolhashsizm1+1)*sizeof(int32_t));
 }
 
-static void alloc_vbit(void)
+static void alloc_vbit(voxconv_t *vc)
 {
-    yzsiz = voxsiz.y*voxsiz.z;
-    int32_t i = ((voxsiz.x*yzsiz+31)>>3)+1;
+    vc->yzsiz = vc->voxsiz.y*vc->voxsiz.z;
+    int32_t i = ((vc->voxsiz.x*vc->yzsiz+31)>>3)+1;
 
-    vbit = (int32_t *)Xmalloc(i);
-    memset(vbit, 0, i);
+    vc->vbit = (int32_t *)Xmalloc(i);
+    memset(vc->vbit, 0, i);
 }
 
-static void read_pal(buildvfs_kfd fil, int32_t pal[256])
+static void read_pal(const char *c, int32_t pal[256])
 {
-    klseek(fil, -768, SEEK_END);
-
-    for (int i=0; i<256; i++)
+    for (int i=0; i<256; i++, c+=3)
     {
-        char c[3];
-        kread(fil, c, sizeof(c));
 //#if B_BIG_ENDIAN != 0
         pal[i] = B_LITTLE32((c[0]<<18) + (c[1]<<10) + (c[2]<<2) + (i<<24));
 //#endif
     }
 }
 
-static int32_t loadvox(const char *filnam)
+//Rejects sizes the bit and color arrays can't be allocated for
+static bool voxsizok(vec3_t const &siz)
+{
+    return siz.x > 0 && siz.y > 0 && siz.z > 0 && (int64_t)siz.x*siz.y*siz.z < (1<<28);
+}
+
+//The loaders parse a whole file held in memory, so they can run on a worker
+
+static int32_t loadvox(voxconv_t *vc, const char *buf, int32_t len)
 {
-    const buildvfs_kfd fil = kopen4load(filnam, 0);
-    if (fil == buildvfs_kfd_invalid)
+    if (len < (int32_t)sizeof(vec3_t) + 768)
         return -1;
 
-    kread(fil, &voxsiz, sizeof(vec3_t));
+    Bmemcpy(&vc->voxsiz, buf, sizeof(vec3_t));
 #if B_BIG_ENDIAN != 0
-    voxsiz.x = B_LITTLE32(voxsiz.x);
-    voxsiz.y = B_LITTLE32(voxsiz.y);
-    voxsiz.z = B_LITTLE32(voxsiz.z);
+    vc->voxsiz.x = B_LITTLE32(vc->voxsiz.x);
+    vc->voxsiz.y = B_LITTLE32(vc->voxsiz.y);
+    vc->voxsiz.z = B_LITTLE32(vc->voxsiz.z);
 #endif
-    voxpiv.x = (float)voxsiz.x * .5f;
-    voxpiv.y = (float)voxsiz.y * .5f;
-    voxpiv.z = (float)voxsiz.z * .5f;
+    if (!voxsizok(vc->voxsiz) || (int64_t)vc->voxsiz.x*vc->voxsiz.y*vc->voxsiz.z > len - (int32_t)sizeof(vec3_t) - 768)
+        return -1;
+
+    vc->voxpiv.x = (float)vc->voxsiz.x * .5f;
+    vc->voxpiv.y = (float)vc->voxsiz.y * .5f;
+    vc->voxpiv.z = (float)vc->voxsiz.z * .5f;
 
     int32_t pal[256];
-    read_pal(fil, pal);
+    read_pal(&buf[len-768], pal);
     pal[255] = -1;
 
-    vcolhashsizm1 = 8192-1;
-    alloc_vcolhashead();
-    alloc_vbit();
+    vc->vcolhashsizm1 = 8192-1;
+    alloc_vcolhashead(vc);
+    alloc_vbit(vc);
 
-    char *const tbuf = (char *)Xmalloc(voxsiz.z*sizeof(uint8_t));
+    const char *const voxels = &buf[sizeof(vec3_t)];
+    const char *tbuf = voxels;
 
-    klseek(fil, sizeof(vec3_t), SEEK_SET);
-    for (int x=0; x<voxsiz.x; x++)
+    for (int x=0; x<vc->voxsiz.x; x++)
     {
-        int32_t j = x * yzsiz;
-        for (int y=0; y<voxsiz.y; y++)
+        int32_t j = x * vc->yzsiz;
+        for (int y=0; y<vc->voxsiz.y; y++)
         {
-            kread(fil, tbuf, voxsiz.z);
-
-            for (int32_t z = 0; z < voxsiz.z; ++z)
+            for (int32_t z = 0; z < vc->voxsiz.z; ++z)
                 if (tbuf[z] != 255)
                 {
                     const int32_t i = j+z;
-                    vbit[i>>5] |= (1<<SHIFTMOD32(i));
+                    vc->vbit[i>>5] |= (1<<SHIFTMOD32(i));
                 }
 
-            j += voxsiz.z;
+            tbuf += vc->voxsiz.z;
+            j += vc->voxsiz.z;
         }
     }
 
-    klseek(fil, sizeof(vec3_t), SEEK_SET);
-    for (int x=0; x<voxsiz.x; x++)
+    tbuf = voxels;
+    for (int x=0; x<vc->voxsiz.x; x++)
     {
-        int32_t j = x * yzsiz;
-        for (int y=0; y<voxsiz.y; y++)
+        int32_t j = x * vc->yzsiz;
+        for (int y=0; y<vc->voxsiz.y; y++)
         {
-            kread(fil, tbuf, voxsiz.z);
-
-            for (int z=0; z<voxsiz.z; z++)
+            for (int z=0; z<vc->voxsiz.z; z++)
             {
                 if (tbuf[z] == 255)
                     continue;
 
-                if (!x | !y | !z | (x == voxsiz.x-1) | (y == voxsiz.y-1) | (z == voxsiz.z-1))
+                if (!x | !y | !z | (x == vc->voxsiz.x-1) | (y == vc->voxsiz.y-1) | (z == vc->voxsiz.z-1))
                 {
-                    putvox(x, y, z, pal[tbuf[z]]);
+                    putvox(vc, x, y, z, pal[tbuf[z]]);
                     continue;
                 }
 
                 const int32_t k = j+z;
 
-                if (isair(k-yzsiz) | isair(k+yzsiz) |
-                    isair(k-voxsiz.z) | isair(k+voxsiz.z) |
-                    isair(k-1) | isair(k+1))
+                if (isair(vc, k-vc->yzsiz) | isair(vc, k+vc->yzsiz) |
+                    isair(vc, k-vc->voxsiz.z) | isair(vc, k+vc->voxsiz.z) |
+                    isair(vc, k-1) | isair(vc, k+1))
                 {
-                    putvox(x, y, z, pal[tbuf[z]]);
+                    putvox(vc, x, y, z, pal[tbuf[z]]);
                     continue;
                 }
             }
 
-            j += voxsiz.z;
+            tbuf += vc->voxsiz.z;
+            j += vc->voxsiz.z;
         }
     }
 
-    Xfree(tbuf);
-    kclose(fil);
-
     return 0;
 }
 
-static int32_t loadkvx(const char *filnam)
+static int32_t loadkvx(voxconv_t *vc, const char *buf, int32_t len)
 {
-    const buildvfs_kfd fil = kopen4load(filnam, 0);
-    if (fil == buildvfs_kfd_invalid)
+    int32_t hdr[7]; //mip1leng, xsiz, ysiz, zsiz, xpivot, ypivot, zpivot
+
+    if (len < (int32_t)sizeof(hdr) + 768)
         return -1;
 
-    int32_t mip1leng;
-    kread(fil, &mip1leng, sizeof(int32_t));
-    kread(fil, &voxsiz, sizeof(vec3_t));
-#if B_BIG_ENDIAN != 0
-    mip1leng = B_LITTLE32(mip1leng);
-    voxsiz.x = B_LITTLE32(voxsiz.x);
-    voxsiz.y = B_LITTLE32(voxsiz.y);
-    voxsiz.z = B_LITTLE32(voxsiz.z);
-#endif
+    Bmemcpy(hdr, buf, sizeof(hdr));
+    for (auto &h : hdr)
+        h = B_LITTLE32(h);
 
-    vec3_t v;
-    kread(fil, &v, sizeof(vec3_t));
-    voxpiv.x = (float)B_LITTLE32(v.x)*(1.f/256.f);
-    voxpiv.y = (float)B_LITTLE32(v.y)*(1.f/256.f);
-    voxpiv.z = (float)B_LITTLE32(v.z)*(1.f/256.f);
-    klseek(fil, (voxsiz.x+1)<<2, SEEK_CUR);
+    int32_t const mip1leng = hdr[0];
+    if (mip1leng > len - 4)
+    {
+        // Invalid KVX file
+        return -1;
+    }
 
-    const int32_t ysizp1 = voxsiz.y+1;
-    int32_t const xyoffscnt = voxsiz.x * ysizp1;
-    int32_t const xyoffssiz = xyoffscnt * sizeof(uint16_t);
+    vc->voxsiz = { hdr[1], hdr[2], hdr[3] };
+    if (!voxsizok(vc->voxsiz))
+        return -1;
 
-    uint16_t *xyoffs = (uint16_t *)Xmalloc(xyoffssiz);
-    kread(fil, xyoffs, xyoffssiz);
-#if B_BIG_ENDIAN != 0
-    for (int32_t i = 0; i < xyoffscnt; ++i)
-        xyoffs[i] = B_LITTLE16(xyoffs[i]);
-#endif
+    vc->voxpiv.x = (float)hdr[4]*(1.f/256.f);
+    vc->voxpiv.y = (float)hdr[5]*(1.f/256.f);
+    vc->voxpiv.z = (float)hdr[6]*(1.f/256.f);
+
+    const int32_t ysizp1 = vc->voxsiz.y+1;
+    const char *const xyoffs = &buf[sizeof(hdr) + ((vc->voxsiz.x+1)<<2)];
+    int32_t const dataofs = sizeof(hdr) + ((vc->voxsiz.x+1)<<2) + ((ysizp1*vc->voxsiz.x)<<1);
+
+    if (dataofs > len - 768)
+        return -1;
 
     int32_t pal[256];
-    read_pal(fil, pal);
+    read_pal(&buf[len-768], pal);
 
-    alloc_vbit();
+    alloc_vbit(vc);
 
-    for (vcolhashsizm1=4096; vcolhashsizm1<(mip1leng>>1); vcolhashsizm1<<=1)
+    for (vc->vcolhashsizm1=4096; vc->vcolhashsizm1<(mip1leng>>1); vc->vcolhashsizm1<<=1)
     {
         /* do nothing */
     }
-    vcolhashsizm1--; //approx to numvoxs!
-    alloc_vcolhashead();
-
-    klseek(fil, (7 * sizeof(int32_t)) + ((voxsiz.x+1)<<2) + ((ysizp1*voxsiz.x)<<1), SEEK_SET);
+    vc->vcolhashsizm1--; //approx to numvoxs!
+    alloc_vcolhashead(vc);
 
-    int32_t const tbufsiz = kfilelength(fil)-ktell(fil);
-    char *const tbuf = (char *)Xmalloc(tbufsiz);
+    const char *cptr = &buf[dataofs];
+    const char *const cend = &buf[len-768];
 
-    kread(fil, tbuf, tbufsiz);
-    kclose(fil);
-
-    char *cptr = tbuf;
-
-    for (int x=0; x<voxsiz.x; x++) //Set surface voxels to 1 else 0
+    for (int x=0; x<vc->voxsiz.x; x++) //Set surface voxels to 1 else 0
     {
-        int32_t j = x * yzsiz;
-        for (int y=0; y<voxsiz.y; y++)
+        int32_t j = x * vc->yzsiz;
+        for (int y=0; y<vc->voxsiz.y; y++)
         {
             int32_t const idx = x*ysizp1+y;
-            int32_t i = xyoffs[idx+1] - xyoffs[idx];
+            int32_t i = B_LITTLE16(B_UNBUF16(&xyoffs[(idx+1)<<1])) - B_LITTLE16(B_UNBUF16(&xyoffs[idx<<1]));
             int32_t z1 = 0;
 
-            while (i)
+            while (i > 0)
             {
+                if (cend - cptr < 3 || cend - cptr < 3 + (uint8_t)cptr[1])
+                    return -1;
+
                 const int32_t z0 = cptr[0];
                 const int32_t k = cptr[1];
                 cptr += 3;
 
+                if (z0+k > vc->voxsiz.z)
+                    return -1;
+
                 if (!(cptr[-1]&16))
-                    setzrange1(vbit, j+z1, j+z0);
+                    setzrange1(vc->vbit, j+z1, j+z0);
 
                 i -= k+3;
                 z1 = z0+k;
 
-                setzrange1(vbit, j+z0, j+z1);  // PK: oob in AMC TC dev if vbit alloc'd w/o +1
+                setzrange1(vc->vbit, j+z0, j+z1);  // PK: oob in AMC TC dev if vbit alloc'd w/o +1
 
                 for (int z=z0; z<z1; z++)
-                    putvox(x, y, z, pal[*cptr++]);
+                    putvox(vc, x, y, z, pal[*cptr++]);
             }
 
-            j += voxsiz.z;
+            j += vc->voxsiz.z;
         }
     }
 
-    Xfree(tbuf);
-    Xfree(xyoffs);
-
     return 0;
 }
 
-static int32_t loadkv6(const char *filnam)
+static int32_t loadkv6(voxconv_t *vc, const char *buf, int32_t len)
 {
-    const buildvfs_kfd fil = kopen4load(filnam, 0);
-    if (fil == buildvfs_kfd_invalid)
+    int32_t hdr[8]; //magic, xsiz, ysiz, zsiz, xpivot, ypivot, zpivot (floats), numvoxs
+
+    if (len < (int32_t)sizeof(hdr))
         return -1;
 
-    int32_t magic;
-    kread(fil, &magic, sizeof(int32_t));
-    if (magic != B_LITTLE32(0x6c78764b)) // "Kvxl"
-    {
-        kclose(fil);
+    Bmemcpy(hdr, buf, sizeof(hdr));
+    for (auto &h : hdr)
+        h = B_LITTLE32(h);
+
+    if (hdr[0] != 0x6c78764b) // "Kvxl"
         return -1;
-    }
 
-    kread(fil, &voxsiz, sizeof(vec3_t));
-#if B_BIG_ENDIAN != 0
-    voxsiz.x = B_LITTLE32(voxsiz.x);
-    voxsiz.y = B_LITTLE32(voxsiz.y);
-    voxsiz.z = B_LITTLE32(voxsiz.z);
-#endif
+    vc->voxsiz = { hdr[1], hdr[2], hdr[3] };
+    if (!voxsizok(vc->voxsiz))
+        return -1;
 
-    vec3_t v;
-    kread(fil, &v, sizeof(vec3_t));
-#if B_BIG_ENDIAN != 0
-    v.x = B_LITTLE32(v.x);
-    v.y = B_LITTLE32(v.y);
-    v.z = B_LITTLE32(v.z);
-#endif
     EDUKE32_STATIC_ASSERT(sizeof(vec3_t) == sizeof(vec3f_t));
-    memcpy(&voxpiv, &v, sizeof(vec3_t));
+    memcpy(&vc->voxpiv, &hdr[4], sizeof(vec3_t));
 
-    int32_t numvoxs;
-    kread(fil, &numvoxs, sizeof(int32_t));
-    numvoxs = B_LITTLE32(numvoxs);
+    int32_t const numvoxs = hdr[7];
+    int64_t const ylenofs = (int64_t)sizeof(hdr) + ((int64_t)numvoxs<<3) + (vc->voxsiz.x<<2);
 
-    int32_t const ylencnt = voxsiz.x * voxsiz.y;
-    int32_t const ylensiz = ylencnt * sizeof(uint16_t);
-    uint16_t *const ylen = (uint16_t *)Xmalloc(ylensiz);
-
-    klseek(fil, (8 * sizeof(int32_t)) + (numvoxs<<3) + (voxsiz.x<<2), SEEK_SET);
-    kread(fil, ylen, ylensiz);
-#if B_BIG_ENDIAN != 0
-    for (int32_t i = 0; i < ylencnt; ++i)
-        ylen[i] = B_LITTLE16(ylen[i]);
-#endif
+    if (numvoxs < 0 || ylenofs + ((int64_t)vc->voxsiz.x*vc->voxsiz.y<<1) > len)
+        return -1;
 
-    klseek(fil, 8 * sizeof(int32_t), SEEK_SET);
+    const char *const ylen = &buf[ylenofs];
 
-    alloc_vbit();
+    alloc_vbit(vc);
 
-    for (vcolhashsizm1=4096; vcolhashsizm1<numvoxs; vcolhashsizm1<<=1)
+    for (vc->vcolhashsizm1=4096; vc->vcolhashsizm1<numvoxs; vc->vcolhashsizm1<<=1)
     {
         /* do nothing */
     }
-    vcolhashsizm1--;
-    alloc_vcolhashead();
+    vc->vcolhashsizm1--;
+    alloc_vcolhashead(vc);
+
+    const char *c = &buf[sizeof(hdr)];
+    int32_t voxleft = numvoxs;
 
-    for (int x=0; x<voxsiz.x; x++)
+    for (int x=0; x<vc->voxsiz.x; x++)
     {
-        int32_t j = x * yzsiz;
-        for (int y=0; y<voxsiz.y; y++)
+        int32_t j = x * vc->yzsiz;
+        for (int y=0; y<vc->voxsiz.y; y++)
         {
-            int32_t z1 = voxsiz.z;
+            int32_t z1 = vc->voxsiz.z;
 
-            for (int32_t i = 0, i_end = ylen[x*voxsiz.y+y]; i < i_end; ++i)
+            for (int32_t i = 0, i_end = B_LITTLE16(B_UNBUF16(&ylen[(x*vc->voxsiz.y+y)<<1])); i < i_end; ++i, c += 8)
             {
-                char c[8];
-                kread(fil, c, sizeof(c)); //b,g,r,a,z_lo,z_hi,vis,dir
-
+                //b,g,r,a,z_lo,z_hi,vis,dir
                 const int32_t z0 = B_LITTLE16(B_UNBUF16(&c[4]));
 
+                if (--voxleft < 0 || z0 >= vc->voxsiz.z)
+                    return -1;
+
                 if (!(c[6]&16))
-                    setzrange1(vbit, j+z1, j+z0);
+                    setzrange1(vc->vbit, j+z1, j+z0);
 
-                vbit[(j+z0)>>5] |= (1<<SHIFTMOD32(j+z0));
+                vc->vbit[(j+z0)>>5] |= (1<<SHIFTMOD32(j+z0));
 
-                putvox(x, y, z0, B_LITTLE32(B_UNBUF32(&c[0]))&0xffffff);
+                putvox(vc, x, y, z0, B_LITTLE32(B_UNBUF32(&c[0]))&0xffffff);
                 z1 = z0+1;
             }
 
-            j += voxsiz.z;
+            j += vc->voxsiz.z;
         }
     }
 
-    Xfree(ylen);
-    kclose(fil);
-
     return 0;
 }
 
@@ -979,171 +975,395 @@ void voxfree(voxmodel_t *m)
     Xfree(m);
 }
 
-voxmodel_t *voxload(const char *filnam)
+enum
 {
-    int32_t is8bit, ret;
+    VOXFMT_NONE,
+    VOXFMT_VOX,
+    VOXFMT_KVX,
+    VOXFMT_KV6,
+};
 
+static int32_t voxformat(const char *filnam)
+{
     const int32_t i = Bstrlen(filnam)-4;
     if (i < 0)
-        return NULL;
+        return VOXFMT_NONE;
 
-    if (!Bstrcasecmp(&filnam[i], ".vox")) { ret = loadvox(filnam); is8bit = 1; }
-    else if (!Bstrcasecmp(&filnam[i], ".kvx")) { ret = loadkvx(filnam); is8bit = 1; }
-    else if (!Bstrcasecmp(&filnam[i], ".kv6")) { ret = loadkv6(filnam); is8bit = 0; }
-    //else if (!Bstrcasecmp(&filnam[i],".vxl")) { ret = loadvxl(filnam); is8bit = 0; }
-    else return NULL;
+    if (!Bstrcasecmp(&filnam[i], ".vox")) return VOXFMT_VOX;
+    if (!Bstrcasecmp(&filnam[i], ".kvx")) return VOXFMT_KVX;
+    if (!Bstrcasecmp(&filnam[i], ".kv6")) return VOXFMT_KV6;
+    //if (!Bstrcasecmp(&filnam[i],".vxl")) return VOXFMT_VXL;
 
-    voxmodel_t* vm = NULL;
-    if (ret >= 0)
-    {
-        // file presence is guaranteed
-        buildvfs_kfd filh = kopen4load(filnam, 0);
-        int32_t const filelen = kfilelength(filh);
-        kclose(filh);
+    return VOXFMT_NONE;
+}
 
-        char voxcacheid[BMAX_PATH];
-        texcache_calcid(voxcacheid, filnam, filelen, -1, -1);
+//Parses and meshes one voxel file held in memory; runs on the worker pool
+static voxmodel_t *voxmesh(const char *buf, int32_t len, int32_t fmt)
+{
+    voxconv_t vc = {};
+    vc.randseed = 1;
 
-        // static variable 'gvox' is normally defined by 'vox2poly' -- do same here for safety
-        if (!(gvox = vm = voxcache_fetchvoxmodel(voxcacheid)))
-        {
-            vm = vox2poly();
-            voxcache_writevoxmodel(voxcacheid, vm);
-        }
+    int32_t ret;
 
-        if (vm)
-        {
-            vm->mdnum = 1; //VOXel model id
-            vm->scale = vm->bscale = 1.f;
-            vm->siz = voxsiz;
-            vm->piv = voxpiv;
-            vm->is8bit = is8bit;
+    switch (fmt)
+    {
+    case VOXFMT_VOX: ret = loadvox(&vc, buf, len); break;
+    case VOXFMT_KVX: ret = loadkvx(&vc, buf, len); break;
+    case VOXFMT_KV6: ret = loadkv6(&vc, buf, len); break;
+    default: ret = -1; break;
+    }
 
-            vm->texid = (uint32_t*)Xcalloc(MAXPALOOKUPS, sizeof(uint32_t));
-        }
+    voxmodel_t *vm = NULL;
+
+    if (ret >= 0 && (vm = vox2poly(&vc)))
+    {
+        vm->siz = vc.voxsiz;
+        vm->piv = vc.voxpiv;
+        vm->is8bit = (fmt != VOXFMT_KV6);
     }
 
-    DO_FREE_AND_NULL(shcntmal);
-    DO_FREE_AND_NULL(vbit);
-    DO_FREE_AND_NULL(vcol);
-    vnum = vmax = 0;
-    DO_FREE_AND_NULL(vcolhashead);
+    Xfree(vc.shcntmal);
+    Xfree(vc.vbit);
+    Xfree(vc.vcol);
+    Xfree(vc.vcolhashead);
 
     return vm;
 }
 
-voxmodel_t *loadkvxfrombuf(const char *kvxbuffer, int32_t length)
+//---------------------------------------------------------------------------
+// Mesh cache
+//
+// Meshes and their atlases are kept in voxels.cache in the mod directory, keyed by a
+// hash of the voxel data, so a voxel that was meshed once is never meshed again,
+// whatever the texture cache is set to. Entries are only ever appended; a cache whose
+// tail doesn't read back whole is started over.
+
+#ifndef USE_PHYSFS
+# define USE_VOXCACHE
+#endif
+
+#define VOXCACHE_MAGIC   "Build voxel mesh cache"
+#define VOXCACHE_VERSION 1
+#define VOXCACHE_MAXENTRIES (MAXVOXELS*4)  //past this the cache is started over
+
+typedef struct
+{
+    uint64_t key;
+    vec3_t   siz;
+    vec3f_t  piv;
+    int32_t  is8bit, qcnt, mytexx, mytexy;
+    int32_t  packedsize;
+} voxcacheentry_t;
+
+static inline int64_t voxcache_meshsize(voxcacheentry_t const &e, size_t *vertexsize, size_t *indexsize)
 {
-    int32_t i, mip1leng;
+    *vertexsize = 5 * 4 * (size_t)e.qcnt * sizeof(GLfloat);
+    *indexsize  = 3 * 2 * (size_t)e.qcnt * sizeof(GLuint);
 
-    if (!kvxbuffer)
-        return NULL;
+    return (int64_t)*vertexsize + *indexsize + (int64_t)e.mytexx * e.mytexy * sizeof(int32_t);
+}
+
+#ifdef USE_VOXCACHE
+static inthashtable_t h_voxcache = { nullptr, INTHASH_SIZE(VOXCACHE_MAXENTRIES) };
+static char voxcachefn[BMAX_PATH];
+static int32_t voxcachecount;
+static int64_t voxcacheend;  //end of the last whole entry, or 0 if the file needs starting over
+
+//Indexes the cache file of the current mod directory, unless that's already done
+static void voxcache_scan(void)
+{
+    char fn[BMAX_PATH];
+
+    if (g_modDir[0] != '/' || g_modDir[1] != 0)
+        Bsnprintf(fn, sizeof(fn), "%s/voxels.cache", g_modDir);
+    else
+        Bstrcpy(fn, "voxels.cache");
+
+    if (h_voxcache.items && !Bstrcmp(fn, voxcachefn))
+        return;
+
+    inthash_free(&h_voxcache);
+    inthash_init(&h_voxcache);
+    Bstrcpy(voxcachefn, fn);
+    voxcacheend = 0;
+    voxcachecount = 0;
+
+    buildvfs_FILE fil = buildvfs_fopen_read(voxcachefn);
+    if (!fil)
+        return;
+
+    int64_t const length = buildvfs_flength(fil);
+
+    char magic[sizeof(VOXCACHE_MAGIC)];
+    int32_t version;
+
+    if (buildvfs_fread(magic, sizeof(magic), 1, fil) != 1 || Bmemcmp(magic, VOXCACHE_MAGIC, sizeof(magic))
+        || buildvfs_fread(&version, sizeof(version), 1, fil) != 1 || version != VOXCACHE_VERSION)
+    {
+        buildvfs_fclose(fil);
+        return;
+    }
+
+    int64_t ofs = sizeof(magic) + sizeof(version);
+    voxcacheentry_t e;
 
-    char *buffer = (char*)Xmalloc(length);
-    if (!buffer)
+    while (voxcachecount < VOXCACHE_MAXENTRIES && ofs + (int64_t)sizeof(e) <= length && buildvfs_fread(&e, sizeof(e), 1, fil) == 1
+           && e.packedsize > 0 && ofs + (int64_t)sizeof(e) + e.packedsize <= length)
+    {
+        inthash_add(&h_voxcache, (intptr_t)e.key, (intptr_t)ofs, 1);
+        voxcachecount++;
+        ofs += sizeof(e) + e.packedsize;
+        buildvfs_fseek_abs(fil, ofs);
+    }
+
+    buildvfs_fclose(fil);
+
+    if (ofs == length)
+        voxcacheend = ofs;
+}
+
+static voxmodel_t *voxcache_fetch(buildvfs_FILE fil, uint64_t key)
+{
+    intptr_t const ofs = inthash_find(&h_voxcache, (intptr_t)key);
+    voxcacheentry_t e;
+
+    if (ofs < 0 || buildvfs_fseek_abs(fil, ofs) || buildvfs_fread(&e, sizeof(e), 1, fil) != 1 || e.key != key)
         return NULL;
 
-    Bmemcpy(buffer, kvxbuffer, length);
+    size_t vertexsize, indexsize;
+    int64_t const meshsize = voxcache_meshsize(e, &vertexsize, &indexsize);
+
+    if (e.qcnt <= 0 || e.mytexx <= 0 || e.mytexy <= 0 || meshsize > INT32_MAX)
+        return NULL;
 
-    int32_t *longptr = (int32_t*)buffer;
+    auto packed = (char *)Xmalloc(e.packedsize);
+    auto mesh   = (char *)Xmalloc(meshsize);
 
-    mip1leng = *longptr++; mip1leng = B_LITTLE32(mip1leng);
-    if (mip1leng > length - 4)
+    if (buildvfs_fread(packed, e.packedsize, 1, fil) != 1 || LZ4_decompress_safe(packed, mesh, e.packedsize, meshsize) != meshsize)
     {
-        // Invalid KVX file
-        Xfree(buffer);
+        Xfree(mesh);
+        Xfree(packed);
         return NULL;
     }
-    memcpy(&voxsiz, longptr, sizeof(vec3_t));
-    longptr += 3;
-#if B_BIG_ENDIAN != 0
-    voxsiz.x = B_LITTLE32(voxsiz.x);
-    voxsiz.y = B_LITTLE32(voxsiz.y);
-    voxsiz.z = B_LITTLE32(voxsiz.z);
-#endif
-    i = *longptr++; voxpiv.x = (float)B_LITTLE32(i)*(1.f/256.f);
-    i = *longptr++; voxpiv.y = (float)B_LITTLE32(i)*(1.f/256.f);
-    i = *longptr++; voxpiv.z = (float)B_LITTLE32(i)*(1.f/256.f);
-    longptr += voxsiz.x+1;
 
-    const int32_t ysizp1 = voxsiz.y+1;
-    i = voxsiz.x*ysizp1*sizeof(int16_t);
-    uint16_t *xyoffs = (uint16_t*)longptr;
+    Xfree(packed);
 
-    for (i=i/sizeof(int16_t)-1; i>=0; i--)
-        xyoffs[i] = B_LITTLE16(xyoffs[i]);
+    auto vm = (voxmodel_t *)Xcalloc(1, sizeof(voxmodel_t));
 
-    const char *paloff = buffer+length-768;
-    int32_t pal[256];
+    vm->qcnt   = e.qcnt;
+    vm->mytexx = e.mytexx;
+    vm->mytexy = e.mytexy;
+    vm->siz    = e.siz;
+    vm->piv    = e.piv;
+    vm->is8bit = e.is8bit;
+
+    vm->vertex = (GLfloat *)Xmalloc(vertexsize);
+    vm->index  = (GLuint *)Xmalloc(indexsize);
+    vm->mytex  = (int32_t *)Xmalloc(meshsize - vertexsize - indexsize);
+
+    Bmemcpy(vm->vertex, mesh, vertexsize);
+    Bmemcpy(vm->index, &mesh[vertexsize], indexsize);
+    Bmemcpy(vm->mytex, &mesh[vertexsize + indexsize], meshsize - vertexsize - indexsize);
+
+    Xfree(mesh);
+
+    return vm;
+}
+
+static void voxcache_store(buildvfs_FILE fil, uint64_t key, voxmodel_t const *vm)
+{
+    voxcacheentry_t e = { key, vm->siz, vm->piv, vm->is8bit, vm->qcnt, vm->mytexx, vm->mytexy, 0 };
+
+    size_t vertexsize, indexsize;
+    int64_t const meshsize = voxcache_meshsize(e, &vertexsize, &indexsize);
+
+    if (voxcacheend == 0 || voxcachecount >= VOXCACHE_MAXENTRIES || e.qcnt <= 0 || meshsize > LZ4_MAX_INPUT_SIZE)
+        return;
 
-    for (bssize_t i=0; i<256; i++)
+    auto mesh = (char *)Xmalloc(meshsize);
+
+    Bmemcpy(mesh, vm->vertex, vertexsize);
+    Bmemcpy(&mesh[vertexsize], vm->index, indexsize);
+    Bmemcpy(&mesh[vertexsize + indexsize], vm->mytex, meshsize - vertexsize - indexsize);
+
+    auto packed = (char *)Xmalloc(LZ4_compressBound(meshsize));
+    e.packedsize = LZ4_compress_default(mesh, packed, meshsize, LZ4_compressBound(meshsize));
+
+    Xfree(mesh);
+
+    if (e.packedsize > 0 && buildvfs_fwrite(&e, sizeof(e), 1, fil) == 1 && buildvfs_fwrite(packed, e.packedsize, 1, fil) == 1)
     {
-        const char *c = &paloff[i*3];
-//#if B_BIG_ENDIAN != 0
-        pal[i] = B_LITTLE32((c[0]<<18) + (c[1]<<10) + (c[2]<<2) + (i<<24));
-//#endif
+        inthash_add(&h_voxcache, (intptr_t)key, (intptr_t)voxcacheend, 1);
+        voxcachecount++;
+        voxcacheend += sizeof(e) + e.packedsize;
+    }
+    else
+        voxcacheend = 0;
+
+    Xfree(packed);
+}
+
+//Opens the cache for appending, starting it over if it's missing or damaged
+static buildvfs_FILE voxcache_openwrite(void)
+{
+    if (voxcacheend > 0 && voxcachecount < VOXCACHE_MAXENTRIES)
+        return buildvfs_fopen_append(voxcachefn);
+
+    buildvfs_FILE fil = buildvfs_fopen_write(voxcachefn);
+
+    if (!fil)
+    {
+        LOG_F(WARNING, "Unable to write voxel mesh cache %s", voxcachefn);
+        return NULL;
     }
 
-    alloc_vbit();
+    int32_t const version = VOXCACHE_VERSION;
+
+    inthash_init(&h_voxcache);
+    voxcachecount = 0;
 
-    for (vcolhashsizm1=4096; vcolhashsizm1<(mip1leng>>1); vcolhashsizm1<<=1)
+    if (buildvfs_fwrite(VOXCACHE_MAGIC, sizeof(VOXCACHE_MAGIC), 1, fil) != 1 || buildvfs_fwrite(&version, sizeof(version), 1, fil) != 1)
     {
-        /* do nothing */
+        buildvfs_fclose(fil);
+        return NULL;
     }
-    vcolhashsizm1--; //approx to numvoxs!
-    alloc_vcolhashead();
 
-    const char *cptr = buffer+28+((voxsiz.x+1)<<2)+((ysizp1*voxsiz.x)<<1);
+    voxcacheend = sizeof(VOXCACHE_MAGIC) + sizeof(version);
+
+    return fil;
+}
+#endif
+
+typedef struct
+{
+    char    *buf;  //file contents, if they were read here
+    uint64_t key;
+    bool     meshed;
+    async::task<voxmodel_t *> *task;
+} voxpending_t;
+
+int32_t voxloadbatch(voxloadjob_t *jobs, int32_t numjobs)
+{
+    auto pending = (voxpending_t *)Xcalloc(numjobs, sizeof(voxpending_t));
+    int32_t numcached = 0, nummeshed = 0;
+
+#ifdef USE_VOXCACHE
+    voxcache_scan();
+    buildvfs_FILE cachefil = voxcachecount ? buildvfs_fopen_read(voxcachefn) : NULL;
+#endif
+
+    //The files are read and looked up in the cache here, because the VFS isn't thread safe.
+    //Everything that needs meshing goes to the workers.
+    for (int i=0; i<numjobs; i++)
+    {
+        voxloadjob_t &job = jobs[i];
+        voxpending_t &p = pending[i];
 
-    for (bssize_t x=0; x<voxsiz.x; x++) //Set surface voxels to 1 else 0
-        for (bssize_t y=0, j=x*yzsiz; y<voxsiz.y; y++, j+=voxsiz.z)
+        int32_t const fmt = job.filnam ? voxformat(job.filnam) : VOXFMT_KVX;
+        const char *buf = job.buffer;
+        int32_t len = job.length;
+
+        job.vm = NULL;
+
+        if (fmt == VOXFMT_NONE)
+            continue;
+
+        if (job.filnam)
         {
-            i = xyoffs[x*ysizp1+y+1] - xyoffs[x*ysizp1+y];
-            if (!i)
+            buildvfs_kfd const fil = kopen4load(job.filnam, 0);
+            if (fil == buildvfs_kfd_invalid)
                 continue;
 
-            int32_t z1 = 0;
+            len = kfilelength(fil);
+            buf = p.buf = (char *)Xmalloc(max(len, 1));
+
+            int32_t const readlen = kread(fil, p.buf, len);
+            kclose(fil);
 
-            while (i)
+            if (readlen != len)
             {
-                const int32_t z0 = cptr[0];
-                const int32_t k = cptr[1];
-                cptr += 3;
+                DO_FREE_AND_NULL(p.buf);
+                continue;
+            }
+        }
+        else if (!buf)
+            continue;
 
-                if (!(cptr[-1]&16))
-                    setzrange1(vbit, j+z1, j+z0);
+        p.key = XXH3_64bits_withSeed(buf, len, (VOXCACHE_VERSION << 4) | fmt);
 
-                i -= k+3;
-                z1 = z0+k;
+#ifdef USE_VOXCACHE
+        if (cachefil && (job.vm = voxcache_fetch(cachefil, p.key)))
+        {
+            DO_FREE_AND_NULL(p.buf);
+            numcached++;
+            continue;
+        }
+#endif
 
-                setzrange1(vbit, j+z0, j+z1);  // PK: oob in AMC TC dev if vbit alloc'd w/o +1
+        p.meshed = true;
+        nummeshed++;
 
-                for (bssize_t z=z0; z<z1; z++)
-                    putvox(x, y, z, pal[*cptr++]);
-            }
-        }
+        if (numjobs == 1)
+            job.vm = voxmesh(buf, len, fmt);
+        else
+            p.task = new async::task<voxmodel_t *>(async::spawn([buf, len, fmt]() { return voxmesh(buf, len, fmt); }));
+    }
 
-    voxmodel_t *const vm = vox2poly();
+#ifdef USE_VOXCACHE
+    if (cachefil)
+        buildvfs_fclose(cachefil);
 
-    if (vm)
+    cachefil = nummeshed ? voxcache_openwrite() : NULL;
+#endif
+
+    for (int i=0; i<numjobs; i++)
     {
-        vm->mdnum = 1; //VOXel model id
-        vm->scale = vm->bscale = 1.f;
-        vm->siz.x = voxsiz.x; vm->siz.y = voxsiz.y; vm->siz.z = voxsiz.z;
-        vm->piv.x = voxpiv.x; vm->piv.y = voxpiv.y; vm->piv.z = voxpiv.z;
-        vm->is8bit = 1;
+        voxloadjob_t &job = jobs[i];
+        voxpending_t &p = pending[i];
+
+        if (p.task)
+        {
+            job.vm = p.task->get();
+            delete p.task;
+        }
+
+#ifdef USE_VOXCACHE
+        if (cachefil && p.meshed && job.vm)
+            voxcache_store(cachefil, p.key, job.vm);
+#endif
+
+        Xfree(p.buf);
 
-        vm->texid = (uint32_t *)Xcalloc(MAXPALOOKUPS, sizeof(uint32_t));
+        if (job.vm)
+        {
+            job.vm->mdnum = 1; //VOXel model id
+            job.vm->scale = job.vm->bscale = 1.f;
+            job.vm->texid = (uint32_t *)Xcalloc(MAXPALOOKUPS, sizeof(uint32_t));
+        }
     }
 
-    DO_FREE_AND_NULL(shcntmal);
-    DO_FREE_AND_NULL(vbit);
-    DO_FREE_AND_NULL(vcol);
-    vnum = vmax = 0;
-    DO_FREE_AND_NULL(vcolhashead);
-    Xfree(buffer);
+#ifdef USE_VOXCACHE
+    if (cachefil)
+        buildvfs_fclose(cachefil);
+#endif
 
-    return vm;
+    Xfree(pending);
+
+    return numcached;
+}
+
+voxmodel_t *voxload(const char *filnam)
+{
+    voxloadjob_t job = { filnam, NULL, 0, NULL };
+    voxloadbatch(&job, 1);
+    return job.vm;
+}
+
+voxmodel_t *loadkvxfrombuf(const char *kvxbuffer, int32_t length)
+{
+    voxloadjob_t job = { NULL, kvxbuffer, length, NULL };
+    voxloadbatch(&job, 1);
+    return job.vm;
 }
 
 //Draw voxel model as perfect cubes
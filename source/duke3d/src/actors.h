@@ -170,11 +170,10 @@ typedef struct
 
 // note: fields in this struct DO NOT have to be in this order,
 // however if you add something to this struct, please make sure
-// a field gets added to ActorFields[], otherwise the field
-// won't get synced over the network!
+// it gets copied in the matching Net_Copy*ToNet() and Net_Copy*FromNet(),
+// otherwise the field won't get synced over the network!
 //
-// I don't think the ActorFields array needs to be in the same order,
-// need to verify this...
+// Snapshots are synced as a byte delta of the whole struct.
 typedef struct netactor_s
 {
     // actor fields
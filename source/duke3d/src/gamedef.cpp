@@ -34,6 +34,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #include "osd.h"
 #include "savegame.h"
 #include "vfs.h"
+#include "xxhash.h"
 
 #include "microprofile.h"
 
@@ -2026,6 +2027,111 @@ void C_AddFileOffset(int const offset, const char* fileName)
     vmoffset = newofs;
 }
 
+// Compiled script cache
+//
+// A successful compile writes the bytecode, the label table, the event and
+// tile tables and the top-level declarations that act outside of the script
+// image (gamevar, definequote, definesound, definelevelname and so on) to
+// g_scriptCacheFile. The next C_Compile() of the same sources loads the image
+// back and replays only those declarations instead of parsing everything.
+// The cache is keyed by an xxHash of every CON file that went into it and by
+// the build, so editing any of them or updating the game recompiles.
+
+#define CONCACHE_MAGIC   "EDuke32 compiled CON"
+#define CONCACHE_VERSION 1
+
+static char g_scriptCacheFile[BMAX_PATH];
+
+typedef struct
+{
+    char    *name;
+    int32_t  length;
+    uint64_t hash;
+} concachefile_t;
+
+static GrowArray<concachefile_t> g_scriptCacheFiles;
+static GrowArray<char *>         g_scriptCacheDecls;
+
+static bool        g_scriptCacheRecording;
+static char const *g_scriptCacheDeclStart;
+static int32_t     g_dynamicTileLabelStart = -1;
+
+static void C_CacheAddFile(const char *fileName, char const *data, int32_t length)
+{
+    if (g_scriptCacheRecording)
+        g_scriptCacheFiles.append({ Xstrdup(fileName), length, XXH3_64bits(data, length) });
+}
+
+static bool C_IsCachedDeclaration(int const tw)
+{
+    switch (tw)
+    {
+        case CON_CHEATKEYS:
+        case CON_DEFINECHEAT:
+        case CON_DEFINECHEATDESCRIPTION:
+        case CON_DEFINEGAMEFUNCNAME:
+        case CON_DEFINEGAMETYPE:
+        case CON_DEFINELEVELNAME:
+        case CON_DEFINEPROJECTILE:
+        case CON_DEFINEQUOTE:
+        case CON_DEFINESKILLNAME:
+        case CON_DEFINESOUND:
+        case CON_DEFINEVOLUMEFLAGS:
+        case CON_DEFINEVOLUMENAME:
+        case CON_DYNAMICREMAP:
+        case CON_DYNAMICSOUNDREMAP:
+        case CON_GAMEARRAY:
+        case CON_GAMESTARTUP:
+        case CON_GAMEVAR:
+        case CON_MUSIC:
+        case CON_REDEFINEQUOTE:
+        case CON_SETCFGNAME:
+        case CON_SETDEFNAME:
+        case CON_SETGAMENAME:
+        case CON_UNDEFINECHEAT:
+        case CON_UNDEFINEGAMEFUNC:
+        case CON_UNDEFINELEVEL:
+        case CON_UNDEFINESKILL:
+        case CON_UNDEFINEVOLUME:
+            return true;
+    }
+
+    return false;
+}
+
+// Called at the top of C_ParseCommand()'s loop: the previous command ends where the next one starts.
+static void C_CacheDeclaration(int const tw)
+{
+    if (g_scriptCacheDeclStart && C_IsCachedDeclaration(tw))
+    {
+        int const length = textptr - g_scriptCacheDeclStart;
+        auto decl = (char *)Xmalloc(length + 2);
+
+        Bmemcpy(decl, g_scriptCacheDeclStart, length);
+        decl[length]   = '\n';
+        decl[length+1] = '\0';
+
+        g_scriptCacheDecls.append(decl);
+    }
+
+    g_scriptCacheDeclStart = nullptr;
+}
+
+static void C_FreeScriptCache(void)
+{
+    for (auto &file : g_scriptCacheFiles)
+        Xfree(file.name);
+
+    for (auto decl : g_scriptCacheDecls)
+        Xfree(decl);
+
+    g_scriptCacheFiles.clear();
+    g_scriptCacheDecls.clear();
+
+    g_scriptCacheRecording = false;
+    g_scriptCacheDeclStart = nullptr;
+}
+
 static void C_Include(const char *confile)
 {
     buildvfs_kfd fp = kopen4loadfrommod(confile, g_loadFromGroupOnly);
@@ -2049,6 +2155,8 @@ static void C_Include(const char *confile)
 
     mptr[len] = 0;
 
+    C_CacheAddFile(confile, mptr, len);
+
     if (*textptr == '"') // skip past the closing quote if it's there so we don't screw up the next line
         textptr++;
 
@@ -2546,6 +2654,9 @@ static bool C_ParseCommand(bool loop /*= false*/)
 
     do
     {
+        if (g_scriptCacheRecording)
+            C_CacheDeclaration(g_lastKeyword);
+
         if (EDUKE32_PREDICT_FALSE(g_errorCnt > 63 || (*textptr == '\0') || (*(textptr+1) == '\0')))
             return 1;
 
@@ -2559,6 +2670,9 @@ static bool C_ParseCommand(bool loop /*= false*/)
 
         C_SkipComments();
 
+        if (g_scriptCacheRecording && !g_processingState && !g_scriptActorOffset && !g_scriptEventOffset)
+            g_scriptCacheDeclStart = textptr;
+
         switch ((g_lastKeyword = tw = C_GetNextKeyword()))
         {
         default:
@@ -2899,6 +3013,9 @@ DO_DEFSTATE:
                 {
                     hash_add(&h_labels,LAST_LABEL,g_labelCnt,0);
 
+                    if (g_dynamicTileLabelStart < 0 && g_dynamicTileMapping)
+                        g_dynamicTileLabelStart = g_labelCnt;
+
                     if ((unsigned)g_scriptPtr[-1] < MAXTILES && g_dynamicTileMapping)
                         G_ProcessDynamicNameMapping(LAST_LABEL, g_dynTileList, g_scriptPtr[-1]);
 
@@ -6651,11 +6768,9 @@ static int C_GetLabelIndex(int32_t val, int type)
     return -1;
 }
 
-void C_Compile(const char *fileName)
+static void C_InitCompiler(void)
 {
     Bmemset(apScriptEvents, 0, sizeof(apScriptEvents));
-    apScriptGameEventEnd = (intptr_t *)Xcalloc(MAXEVENTS, sizeof(intptr_t));
-    apScriptStateEnd = (intptr_t *)Xcalloc(MAXLABELS, sizeof(intptr_t));
 
     for (auto & i : g_tile)
         Bmemset(&i, 0, sizeof(tiledata_t));
@@ -6665,12 +6780,468 @@ void C_Compile(const char *fileName)
 
     Gv_Init();
     C_InitProjectiles();
+}
+
+static void C_FinishCompile(void)
+{
+    DO_FREE_AND_NULL(apScriptGameEventEnd);
+    DO_FREE_AND_NULL(apScriptStateEnd);
+    DO_FREE_AND_NULL(bitstate);
+
+    for (auto i : tables_free)
+        hash_free(i);
+
+    for (auto i : inttables)
+        inthash_free(i);
+
+    freehashnames();
+
+    if (g_scriptDebug)
+        C_PrintStats();
+
+    C_InitQuotes();
+
+#if MICROPROFILE_ENABLED != 0
+    for (int i=0; i<MAXEVENTS; i++)
+    {
+        if (VM_HaveEvent(i))
+        {
+            g_eventTokens[i]        = MicroProfileGetToken("CON VM Events", EventNames[i], MP_AUTO, MicroProfileTokenTypeCpu);
+            g_eventCounterTokens[i] = MicroProfileGetCounterToken(EventNames[i]);
+        }
+    }
+
+#if 0
+    for (int i=0; i<CON_END; i++)
+    {
+        Bassert(VM_GetKeywordForID(i) != nullptr);
+        g_instTokens[i] = MicroProfileGetToken("CON VM Instructions", VM_GetKeywordForID(i), MP_AUTO, MicroProfileTokenTypeCpu);
+    }
+#endif
+
+    for (int i=0; i<MAXSTATUS; i++)
+    {
+        Bsprintf(tempbuf,"statnum%d", i);
+        g_statnumTokens[i] = MicroProfileGetToken("CON VM Actors", tempbuf, MP_AUTO, MicroProfileTokenTypeCpu);
+    }
+#endif
+
+    for (int i=0; i<MAXTILES; i++)
+    {
+        int const index = C_GetLabelIndex(i, LABEL_ANY);
+
+        tempbuf[0] = 0;
+        g_tileLabels[i] = nullptr;
+
+        if (index != -1)
+        {
+            g_tileLabels[i] = label+(index<<6);
+            Bsprintf(tempbuf,"%s (%d)", label+(index<<6), i);
+        }
+        else if (G_TileHasActor(i))
+            Bsprintf(tempbuf,"unnamed (%d)", i);
+
+#if MICROPROFILE_ENABLED != 0
+        if (tempbuf[0])
+            g_actorTokens[i] = MicroProfileGetToken("CON VM Actors", tempbuf, MP_AUTO, MicroProfileTokenTypeCpu);
+#endif
+    }
+}
+
+static uint64_t C_ScriptCacheKey(const char *fileName)
+{
+    int32_t const params[] = { CONCACHE_VERSION, (int32_t)sizeof(intptr_t), MAXTILES, MAXLABELS, MAXEVENTS,
+                               g_scriptVersion, g_loadFromGroupOnly, g_gameType };
+
+    uint64_t key = XXH3_64bits(params, sizeof(params));
+
+    key = XXH3_64bits_withSeed(s_buildRev, Bstrlen(s_buildRev), key);
+    key = XXH3_64bits_withSeed(s_buildTimestamp, Bstrlen(s_buildTimestamp), key);
+    key = XXH3_64bits_withSeed(fileName, Bstrlen(fileName), key);
+
+    for (char const *m : g_scriptModules)
+        key = XXH3_64bits_withSeed(m, Bstrlen(m), key);
+
+    return key;
+}
+
+typedef struct
+{
+    int32_t  execPtr, loadPtr;
+    uint32_t flags;
+    int32_t  cacherange;
+} concachetile_t;
+
+enum
+{
+    CONCACHE_SCRIPTSIZE,
+    CONCACHE_SCRIPTLENGTH,
+    CONCACHE_LABELS,
+    CONCACHE_OFFSETS,
+    CONCACHE_OFFSETNAMES,
+    CONCACHE_DECLS,
+    CONCACHE_DECLSIZE,
+    CONCACHE_SCRIPTVERSION,
+    CONCACHE_TOTALLINES,
+    CONCACHE_DYNAMICTILELABEL,
+    CONCACHE_NUMINFO
+};
+
+static void C_WriteCacheBlock(buildvfs_FILE fil, void const *buf, int32_t size)
+{
+    if (size > 0)
+        dfwrite_LZ4(buf, size, 1, fil);
+}
+
+static bool C_ReadCacheBlock(buildvfs_kfd fil, void *buf, int32_t size)
+{
+    return size <= 0 || kdfread_LZ4(buf, size, 1, fil) == 1;
+}
+
+// <firstOffset> is the head of the vmoffset list before this compile added to it
+static void C_WriteScriptCache(uint64_t const key, struct vmofs const *firstOffset)
+{
+    buildvfs_FILE fil = buildvfs_fopen_write(g_scriptCacheFile);
+
+    if (!fil)
+    {
+        LOG_F(WARNING, "Unable to write compiled script cache %s.", g_scriptCacheFile);
+        return;
+    }
+
+    int32_t const numFiles = g_scriptCacheFiles.size();
+
+    buildvfs_fwrite(CONCACHE_MAGIC, sizeof(CONCACHE_MAGIC), 1, fil);
+    buildvfs_fwrite(&key, sizeof(key), 1, fil);
+    buildvfs_fwrite(&numFiles, sizeof(numFiles), 1, fil);
+
+    for (auto const &file : g_scriptCacheFiles)
+    {
+        int32_t const nameLength = Bstrlen(file.name);
+
+        buildvfs_fwrite(&nameLength, sizeof(nameLength), 1, fil);
+        buildvfs_fwrite(file.name, nameLength, 1, fil);
+        buildvfs_fwrite(&file.length, sizeof(file.length), 1, fil);
+        buildvfs_fwrite(&file.hash, sizeof(file.hash), 1, fil);
+    }
+
+    int32_t info[CONCACHE_NUMINFO] = {};
+
+    for (auto ofs = vmoffset; ofs != firstOffset; ofs = ofs->next)
+    {
+        info[CONCACHE_OFFSETS]++;
+        info[CONCACHE_OFFSETNAMES] += Bstrlen(ofs->fn) + 1;
+    }
+
+    for (auto decl : g_scriptCacheDecls)
+        info[CONCACHE_DECLSIZE] += Bstrlen(decl) + 1;
+
+    info[CONCACHE_SCRIPTSIZE]       = g_scriptSize;
+    info[CONCACHE_SCRIPTLENGTH]     = g_scriptPtr - apScript;
+    info[CONCACHE_LABELS]           = g_labelCnt;
+    info[CONCACHE_DECLS]            = g_scriptCacheDecls.size();
+    info[CONCACHE_SCRIPTVERSION]    = g_scriptVersion;
+    info[CONCACHE_TOTALLINES]       = g_totalLines;
+    info[CONCACHE_DYNAMICTILELABEL] = g_dynamicTileLabelStart;
+
+    buildvfs_fwrite(info, sizeof(info), 1, fil);
+
+    // pointers within the script are stored as offsets
+    auto script = (intptr_t *)Xmalloc(g_scriptSize * sizeof(intptr_t));
+
+    for (int i = 0; i < g_scriptSize; i++)
+        script[i] = bitmap_test(bitptr, i) ? apScript[i] - (intptr_t)apScript : apScript[i];
+
+    C_WriteCacheBlock(fil, script, g_scriptSize * sizeof(intptr_t));
+    C_WriteCacheBlock(fil, bitptr, bitmap_size(g_scriptSize) + 1);
+
+    Xfree(script);
+
+    C_WriteCacheBlock(fil, label, g_labelCnt << 6);
+    C_WriteCacheBlock(fil, labelcode, g_labelCnt * sizeof(int32_t));
+    C_WriteCacheBlock(fil, labeltype, g_labelCnt * sizeof(uint8_t));
+    C_WriteCacheBlock(fil, apScriptEvents, sizeof(apScriptEvents));
+
+    auto tiles = (concachetile_t *)Xmalloc(MAXTILES * sizeof(concachetile_t));
+
+    for (int i = 0; i < MAXTILES; i++)
+    {
+        auto const &tile = g_tile[i];
+        tiles[i] = { tile.execPtr ? (int32_t)(tile.execPtr - apScript) : 0, tile.loadPtr ? (int32_t)(tile.loadPtr - apScript) : 0,
+                     tile.flags, tile.cacherange };
+    }
+
+    C_WriteCacheBlock(fil, tiles, MAXTILES * sizeof(concachetile_t));
+    Xfree(tiles);
+
+    // file offsets oldest first, so reading them back with C_AddFileOffset() rebuilds the same list
+    auto offsets = (int32_t *)Xmalloc(max(info[CONCACHE_OFFSETS], 1) * sizeof(int32_t));
+    auto names   = (char *)Xmalloc(max(info[CONCACHE_OFFSETNAMES], 1));
+    int  nameofs = info[CONCACHE_OFFSETNAMES];
+    int  i       = info[CONCACHE_OFFSETS];
+
+    for (auto ofs = vmoffset; ofs != firstOffset; ofs = ofs->next)
+    {
+        int const len = Bstrlen(ofs->fn) + 1;
+
+        nameofs -= len;
+        Bmemcpy(names + nameofs, ofs->fn, len);
+        offsets[--i] = ofs->offset;
+    }
+
+    C_WriteCacheBlock(fil, offsets, info[CONCACHE_OFFSETS] * sizeof(int32_t));
+    C_WriteCacheBlock(fil, names, info[CONCACHE_OFFSETNAMES]);
+
+    Xfree(offsets);
+    Xfree(names);
+
+    auto decls = (char *)Xmalloc(max(info[CONCACHE_DECLSIZE], 1));
+    auto declptr = decls;
+
+    for (auto decl : g_scriptCacheDecls)
+    {
+        int const len = Bstrlen(decl) + 1;
+        Bmemcpy(declptr, decl, len);
+        declptr += len;
+    }
+
+    C_WriteCacheBlock(fil, decls, info[CONCACHE_DECLSIZE]);
+    Xfree(decls);
+
+    buildvfs_fclose(fil);
+}
+
+static bool C_CheckCachedFile(const char *fileName, int32_t const length, uint64_t const hash)
+{
+    buildvfs_kfd kFile = kopen4loadfrommod(fileName, g_loadFromGroupOnly);
+
+    if (kFile == buildvfs_kfd_invalid)
+        return false;
+
+    bool match = false;
+
+    if (kfilelength(kFile) == length)
+    {
+        auto buf = (char *)Xmalloc(max(length, 1));
+        match = kread(kFile, buf, length) == length && XXH3_64bits(buf, length) == hash;
+        Xfree(buf);
+    }
+
+    kclose(kFile);
+
+    return match;
+}
+
+// Returns true if the cache matched and the compiled script was loaded from it. Nothing is
+// changed unless the whole cache reads back, except when replaying its declarations fails,
+// in which case the compiler is reset for a regular compile.
+static bool C_LoadScriptCache(uint64_t const key)
+{
+    buildvfs_kfd fil = kopen4load(g_scriptCacheFile, 0);
+
+    if (fil == buildvfs_kfd_invalid)
+        return false;
+
+    char     magic[sizeof(CONCACHE_MAGIC)];
+    uint64_t fileKey;
+    int32_t  numFiles;
+
+    if (kread_and_test(fil, magic, sizeof(magic)) || Bmemcmp(magic, CONCACHE_MAGIC, sizeof(magic))
+        || kread_and_test(fil, &fileKey, sizeof(fileKey)) || fileKey != key || kread_and_test(fil, &numFiles, sizeof(numFiles)))
+    {
+        kclose(fil);
+        return false;
+    }
+
+    // every file that went into the cache has to read back the same
+    for (int i = 0; i < numFiles; i++)
+    {
+        char     name[BMAX_PATH];
+        int32_t  nameLength, length;
+        uint64_t hash;
+
+        if (kread_and_test(fil, &nameLength, sizeof(nameLength)) || (unsigned)nameLength >= BMAX_PATH
+            || kread_and_test(fil, name, nameLength) || kread_and_test(fil, &length, sizeof(length))
+            || kread_and_test(fil, &hash, sizeof(hash)))
+        {
+            kclose(fil);
+            return false;
+        }
+
+        name[nameLength] = '\0';
+
+        if (!C_CheckCachedFile(name, length, hash))
+        {
+            VLOG_F(LOG_CON, "%s has changed, recompiling.", name);
+            kclose(fil);
+            return false;
+        }
+    }
+
+    int32_t info[CONCACHE_NUMINFO];
+
+    if (kread_and_test(fil, info, sizeof(info)) || info[CONCACHE_SCRIPTSIZE] <= 0
+        || (unsigned)info[CONCACHE_SCRIPTLENGTH] > (unsigned)info[CONCACHE_SCRIPTSIZE] || (unsigned)info[CONCACHE_LABELS] > MAXLABELS
+        || info[CONCACHE_OFFSETS] < 0 || info[CONCACHE_OFFSETNAMES] < 0 || info[CONCACHE_DECLS] < 0 || info[CONCACHE_DECLSIZE] < 0)
+    {
+        kclose(fil);
+        return false;
+    }
+
+    int32_t const scriptSize = info[CONCACHE_SCRIPTSIZE];
+    int32_t const labelCnt   = info[CONCACHE_LABELS];
+
+    auto script    = (intptr_t *)Xmalloc(scriptSize * sizeof(intptr_t));
+    auto scriptbit = (uint8_t *)Xcalloc(1, bitmap_size(scriptSize) + 1);
+    auto labels    = (char *)Xmalloc((labelCnt << 6) + 1);
+    auto codes     = (int32_t *)Xmalloc(labelCnt * sizeof(int32_t) + 1);
+    auto types     = (uint8_t *)Xmalloc(labelCnt + 1);
+    auto tiles     = (concachetile_t *)Xmalloc(MAXTILES * sizeof(concachetile_t));
+    auto offsets   = (int32_t *)Xmalloc(info[CONCACHE_OFFSETS] * sizeof(int32_t) + 1);
+    auto names     = (char *)Xmalloc(info[CONCACHE_OFFSETNAMES] + 1);
+    auto decls     = (char *)Xmalloc(info[CONCACHE_DECLSIZE] + 1);
+
+    intptr_t events[MAXEVENTS];
+
+    bool const ok = C_ReadCacheBlock(fil, script, scriptSize * sizeof(intptr_t))
+                    && C_ReadCacheBlock(fil, scriptbit, bitmap_size(scriptSize) + 1)
+                    && C_ReadCacheBlock(fil, labels, labelCnt << 6)
+                    && C_ReadCacheBlock(fil, codes, labelCnt * sizeof(int32_t))
+                    && C_ReadCacheBlock(fil, types, labelCnt * sizeof(uint8_t))
+                    && C_ReadCacheBlock(fil, events, sizeof(events))
+                    && C_ReadCacheBlock(fil, tiles, MAXTILES * sizeof(concachetile_t))
+                    && C_ReadCacheBlock(fil, offsets, info[CONCACHE_OFFSETS] * sizeof(int32_t))
+                    && C_ReadCacheBlock(fil, names, info[CONCACHE_OFFSETNAMES])
+                    && C_ReadCacheBlock(fil, decls, info[CONCACHE_DECLSIZE]);
+
+    kclose(fil);
+
+    auto const freeBuffers = [&]() {
+        Xfree(script);
+        Xfree(scriptbit);
+        Xfree(labels);
+        Xfree(codes);
+        Xfree(types);
+        Xfree(tiles);
+        Xfree(offsets);
+        Xfree(names);
+        Xfree(decls);
+    };
+
+    if (!ok)
+    {
+        LOG_F(WARNING, "Compiled script cache %s is damaged, recompiling.", g_scriptCacheFile);
+        freeBuffers();
+        return false;
+    }
+
+    // labels go first: the declarations refer to them
+    Bmemcpy(label, labels, labelCnt << 6);
+    Bmemcpy(labelcode, codes, labelCnt * sizeof(int32_t));
+    Bmemcpy(labeltype, types, labelCnt * sizeof(uint8_t));
+
+    for (g_labelCnt = 0; g_labelCnt < labelCnt; g_labelCnt++)
+        hash_add(&h_labels, label + (g_labelCnt << 6), g_labelCnt, 0);
+
+    // replay the declarations into the scratch script C_Compile() allocated
+    auto const origTextPtr       = textptr;
+    auto const origScriptPtr     = g_scriptPtr;
+    int const  origScriptVersion = g_scriptVersion;
+    auto decl = decls;
+
+    for (int i = 0; i < info[CONCACHE_DECLS] && !g_errorCnt; i++)
+    {
+        textptr      = decl;
+        g_scriptPtr  = apScript + 3;
+        g_lineNumber = 1;
+
+        C_ParseCommand();
+
+        decl += Bstrlen(decl) + 1;
+    }
+
+    if (g_errorCnt)
+    {
+        LOG_F(WARNING, "Replaying the declarations in compiled script cache %s failed, recompiling.", g_scriptCacheFile);
+        freeBuffers();
+
+        Bmemset(apScript, 0, g_scriptSize * sizeof(intptr_t));
+        Bmemset(bitptr, 0, bitmap_size(g_scriptSize) + 1);
+
+        textptr         = origTextPtr;
+        g_scriptPtr     = origScriptPtr;
+        g_scriptVersion = origScriptVersion;
+        g_lineNumber    = 1;
+
+        g_labelCnt = g_errorCnt = g_warningCnt = 0;
+        C_InitCompiler();
+
+        return false;
+    }
+
+    Xfree(apScript);
+    Xfree(bitptr);
+
+    apScript     = script;
+    bitptr       = scriptbit;
+    g_scriptSize = scriptSize;
+    g_scriptPtr  = apScript + info[CONCACHE_SCRIPTLENGTH];
+
+    for (int i = 0; i < g_scriptSize; i++)
+        if (bitmap_test(bitptr, i))
+            apScript[i] += (intptr_t)apScript;
+
+    Bmemcpy(apScriptEvents, events, sizeof(apScriptEvents));
+
+    for (int i = 0; i < MAXTILES; i++)
+    {
+        auto &tile = g_tile[i];
+
+        tile.execPtr    = tiles[i].execPtr ? apScript + tiles[i].execPtr : nullptr;
+        tile.loadPtr    = tiles[i].loadPtr ? apScript + tiles[i].loadPtr : nullptr;
+        tile.flags      = tiles[i].flags;
+        tile.cacherange = tiles[i].cacherange;
+    }
+
+    auto name = names;
+
+    for (int i = 0; i < info[CONCACHE_OFFSETS]; i++)
+    {
+        C_AddFileOffset(offsets[i], name);
+        name += Bstrlen(name) + 1;
+    }
+
+    g_scriptVersion = info[CONCACHE_SCRIPTVERSION];
+    g_totalLines    = info[CONCACHE_TOTALLINES];
+
+    // defines after dynamicremap map the tile names they match; the replay skipped them
+    if ((g_dynamicTileLabelStart = info[CONCACHE_DYNAMICTILELABEL]) >= 0)
+    {
+        for (int i = g_dynamicTileLabelStart; i < g_labelCnt; i++)
+            if ((labeltype[i] & LABEL_DEFINE) && (unsigned)labelcode[i] < MAXTILES)
+                G_ProcessDynamicNameMapping(label + (i << 6), g_dynTileList, labelcode[i]);
+    }
+
+    script    = nullptr;
+    scriptbit = nullptr;
+    freeBuffers();
+
+    return true;
+}
+
+void C_Compile(const char *fileName)
+{
+    apScriptGameEventEnd = (intptr_t *)Xcalloc(MAXEVENTS, sizeof(intptr_t));
+    apScriptStateEnd = (intptr_t *)Xcalloc(MAXLABELS, sizeof(intptr_t));
+    g_dynamicTileLabelStart = -1;
+
+    C_InitCompiler();
 
     buildvfs_kfd kFile = kopen4loadfrommod(fileName, g_loadFromGroupOnly);
 
     if (kFile == buildvfs_kfd_invalid) // JBF: was 0
     {
-        if (g_loadFromGroupOnly || (numgroupfiles == 0 && !kzfs.leng))
+        if (g_loadFromGroupOnly || (numgroupfiles == 0 && !kzhasfiles()))
         {
 #ifndef EDUKE32_STANDALONE
             char const *gf = G_GrpFile();
@@ -6695,8 +7266,6 @@ void C_Compile(const char *fileName)
 
     VLOG_F(LOG_CON, "Compiling: %s (%d bytes)", fileName, kFileLen);
 
-    C_AddFileOffset(0, fileName);
-
     uint32_t const startcompiletime = timerGetTicks();
 
     char * mptr = (char *)Xmalloc(kFileLen+1);
@@ -6721,6 +7290,32 @@ void C_Compile(const char *fileName)
 
     Bstrcpy(g_scriptFileName, fileName);
 
+    G_ModDirSnprintfLite(g_scriptCacheFile, sizeof(g_scriptCacheFile), "concache");
+
+    uint64_t const cacheKey = C_ScriptCacheKey(fileName);
+
+    if (C_LoadScriptCache(cacheKey))
+    {
+        DO_FREE_AND_NULL(mptr);
+
+        for (char * m : g_scriptModules)
+            Xfree(m);
+        g_scriptModules.clear();
+
+        VLOG_F(LOG_CON, "Loaded %d bytes of compiled script from %s in %ums%s", (int)((intptr_t)g_scriptPtr - (intptr_t)apScript),
+                   g_scriptCacheFile, timerGetTicks() - startcompiletime, C_ScriptVersionString(g_scriptVersion));
+
+        C_FinishCompile();
+        return;
+    }
+
+    auto const firstOffset = vmoffset;
+
+    C_AddFileOffset(0, fileName);
+
+    g_scriptCacheRecording = true;
+    C_CacheAddFile(fileName, mptr, kFileLen);
+
     C_AddDefaultDefinitions();
     C_ParseCommand(true);
 
@@ -6744,7 +7339,7 @@ void C_Compile(const char *fileName)
 
         if (g_errorCnt)
         {
-            if (g_loadFromGroupOnly || (numgroupfiles == 0 && !kzfs.leng))
+            if (g_loadFromGroupOnly || (numgroupfiles == 0 && !kzhasfiles()))
             {
 #ifndef EDUKE32_STANDALONE
 err:
@@ -6778,6 +7373,7 @@ err:
             DO_FREE_AND_NULL(apScriptStateEnd);
 
             Gv_Clear();
+            C_FreeScriptCache();
 
             return;
         }
@@ -6832,71 +7428,13 @@ err:
 
     C_SetScriptSize(g_scriptPtr-apScript+8);
 
+    C_WriteScriptCache(cacheKey, firstOffset);
+    C_FreeScriptCache();
+
     VLOG_F(LOG_CON, "Compiled %d bytes in %ums%s", (int)((intptr_t)g_scriptPtr - (intptr_t)apScript),
                timerGetTicks() - startcompiletime, C_ScriptVersionString(g_scriptVersion));
 
-    DO_FREE_AND_NULL(apScriptGameEventEnd);
-    DO_FREE_AND_NULL(apScriptStateEnd);
-    DO_FREE_AND_NULL(bitstate);
-
-    for (auto i : tables_free)
-        hash_free(i);
-
-    for (auto i : inttables)
-        inthash_free(i);
-
-    freehashnames();
-
-    if (g_scriptDebug)
-        C_PrintStats();
-
-    C_InitQuotes();
-
-#if MICROPROFILE_ENABLED != 0
-    for (int i=0; i<MAXEVENTS; i++)
-    {
-        if (VM_HaveEvent(i))
-        {
-            g_eventTokens[i]        = MicroProfileGetToken("CON VM Events", EventNames[i], MP_AUTO, MicroProfileTokenTypeCpu);
-            g_eventCounterTokens[i] = MicroProfileGetCounterToken(EventNames[i]);
-        }
-    }
-
-#if 0
-    for (int i=0; i<CON_END; i++)
-    {
-        Bassert(VM_GetKeywordForID(i) != nullptr);
-        g_instTokens[i] = MicroProfileGetToken("CON VM Instructions", VM_GetKeywordForID(i), MP_AUTO, MicroProfileTokenTypeCpu);
-    }
-#endif
-
-    for (int i=0; i<MAXSTATUS; i++)
-    {
-        Bsprintf(tempbuf,"statnum%d", i);
-        g_statnumTokens[i] = MicroProfileGetToken("CON VM Actors", tempbuf, MP_AUTO, MicroProfileTokenTypeCpu);
-    }
-#endif
-
-    for (int i=0; i<MAXTILES; i++)
-    {
-        int const index = C_GetLabelIndex(i, LABEL_ANY);
-
-        tempbuf[0] = 0;
-        g_tileLabels[i] = nullptr;
-
-        if (index != -1)
-        {
-            g_tileLabels[i] = label+(index<<6);
-            Bsprintf(tempbuf,"%s (%d)", label+(index<<6), i);
-        }
-        else if (G_TileHasActor(i))
-            Bsprintf(tempbuf,"unnamed (%d)", i);
-
-#if MICROPROFILE_ENABLED != 0
-        if (tempbuf[0])
-            g_actorTokens[i] = MicroProfileGetToken("CON VM Actors", tempbuf, MP_AUTO, MicroProfileTokenTypeCpu);
-#endif
-    }
+    C_FinishCompile();
 }
 
 void C_ReportError(int error)
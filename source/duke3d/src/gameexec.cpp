@@ -2659,6 +2659,12 @@ GAMEEXEC_STATIC void VM_Execute(int vm_execution_depth /*= false*/)
                     auto const &wallLabel = WallLabels[*insptr++];
 
                     VM_SetStruct(wallLabel.flags, (intptr_t *)((char *)&wall[wallNum] + wallLabel.offset), Gv_GetVar(*insptr++));
+
+                    if (wallLabel.lId == WALL_X || wallLabel.lId == WALL_Y)
+                        sectorgrid_updatewall(wallNum);
+                    else if (wallLabel.lId == WALL_POINT2)
+                        sectorgrid_invalidate();
+
                     dispatch();
                 }
 
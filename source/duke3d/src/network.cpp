@@ -37,6 +37,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 
 #include "enet.h"
 #include "lz4.h"
+#include "netdelta.h"
 #include "crc32.h"
 
 #include "vfs.h"
@@ -212,221 +213,23 @@ static int32_t g_chatPlayer = -1;
 // also NETINDEX_BITS should not exceed 32
 #define NETINDEX_BITS (16 + 1)
 
+// A world update carries the byte delta (see netdelta.h) from the last snapshot the client
+// acknowledged to the server's newest one, for the walls, sectors and actors in that order.
+// The delta is LZ4 compressed whenever that makes it smaller.
+//
+// {PACKET_WORLD_UPDATE, <from revision:32>, <to revision:32>, <flags:8>, <delta size:32>, <delta>}
+#define WORLD_HEADERSIZE (1 + 4 + 4 + 1 + 4)
 
-// worst case: 2 bits per field per stuct if every field in every struct is changed
-#define WORLD_CHANGEBITSSIZE                                                                                                               \
-    (MAXWALLS * ARRAY_SIZE(WallFields) * 2) + (MAXSECTORS * ARRAY_SIZE(SectorFields) * 2) + (MAXSPRITES * ARRAY_SIZE(ActorFields) * 2)
-
-//                              each changed entry has a netindex + stop codes                  bits to indicate whether a field
-//                              changed/zeroed                 convert to bytes....
-#define WORLD_OVERHEADSIZE (((MAXSECTORS + MAXWALLS + MAXSPRITES + 3) * NETINDEX_BITS + WORLD_CHANGEBITSSIZE) >> 8) + 1
-
-
-typedef struct netField_s
-{
-    const char  *name;      // field name
-    int32_t     offset;     // offset from the start of the entity struct
-    int32_t     bits;       // field size
-
-} netField_t;
-
-#define	SECTF(x) #x,(int32_t)(size_t)&((netSector_t*)0)->x
-
-static netField_t SectorFields[] =
-{
-    { SECTF(wallptr),                16 },
-    { SECTF(wallnum),                16 },
-
-    { SECTF(ceilingz),                   32 },
-    { SECTF(floorz),                     32 },
-
-    { SECTF(ceilingstat),           16 },
-    { SECTF(floorstat),             16 },
-    { SECTF(ceilingpicnum),         16 },
-    { SECTF(ceilingheinum),         16 },
-
-    { SECTF(ceilingshade),       8 },
-    { SECTF(ceilingpal),         8 },
-    { SECTF(ceilingxpanning),    8 },
-    { SECTF(ceilingypanning),    8 },
-
-    { SECTF(floorpicnum),           16 },
-    { SECTF(floorheinum),           16 },
-
-    { SECTF(floorshade),         8 },
-    { SECTF(floorpal),           8 },
-    { SECTF(floorxpanning),      8 },
-    { SECTF(floorypanning),      8 },
-    { SECTF(visibility),         8 },
-    { SECTF(fogpal),             8 },
-
-    { SECTF(lotag),                  16 },
-    { SECTF(hitag),                  16 },
-    { SECTF(extra),                  16 },
-
-};
-
-#undef SECTF
-
-
-#define	WALLF(x) #x,(int32_t)(size_t)&((netWall_t*)0)->x
-
-static netField_t WallFields[] =
-{
-    { WALLF(x),                          32 },
-    { WALLF(y),                          32 },
-
-    { WALLF(point2),                 16 },
-    { WALLF(nextwall),               16 },
-    { WALLF(nextsector),             16 },
-
-    { WALLF(cstat),                  16 },
-    { WALLF(picnum),                 16 },
-    { WALLF(overpicnum),             16 },
-
-    { WALLF(shade),              8 },
-    { WALLF(pal),                8 },
-    { WALLF(xrepeat),            8 },
-    { WALLF(yrepeat),            8 },
-    { WALLF(xpanning),           8 },
-    { WALLF(ypanning),           8 },
-
-    { WALLF(lotag),                  16 },
-    { WALLF(hitag),                  16 },
-    { WALLF(extra),                  16 },
-
-};
-
-#undef WALLF
-
+#define WORLD_DELTASIZE                                                                                                                    \
+    (netDeltaBound(MAXWALLS * sizeof(netWall_t)) + netDeltaBound(MAXSECTORS * sizeof(netSector_t)) + netDeltaBound(MAXSPRITES * sizeof(netactor_t)))
 
-#define	ACTF(x) #x,(int32_t)(size_t)&((netactor_t*)0)->x
+// max packet array size
+#define MAX_WORLDBUFFER (WORLD_HEADERSIZE + LZ4_COMPRESSBOUND(WORLD_DELTASIZE))
 
-static netField_t ActorFields[] =
+enum networldflags_t
 {
-    { ACTF(t_data_0),                   32 },
-    { ACTF(t_data_1),                   32 },
-    { ACTF(t_data_2),                   32 },
-    { ACTF(t_data_3),                   32 },
-    { ACTF(t_data_4),                   32 },
-    { ACTF(t_data_5),                   32 },
-    { ACTF(t_data_6),                   32 },
-    { ACTF(t_data_7),                   32 },
-    { ACTF(t_data_8),                   32 },
-    { ACTF(t_data_9),                   32 },
-
-    { ACTF(flags),                      32 },
-
-    { ACTF(bpos_x),                     32 },
-    { ACTF(bpos_y),                     32 },
-    { ACTF(bpos_z),                     32 },
-
-    { ACTF(floorz),                     32 },
-    { ACTF(ceilingz),                   32 },
-    { ACTF(lastvx),                     32 },
-    { ACTF(lastvy),                     32 },
-
-    { ACTF(lasttransport),  8},
-
-    { ACTF(htpicnum),             16 },
-    { ACTF(htang),                16 },
-    { ACTF(htextra),              16 },
-    { ACTF(htowner),              16 },
-
-    { ACTF(movflag),            16 },
-    { ACTF(tempang),            16 },
-    { ACTF(timetosleep),        16 },
-
-    { ACTF(stayput),            16 },
-    { ACTF(floorzoffset),        8 },
-    { ACTF(waterzoffset),        8 },
-    { ACTF(dispicnum),          16 },
-
-    { ACTF(cgg),            8},
-
-    //------------------------------------------------------
-    // sprite fields
-
-    { ACTF(spr_x),                          32 },
-    { ACTF(spr_y),                          32 },
-    { ACTF(spr_z),                          32 },
-
-    { ACTF(spr_cstat),          16 },
-
-    { ACTF(spr_picnum),         16 },
-    { ACTF(spr_shade),      8 },
-    { ACTF(spr_pal),        8 },
-    { ACTF(spr_clipdist),   8 },
-    { ACTF(spr_blend),      8 },
-    { ACTF(spr_xrepeat),    8 },
-    { ACTF(spr_yrepeat),    8 },
-    { ACTF(spr_xoffset),    8 },
-    { ACTF(spr_yoffset),    8 },
-
-    { ACTF(spr_sectnum),        16 },
-    { ACTF(spr_statnum),        16 },
-
-    { ACTF(spr_ang),            16 },
-    { ACTF(spr_owner),          16 },
-    { ACTF(spr_xvel),           16 },
-    { ACTF(spr_yvel),           16 },
-    { ACTF(spr_zvel),           16 },
-
-    { ACTF(spr_lotag),          16 },
-    { ACTF(spr_hitag),          16 },
-
-    { ACTF(spr_extra),          16 },
-
-    //--------------------------------------------------------------
-    //spriteext fields
-
-    { ACTF(ext_mdanimtims),                 32 },
-    { ACTF(ext_mdanimcur),      16 },
-    { ACTF(ext_angoff),         16 },
-    { ACTF(ext_pitch),          16 },
-    { ACTF(ext_roll),           16 },
-
-    { ACTF(ext_pivot_offset_x),                   32 },
-    { ACTF(ext_pivot_offset_y),                   32 },
-    { ACTF(ext_pivot_offset_z),                   32 },
-
-    { ACTF(ext_position_offset_x),                   32 },
-    { ACTF(ext_position_offset_y),                   32 },
-    { ACTF(ext_position_offset_z),                   32 },
-
-    { ACTF(ext_flags),      8 },
-    { ACTF(ext_xpanning),   8 },
-    { ACTF(ext_ypanning),   8 },
-    { ACTF(ext_alpha),                                  0 }, // float
-
-    //--------------------------------------------------------------
-    //spritesmooth fields
-
-    { ACTF(sm_smoothduration),                          0 }, // float
-    { ACTF(sm_mdcurframe),      16 },
-    { ACTF(sm_mdoldframe),      16 },
-    { ACTF(sm_mdsmooth),        16 },
-
-
-
+    WORLD_LZ4 = 1,
 };
-#undef ACTF
-
-// actual game struct data size
-#define WORLD_DATASIZE (MAXSECTORS * sizeof(netSector_t) + MAXWALLS * sizeof(netWall_t) + MAXSPRITES * sizeof(netactor_t))
-
-// max packet array size
-#define MAX_WORLDBUFFER WORLD_DATASIZE + WORLD_OVERHEADSIZE
-
-#ifdef CURRENTLY_UNUSED
-// Just so you can get an idea of how much memory the netcode needs...
-static const int64_t cWORLD_DataSize     = WORLD_DATASIZE;
-static const int64_t cWORLD_OverheadSize = WORLD_OVERHEADSIZE;
-static const int64_t cWORLD_TotalSize    = MAX_WORLDBUFFER;
-
-// ...it's pretty big for now (!)
-static const int64_t SnapshotArraySize = sizeof(netmapstate_t) * NET_REVISIONS;
-#endif
 
 
 // both the client and server store their current revision number here,
@@ -447,6 +250,13 @@ static netmapstate_t *g_cl_InterpolatedMapStateHistory[NET_REVISIONS];
 // to get the index into this array out of a map state number, do <Map state number> % NET_REVISONS
 static netmapstate_t *g_mapStateHistory[NET_REVISIONS];
 static uint8_t       *tempnetbuf;
+static uint8_t       *netdeltabuf;
+
+// the last world update the server encoded is still in tempnetbuf, other clients that acknowledged
+// the same revision get sent it again instead of a new encode
+static uint32_t g_netWorldUpdateFrom;
+static uint32_t g_netWorldUpdateTo;
+static int32_t  g_netWorldUpdateSize;
 
 // Remember that this constant needs to be one bit longer than a struct index, so it can't be mistaken for a valid wall, sprite, or sector index
 static const int32_t cSTOP_PARSING_CODE = ((1 << NETINDEX_BITS) - 1);
@@ -469,6 +279,7 @@ static void Net_AllocatePacketBuffer(void)
         return;
 
     tempnetbuf = (uint8_t *)Xmalloc(MAX_WORLDBUFFER);
+    netdeltabuf = (uint8_t *)Xmalloc(WORLD_DELTASIZE);
 }
 
 //Adds a sprite with index 'spriteIndex' to the netcode's internal scratch sprite list,
@@ -586,14 +397,6 @@ static void Net_Error_Disconnect(const char* message)
     Bassert(0);
 }
 
-static void Net_InitNetActor(netactor_t *netActor)
-{
-
-    *(netActor) = cNullNetActor;
-
-    netActor->netIndex = cSTOP_PARSING_CODE;
-}
-
 // Low level "Copy net structs to / from game structs" functions
 //------------------------------------------------------------------------------
 // Net -> Game Arrays
@@ -2614,1731 +2417,236 @@ static void Net_ResetPlayerReady()
 //---------------------------------------------------------------------------------------------------------------------------------
 
 
-// enforce signed/unsigned and overflow behavior for WriteBits smaller than 32
-// remember that all of the WriteX functions only take 32 bit integers as input...
-#define PICKY_TYPECHECK 1
-
-#define MAX_PACKET_STRING 1024
-
-#define LOG_MESSAGE_BITS 1
-
-#define NetNumberOfIndexes (1 << NETINDEX_BITS)
-#define IndexesOK (MAXWALLS < NetNumberOfIndexes) && (MAXSPRITES < NetNumberOfIndexes) && (MAXSECTORS < NetNumberOfIndexes)
-
-#if(!IndexesOK)
-#error "network.cpp: game arrays are now too big to send over the network, please update NETINDEX_BITS to be the right length to store a wall, sprite, and sector index"
-#endif
-
-#define STRUCTINDEX_BITS 8 // hopefully no game structs ever have more than 255 fields....
-
-#define DEBUG_CHANGEDINDEXES 1
-
-#define	FLOAT_INT_BITS	13
-
-// remember that the minimum negative number is the sign bit + all zeros
-const int32_t cTruncInt_Min = -(1 << (FLOAT_INT_BITS - 1));
-const int32_t cTruncInt_Max = (1 << (FLOAT_INT_BITS - 1)) - 1;
-
-typedef struct NetBuffer_s
+// Walls and sectors past numwalls and numsectors are never filled in, so only the used part
+// of those arrays is compared.
+static int32_t Net_WriteWorldDelta(uint8_t *deltaBuffer, const netmapstate_t* fromSnapshot, const netmapstate_t* toSnapshot)
 {
-    uint8_t     *Data;
-    int32_t     Bit;
-    int32_t     ReadCurByte;
-    int32_t     CurSize;
-    int32_t     MaxSize; // set in NetBuffer_Init to the size of the byte array that this struct referrs to in Data
-} NetBuffer_t;
-
-// NOTE: does NOT fill byteArray with zeros
-static void NetBuffer_Init(NetBuffer_t *buffer, uint8_t *byteArray, int32_t arrayLength)
-{
-    // fill all the entries of the netbuffer struct (reminder: the byte array is not part of the struct)
-    Bmemset(buffer, 0, sizeof(*buffer));
-    buffer->Data = byteArray;
-    buffer->MaxSize = arrayLength;
-}
-
+    Bassert(fromSnapshot != nullptr);
+    Bassert(toSnapshot != nullptr);
 
-///<summary>
-///guarantees that the destination string will be nul terminated
-///</summary>
-static void SafeStrncpyz(char *dest, const char *src, int destsize)
-{
-    if (!dest || !src || (destsize <= 0))
-    {
+    uint8_t *bufPtr = deltaBuffer;
 
-        Bassert(dest);
-        Bassert(src);
-        Bassert(destsize > 0);
-        Net_Error_Disconnect("SafeStrncpyz: Invalid src, dest, or datasize.");
-        return;
-    }
+    bufPtr += netDeltaEncode(fromSnapshot->wall, toSnapshot->wall, numwalls * sizeof(netWall_t), bufPtr);
+    bufPtr += netDeltaEncode(fromSnapshot->sector, toSnapshot->sector, numsectors * sizeof(netSector_t), bufPtr);
+    bufPtr += netDeltaEncode(fromSnapshot->actor, toSnapshot->actor, MAXSPRITES * sizeof(netactor_t), bufPtr);
 
-    strncpy(dest, src, destsize - 1);
-    dest[destsize - 1] = 0;
+    return bufPtr - deltaBuffer;
 }
 
-// Write a bit (bitValue) to a byte array (dataBuffer) at bit offset bitOffset,
-// this function increments bitOffset for you.
-static void PutBit(int32_t bitValue, uint8_t *dataBuffer, int32_t *bitOffset)
+// Using oldSnapshot as the "From" snapshot, apply the delta to make newSnapshot.
+static bool Net_ReadWorldDelta(const uint8_t *deltaBuffer, int32_t deltaSize, const netmapstate_t* oldSnapshot, netmapstate_t* newSnapshot)
 {
-    int32_t bitOffsetValue = *bitOffset;
+    Bassert(oldSnapshot != nullptr);
+    Bassert(newSnapshot != nullptr);
 
-    const int32_t byteIndex = bitOffsetValue >> 3;
-    const int32_t bitIndex = bitOffsetValue & 7;
+    int32_t const wallSize   = numwalls * sizeof(netWall_t);
+    int32_t const sectorSize = numsectors * sizeof(netSector_t);
+    int32_t const actorSize  = MAXSPRITES * sizeof(netactor_t);
 
-    // reset this byte to 0 on the first bit
-    if ((bitIndex) == 0)
+    if (oldSnapshot != newSnapshot)
     {
-        dataBuffer[byteIndex] = 0;
+        Bmemcpy(newSnapshot->wall, oldSnapshot->wall, wallSize);
+        Bmemcpy(newSnapshot->sector, oldSnapshot->sector, sectorSize);
+        Bmemcpy(newSnapshot->actor, oldSnapshot->actor, actorSize);
     }
 
-    dataBuffer[byteIndex] |= (bitValue << (bitIndex));
+    int32_t readSize = 0, chunkSize;
 
+    if ((chunkSize = netDeltaApply(newSnapshot->wall, wallSize, deltaBuffer, deltaSize)) < 0)
+        return false;
 
-    bitOffsetValue++;
-    *bitOffset = bitOffsetValue;
-}
+    readSize += chunkSize;
 
-// Get a single bit (return value) from a byte array (dataBuffer) at bit offset bitOffset
-// this function increments bitOffset for you.
-static int32_t GetBit(uint8_t *dataBuffer, int32_t *bitOffset)
-{
-    int32_t bitValue = -1;
+    if ((chunkSize = netDeltaApply(newSnapshot->sector, sectorSize, deltaBuffer + readSize, deltaSize - readSize)) < 0)
+        return false;
 
-    int32_t bitOffsetValue = *bitOffset;
+    readSize += chunkSize;
 
-    const int32_t byteIndex = bitOffsetValue >> 3;
-    const int32_t bitIndex = bitOffsetValue & 7;
+    if ((chunkSize = netDeltaApply(newSnapshot->actor, actorSize, deltaBuffer + readSize, deltaSize - readSize)) < 0)
+        return false;
 
-    bitValue = (dataBuffer[byteIndex] >> bitIndex) & 0x1;
+    readSize += chunkSize;
 
-    bitOffsetValue++;
-    *bitOffset = bitOffsetValue;
+    NET_75_CHECK++; // For now every snapshot will have MAXSPRITES entries
+    newSnapshot->maxActorIndex = MAXSPRITES;
 
-    return bitValue;
+    return readSize == deltaSize;
 }
 
-//Note: This function increments bitOffset for you
-static void PutBits(int32_t value, uint8_t *dataBuffer, int32_t *bitOffset, int16_t numberOfBits)
+static void Net_SendWorldUpdate(uint32_t fromRevisionNumber, uint32_t toRevisionNumber, int32_t sendToPlayerIndex)
 {
-    int16_t bitIndex;
-
-    if (numberOfBits > 32)
+    if (sendToPlayerIndex == myconnectindex)
     {
-        Net_Error_Disconnect("PutBits: Attempted to write more than 32 bits to the buffer.");
-        numberOfBits = 32;
+        return;
     }
 
-    for (bitIndex = 0; bitIndex < numberOfBits; bitIndex++)
-    {
-        int32_t bitValue = value & (1 << bitIndex);
+    Bassert(tempnetbuf != nullptr);
+    Bassert(NET_REVISIONS == ARRAY_SIZE(g_mapStateHistory));
 
-        PutBit((bitValue != 0), dataBuffer, bitOffset);
+    uint32_t        playerRevisionIsTooOld = (toRevisionNumber - fromRevisionNumber) > NET_REVISIONS;
 
-    }
+    // to avoid the client thinking that revision 2 is older than revision 0xFFFF_FFFF,
+    // send packets to take the client from the map's initial state until the client reports back
+    // that it's beyond that rollover threshold.
+    uint32_t        revisionInRolloverState = (fromRevisionNumber > toRevisionNumber);
 
-}
 
-//Note: this function increments bitOffset for you
-static int32_t GetBits(uint8_t *dataBuffer, int32_t *bitOffset, int16_t numberOfBits)
-{
-    int32_t value = 0;
-    int16_t bitIndex;
+    uint32_t        fromRevisionNumberToSend = 0x86753090;
 
-    if (numberOfBits > 32)
-    {
-        Net_Error_Disconnect("GetBits: Attempted to read more than 32 bits from the buffer.");
-        numberOfBits = 32;
-    }
+    netmapstate_t*  toMapState = g_mapStateHistory[toRevisionNumber % NET_REVISIONS];
+    netmapstate_t*  fromMapState = NULL;
 
-    for (bitIndex = 0; bitIndex < numberOfBits; bitIndex++)
-    {
-        int32_t tBitValue = GetBit(dataBuffer, bitOffset);
+    Bassert(toMapState != nullptr);
+
+    NET_75_CHECK++; // during the rollover state it might be a good idea to init the map state history?
+                    // maybe not? I do init map states before using them, so it might not be needed.
 
-        value |= (tBitValue << bitIndex);
 
+    if (playerRevisionIsTooOld || revisionInRolloverState)
+    {
+        fromMapState = g_mapStartState;
+        fromRevisionNumberToSend = cInitialMapStateRevisionNumber;
     }
+    else
+    {
+        uint32_t tFromRevisionIndex = fromRevisionNumber % NET_REVISIONS;
 
-    return value;
-}
+        fromMapState = g_mapStateHistory[tFromRevisionIndex];
+        fromRevisionNumberToSend = fromRevisionNumber;
+    }
 
+    Bassert(fromMapState != nullptr);
 
-// only difference between this and GetBits is this one does not require you
-// to pass in a pointer for the bit offset. Remember to not use semicolons in the watch list!
-//
-// use this to debug packets
-//
-// NOTE: Set to non-static just so the compiler won't optimize it out.
-int32_t Dbg_GetBits(NetBuffer_t *netBuffer, int32_t bitOffset, int16_t numberOfBits)
-{
-    // I'm having GetBits modify a temp instead of the input parameter so that you can
-    // still see what the input parameter was at the end of the function.
-    int32_t bitOffsetValue = bitOffset;
-    return GetBits(netBuffer->Data, &bitOffsetValue, numberOfBits);
-}
+    // with many players most of them will have acknowledged the same revision, so only encode once per revision pair
+    if (g_netWorldUpdateSize == 0 || g_netWorldUpdateFrom != fromRevisionNumberToSend || g_netWorldUpdateTo != toRevisionNumber)
+    {
+        int32_t const deltaSize = Net_WriteWorldDelta(netdeltabuf, fromMapState, toMapState);
+        int32_t packedSize = LZ4_compress_default((char const *)netdeltabuf, (char *)&tempnetbuf[WORLD_HEADERSIZE], deltaSize, LZ4_COMPRESSBOUND(deltaSize));
+        uint8_t flags = WORLD_LZ4;
 
-// intended for use in the debugger
-// the netcode will return (32 bit) floats in a variable with type int32, though the data is actually
-// floating point data. This function is here to make it easier to verify a (full) float encoded as int32
-// in the debugger.
-// note: floats that are actually truncated integers will usually look something like this: 3.922e-39#DEN
-EDUKE32_UNUSED static float Dbg_RawIntToFloat(NetChunk32 floatRawData)
-{
-    float* floatPtr = (float*)&floatRawData;
+        if (packedSize <= 0 || packedSize >= deltaSize)
+        {
+            Bmemcpy(&tempnetbuf[WORLD_HEADERSIZE], netdeltabuf, deltaSize);
+            packedSize = deltaSize;
+            flags = 0;
+        }
 
-    return *(floatPtr);
-}
+        tempnetbuf[0] = PACKET_WORLD_UPDATE;
+        B_BUF32(&tempnetbuf[1], fromRevisionNumberToSend);
+        B_BUF32(&tempnetbuf[5], toRevisionNumber);
+        tempnetbuf[9] = flags;
+        B_BUF32(&tempnetbuf[10], deltaSize);
 
+        g_netWorldUpdateFrom = fromRevisionNumberToSend;
+        g_netWorldUpdateTo   = toRevisionNumber;
+        g_netWorldUpdateSize = WORLD_HEADERSIZE + packedSize;
+    }
 
-static void NetBuffer_WriteBits(NetBuffer_t *netBuffer, int32_t data, int16_t numberOfBits)
-{
-    if (netBuffer->CurSize >= netBuffer->MaxSize)
+    if (sendToPlayerIndex > ((int32_t) g_netServer->peerCount))
     {
-        Net_Error_Disconnect("NetBuffer_WriteBits: Buffer overrun.");
+        Net_Error_Disconnect("No peer for player.");
+        return;
     }
 
-    int32_t dataToWrite = data & (0xffffffff >> (32 - numberOfBits));
-
-    PutBits(dataToWrite, netBuffer->Data, &netBuffer->Bit, numberOfBits);
-
-    netBuffer->CurSize = (netBuffer->Bit >> 3) + 1;
+    // in the future we could probably use these flags for enet_peer_send, for the world updates
+    EDUKE32_UNUSED const ENetPacketFlag optimizedFlags = (ENetPacketFlag)(ENET_PACKET_FLAG_UNSEQUENCED | ENET_PACKET_FLAG_UNRELIABLE_FRAGMENT);
 
-}
+    NET_75_CHECK++; // HACK: I Really need to keep the peer with the player instead of assuming that the peer index is the same as the (player index - 1)
+    ENetPeer *const tCurrentPeer = &g_netServer->peers[sendToPlayerIndex - 1];
+    enet_peer_send(tCurrentPeer, CHAN_GAMESTATE, enet_packet_create(&tempnetbuf[0], g_netWorldUpdateSize, 0));
+    Dbg_PacketSent(PACKET_WORLD_UPDATE);
 
-EDUKE32_UNUSED static void NetBuffer_WriteUnsignedByte(NetBuffer_t *netBuffer, int32_t byte)
-{
-#ifdef PICKY_TYPECHECK
-    if ((byte < 0) || byte > 255)
-    {
-        Net_Error_Disconnect("NetBuffer_WriteUnsignedByte: Value not valid.");
-    }
-#endif
-    NetBuffer_WriteBits(netBuffer, byte, 8);
-}
 
-EDUKE32_UNUSED static void NetBuffer_WriteSignedByte(NetBuffer_t *netBuffer, int32_t byte)
-{
-#ifdef PICKY_TYPECHECK
-    if ((byte < -128) || (byte > 127))
-    {
-        Net_Error_Disconnect("NetBuffer_WriteSignedByte: Value not valid.");
-    }
-#endif
-    NetBuffer_WriteBits(netBuffer, byte, 8);
 }
 
-
-EDUKE32_UNUSED static void NetBuffer_WriteInt16(NetBuffer_t *netBuffer, int32_t word)
+static void Net_CopySnapshotToGameArrays(netmapstate_t* srv_snapshot, netmapstate_t* cl_snapshot)
 {
-#ifdef PICKY_TYPECHECK
-    const int16_t cLowVal = (int16_t)0x00008000;
-    const int16_t cHighVal = (int16_t)0x00007fff;
+    Bassert(srv_snapshot != nullptr);
+    Bassert(cl_snapshot != nullptr);
 
-    if ((word < cLowVal) || (word > cHighVal))
-    {
-        Net_Error_Disconnect("NetBuffer_WriteInt16: Value not valid.");
-    }
-#endif
-    NetBuffer_WriteBits(netBuffer, word, 16);
-}
+    int32_t index;
 
-EDUKE32_UNUSED static void NetBuffer_WriteUInt16(NetBuffer_t *netBuffer, int32_t word)
-{
-#ifdef PICKY_TYPECHECK
-    const uint16_t cLowVal = (uint16_t)0x00000000;
-    const uint16_t cHighVal = (uint16_t)0x0000ffff;
+    // this isn't just copying the entries that "changed" into the game arrays,
+    // remember that we need to correct any incorrect guesses the client made.
+    // don't do memcpy either, e.g., sizeof(netWall_t) != sizeof(walltype)
 
-    if ((word < cLowVal) | (word > cHighVal))
+    for (index = 0; index < numwalls; index++)
     {
-        Net_Error_Disconnect("NetBuffer_WriteUInt16: Value not valid.");
-    }
+        netWall_t*  srvWall = &(srv_snapshot->wall[index]);
+        netWall_t*  clWall  = &(cl_snapshot->wall[index]);
 
-#endif
-    NetBuffer_WriteBits(netBuffer, word, 16);
-}
+        int status = memcmp(srvWall, clWall, sizeof(netWall_t));
 
-static void NetBuffer_WriteDword(NetBuffer_t *netBuffer, int32_t dword)
-{
-    // don't care about signed/unsigned since the bit width matches
-    NetBuffer_WriteBits(netBuffer, dword, 32);
-}
+        if(status == 0)
+        {
+            if(g_enableClientInterpolationCheck)
+            {
+                // only copy in the server's (old) value if the client's interpolation up to that point was incorrect
+                continue;
+            }
+        }
 
+        walltype*   gameWall = &(wall[index]);
 
-//where length is the size in bytes
-static void NetBuffer_WriteData(NetBuffer_t  *netBuffer, const void *data, int16_t length)
-{
-    int32_t byteIndex;
-    for (byteIndex = 0; byteIndex < length; byteIndex++)
-    {
-        NetBuffer_WriteUnsignedByte(netBuffer, ((const int8_t *)data)[byteIndex]);
-    }
-}
+        Net_CopyWallFromNet(srvWall, gameWall);
 
-EDUKE32_UNUSED static void NetBuffer_WriteString(NetBuffer_t *netBuffer, const char *stringToWrite)
-{
-    if (!stringToWrite)
-    {
-        // if stringToWrite is null, write a NUL ('\0') character
-        NetBuffer_WriteData(netBuffer, "", 1);
     }
 
-    else
+    for (index = 0; index < numsectors; index++)
     {
-        int32_t     length; // length of input string
-        char        tempStringBuffer[MAX_PACKET_STRING]; // temp storage
+        netSector_t*  srvSector = &(srv_snapshot->sector[index]);
+        netSector_t*  clSector  = &(cl_snapshot->sector[index]);
 
-        length = strlen(stringToWrite);
+        int status = memcmp(srvSector, clSector, sizeof(netSector_t));
 
-        if (length >= MAX_PACKET_STRING)
+        if(status == 0)
         {
-            Net_Error_Disconnect("NetBuffer_WriteString: String too long.");
+            if(g_enableClientInterpolationCheck)
+            {
+                continue;
+            }
         }
-        SafeStrncpyz(tempStringBuffer, stringToWrite, sizeof(tempStringBuffer));
 
-        NetBuffer_WriteData(netBuffer, tempStringBuffer, length + 1);
+        sectortype*   gameSector = &(sector[index]);
+
+        Net_CopySectorFromNet(srvSector, gameSector);
     }
+
+    Net_CopyActorsToGameArrays(srv_snapshot, cl_snapshot);
 }
 
-static void NetBuffer_WriteDeltaFloat(NetBuffer_t *netBuffer, NetChunk32 rawFloatData)
+// clients only
+static void Net_ReadWorldUpdate(uint8_t* packetData, int32_t packetSize)
 {
-    if (sizeof(float) != sizeof(int32_t))
+    if (!g_netClient)
     {
-        Net_Error_Disconnect("Can't write float to buffer: sizeof(float) must be 4 bytes");
+        return;
     }
 
+    NET_DEBUG_VAR int16_t   DEBUG_NoMapLoaded               = ((numwalls < 1) || (numsectors < 1));
+    NET_DEBUG_VAR int32_t   DEBUG_InitialSnapshotNotSet     = (g_mapStartState->sector[0].wallnum <= 0);
 
-    // interpret the FOUR BYTES of raw float data as a float
-    float*	floatDataPtr = (float*) &(rawFloatData);
-    float	floatValue = *(floatDataPtr);
-
-    int32_t truncatedFloat = (int32_t)floatValue;
-
-    if (floatValue == 0.0f)
+    if (!ClientPlayerReady)
     {
-        NetBuffer_WriteBits(netBuffer, 0, 1);                                          // float is zeroed
-
+        return;
     }
-    else
-    {
-        NetBuffer_WriteBits(netBuffer, 1, 1);                                          // float is not zeroed
-
-                                                                                       // check if this float can be sent as a FLOAT_INT_BITS sized (*signed*) integer with no data loss
-        if (
-            ((float)truncatedFloat == floatValue) &&
-            (truncatedFloat >= cTruncInt_Min) &&
-            (truncatedFloat <= cTruncInt_Max)
-            )
-        {
-            NetBuffer_WriteBits(netBuffer, 0, 1);                                                 // send float as small integer
-            NetBuffer_WriteBits(netBuffer, truncatedFloat + cTruncInt_Max, FLOAT_INT_BITS);      // float as small integer data
-
-        }
-
-        else
-        {
-            // send as full floating point value
-
-            NetBuffer_WriteBits(netBuffer, 1, 1);                                          // send full float
-            NetBuffer_WriteBits(netBuffer, rawFloatData, 32);                              // full raw float data
-
-        }
 
+    if (packetSize < WORLD_HEADERSIZE)
+    {
+        Net_Error_Disconnect("Malformed world update packet.");
+        return;
     }
 
-}
-
-//-------------------------------------------------------------------------------------
-// low level buffer reading functions
-
-static int32_t NetBuffer_ReadBits(NetBuffer_t *netBuffer, int32_t numberOfBits)
-{
-    int32_t    value = GetBits(netBuffer->Data, &netBuffer->Bit, numberOfBits);
-
-    netBuffer->ReadCurByte = (netBuffer->Bit >> 3) + 1;
-
-    return value;
-}
+    uint32_t packetFromRevisionNumber = B_UNBUF32(&packetData[1]);
+    uint32_t packetToRevisionNumber = B_UNBUF32(&packetData[5]);
 
+    uint32_t from_IsInitialState = (packetFromRevisionNumber == cInitialMapStateRevisionNumber);
 
-// returns -1 if no more characters are available
-static int32_t NetBuffer_ReadByte(NetBuffer_t *netBuffer)
-{
-    int32_t    byte;
+    uint32_t clientRevisionIsTooOld = (packetToRevisionNumber - g_netMapRevisionNumber) > NET_REVISIONS;
 
-    byte = (int8_t)NetBuffer_ReadBits(netBuffer, 8);
+    netmapstate_t* fromMapState = NULL;
 
-    if (netBuffer->ReadCurByte > netBuffer->CurSize)
-    {
-        Net_Error_Disconnect("NetBuffer_ReadByte: Attempted to read beyond end of buffer current size.");
-    }
-
-    return byte;
-}
-
-EDUKE32_UNUSED static int32_t NetBuffer_ReadUnsignedByte(NetBuffer_t *netBuffer)
-{
-    int32_t    byte;
-
-    byte = (uint8_t)NetBuffer_ReadBits(netBuffer, 8);
-
-    if (netBuffer->ReadCurByte > netBuffer->CurSize)
-    {
-        Net_Error_Disconnect("NetBuffer_ReadUnsignedByte: Attempted to read beyond end of buffer current size.");
-    }
-
-    return byte;
-}
-
-EDUKE32_UNUSED static int32_t NetBuffer_ReadInt16(NetBuffer_t *netBuffer)
-{
-    int32_t    word;
-
-    word = (int16_t)NetBuffer_ReadBits(netBuffer, 16);
-    if (netBuffer->ReadCurByte > netBuffer->CurSize)
-    {
-        Net_Error_Disconnect("NetBuffer_ReadInt16: Attempted to read beyond end of buffer current size.");
-    }
-
-    return word;
-}
-
-EDUKE32_UNUSED static int32_t NetBuffer_ReadUInt16(NetBuffer_t *netBuffer)
-{
-    int32_t    word;
-
-    word = (uint16_t)NetBuffer_ReadBits(netBuffer, 16);
-    if (netBuffer->ReadCurByte > netBuffer->CurSize)
-    {
-        Net_Error_Disconnect("NetBuffer_ReadUInt16: Attempted to read beyond end of buffer current size.");
-    }
-
-    return word;
-}
-
-static int32_t NetBuffer_ReadDWord(NetBuffer_t *netBuffer)
-{
-    int32_t    dword;
-
-    dword = NetBuffer_ReadBits(netBuffer, 32);
-    if (netBuffer->ReadCurByte > netBuffer->CurSize)
-    {
-        Net_Error_Disconnect("NetBuffer_ReadDword: Attempted to read beyond end of buffer current size.");
-    }
-
-    return dword;
-}
-
-EDUKE32_UNUSED static void NetBuffer_ReadData(NetBuffer_t *netBuffer, void *data, int32_t dataLength)
-{
-    int32_t byteIndex;
-    for (byteIndex = 0; byteIndex < dataLength; byteIndex++)
-    {
-        ((int8_t *)data)[byteIndex] = NetBuffer_ReadByte(netBuffer);
-    }
-}
-
-// net struct -> Buffer functions
-//----------------------------------------------------------------------------------------------------------
-
-static void NetBuffer_WriteDeltaNetWall(NetBuffer_t *netBuffer, const netWall_t *from, const netWall_t *to)
-{
-    const   int32_t         cMaxStructs = MAXWALLS;
-    const   int32_t         cFieldsInStruct = ARRAY_SIZE(WallFields);
-
-    int32_t         fieldIndex,
-                    maxChgIndex;
-
-    netField_t      *fieldPtr;
-
-    const int32_t   *fromField,
-                    *toField;
-
-    // all fields should be 32 bits to avoid any compiler packing issues
-    // the "number" field is not part of the field list
-    //
-    // if this assert fails, check that all of the entries in net*_t are in the engine's type
-    Bassert(cFieldsInStruct + 1 == (sizeof(*from) / 4));
-    Bassert(to);
-    Bassert(from);
-
-    if (to->netIndex >= cMaxStructs)
-    {
-        Net_Error_Disconnect("Netbuffer_WriteDeltaNetWall: Invalid To NetIndex");
-        return;
-    }
-
-    maxChgIndex = 0;
-
-    for (fieldIndex = 0, fieldPtr = WallFields; fieldIndex < cFieldsInStruct; fieldIndex++, fieldPtr++)
-    {
-        fromField   = (int32_t const *)((int8_t const *)from  + fieldPtr->offset);
-        toField     = (int32_t const *)((int8_t const *)to    + fieldPtr->offset);
-
-        if (*fromField != *toField)
-        {
-            maxChgIndex = fieldIndex + 1;
-        }
-    }
-
-    if (maxChgIndex == 0)  // no fields changed
-    {
-        return;     // write nothing at all
-    }
-
-    NetBuffer_WriteBits(netBuffer, to->netIndex, NETINDEX_BITS);
-
-    NetBuffer_WriteBits(netBuffer, maxChgIndex, STRUCTINDEX_BITS);
-
-    for (fieldIndex = 0, fieldPtr = WallFields; fieldIndex < maxChgIndex; fieldIndex++, fieldPtr++)
-    {
-        fromField   = (int32_t const *)((int8_t const *)from    + fieldPtr->offset);
-        toField     = (int32_t const *)((int8_t const *)to      + fieldPtr->offset);
-
-        //                                                              // Bit(s) meaning
-        //                                                              //-------------------
-        if (*fromField == *toField)
-        {
-            NetBuffer_WriteBits(netBuffer, 0, 1);                       // field not changed
-            continue;
-        }
-
-        NetBuffer_WriteBits(netBuffer, 1, 1);                           // field changed
-
-        if (*toField == 0)
-        {
-            NetBuffer_WriteBits(netBuffer, 0, 1);                       // zero this field
-        }
-        else
-        {
-            NetBuffer_WriteBits(netBuffer, 1, 1);                       // don't zero this field
-            NetBuffer_WriteBits(netBuffer, *toField, fieldPtr->bits);   // new field value
-        }
-
-    }
-}
-
-static void NetBuffer_WriteDeltaNetSector(NetBuffer_t *netBuffer, const netSector_t *from, const netSector_t *to)
-{
-    const   int32_t         cMaxStructs = MAXSECTORS;
-    const   int32_t         cFieldsInStruct = ARRAY_SIZE(SectorFields);
-
-    int32_t         fieldIndex,
-                    maxChgIndex;
-
-    netField_t      *fieldPtr;
-
-    const int32_t       *fromField,
-                        *toField;
-
-    // all fields should be 32 bits to avoid any compiler packing issues
-    // the "number" field is not part of the field list
-    //
-    // if this assert fails, check that all of the entries in net*_t are in the engine's type
-    Bassert(cFieldsInStruct + 1 == (sizeof(*from) / 4));
-    Bassert(to);
-    Bassert(from);
-
-    if (to->netIndex >= cMaxStructs)
-    {
-        Net_Error_Disconnect("Netbuffer_WriteDeltaNetSector: Invalid To NetIndex");
-        return;
-    }
-
-    maxChgIndex = 0;
-
-    for (fieldIndex = 0, fieldPtr = SectorFields; fieldIndex < cFieldsInStruct; fieldIndex++, fieldPtr++)
-    {
-        fromField   = (int32_t const *)((int8_t const *)from    + fieldPtr->offset);
-        toField     = (int32_t const *)((int8_t const *)to      + fieldPtr->offset);
-
-        if (*fromField != *toField)
-        {
-            maxChgIndex = fieldIndex + 1;
-        }
-    }
-
-    if (maxChgIndex == 0)  // no fields changed
-    {
-        return;     // write nothing at all
-    }
-
-    NetBuffer_WriteBits(netBuffer, to->netIndex, NETINDEX_BITS);
-
-    NetBuffer_WriteBits(netBuffer, maxChgIndex, STRUCTINDEX_BITS);
-
-    for (fieldIndex = 0, fieldPtr = SectorFields; fieldIndex < maxChgIndex; fieldIndex++, fieldPtr++)
-    {
-        fromField   = (int32_t const *)((int8_t const *)from    + fieldPtr->offset);
-        toField     = (int32_t const *)((int8_t const *)to      + fieldPtr->offset);
-
-        //                                                              // Bit(s) meaning
-        //                                                              //-------------------
-        if (*fromField == *toField)
-        {
-            NetBuffer_WriteBits(netBuffer, 0, 1);                       // field not changed
-            continue;
-        }
-
-        NetBuffer_WriteBits(netBuffer, 1, 1);                           // field changed
-
-        if (*toField == 0)
-        {
-            NetBuffer_WriteBits(netBuffer, 0, 1);                       // zero this field
-        }
-        else
-        {
-            NetBuffer_WriteBits(netBuffer, 1, 1);                       // don't zero this field
-            NetBuffer_WriteBits(netBuffer, *toField, fieldPtr->bits);      // new field value
-        }
-
-    }
-}
-
-static void NetBuffer_WriteDeltaNetActor(NetBuffer_t* netBuffer, const netactor_t *from, const netactor_t* to, int8_t writeDeletedActors)
-{
-    const   int32_t         cMaxStructs = MAXSPRITES;
-    const   int32_t         cFieldsInStruct = ARRAY_SIZE(ActorFields);
-
-    int32_t         fieldIndex,
-                    maxChgIndex;
-
-    netField_t      *fieldPtr;
-
-    const int32_t       *fromField,
-                        *toField;
-
-    if ((from == NULL) && (to == NULL))
-    {
-        // Actor was deleted in the "from" snapshot and it's still deleted in the "to" snasphot, don't write anything.
-        return;
-    }
-
-    if (from == NULL)
-    {
-        // The actor was deleted in the "From" snapshot, but it's there in the "To" snapshot, so that means it has been inserted in the "To" snapshot.
-        from = &cNullNetActor;
-    }
-
-    if (to == NULL)
-    {
-        // The actor was present in the "From" snapshot but it's now deleted in the "To" snapshot.
-        NetBuffer_WriteBits(netBuffer, from->netIndex, NETINDEX_BITS);                      // {<NetIndex>}     sprite index
-        NetBuffer_WriteBits(netBuffer, 1, 1);                                               // {<NetIndex>, 1}  sprite deleted
-        return;
-    }
-
-    // all fields should be 32 bits to avoid any compiler packing issues
-    // the "number" field is not part of the field list
-    //
-    // if this assert fails, check that all of the entries in net*_t are in the engine's type
-    Bassert(cFieldsInStruct + 1 == (sizeof(*from) / 4));
-
-    if (to->netIndex < 0 || to->netIndex >= cMaxStructs)
-    {
-        Net_Error_Disconnect("Netbuffer_WriteDeltaNetActor: Invalid To NetIndex");
-        return;
-    }
-
-    maxChgIndex = 0;
-
-    for (fieldIndex = 0, fieldPtr = ActorFields; fieldIndex < cFieldsInStruct; fieldIndex++, fieldPtr++)
-    {
-        fromField   = (int32_t const *)((int8_t const *)from    + fieldPtr->offset);
-        toField     = (int32_t const *)((int8_t const *)to      + fieldPtr->offset);
-
-        if (*fromField != *toField)
-        {
-            maxChgIndex = fieldIndex + 1;
-        }
-    }
-
-    if (maxChgIndex == 0)
-    {
-
-        if (!writeDeletedActors)
-        {
-            // no fields changed, if we're not forcing a write for each actor then we're done
-            return;
-        }
-
-        // write two bits for no change
-        // as in, write {0,0} to indicate that the entity still exists,
-        // but has not changed.
-        NetBuffer_WriteBits(netBuffer, to->netIndex, NETINDEX_BITS);                    // {<NetIndex>}         sprite index
-        NetBuffer_WriteBits(netBuffer, 0, 1);                                           // {<NetIndex>, 0}      sprite NOT deleted
-        NetBuffer_WriteBits(netBuffer, 0, 1);                                           // {<NetIndex>, 0,0}    sprite has NOT changed.
-
-        return;
-
-    }
-
-    // if we got to this point, the sprite / actor exists and has changed
-    NetBuffer_WriteBits(netBuffer, to->netIndex, NETINDEX_BITS);                        // {<NetIndex>}         sprite index
-    NetBuffer_WriteBits(netBuffer, 0, 1);                                               // {<NetIndex>, 0}      sprite/actor NOT deleted.
-    NetBuffer_WriteBits(netBuffer, 1, 1);                                               // {<NetIndex>, 0,1}    sprite/actor HAS changed.
-
-                                                                                        //--------------------------------------------------
-                                                                                        // then...
-
-    NetBuffer_WriteBits(netBuffer, maxChgIndex, STRUCTINDEX_BITS);						// Write Max change index
-
-                                                                                        // For each field in struct...
-
-    for (fieldIndex = 0, fieldPtr = ActorFields; fieldIndex < maxChgIndex; fieldIndex++, fieldPtr++)
-    {
-        const int8_t isFloatingPointField = (fieldPtr->bits == 0);
-
-        fromField   = (int32_t const *)((int8_t const *)from    + fieldPtr->offset);
-        toField     = (int32_t const *)((int8_t const *)to      + fieldPtr->offset);
-
-        if (*fromField == *toField)
-        {
-            NetBuffer_WriteBits(netBuffer, 0, 1);                                       // {0}              field not changed
-            continue;
-
-        }
-
-        NetBuffer_WriteBits(netBuffer, 1, 1);                                           // {1}              field changed
-
-        if (isFloatingPointField)
-        {
-            int32_t rawFloatData = *(toField);
-
-            NetBuffer_WriteDeltaFloat(netBuffer, rawFloatData);                         // {1, <special float behavior>}
-
-        }
-        else
-        {
-            if (*toField == 0)
-            {
-                NetBuffer_WriteBits(netBuffer, 0, 1);                                    // {1, 0}           Zero this field
-
-            }
-            else
-            {
-                NetBuffer_WriteBits(netBuffer, 1, 1);                                    // {1, 1}           don't zero this int field
-                NetBuffer_WriteBits(netBuffer, *toField, fieldPtr->bits);                    // {1, 1, <value>}  new field value
-
-            }
-
-        }
-
-    }
-
-}
-
-
-static void Net_WriteNetActorsToBuffer(NetBuffer_t* netBuffer, const netmapstate_t* from, const netmapstate_t* to)
-{
-    Bassert(from != nullptr);
-    Bassert(to != nullptr);
-
-    const netactor_t* fromActor = NULL;
-
-    const netactor_t* toActor = NULL;
-
-    int16_t     actorIndex = 0;
-
-    int16_t     fromMaxIndex = 0;
-
-    if (!from)
-    {
-        fromMaxIndex = 0;
-    }
-    else
-    {
-        fromMaxIndex = from->maxActorIndex;
-    }
-
-    while (
-        actorIndex < to->maxActorIndex
-        ||
-        actorIndex < fromMaxIndex
-        )
-    {
-
-        // load actor pointers using actor indexes
-        if (actorIndex >= to->maxActorIndex)
-        {
-            toActor = NULL;
-        }
-        else
-        {
-            toActor = &to->actor[actorIndex];
-
-            if (toActor->netIndex == cSTOP_PARSING_CODE)
-            {
-                toActor = NULL;
-            }
-        }
-
-
-        if (actorIndex >= fromMaxIndex)
-        {
-            fromActor = NULL;
-        }
-        else
-        {
-            fromActor = &from->actor[actorIndex];
-
-            if (fromActor->netIndex == cSTOP_PARSING_CODE)
-            {
-                fromActor = NULL;
-            }
-        }
-
-        NetBuffer_WriteDeltaNetActor(netBuffer, fromActor, toActor, 0);
-
-        actorIndex++;
-
-    }
-}
-
-
-static void Net_WriteWorldToBuffer(NetBuffer_t* netBuffer, const netmapstate_t* fromSnapshot, const netmapstate_t* toSnapshot)
-{
-    Bassert(fromSnapshot != nullptr);
-    Bassert(toSnapshot != nullptr);
-
-    int32_t index = 0;
-
-    for (index = 0; index < numwalls; index++)
-    {
-        Bassert(index < MAXWALLS);
-
-        const netWall_t* fromWall = &fromSnapshot->wall[index];
-        const netWall_t* toWall = &toSnapshot->wall[index];
-
-        NetBuffer_WriteDeltaNetWall(netBuffer, fromWall, toWall);
-
-    }
-
-    NetBuffer_WriteBits(netBuffer, cSTOP_PARSING_CODE, NETINDEX_BITS);
-
-
-
-    for (index = 0; index < numsectors; index++)
-    {
-        Bassert(index < MAXSECTORS);
-
-        const netSector_t* fromSector = &fromSnapshot->sector[index];
-        const netSector_t* toSector = &toSnapshot->sector[index];
-
-        NetBuffer_WriteDeltaNetSector(netBuffer, fromSector, toSector);
-    }
-
-    NetBuffer_WriteBits(netBuffer, cSTOP_PARSING_CODE, NETINDEX_BITS);
-
-    Net_WriteNetActorsToBuffer(netBuffer, fromSnapshot, toSnapshot);
-
-    NetBuffer_WriteBits(netBuffer, cSTOP_PARSING_CODE, NETINDEX_BITS); // end of actors/sprites
-
-}
-
-
-// buffer -> net struct functions
-//----------------------------------------------------------------------------------------------------------
-
-// I agonized over whether to just make a more generic NetBuffer_ReadDeltaWorldEntry since there's so little
-// difference between walls and sectors for this function but my attempts ended up being much harder
-// to read and probably more error prone than using "clipboard" inheritance, I really hope I made the right call here...
-
-static void NetBuffer_ReadDeltaWall(NetBuffer_t *netBuffer, const netWall_t *from, netWall_t *to, uint16_t netIndex)
-{
-    int32_t         fieldIndex,
-                    maxChgIndex;                               // the number of fields that changed in this delta struct from the server
-
-    const   int32_t         cMaxStructs = MAXWALLS;
-    const   int32_t         cStructFields = ARRAY_SIZE(WallFields);     // the number of fields in the full struct
-
-    netField_t      *cFieldsArray = &(WallFields[0]);
-
-    netField_t      *field;
-
-    const NetChunk32      *fromField;
-          NetChunk32      *toField;
-
-    if (netIndex >= cMaxStructs)
-    {
-        Net_Error_Disconnect("NetBuffer_ReadDeltaWall: Bad Netindex to read.");
-        return;
-    }
-
-    if (from->netIndex != netIndex)
-    {
-        Net_Error_Disconnect("Unexpected from struct netIndex. from struct netIndex should match the netIndex parameter.");
-        return;
-    }
-
-    maxChgIndex = NetBuffer_ReadBits(netBuffer, STRUCTINDEX_BITS);
-
-    if (maxChgIndex  > cStructFields || maxChgIndex < 0)
-    {
-        Net_Error_Disconnect("NetBuffer_ReadDeltaWall: Invalid delta field count from client.");
-        return;
-    }
-
-    to->netIndex = netIndex;
-
-    // for each field of the delta struct
-    for (fieldIndex = 0, field = cFieldsArray; fieldIndex < maxChgIndex; fieldIndex++, field++)
-    {
-        fromField = (int32_t const *)((int8_t const *)from  + field->offset);
-        toField   = (int32_t *)      ((int8_t *)      to    + field->offset);
-
-        // no change to this field
-        if (!NetBuffer_ReadBits(netBuffer, 1))
-        {
-            *toField = *fromField;
-
-        }
-
-        // field has changed
-        else
-        {
-            // zero the field
-            if (NetBuffer_ReadBits(netBuffer, 1) == 0)
-            {
-                *toField = 0;
-
-            }
-
-            // read the whole field
-            else
-            {
-                *toField = NetBuffer_ReadBits(netBuffer, field->bits);
-
-            }
-
-        }
-    }
-
-    // if the delta for this struct doesn't include every field of the struct (likely)
-    // just set every field after the end of this delta struct to the "from" value
-    for (fieldIndex = maxChgIndex, field = &cFieldsArray[maxChgIndex]; fieldIndex < cStructFields; fieldIndex++, field++)
-    {
-        fromField   = (NetChunk32 const *)((int8_t const *)from + field->offset);
-        toField     = (NetChunk32 *)      ((int8_t *)      to + field->offset);
-
-        // no change on all the rest of the fields of the struct
-        *toField = *fromField;
-    }
-
-
-}
-
-static void NetBuffer_ReadDeltaSector(NetBuffer_t *netBuffer, const netSector_t *from, netSector_t *to, uint16_t netIndex)
-{
-    int32_t         fieldIndex,
-                    maxChgIndex;                                    // the number of fields that changed in this delta struct from the server
-
-    const   int32_t         cMaxStructs = MAXSECTORS;
-    const   int32_t         cStructFields = ARRAY_SIZE(SectorFields);       // the number of fields in the full struct
-
-    netField_t      *cFieldsArray = &(SectorFields[0]);
-
-    netField_t      *field;
-
-    const NetChunk32      *fromField;
-          NetChunk32      *toField;
-
-
-    if (netIndex >= cMaxStructs)
-    {
-        Net_Error_Disconnect("NetBuffer_ReadDeltaSector: Bad Netindex to read.");
-        return;
-    }
-
-    if (from->netIndex != netIndex)
-    {
-        Net_Error_Disconnect("Unexpected from struct netIndex. from struct netIndex should match the netIndex parameter.");
-        return;
-    }
-
-    maxChgIndex = NetBuffer_ReadBits(netBuffer, STRUCTINDEX_BITS);
-
-    if (maxChgIndex  > cStructFields || maxChgIndex < 0)
-    {
-        Net_Error_Disconnect("NetBuffer_ReadDeltaSector: Invalid delta field count from client.");
-        return;
-    }
-
-    to->netIndex = netIndex;
-
-    // for each field of the delta struct
-    for (fieldIndex = 0, field = cFieldsArray; fieldIndex < maxChgIndex; fieldIndex++, field++)
-    {
-        fromField = (int32_t const *)((int8_t const *)from + field->offset);
-        toField   = (int32_t *)      ((int8_t *)      to + field->offset);
-
-        // no change to this field
-        if (!NetBuffer_ReadBits(netBuffer, 1))
-        {
-            *toField = *fromField;
-
-        }
-
-        // field has changed
-        else
-        {
-            // zero the field
-            if (NetBuffer_ReadBits(netBuffer, 1) == 0)
-            {
-                *toField = 0;
-
-            }
-
-            // read the whole field
-            else
-            {
-                *toField = NetBuffer_ReadBits(netBuffer, field->bits);
-
-            }
-
-        }
-    }
-
-    // if the delta for this struct doesn't include every field of the struct (likely)
-    // just set every field after the end of this delta struct to the "from" value
-    for (fieldIndex = maxChgIndex, field = &cFieldsArray[maxChgIndex]; fieldIndex < cStructFields; fieldIndex++, field++)
-    {
-        // I am not sure if this is type punning or not, just to be safe
-        fromField   = (NetChunk32 const *)((int8_t const *)from + field->offset);
-        toField     = (NetChunk32 *)      ((int8_t *)      to + field->offset);
-
-        // no change on all the rest of the fields of the struct
-        *toField = *fromField;
-    }
-
-
-}
-
-
-
-static void NetBuffer_ReadDeltaActor(NetBuffer_t* netBuffer, const netactor_t *from, netactor_t *to, uint16_t actorIndex)
-{
-    int32_t         fieldIndex,
-                    maxChgIndex;                                   // the number of fields that changed in this delta struct from the server
-
-    const	int32_t         cMaxStructs = MAXWALLS;
-    const	int32_t         cStructFields = ARRAY_SIZE(ActorFields);        // the number of fields in the full struct
-
-    netField_t      *cFieldsArray = &(ActorFields[0]);
-
-    netField_t      *field;
-
-    const NetChunk32      *fromField;
-          NetChunk32      *toField;
-
-    int32_t         removeActor;
-
-    int32_t         actorChanged; // this is only used if the packet is sent with "force"
-
-    int32_t         fromActorDeleted = (from->spr_sectnum == MAXSECTORS);
-
-    int32_t         actorIndexOK = ((fromActorDeleted) || (from->netIndex == actorIndex));
-
-    if (actorIndex >= cMaxStructs)
-    {
-        Net_Error_Disconnect("NetBuffer_ReadDeltaActor: Bad Netindex to read.");
-    }
-
-    if (!actorIndexOK)
-    {
-        Net_Error_Disconnect("Unexpected from struct netIndex. from struct netIndex should match the netIndex parameter.");
-        return;
-    }
-
-
-    removeActor = NetBuffer_ReadBits(netBuffer, 1);                                    // read actor deleted bit
-
-                                                                                       // if this actor is being deleted, fill it with zeros and set its netIndex to STOP_PARSING_CODE
-    if (removeActor == 1)
-    {
-        Net_InitNetActor(to);
-
-        return;
-    }
-
-    actorChanged = NetBuffer_ReadBits(netBuffer, 1);                                     // read actor changed bit
-
-    to->netIndex = actorIndex;
-
-    if (actorChanged == 0)
-    {
-        *to = *from;
-
-        if (to->netIndex == cSTOP_PARSING_CODE)
-        {
-            Net_Error_Disconnect("Read invalid netindex from delta actor buffer.");
-        }
-
-        return;
-    }
-
-    maxChgIndex = NetBuffer_ReadBits(netBuffer, STRUCTINDEX_BITS);                          // max change index
-
-    if (maxChgIndex  > cStructFields || maxChgIndex < 0)
-    {
-        Net_Error_Disconnect("NetBuffer_ReadDeltaActor: Invalid delta field count from server.");
-    }
-
-    // for each field of the delta struct
-    for (fieldIndex = 0, field = cFieldsArray; fieldIndex < maxChgIndex; fieldIndex++, field++)
-    {
-        int8_t isFloatField = (field->bits == 0);
-
-        fromField = (int32_t const *)((int8_t const *)from + field->offset);
-        toField   = (int32_t *)      ((int8_t *)      to + field->offset);
-
-        // no change to this field
-        if (!NetBuffer_ReadBits(netBuffer, 1))
-        {
-            *toField = *fromField;
-
-        }
-
-        // field has changed
-        else
-        {
-            if (isFloatField)
-            {
-                int32_t notZeroed = NetBuffer_ReadBits(netBuffer, 1);
-
-                if (notZeroed == 0)
-                {
-                    *(float *)toField = 0.0f;
-
-                }
-
-                else
-                {
-                    int32_t sentAsRealFloat = NetBuffer_ReadBits(netBuffer, 1);
-
-                    if (sentAsRealFloat == 0)
-                    {
-                        // float was written as a truncated FLOAT_INT_BITS integer
-                        NetChunk32 truncated = NetBuffer_ReadBits(netBuffer, FLOAT_INT_BITS);
-
-                        // remove bias to allow this to be signed
-                        truncated -= cTruncInt_Max;
-
-                        *(float *)toField = (float)truncated;
-                    }
-
-                    else
-                    {
-                        // read the raw float data directly from the buffer
-                        *toField = NetBuffer_ReadBits(netBuffer, 32);
-                    }
-                }
-            }
-
-            // not a float field
-            else
-            {
-
-                // zero the field
-                if (NetBuffer_ReadBits(netBuffer, 1) == 0)
-                {
-                    *toField = 0;
-
-                }
-
-                // read the whole field
-                else
-                {
-                    *toField = NetBuffer_ReadBits(netBuffer, field->bits);
-
-                }
-            }
-
-        }
-    }
-
-    // if the delta for this struct doesn't include every field of the struct (likely)
-    // just set every field after the end of this delta struct to the "from" value
-    for (fieldIndex = maxChgIndex, field = &cFieldsArray[maxChgIndex]; fieldIndex < cStructFields; fieldIndex++, field++)
-    {
-        // I am really not 100% sure if this is type punning or not, just to be safe.
-        fromField   = (NetChunk32 const *)((int8_t const *)from + field->offset);
-        toField     = (NetChunk32 *)      ((int8_t *)      to + field->offset);
-
-        // no change on all the rest of the fields of the struct
-        *toField = *fromField;
-    }
-
-    if (to->netIndex == cSTOP_PARSING_CODE)
-    {
-        Net_Error_Disconnect("Read invalid netindex from delta actor buffer.");
-    }
-
-}
-
-// Using oldSnapshot as the "From" snapshot, parse the data in netBuffer as a diff from
-// oldSnapshot to make newSnapshot.
-static void Net_ParseWalls(NetBuffer_t *netBuffer, netmapstate_t *oldSnapshot, netmapstate_t *newSnapshot)
-{
-    Bassert(oldSnapshot != nullptr);
-    Bassert(newSnapshot != nullptr);
-
-    int32_t         newSnapshotNetIndex = 0;
-    int32_t         oldSnapshotNetIndex = 0;
-
-
-
-    netWall_t       *oldSnapshotStruct = NULL;
-    netWall_t       *newSnapshotStruct = NULL;
-
-    const   int32_t         cMaxStructIndex = numwalls - 1;
-
-    NET_DEBUG_VAR int32_t       DEBUG_NumberOfStructsInPacket  = 0;
-
-    NET_DEBUG_VAR int32_t       DEBUG_FirstChangedIndex  = -1234;
-    NET_DEBUG_VAR int32_t       DEBUG_LastChangedIndex  = -1234;
-
-
-
-#if DEBUG_CHANGEDINDEXES
-    NET_DEBUG_VAR int32_t       DEBUG_ChangedIndexes[NetNumberOfIndexes];
-
-    memset(&DEBUG_ChangedIndexes, 0, sizeof(DEBUG_ChangedIndexes));
-
-#endif
-
-    //read each struct from the delta packet, until the NetIndex == the stop number
-    while (1)
-    {
-        // read the netIndex of this struct
-        newSnapshotNetIndex = NetBuffer_ReadBits(netBuffer, NETINDEX_BITS);
-
-        if (newSnapshotNetIndex < 0)
-        {
-            Net_Error_Disconnect("Net_ParseWalls: Invalid netIndex from client.");
-            return;
-        }
-
-        //================================================================
-        // DEBUG ONLY
-
-        if (DEBUG_FirstChangedIndex < 0)
-        {
-            DEBUG_FirstChangedIndex = newSnapshotNetIndex;
-        }
-
-        if (newSnapshotNetIndex != cSTOP_PARSING_CODE)
-        {
-            DEBUG_LastChangedIndex = newSnapshotNetIndex;
-        }
-
-        //----------------------------------------------------------------
-
-        if (newSnapshotNetIndex == (cSTOP_PARSING_CODE))
-        {
-            break;
-        }
-
-        if (newSnapshotNetIndex > cMaxStructIndex)
-        {
-            // this assert is only here to test the STOP_PARSING_CODE because we need that code to work for actors/sprites,
-            // since the number of walls/sectors does not change, it's safe to return here.
-            Bassert(0);
-            break;
-        }
-
-        newSnapshotStruct = &(newSnapshot->wall[newSnapshotNetIndex]);
-        oldSnapshotStruct = &(oldSnapshot->wall[oldSnapshotNetIndex]);
-
-        if (netBuffer->ReadCurByte > netBuffer->CurSize)
-        {
-            Net_Error_Disconnect("Net_ParseWalls: Reached end of buffer without finding a stop code.");
-            return;
-        }
-
-        // index up to the point where the changed structs start
-        while (oldSnapshotNetIndex < newSnapshotNetIndex)
-        {
-            // if it's not in the delta entity set, just use the previous snapshot's value
-            newSnapshot->wall[oldSnapshotNetIndex] = oldSnapshot->wall[oldSnapshotNetIndex];
-            oldSnapshotNetIndex++;
-            oldSnapshotStruct = &(oldSnapshot->wall[oldSnapshotNetIndex]);
-
-        }
-
-        // the struct referred to by oldindex is the same struct as the one referred to by newindex,
-        // compare the two structs
-        if (oldSnapshotNetIndex == newSnapshotNetIndex)
-        {
-            NetBuffer_ReadDeltaWall(netBuffer, oldSnapshotStruct, newSnapshotStruct, newSnapshotNetIndex);
-
-            oldSnapshotNetIndex++;
-
-            DEBUG_NumberOfStructsInPacket++;
-
-#if DEBUG_CHANGEDINDEXES
-            DEBUG_ChangedIndexes[newSnapshotNetIndex] = 1;
-#endif
-
-        }
-
-    }
-
-    // No more walls changed for the new snapshot, but there's still walls in the old snapshot.
-    //
-    // all of those old walls are unchanged. Copy all of these into the new snapshot.
-    while (oldSnapshotNetIndex < numwalls)
-    {
-        newSnapshot->wall[oldSnapshotNetIndex] = oldSnapshot->wall[oldSnapshotNetIndex];
-
-        oldSnapshotNetIndex++;
-    }
-
-}
-
-static void Net_ParseSectors(NetBuffer_t *netBuffer, netmapstate_t *oldSnapshot, netmapstate_t *newSnapshot)
-{
-    Bassert(oldSnapshot != nullptr);
-    Bassert(newSnapshot != nullptr);
-
-    int32_t         newSnapshotNetIndex = 0;
-    int32_t         oldSnapshotNetIndex = 0;
-
-
-
-    netSector_t     *oldSnapshotStruct = NULL;
-    netSector_t     *newSnapshotStruct = NULL;
-
-    const   int32_t         cMaxStructIndex = numsectors - 1;
-
-    NET_DEBUG_VAR int32_t       DEBUG_PrevNewIndex  = -1;
-
-    NET_DEBUG_VAR int32_t       DEBUG_FirstChangedIndex  = -1234;
-    NET_DEBUG_VAR int32_t       DEBUG_LastChangedIndex = -1234;
-
-
-
-#if DEBUG_CHANGEDINDEXES
-    NET_DEBUG_VAR int32_t       DEBUG_ChangedIndexes[NetNumberOfIndexes];
-
-    memset(&DEBUG_ChangedIndexes, 0, sizeof(DEBUG_ChangedIndexes));
-
-#endif
-
-    //read each struct from the delta packet, until the NetIndex == the stop number
-    while (1)
-    {
-        // read the netIndex of this struct
-        newSnapshotNetIndex = NetBuffer_ReadBits(netBuffer, NETINDEX_BITS);
-
-        //================================================================
-        // DEBUG ONLY
-
-        if (DEBUG_FirstChangedIndex < 0)
-        {
-            DEBUG_FirstChangedIndex = newSnapshotNetIndex;
-        }
-
-        if (newSnapshotNetIndex != cSTOP_PARSING_CODE)
-        {
-            DEBUG_LastChangedIndex = newSnapshotNetIndex;
-        }
-
-        //----------------------------------------------------------------
-
-
-        if (newSnapshotNetIndex < DEBUG_PrevNewIndex)
-        {
-            Net_Error_Disconnect("Error: Sectors were recieved out of order.");
-        }
-
-        DEBUG_PrevNewIndex = newSnapshotNetIndex;
-
-        if (newSnapshotNetIndex < 0)
-        {
-            Net_Error_Disconnect("Net_ParseSectors: Invalid netIndex from client.");
-            return;
-        }
-
-        if (newSnapshotNetIndex == (cSTOP_PARSING_CODE))
-        {
-            break;
-        }
-
-        if (newSnapshotNetIndex > cMaxStructIndex)
-        {
-            // this assert is only here to test the STOP_PARSING_CODE because we need that code to work for actors/sprites,
-            // since the number of walls/sectors does not change, it's safe to return here.
-            //
-            // also this can help catch corrupted packets
-            Bassert(0);
-            break;
-        }
-
-        newSnapshotStruct = &(newSnapshot->sector[newSnapshotNetIndex]);
-        oldSnapshotStruct = &(oldSnapshot->sector[oldSnapshotNetIndex]);
-
-        if (netBuffer->ReadCurByte > netBuffer->CurSize)
-        {
-            Net_Error_Disconnect("Net_ParseSectors: Reached end of buffer without finding a stop code.");
-            return;
-        }
-
-        // index up to the point where the changed structs start
-        while (oldSnapshotNetIndex < newSnapshotNetIndex)
-        {
-            // if it's not in the delta entity set, just use the previous snapshot's value
-            newSnapshot->sector[oldSnapshotNetIndex] = oldSnapshot->sector[oldSnapshotNetIndex];
-            oldSnapshotNetIndex++;
-            oldSnapshotStruct = &(oldSnapshot->sector[oldSnapshotNetIndex]);
-        }
-
-        // the struct referred to by oldindex is the same struct as the one referred to by newindex,
-        // compare the two structs
-        if (oldSnapshotNetIndex == newSnapshotNetIndex)
-        {
-            NetBuffer_ReadDeltaSector(netBuffer, oldSnapshotStruct, newSnapshotStruct, newSnapshotNetIndex);
-
-            oldSnapshotNetIndex++;
-
-#if DEBUG_CHANGEDINDEXES
-            DEBUG_ChangedIndexes[newSnapshotNetIndex] = 1;
-#endif
-
-        }
-
-    }
-
-    // No more sectors changed for the new snapshot, but there's still sectors in the old snapshot.
-    //
-    // all of those old sectors are unchanged. Copy all of these into the new snapshot.
-    while (oldSnapshotNetIndex < numsectors)
-    {
-        newSnapshot->sector[oldSnapshotNetIndex] = oldSnapshot->sector[oldSnapshotNetIndex];
-
-        oldSnapshotNetIndex++;
-    }
-
-}
-
-static void Net_ParseActors(NetBuffer_t *netBuffer, const netmapstate_t* oldSnapshot, netmapstate_t* newSnapshot)
-{
-    Bassert(oldSnapshot != nullptr);
-    Bassert(newSnapshot != nullptr);
-
-    // FROM PACKET: index into sprite[] (game arrays)
-    int32_t         newActorIndex = 0;
-
-    // INCREMENTED: index into sprite[] (game arrays)
-    int32_t         oldActorIndex = 0;
-
-    const   netactor_t      *oldSnapshotStruct = NULL;
-    netactor_t              *newSnapshotStruct = NULL;
-
-    const   int32_t         cActorIndex_OutOfOldFrameActors = 99999;
-
-    NET_DEBUG_VAR int32_t   DEBUG_FirstChangedIndex  = -1234;
-    NET_DEBUG_VAR int32_t   DEBUG_LastChangedIndex   = -1234;
-
-
-
-#if DEBUG_CHANGEDINDEXES
-    NET_DEBUG_VAR int32_t   DEBUG_ChangedIndexes[NetNumberOfIndexes];
-
-    memset(&DEBUG_ChangedIndexes, 0, sizeof(DEBUG_ChangedIndexes));
-
-#endif
-
-    newSnapshot->maxActorIndex = 0;
-
-    if (!oldSnapshot)
-    {
-        oldActorIndex = cActorIndex_OutOfOldFrameActors;
-    }
-    else
-    {
-        oldSnapshotStruct = &oldSnapshot->actor[oldActorIndex];
-    }
-
-    //read each struct from the delta packet, until the NetIndex == the stop number
-    //i.e., for each actor in the actors section of the packet...
-    while (1)
-    {
-        newActorIndex = NetBuffer_ReadBits(netBuffer, NETINDEX_BITS);
-
-        //================================================================
-        // DEBUG ONLY
-
-        if (DEBUG_FirstChangedIndex < 0)
-        {
-            DEBUG_FirstChangedIndex = newActorIndex;
-        }
-
-        if (newActorIndex != cSTOP_PARSING_CODE)
-        {
-            DEBUG_LastChangedIndex = newActorIndex;
-        }
-
-        //----------------------------------------------------------------
-
-        if (newActorIndex == cSTOP_PARSING_CODE)
-        {
-            //NOTE: This is okay, there is a while loop below to handle cases
-            //      where there are unchanged actors after the last changed actor in the
-            //      netbuffer.
-            break;
-        }
-
-        if (netBuffer->ReadCurByte > netBuffer->CurSize)
-        {
-            Net_Error_Disconnect("Net_ParseActors: Reached end of buffer without finding a stop code.");
-        }
-
-        if ((newActorIndex < 0) || (newActorIndex > MAXSPRITES))
-        {
-            Net_Error_Disconnect("Net_ParseActors: Invalid netIndex from client.");
-        }
-
-        // loop up to the point where the structs changed between the old frame and the new frame start
-        while (oldActorIndex < newActorIndex)
-        {
-            //actor is unchanged in the new snapshot, just *copy* the previous snapshot's value
-            newSnapshot->actor[oldActorIndex] = oldSnapshot->actor[oldActorIndex];
-
-            oldActorIndex++;
-
-        }
-
-        // NOTE that actors deleted for the new snapshot will be processed *here*. New actors that "fill in gaps"
-        // (rather than being added to the end) in the actor list will be processed here too.
-        if (oldActorIndex == newActorIndex)
-        {
-            oldSnapshotStruct = &(oldSnapshot->actor[oldActorIndex]);
-            newSnapshotStruct = &(newSnapshot->actor[newActorIndex]);
-
-            NetBuffer_ReadDeltaActor(netBuffer, oldSnapshotStruct, newSnapshotStruct, newActorIndex);
-
-            oldActorIndex++;
-
-#if DEBUG_CHANGEDINDEXES
-            DEBUG_ChangedIndexes[newSnapshotStruct->netIndex] = 1;
-#endif
-
-            continue; // because we handled the newActorIndex read from the packet.
-        }
-
-        // This actor is a newly inserted actor, either to be put in a space between
-        // two actors in the old snapshot, or after the end of the old snapshot.
-        //
-        // Note that the "no more oldframe entities" index constant runs this
-        if (oldActorIndex > newActorIndex)
-        {
-            newSnapshotStruct = &(newSnapshot->actor[newActorIndex]);
-
-            NetBuffer_ReadDeltaActor(netBuffer, &cNullNetActor, newSnapshotStruct, newActorIndex);
-
-        }
-    }
-
-    // No more actors changed for the new snapshot, but there's still actors in the old snapshot.
-    //
-    // All of those old actors are unchanged. Copy all of these into the new snapshot.
-    // Remember that deleting an actor counts as a "change".
-    while (oldActorIndex < MAXSPRITES)
-    {
-        newSnapshot->actor[oldActorIndex] = oldSnapshot->actor[oldActorIndex];
-
-        oldActorIndex++;
-
-    }
-
-    NET_75_CHECK++; // For now every snapshot will have MAXSPRITES entries
-    newSnapshot->maxActorIndex = MAXSPRITES;
-}
-
-
-
-static void NetBuffer_ReadWorldSnapshotFromBuffer(NetBuffer_t* netBuffer, netmapstate_t* oldSnapshot, netmapstate_t* newSnapshot)
-{
-    Bassert(oldSnapshot != nullptr);
-    Bassert(newSnapshot != nullptr);
-
-    // note that the order these functions are called should match the order that these structs are written to
-    // by the server
-    Net_ParseWalls(netBuffer, oldSnapshot, newSnapshot);
-    Net_ParseSectors(netBuffer, oldSnapshot, newSnapshot);
-    Net_ParseActors(netBuffer, oldSnapshot, newSnapshot);
-}
-
-
-static void Net_SendWorldUpdate(uint32_t fromRevisionNumber, uint32_t toRevisionNumber, int32_t sendToPlayerIndex)
-{
-    if (sendToPlayerIndex == myconnectindex)
-    {
-        return;
-    }
-
-    Bassert(tempnetbuf != nullptr);
-    Bassert(NET_REVISIONS == ARRAY_SIZE(g_mapStateHistory));
-
-    uint32_t        playerRevisionIsTooOld = (toRevisionNumber - fromRevisionNumber) > NET_REVISIONS;
-
-    // to avoid the client thinking that revision 2 is older than revision 0xFFFF_FFFF,
-    // send packets to take the client from the map's initial state until the client reports back
-    // that it's beyond that rollover threshold.
-    uint32_t        revisionInRolloverState = (fromRevisionNumber > toRevisionNumber);
-
-
-    NetBuffer_t     buffer;
-    NetBuffer_t*    bufferPtr = &buffer;
-
-    // note: not enough stack memory to put the world data as a local variable
-    uint8_t*        byteBuffer = &tempnetbuf[1];
-
-
-    uint32_t        fromRevisionNumberToSend = 0x86753090;
-
-    netmapstate_t*  toMapState = g_mapStateHistory[toRevisionNumber % NET_REVISIONS];
-    netmapstate_t*  fromMapState = NULL;
-
-    Bassert(toMapState != nullptr);
-
-    NET_75_CHECK++; // during the rollover state it might be a good idea to init the map state history?
-                    // maybe not? I do init map states before using them, so it might not be needed.
-
-
-    if (playerRevisionIsTooOld || revisionInRolloverState)
-    {
-        fromMapState = g_mapStartState;
-        fromRevisionNumberToSend = cInitialMapStateRevisionNumber;
-    }
-    else
-    {
-        uint32_t tFromRevisionIndex = fromRevisionNumber % NET_REVISIONS;
-
-        fromMapState = g_mapStateHistory[tFromRevisionIndex];
-        fromRevisionNumberToSend = fromRevisionNumber;
-    }
-
-    Bassert(fromMapState != nullptr);
-
-    Bmemset(byteBuffer, 0, sizeof(tempnetbuf) - 1);
-
-    tempnetbuf[0] = PACKET_WORLD_UPDATE;
-
-    NetBuffer_Init(bufferPtr, byteBuffer, MAX_WORLDBUFFER);
-
-    NetBuffer_WriteDword(bufferPtr, fromRevisionNumberToSend);
-    NetBuffer_WriteDword(bufferPtr, toRevisionNumber);
-
-    Net_WriteWorldToBuffer(bufferPtr, fromMapState, toMapState);
-
-    if (sendToPlayerIndex > ((int32_t) g_netServer->peerCount))
-    {
-        Net_Error_Disconnect("No peer for player.");
-        return;
-    }
-
-    // in the future we could probably use these flags for enet_peer_send, for the world updates
-    EDUKE32_UNUSED const ENetPacketFlag optimizedFlags = (ENetPacketFlag)(ENET_PACKET_FLAG_UNSEQUENCED | ENET_PACKET_FLAG_UNRELIABLE_FRAGMENT);
-
-    NET_75_CHECK++; // HACK: I Really need to keep the peer with the player instead of assuming that the peer index is the same as the (player index - 1)
-    ENetPeer *const tCurrentPeer = &g_netServer->peers[sendToPlayerIndex - 1];
-    enet_peer_send(tCurrentPeer, CHAN_GAMESTATE, enet_packet_create(&tempnetbuf, bufferPtr->CurSize + 1, 0));
-    Dbg_PacketSent(PACKET_WORLD_UPDATE);
-
-
-}
-
-static void Net_CopySnapshotToGameArrays(netmapstate_t* srv_snapshot, netmapstate_t* cl_snapshot)
-{
-    Bassert(srv_snapshot != nullptr);
-    Bassert(cl_snapshot != nullptr);
-
-    int32_t index;
-
-    // this isn't just copying the entries that "changed" into the game arrays,
-    // remember that we need to correct any incorrect guesses the client made.
-    // don't do memcpy either, e.g., sizeof(netWall_t) != sizeof(walltype)
-
-    for (index = 0; index < numwalls; index++)
-    {
-        netWall_t*  srvWall = &(srv_snapshot->wall[index]);
-        netWall_t*  clWall  = &(cl_snapshot->wall[index]);
-
-        int status = memcmp(srvWall, clWall, sizeof(netWall_t));
-
-        if(status == 0)
-        {
-            if(g_enableClientInterpolationCheck)
-            {
-                // only copy in the server's (old) value if the client's interpolation up to that point was incorrect
-                continue;
-            }
-        }
-
-        walltype*   gameWall = &(wall[index]);
-
-        Net_CopyWallFromNet(srvWall, gameWall);
-
-    }
-
-    for (index = 0; index < numsectors; index++)
-    {
-        netSector_t*  srvSector = &(srv_snapshot->sector[index]);
-        netSector_t*  clSector  = &(cl_snapshot->sector[index]);
-
-        int status = memcmp(srvSector, clSector, sizeof(netSector_t));
-
-        if(status == 0)
-        {
-            if(g_enableClientInterpolationCheck)
-            {
-                continue;
-            }
-        }
-
-        sectortype*   gameSector = &(sector[index]);
-
-        Net_CopySectorFromNet(srvSector, gameSector);
-    }
-
-    Net_CopyActorsToGameArrays(srv_snapshot, cl_snapshot);
-}
-
-// clients only
-static void Net_ReadWorldUpdate(uint8_t* packetData, int32_t packetSize)
-{
-    if (!g_netClient)
-    {
-        return;
-    }
-
-    NetBuffer_t     buffer;
-    NetBuffer_t*    bufferPtr = &buffer;
-    uint8_t*        dataStartAddr = packetData + 1;
-
-    NET_DEBUG_VAR int16_t   DEBUG_NoMapLoaded               = ((numwalls < 1) || (numsectors < 1));
-    NET_DEBUG_VAR int32_t   DEBUG_InitialSnapshotNotSet     = (g_mapStartState->sector[0].wallnum <= 0);
-
-    if (!ClientPlayerReady)
-    {
-        return;
-    }
-
-    NetBuffer_Init(bufferPtr, dataStartAddr, MAX_WORLDBUFFER);
-
-    bufferPtr->CurSize = packetSize - 1;
-
-    uint32_t packetFromRevisionNumber = NetBuffer_ReadDWord(bufferPtr);
-    uint32_t packetToRevisionNumber = NetBuffer_ReadDWord(bufferPtr);
-
-    uint32_t from_IsInitialState = (packetFromRevisionNumber == cInitialMapStateRevisionNumber);
-
-    uint32_t clientRevisionIsTooOld = (packetToRevisionNumber - g_netMapRevisionNumber) > NET_REVISIONS;
-
-    netmapstate_t* fromMapState = NULL;
-
-    if (clientRevisionIsTooOld && !from_IsInitialState)
+    if (clientRevisionIsTooOld && !from_IsInitialState)
     {
         // this is actually not a major problem, an alternative way to handle this would be to just ignore the packet and hope the
         // server sends a diff from the initial revision eventually.
@@ -4383,7 +2691,39 @@ static void Net_ReadWorldUpdate(uint8_t* packetData, int32_t packetSize)
     NET_DEBUG_VAR uint32_t DEBUG_OldClientRevision = g_netMapRevisionNumber;
 
     Bassert(fromMapState);
-    NetBuffer_ReadWorldSnapshotFromBuffer(bufferPtr, fromMapState, toMapState);
+
+    uint8_t const  flags     = packetData[9];
+    int32_t const  deltaSize = B_UNBUF32(&packetData[10]);
+    int32_t const  dataSize  = packetSize - WORLD_HEADERSIZE;
+    uint8_t const *deltaData = &packetData[WORLD_HEADERSIZE];
+
+    if (deltaSize <= 0 || deltaSize > (int32_t)WORLD_DELTASIZE)
+    {
+        Net_Error_Disconnect("Malformed world update packet.");
+        return;
+    }
+
+    if (flags & WORLD_LZ4)
+    {
+        if (LZ4_decompress_safe((char const *)deltaData, (char *)netdeltabuf, dataSize, deltaSize) != deltaSize)
+        {
+            Net_Error_Disconnect("Malformed world update packet.");
+            return;
+        }
+
+        deltaData = netdeltabuf;
+    }
+    else if (dataSize != deltaSize)
+    {
+        Net_Error_Disconnect("Malformed world update packet.");
+        return;
+    }
+
+    if (!Net_ReadWorldDelta(deltaData, deltaSize, fromMapState, toMapState))
+    {
+        Net_Error_Disconnect("Malformed world update packet.");
+        return;
+    }
 
     g_netMapRevisionNumber = packetToRevisionNumber;
 
@@ -4600,6 +2940,9 @@ void Net_SendMapUpdate(void)
 
     toMapState->revisionNumber = g_netMapRevisionNumber;
 
+    // a new revision was just taken, whatever world update tempnetbuf holds is stale
+    g_netWorldUpdateSize = 0;
+
     int32_t playerIndex = 0;
 
     for (TRAVERSE_CONNECT(playerIndex))
@@ -34,7 +34,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #include "enet.h"
 
 // net packet specification/compatibility version
-#define NETVERSION    1
+#define NETVERSION    2
 
 extern ENetHost       *g_netClient;
 extern ENetHost       *g_netServer;
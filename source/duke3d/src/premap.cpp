@@ -493,6 +493,14 @@ void G_CacheMapData(void)
         }
     }
 
+#ifdef USE_OPENGL
+    if (videoGetRenderMode() != REND_CLASSIC)
+    {
+        for (int j = 0; j < 2; j++)
+            polymost_prefetch(precachehightile[j], j);
+    }
+#endif
+
     int cnt = 0;
     int cntDisplayed = -1;
     int pctDisplayed = -1;
@@ -507,6 +515,10 @@ void G_CacheMapData(void)
             if (waloff[i] == 0)
                 tileLoad((int16_t)i);
 
+#ifdef USE_OPENGL
+            polymost_prefetchnext(i);
+#endif
+
             for (int j = 0; j < 2; j++)
             {
                 if (bitmap_test(precachehightile[j], i))
@@ -534,6 +546,10 @@ void G_CacheMapData(void)
         }
     }
 
+#ifdef USE_OPENGL
+    polymost_prefetchfree();
+#endif
+
     Bmemset(gotpic, 0, sizeof(gotpic));
 
     LOG_F(INFO, "Cache time: %dms.", timerGetTicks() - cacheStartTime);
@@ -1146,6 +1146,10 @@ void S_Update(void)
 
     S_Cleanup();
 
+    // positional updates are handed to the mixer in batches so it is locked once per batch rather than once per voice
+    MV_Pan3DUpdate pan[64];
+    int numPan = 0;
+
     do
     {
         if ((g_sounds[sndnum] == &nullsound) | (g_sounds[sndnum]->playing == 0))
@@ -1173,9 +1177,18 @@ void S_Update(void)
                 g_numEnvSoundsPlaying++;
 
             S_CalcDistAndAng(spriteNum, sndnum, cs, ca, *c, sprite[spriteNum].xyz, &sndist, &sndang);
-            FX_Pan3D(voice.handle, sndang >> 4, (voice.dist = (sndist >> 6)));
+            pan[numPan++] = { voice.handle, sndang >> 4, (voice.dist = (sndist >> 6)) };
+
+            if (numPan == ARRAY_SSIZE(pan))
+            {
+                FX_Pan3DBatch(pan, numPan);
+                numPan = 0;
+            }
         }
     } while (++sndnum <= g_highestSoundIdx);
+
+    if (numPan)
+        FX_Pan3DBatch(pan, numPan);
 }
 
 // when playing back a new sound needs an existing sound to be stopped first
@@ -261,6 +261,8 @@ bool LoadLevel(int nMap)
             kread(hFile, wall, sizeof(WALL) * nWalls);
         }
 
+        sectorgrid_invalidate();
+
         // sprites
         short nSprites;
         kread(hFile, &nSprites, sizeof(nSprites));
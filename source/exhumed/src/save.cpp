@@ -146,6 +146,7 @@ int loadgame(int nSlot)
         buildvfs_read(hFile, sector, sizeof(SECTOR) * numsectors);
         buildvfs_read(hFile, &numwalls, sizeof(numwalls));
         buildvfs_read(hFile, wall, sizeof(WALL) * numwalls);
+        sectorgrid_invalidate();
         buildvfs_read(hFile, sprite, sizeof(SPRITE) * kMaxSprites);
         buildvfs_read(hFile, headspritesect, sizeof(headspritesect));
         buildvfs_read(hFile, prevspritesect, sizeof(prevspritesect));
@@ -293,6 +294,7 @@ void MyLoadSave::Load()
 
     Read(sector, sizeof(sector[0]) * numsectors);
     Read(wall,   sizeof(wall[0])   * numwalls);
+    sectorgrid_invalidate();
     Read(sprite, sizeof(sprite[0]) * kMaxSprites);
 
     Read(&parallaxtype, sizeof(parallaxtype));
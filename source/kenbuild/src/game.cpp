@@ -2337,6 +2337,7 @@ void tagcode(void)
                         if (wall[k].x < subwaytrackx2[i])
                             if (wall[k].y < subwaytracky2[i])
                                 wall[k].x += subwayvel[i];
+            sectorgrid_update(dasector);
 
             for (j=1; j<subwaynumsectors[i]; j++)
             {
@@ -2346,6 +2347,7 @@ void tagcode(void)
                 endwall = startwall+sector[dasector].wallnum;
                 for (k=startwall; k<endwall; k++)
                     wall[k].x += subwayvel[i];
+                sectorgrid_update(dasector);
 
                 for (s=headspritesect[dasector]; s>=0; s=nextspritesect[s])
                     sprite[s].x += subwayvel[i];
@@ -5415,6 +5417,7 @@ int loadgame(void)
     kdfread(sector,sizeof(sectortype),numsectors,fil);
     kdfread(&numwalls,2,1,fil);
     kdfread(wall,sizeof(walltype),numwalls,fil);
+    sectorgrid_invalidate();
     //Store all sprites (even holes) to preserve indeces
     kdfread(sprite,sizeof(spritetype),MAXSPRITES,fil);
     kdfread(headspritesect,2,MAXSECTORS+1,fil);
@@ -24,13 +24,6 @@ std::string ap_message_str;
 // Convenience access to player struct
 #define ACTIVE_PLAYER g_player[myconnectindex].ps
 
-static inline ap_location_t safe_location_id(Json::Value& val)
-{
-    if (val.isInt())
-        return AP_SHORT_LOCATION(val.asInt());
-    return -1;
-}
-
 // Map name in format EYLX[X]
 std::string ap_format_map_id(uint8_t level_number, uint8_t volume_number)
 {
@@ -43,6 +36,14 @@ std::string ap_format_map_id(uint8_t level_number, uint8_t volume_number)
 }
 
 std::string current_map = "";
+// Compiled location tables for current_map, NULL if the map has no locations
+static const ap_map_locations_t* current_map_locations = NULL;
+
+static void ap_set_current_map(void)
+{
+    current_map = ap_format_map_id(ud.level_number, ud.volume_number);
+    current_map_locations = AP_GetMapLocations(current_map);
+}
 
 static void ap_add_processor_sprite(void)
 {
@@ -77,26 +78,23 @@ static void ap_add_processor_sprite(void)
 */
 static void ap_map_patch_sprites(void)
 {
-    std::string map = current_map;
-    Json::Value sprite_locations = ap_game_config["locations"][map]["sprites"];
     int32_t i;
-    Json::Value sprite_info;
     int32_t use_sprite;
-    int location_id;
     ap_location_t sprite_location;
     std::vector<int32_t> to_delete;
+    if (current_map_locations == NULL)
+    {
+        ap_add_processor_sprite();
+        return;
+    }
     for (i = 0; i < Numsprites; i++)
     {
-        sprite_info = sprite_locations[std::to_string(i)];
-        if (!sprite_info["id"].isInt()) continue;  // Not a sprite described in the AP Game Data, ignore it
-        location_id = sprite_info["id"].asInt();
-        if (location_id < 0)
+        sprite_location = AP_MapLocation(current_map_locations->sprites, i);
+        if (sprite_location == AP_LOCATION_NONE) continue;  // Not a sprite described in the AP Game Data, ignore it
+        if (sprite_location == AP_LOCATION_DISABLED)
             use_sprite = 0;
         else
-        {
-            sprite_location = AP_SHORT_LOCATION(location_id);
-            use_sprite  = AP_VALID_LOCATION(sprite_location);
-        }
+            use_sprite = AP_VALID_LOCATION(sprite_location);
         if (use_sprite)
         {
             // Have a sprite that should become an AP Pickup
@@ -378,15 +376,13 @@ static void print_level_template(void)
 static void ap_mark_known_secret_sectors(bool from_save)
 {
     int32_t i;
-    Json::Value cur_secret_locations = ap_game_config["locations"][current_map]["sectors"];
-    Json::Value sector_info;
+    if (current_map_locations == NULL) return;
     for (i = 0; i < numsectors; i++)
     {
         if (sector[i].lotag == 32767)
         {
             // Secret sector, check if it is a valid location for the AP seed and has been collected already
-            sector_info = cur_secret_locations[std::to_string(i)];
-            ap_location_t location_id = safe_location_id(sector_info["id"]);
+            ap_location_t location_id = AP_MapLocation(current_map_locations->sectors, i);
             if (location_id < 0)
                 continue;
             if AP_LOCATION_CHECKED(location_id)
@@ -417,7 +413,14 @@ void ap_startup(void)
         ap_connection_settings.player = ud.setup.ap_user;
         ap_connection_settings.ip = ud.setup.ap_server;
         ap_connection_settings.password = ud.setup.ap_pass;
-        AP_Printf("Connecting to AP Server " + std::string(ud.setup.ap_server) + " as " + std::string(ud.setup.ap_user));
+        if (!Bstrcasecmp(ud.setup.ap_server, "mock"))
+        {
+            // In-process stand-in for a server, for testing the connection handling offline
+            ap_connection_settings.mode = AP_LOCAL;
+            AP_Printf("Using mock AP Server as " + std::string(ud.setup.ap_user));
+        }
+        else
+            AP_Printf("Connecting to AP Server " + std::string(ud.setup.ap_server) + " as " + std::string(ud.setup.ap_user));
     }
     if (ap_connection_settings.mode == AP_DISABLED)
     {
@@ -498,6 +501,242 @@ void ap_parse_levels()
 
 }
 
+static inline int64_t json_get_int(Json::Value& val, int64_t def)
+{
+    return val.isInt() ? val.asInt() : def;
+}
+
+/* Item descriptors compiled from ap_item_info and the seed's dynamic overrides */
+
+typedef enum
+{
+    AP_ITEM_NONE,
+    AP_ITEM_PROGRESSIVE,
+    AP_ITEM_KEY,
+    AP_ITEM_AUTOMAP,
+    AP_ITEM_WEAPON,
+    AP_ITEM_AMMO,
+    AP_ITEM_INVENTORY,
+    AP_ITEM_INVCAPACITY,
+    AP_ITEM_ABILITY,
+    AP_ITEM_HEALTH,
+    AP_ITEM_ARMOR,
+    AP_ITEM_TRAP,
+    AP_ITEM_MAP,
+} ap_item_type_t;
+
+typedef enum
+{
+    AP_TRAP_NONE,
+    AP_TRAP_CELEBRATE,
+    AP_TRAP_CREDITS,
+    AP_TRAP_HYPERSPEED,
+    AP_TRAP_DEATH,
+    AP_TRAP_SHRINK,
+    AP_TRAP_SPAWN,
+} ap_trap_type_t;
+
+typedef struct {
+    ap_net_id_t id;  // Full item id, 0 if this descriptor slot is unused
+    ap_item_type_t type;
+    bool silent;
+    bool persistent;
+    bool unique;
+    int32_t levelnum;  // -1 if the item is not scoped to a level
+    int32_t volumenum;  // -1 if the item is not scoped to a level
+    int32_t flags;  // Key flags
+    int64_t weaponnum;
+    int64_t invnum;
+    int64_t ammo;
+    int64_t capacity;
+    int64_t max_capacity;  // Inventory saturation, -1 if unbounded
+    int64_t maxcapacity;  // Armor max capacity increase
+    int64_t heal;
+    bool overheal;
+    std::string enables;  // Ability name, empty if none
+    std::vector<ap_net_id_t> items;  // Progressive item chain
+    ap_trap_type_t trap;
+    std::string name;
+    double duration;  // Trap duration in tics
+    uint32_t grace;  // Trap grace period in tics
+    int32_t sprite;  // Spawn trap picnum
+    int32_t amount;  // Spawn trap count
+} ap_item_desc_t;
+
+// Indexed by the short item id, which is unique per game
+static ap_item_desc_t ap_item_descs[AP_LOCATION_MASK + 1];
+
+static inline const ap_item_desc_t* ap_get_item_desc(ap_net_id_t item_id)
+{
+    const ap_item_desc_t* desc = &ap_item_descs[AP_SHORT_LOCATION(item_id)];
+    return (desc->id == item_id) ? desc : NULL;
+}
+
+static ap_item_type_t ap_parse_item_type(const std::string& type)
+{
+    if (type == "progressive") return AP_ITEM_PROGRESSIVE;
+    if (type == "key") return AP_ITEM_KEY;
+    if (type == "automap") return AP_ITEM_AUTOMAP;
+    if (type == "weapon") return AP_ITEM_WEAPON;
+    if (type == "ammo" || type == "maxammo") return AP_ITEM_AMMO;
+    if (type == "inventory") return AP_ITEM_INVENTORY;
+    if (type == "invcapacity") return AP_ITEM_INVCAPACITY;
+    if (type == "ability") return AP_ITEM_ABILITY;
+    if (type == "health") return AP_ITEM_HEALTH;
+    if (type == "armor") return AP_ITEM_ARMOR;
+    if (type == "trap") return AP_ITEM_TRAP;
+    if (type == "map") return AP_ITEM_MAP;
+    return AP_ITEM_NONE;
+}
+
+static ap_trap_type_t ap_parse_trap_type(const std::string& type)
+{
+    if (type == "celebrate") return AP_TRAP_CELEBRATE;
+    if (type == "credits") return AP_TRAP_CREDITS;
+    if (type == "hyperspeed") return AP_TRAP_HYPERSPEED;
+    if (type == "death") return AP_TRAP_DEATH;
+    if (type == "shrink") return AP_TRAP_SHRINK;
+    if (type == "spawn") return AP_TRAP_SPAWN;
+    return AP_TRAP_NONE;
+}
+
+/*
+  Compiles all item definitions into typed descriptors. Has to run after the slot
+  data has been received, as the seed can override item definitions.
+*/
+static void ap_compile_item_descs(void)
+{
+    for (auto& desc : ap_item_descs)
+        desc = ap_item_desc_t();
+
+    for (auto& item_pair : ap_item_info)
+    {
+        Json::Value item_info = item_pair.second;
+        // Check if we have a dynamic override for the item in our seed slot data
+        if (!ap_game_settings["dynamic"][std::to_string(item_pair.first)].isNull())
+            item_info = ap_game_settings["dynamic"][std::to_string(item_pair.first)];
+
+        ap_item_desc_t& desc = ap_item_descs[AP_SHORT_LOCATION(item_pair.first)];
+        desc.id = item_pair.first;
+        desc.type = ap_parse_item_type(item_info["type"].asString());
+        desc.silent = item_info["silent"].asBool();
+        desc.persistent = item_info["persistent"].asBool();
+        desc.unique = item_info["unique"].asBool();
+        desc.levelnum = item_info["levelnum"].isInt() ? item_info["levelnum"].asInt() : -1;
+        desc.volumenum = item_info["volumenum"].isInt() ? item_info["volumenum"].asInt() : -1;
+        desc.flags = item_info["flags"].asInt();
+        desc.weaponnum = json_get_int(item_info["weaponnum"], 0);
+        desc.invnum = json_get_int(item_info["invnum"], -1);
+        desc.ammo = json_get_int(item_info["ammo"], 0);
+        desc.capacity = json_get_int(item_info["capacity"], 0);
+        desc.max_capacity = json_get_int(item_info["max_capacity"], -1);
+        desc.maxcapacity = json_get_int(item_info["maxcapacity"], 0);
+        desc.heal = json_get_int(item_info["heal"], 0);
+        desc.overheal = item_info["overheal"].asBool();
+        if (item_info["enables"].isString())
+            desc.enables = item_info["enables"].asString();
+        if (item_info["items"].isArray())
+        {
+            for (auto& next_item : item_info["items"])
+                desc.items.push_back(AP_NET_ID(json_get_int(next_item, 0)));
+        }
+        desc.trap = ap_parse_trap_type(item_info["trap"].asString());
+        desc.name = item_info["name"].asString();
+        desc.duration = item_info["duration"].asDouble();
+        desc.grace = item_info["grace"].asUInt();
+        desc.sprite = item_info["sprite"].asInt();
+        desc.amount = item_info["amount"].asInt();
+    }
+}
+
+// Safe check if an item is scoped to a level
+static inline bool item_for_level(const ap_item_desc_t* info, uint8_t level, uint8_t volume)
+{
+    return info->levelnum == level && info->volumenum == volume;
+}
+
+static inline bool item_for_current_level(const ap_item_desc_t* info)
+{
+    return item_for_level(info, ud.level_number, ud.volume_number);
+}
+
+/*
+  Trap states, one entry per trap type received. Kept out of dynamic_player so that
+  ticking them does not touch the JSON tree, and only written back to it when the
+  player data is stored or synced.
+*/
+#define AP_MAX_TRAPS 64
+
+typedef struct {
+    ap_net_id_t id;
+    const ap_item_desc_t* info;
+    uint32_t count;  // Queued trap instances
+    uint32_t remaining;  // Tics left on the active instance
+    uint32_t grace;  // Tics left until the next instance can trigger
+} ap_trap_state_t;
+
+static ap_trap_state_t ap_traps[AP_MAX_TRAPS];
+static uint8_t ap_num_traps = 0;
+
+static ap_trap_state_t* ap_find_trap(ap_net_id_t trap_id, bool create)
+{
+    for (uint8_t i = 0; i < ap_num_traps; i++)
+    {
+        if (ap_traps[i].id == trap_id)
+            return &ap_traps[i];
+    }
+
+    if (!create)
+        return NULL;
+
+    const ap_item_desc_t* trap_info = ap_get_item_desc(trap_id);
+    if (trap_info == NULL)
+        return NULL;
+    if (ap_num_traps >= AP_MAX_TRAPS)
+    {
+        AP_Errorf("Too many trap types, ignoring " + trap_info->name);
+        return NULL;
+    }
+
+    // New trap type, initialize
+    ap_trap_state_t* trap_state = &ap_traps[ap_num_traps++];
+    trap_state->id = trap_id;
+    trap_state->info = trap_info;
+    trap_state->count = 0;
+    trap_state->remaining = 0;
+    trap_state->grace = 0;
+    return trap_state;
+}
+
+// Restores trap states from the dynamic player data received from the server
+static void ap_load_traps(void)
+{
+    ap_num_traps = 0;
+    Json::Value& traps = ap_game_state.dynamic_player["traps"];
+    for (std::string trap_str : traps.getMemberNames())
+    {
+        ap_trap_state_t* trap_state = ap_find_trap(traps[trap_str]["id"].asUInt64(), true);
+        if (trap_state == NULL)
+            continue;
+        trap_state->count = traps[trap_str]["count"].asUInt();
+        trap_state->remaining = traps[trap_str]["remaining"].asUInt();
+        trap_state->grace = traps[trap_str]["grace"].asUInt();
+    }
+}
+
+static void ap_store_traps(Json::Value& dynamic_player)
+{
+    Json::Value& traps = dynamic_player["traps"];
+    for (uint8_t i = 0; i < ap_num_traps; i++)
+    {
+        Json::Value& trap_state = traps[std::to_string(ap_traps[i].id)];
+        trap_state["id"] = Json::UInt64(ap_traps[i].id);
+        trap_state["count"] = Json::UInt64(ap_traps[i].count);
+        trap_state["remaining"] = Json::UInt64(ap_traps[i].remaining);
+        trap_state["grace"] = Json::UInt64(ap_traps[i].grace);
+    }
+}
+
 void ap_fix_spawns(void)
 {
     // Tune blimp spawn items to not include progression stuff
@@ -520,6 +759,17 @@ void ap_fix_spawns(void)
 
 ap_connection_settings_t ap_connection_settings = {AP_DISABLED, "", "", "", ""};
 
+// Additional initializations after the archipelago setup is done
+static void ap_on_initialized(void)
+{
+    ap_compile_item_descs();
+    ap_load_traps();
+    AP_SetSyncCallback(&ap_store_traps);
+    ap_parse_levels();
+    // Fix spawns
+    ap_fix_spawns();
+}
+
 void ap_initialize(void)
 {
     if (ap_connection_settings.mode == AP_DISABLED) return;
@@ -527,31 +777,20 @@ void ap_initialize(void)
     if (game_ap_config.isNull()) return;
 
     ap_connection_settings.game = game_ap_config["game"].asCString();
+    AP_SetInitializedCallback(&ap_on_initialized);
+    // Only starts the connection, it completes in the background while the game keeps loading
     AP_Initialize(game_ap_config, ap_connection_settings);
-
-    if (AP)
-    {
-        // Additional initializations after the archipelago setup is done
-        ap_parse_levels();
-        // Fix spawns
-        ap_fix_spawns();
-    }
 }
 
-// Safe check if an item is scoped to a level
-static inline bool item_for_level(Json::Value& info, uint8_t level, uint8_t volume)
-{
-    return (info["levelnum"].isInt() && (info["levelnum"].asInt() == level)) && (info["volumenum"].isInt() && (info["volumenum"].asInt() == volume));
-}
-
-static inline bool item_for_current_level(Json::Value& info)
+void ap_poll_initialize(bool wait)
 {
-    return item_for_level(info, ud.level_number, ud.volume_number);
-}
+    if (!APConnecting) return;
 
-static inline int64_t json_get_int(Json::Value& val, int64_t def)
-{
-    return val.isInt() ? val.asInt() : def;
+    // The menus were built without the seed dependent entries, add them now that the connect has
+    // either finished or given up
+    AP_PollInitialize(wait);
+    if (!APConnecting)
+        Menu_SetupAP();
 }
 
 // Track inventory unlock state. There might be a better solution to this?
@@ -620,22 +859,64 @@ void force_set_inventory_item(uint8_t invnum)
         P_SelectNextInvItem(ACTIVE_PLAYER);
 }
 
+/*
+  Ammo and capacity received in the same tic are collected per weapon and
+  written back to the player once. Every item still adds its capacity and
+  ammo and clamps to the capacity in the order received, exactly like
+  P_AddAmmo would, so the result is the same as applying them one by one.
+*/
+typedef struct {
+    bool pending;
+    bool touched[MAX_WEAPONS];
+    int16_t max_ammo[MAX_WEAPONS];
+    int16_t ammo[MAX_WEAPONS];
+} ap_item_batch_t;
+
+static void ap_batch_add_ammo(ap_item_batch_t* batch, int weaponnum, int capacity, int ammo)
+{
+    if (!batch->touched[weaponnum])
+    {
+        batch->max_ammo[weaponnum] = ACTIVE_PLAYER->max_ammo_amount[weaponnum];
+        batch->ammo[weaponnum] = ACTIVE_PLAYER->ammo_amount[weaponnum];
+        batch->touched[weaponnum] = true;
+        batch->pending = true;
+    }
+    batch->max_ammo[weaponnum] += capacity;
+    batch->ammo[weaponnum] += ammo;
+    if (batch->ammo[weaponnum] > batch->max_ammo[weaponnum])
+        batch->ammo[weaponnum] = batch->max_ammo[weaponnum];
+}
+
+static void ap_apply_item_batch(ap_item_batch_t* batch)
+{
+    if (!batch->pending) return;
+    for (uint8_t i = 0; i < MAX_WEAPONS; i++)
+    {
+        if (!batch->touched[i])
+            continue;
+        ACTIVE_PLAYER->max_ammo_amount[i] = batch->max_ammo[i];
+        ACTIVE_PLAYER->ammo_amount[i] = batch->ammo[i];
+    }
+    *batch = {};
+}
+
 /* 
   Apply whatever item we just got to our current game state 
 
   Upgrade only provides just the unlock, but no ammo/capacity. This is used
   when loading savegames.
+
+  If a batch is given, ammo items are collected in it and applied later by
+  ap_apply_item_batch.
 */
-static void ap_get_item(ap_net_id_t item_id, bool silent, bool is_new)
+static void ap_get_item(ap_net_id_t item_id, bool silent, bool is_new, ap_item_batch_t* batch = NULL)
 {
-    Json::Value item_info = ap_item_info[item_id];
-    // Check if we have a dynamic override for the item in our seed slot data
-    if (!ap_game_settings["dynamic"][std::to_string(item_id)].isNull())
-        item_info = ap_game_settings["dynamic"][std::to_string(item_id)];
-    bool notify = !(silent || item_info["silent"].asBool());
+    const ap_item_desc_t* item_info = ap_get_item_desc(item_id);
+    if (item_info == NULL) return;  // Don't know anything about this type of item
+    bool notify = !(silent || item_info->silent);
 
     // Store counts for stateful items
-    if (is_new && item_info["persistent"].asBool())
+    if (is_new && item_info->persistent)
     {
         uint16_t count = 0;
         if (AP_HasItem(item_id))
@@ -645,31 +926,32 @@ static void ap_get_item(ap_net_id_t item_id, bool silent, bool is_new)
         // Increment
         count++;
         // Set to 1 if it's a unique item
-        if (item_info["unique"].asBool())
+        if (item_info->unique)
             count = 1;
         ap_game_state.persistent[item_id] = count;
     }
 
-    std::string item_type = item_info["type"].asString();
-    // Poor man's switch
-    if (item_type == "progressive")
+    switch (item_info->type)
+    {
+    case AP_ITEM_PROGRESSIVE:
     {
         // Add to our progressive counter and check how many we have now
         uint16_t prog_count = AP_ProgressiveItem(item_id);
         // And apply whatever item we have next in the queue
-        if (item_info["items"].isArray() && item_info["items"].size() > 0)
+        if (item_info->items.size() > 0)
         {
             // Repeat the last entry if we have more copies
-            uint16_t idx = (item_info["items"].size() < prog_count ? item_info["items"].size() : prog_count) - 1;
-            ap_net_id_t next_item = AP_NET_ID(json_get_int(item_info["items"][idx], 0));
-            ap_get_item(next_item, silent, false);
+            uint16_t idx = (item_info->items.size() < prog_count ? item_info->items.size() : prog_count) - 1;
+            ap_get_item(item_info->items[idx], silent, false, batch);
         }
+        break;
     }
-    else if (item_type == "key" && item_for_current_level(item_info))
+    case AP_ITEM_KEY:
     {
+        if (!item_for_current_level(item_info)) break;
         // Key is for current level, apply
         // Lower 3 bits match the flags we have on access cards
-        uint8_t key_flag = item_info["flags"].asInt();
+        uint8_t key_flag = item_info->flags;
         ACTIVE_PLAYER->got_access |= (key_flag & 0x7);
         // Remaining flags are for RR keys
         for (uint8_t i = 0; i < 5; i++)
@@ -677,16 +959,17 @@ static void ap_get_item(ap_net_id_t item_id, bool silent, bool is_new)
             if (key_flag & (1 << (i + 2)))
                 ACTIVE_PLAYER->keys[i] = 1;
         }
+        break;
     }
-    else if (item_type == "automap" && item_for_current_level(item_info))
-    {
+    case AP_ITEM_AUTOMAP:
+        if (!item_for_current_level(item_info)) break;
         // Enable all sectors
         ud.showallmap = 1;
         Bmemset(show2dsector, 0xFF, 512);
-    }
-    else if (item_type == "weapon")
+        break;
+    case AP_ITEM_WEAPON:
     {
-        int64_t weaponnum = json_get_int(item_info["weaponnum"], 0);
+        int64_t weaponnum = item_info->weaponnum;
         if (weaponnum >= MAX_WEAPONS) return;  // Limit to valid weapons
         bool had_weapon = ACTIVE_PLAYER->gotweapon & (1 << weaponnum);
         ACTIVE_PLAYER->gotweapon |= (1 << weaponnum);
@@ -695,23 +978,33 @@ static void ap_get_item(ap_net_id_t item_id, bool silent, bool is_new)
         {
             force_set_player_weapon(weaponnum);
         }
-        P_AddAmmo(ACTIVE_PLAYER, json_get_int(item_info["weaponnum"], 0), json_get_int(item_info["ammo"], 0));
+        if (batch)
+            ap_batch_add_ammo(batch, weaponnum, 0, item_info->ammo);
+        else
+            P_AddAmmo(ACTIVE_PLAYER, weaponnum, item_info->ammo);
+        break;
     }
-    else if (item_type == "ammo" || item_type == "maxammo")
+    case AP_ITEM_AMMO:
     {
-        int64_t weaponnum = json_get_int(item_info["weaponnum"], 0);
+        int64_t weaponnum = item_info->weaponnum;
         if (weaponnum >= MAX_WEAPONS) return;  // Limit to valid weapons
-        ACTIVE_PLAYER->max_ammo_amount[weaponnum] += json_get_int(item_info["capacity"], 0);
-        P_AddAmmo(ACTIVE_PLAYER, weaponnum, json_get_int(item_info["ammo"], 0));
+        if (batch)
+        {
+            ap_batch_add_ammo(batch, weaponnum, item_info->capacity, item_info->ammo);
+            break;
+        }
+        ACTIVE_PLAYER->max_ammo_amount[weaponnum] += item_info->capacity;
+        P_AddAmmo(ACTIVE_PLAYER, weaponnum, item_info->ammo);
+        break;
     }
-    else if (item_type == "inventory")
+    case AP_ITEM_INVENTORY:
     {
-        int64_t invnum = json_get_int(item_info["invnum"], -1);
+        int64_t invnum = item_info->invnum;
         if (invnum < 0 || invnum >= GET_MAX) return;  // Limit to valid slots
 
         // Add capacity
-        ACTIVE_PLAYER->inv_amount[invnum] += json_get_int(item_info["capacity"], 0);
-        inv_max_capacity[invnum] += json_get_int(item_info["capacity"], 0);
+        ACTIVE_PLAYER->inv_amount[invnum] += item_info->capacity;
+        inv_max_capacity[invnum] += item_info->capacity;
         if (inv_available[invnum] == 0)
         {
             // Also use stored min capacity
@@ -723,7 +1016,7 @@ static void ap_get_item(ap_net_id_t item_id, bool silent, bool is_new)
         inv_available[invnum] = 1;
 
         // Saturate
-        int64_t max_capacity = json_get_int(item_info["max_capacity"], -1);
+        int64_t max_capacity = item_info->max_capacity;
         // Special case, armor has a dynamic max value tracked already
         // Armor should usually be provided with an "armor" type item instead, but no
         // Reason not to support this
@@ -735,22 +1028,23 @@ static void ap_get_item(ap_net_id_t item_id, bool silent, bool is_new)
         // And display item
         if (notify)
             force_set_inventory_item(invnum);
+        break;
     }
-    else if (item_type == "invcapacity")
+    case AP_ITEM_INVCAPACITY:
     {
-        int64_t invnum = json_get_int(item_info["invnum"], -1);
+        int64_t invnum = item_info->invnum;
         if (invnum < 0 || invnum >= GET_MAX) return;  // Limit to valid slots
 
         // If the item is not unlocked yet, just add it to the min capacity
         if (!inv_available[invnum])
-            inv_capacity[invnum] += json_get_int(item_info["capacity"], 0);
+            inv_capacity[invnum] += item_info->capacity;
         else
         {
             // Inventory item unlocked, just increase capacity
-            ACTIVE_PLAYER->inv_amount[invnum] += json_get_int(item_info["capacity"], 0);
-            inv_max_capacity[invnum] += json_get_int(item_info["capacity"], 0);
+            ACTIVE_PLAYER->inv_amount[invnum] += item_info->capacity;
+            inv_max_capacity[invnum] += item_info->capacity;
             // Saturate
-            int64_t max_capacity = json_get_int(item_info["max_capacity"], -1);
+            int64_t max_capacity = item_info->max_capacity;
             if (max_capacity >= 0 && ACTIVE_PLAYER->inv_amount[invnum] > max_capacity)
                 ACTIVE_PLAYER->inv_amount[invnum] = max_capacity;
 
@@ -758,56 +1052,52 @@ static void ap_get_item(ap_net_id_t item_id, bool silent, bool is_new)
             if (notify)
                 ACTIVE_PLAYER->inven_icon = inv_to_icon[invnum];
         }
+        break;
     }
-    else if (item_type == "ability")
-    {
-        if (item_info["enables"].isString())
-            ability_unlocks[item_info["enables"].asString()] = 1;
-    }
-    else if (item_type == "health")
+    case AP_ITEM_ABILITY:
+        if (!item_info->enables.empty())
+            ability_unlocks[item_info->enables] = 1;
+        break;
+    case AP_ITEM_HEALTH:
     {
-        uint16_t capacity = json_get_int(item_info["capacity"], 0);
+        uint16_t capacity = item_info->capacity;
         ACTIVE_PLAYER->max_player_health += capacity;
-        uint16_t healing = json_get_int(item_info["heal"], 0);
+        uint16_t healing = item_info->heal;
         // Non standard max health, like for atomic health
-        bool overheal = item_info["overheal"].asBool();
-        uint16_t max_health = overheal ? (2 * ACTIVE_PLAYER->max_player_health) : ACTIVE_PLAYER->max_player_health;
+        uint16_t max_health = item_info->overheal ? (2 * ACTIVE_PLAYER->max_player_health) : ACTIVE_PLAYER->max_player_health;
         if (sprite[ACTIVE_PLAYER->i].extra < max_health)
         {
             sprite[ACTIVE_PLAYER->i].extra += healing;
             if (sprite[ACTIVE_PLAYER->i].extra > max_health)
                 sprite[ACTIVE_PLAYER->i].extra = max_health;
         }
+        break;
     }
-    else if (item_type == "armor")
+    case AP_ITEM_ARMOR:
     {
-        uint16_t capacity = json_get_int(item_info["maxcapacity"], 0);
+        uint16_t capacity = item_info->maxcapacity;
         ACTIVE_PLAYER->max_shield_amount += capacity;
-        uint16_t new_armor = json_get_int(item_info["capacity"], 0);
+        uint16_t new_armor = item_info->capacity;
         if (ACTIVE_PLAYER->inv_amount[GET_SHIELD] < ACTIVE_PLAYER->max_shield_amount)
         {
             ACTIVE_PLAYER->inv_amount[GET_SHIELD] += new_armor;
             if (ACTIVE_PLAYER->inv_amount[GET_SHIELD] > ACTIVE_PLAYER->max_shield_amount)
                 ACTIVE_PLAYER->inv_amount[GET_SHIELD] = ACTIVE_PLAYER->max_shield_amount;
         }
+        break;
     }
-    // Do not retrigger traps that the server has sent us before
-    else if (item_type == "trap" && !silent)
+    case AP_ITEM_TRAP:
     {
-        Json::Value& trap_state = ap_game_state.dynamic_player["traps"][std::to_string(item_id)];
-        if (!trap_state.isObject())
-        {
-            // New trap type, initialize
-            trap_state["id"] = Json::UInt64(item_id);
-            trap_state["count"] = Json::UInt64(1);
-            trap_state["remaining"] = Json::UInt64(0);
-            trap_state["grace"] = Json::UInt64(0);
-        }
-        else
-        {
-            // Just increment the queue trap count
-            trap_state["count"] = trap_state["count"].asInt() + 1;
-        }
+        // Do not retrigger traps that the server has sent us before
+        if (silent) break;
+        ap_trap_state_t* trap_state = ap_find_trap(item_id, true);
+        // Just increment the queue trap count
+        if (trap_state)
+            trap_state->count++;
+        break;
+    }
+    default:
+        break;
     }
 }
 
@@ -834,15 +1124,15 @@ static double credits_trap_end = 0;
 int ap_velocity_modifier = 1;
 int32_t pshrinking_label_code = 0;
 
-void ap_handle_trap(Json::Value& trap_info, bool triggered)
+void ap_handle_trap(const ap_item_desc_t* trap_info, bool triggered)
 {
     if (triggered)
-        AP_QueueMessage("^10" + trap_info["name"].asString() + "^12 triggered!");
+        AP_QueueMessage("^10" + trap_info->name + "^12 triggered!");
 
     // Process supported trap types
-    std::string trap_type = trap_info["trap"].asString();
-    if (trap_type == "celebrate")
+    switch (trap_info->trap)
     {
+    case AP_TRAP_CELEBRATE:
         // 1 in 25 chance to start a new fist pump each frame
         if (ACTIVE_PLAYER->fist_incs == 0 && (krand2() % 25 == 0))
         {
@@ -869,23 +1159,21 @@ void ap_handle_trap(Json::Value& trap_info, bool triggered)
                 break;
             }
         }
-    }
-    else if (trap_type == "credits" && triggered)
-    {
+        break;
+    case AP_TRAP_CREDITS:
+        if (!triggered) break;
         // Go look at the credits for some time
-        credits_trap_end = timerGetFractionalTicks() + trap_info["duration"].asDouble()*1000/REALGAMETICSPERSEC;
-    }
-    else if (trap_type == "hyperspeed")
-    {
+        credits_trap_end = timerGetFractionalTicks() + trap_info->duration*1000/REALGAMETICSPERSEC;
+        break;
+    case AP_TRAP_HYPERSPEED:
         // Good Luck
         ap_velocity_modifier = 6;
-    }
-    else if (trap_type == "death" && triggered)
-    {
-        P_QuickKill(ACTIVE_PLAYER);
-    }
-    else if (trap_type == "shrink")
-    {
+        break;
+    case AP_TRAP_DEATH:
+        if (triggered)
+            P_QuickKill(ACTIVE_PLAYER);
+        break;
+    case AP_TRAP_SHRINK:
         // All of the shrinking code is handled in the game CON script, try to inject stuff to there
         if (actor[ACTIVE_PLAYER->i].t_data[1] != pshrinking_label_code)
         {
@@ -896,12 +1184,13 @@ void ap_handle_trap(Json::Value& trap_info, bool triggered)
         {
             actor[ACTIVE_PLAYER->i].t_data[0] = 268;
         }
-    }
-    else if (trap_type == "spawn" && triggered)
+        break;
+    case AP_TRAP_SPAWN:
     {
+        if (!triggered) break;
         int i, j;
-        int sprite_id = trap_info["sprite"].asInt();
-        for (i = 0; i < trap_info["amount"].asInt(); i++)
+        int sprite_id = trap_info->sprite;
+        for (i = 0; i < trap_info->amount; i++)
         {
             j = A_Spawn(ACTIVE_PLAYER->i, sprite_id);
             // ToDo find a valid nearby location instead of a random nearby spot
@@ -913,7 +1202,34 @@ void ap_handle_trap(Json::Value& trap_info, bool triggered)
                 sprite[j].pal = 21;
             }
         }
+        break;
+    }
+    default:
+        break;
+    }
+}
+
+/*
+  Applies and removes queued items in the order they were received, merging
+  both queues by arrival. With global_only, only the items that can be
+  applied outside of the game are taken. Returns the number of items applied.
+*/
+static uint32_t ap_drain_item_queues(bool global_only, ap_item_batch_t* batch)
+{
+    std::deque<ap_queued_item_t>& global_queue = ap_game_state.ap_item_queue_global;
+    std::deque<ap_queued_item_t>& game_queue = ap_game_state.ap_item_queue;
+    uint32_t count = 0;
+    while (!global_queue.empty() || (!global_only && !game_queue.empty()))
+    {
+        bool from_global = global_only || game_queue.empty()
+                           || (!global_queue.empty() && (int32_t)(global_queue.front().seq - game_queue.front().seq) < 0);
+        std::deque<ap_queued_item_t>& queue = from_global ? global_queue : game_queue;
+        ap_queued_item_t queue_item = queue.front();
+        queue.pop_front();
+        ap_get_item(queue_item.id, !queue_item.notify, true, batch);
+        count++;
     }
+    return count;
 }
 
 // Called from an actor in game, ensures we are in a valid game state and an in game tic has expired since last call
@@ -922,56 +1238,51 @@ void ap_process_game_tic(void)
     // Ensure we don't have a velocity modifier unless something actively changes it for the current tic
     ap_velocity_modifier = 1;
 
-    // Check for items in our queue to process
-    while (!ap_game_state.ap_item_queue.empty())
+    // Check for items in our queues to process
+    if (!ap_game_state.ap_item_queue_global.empty() || !ap_game_state.ap_item_queue.empty())
     {
-        auto queue_item = ap_game_state.ap_item_queue.front();
-        ap_game_state.ap_item_queue.erase(ap_game_state.ap_item_queue.begin());
-        ap_get_item(queue_item.first, !queue_item.second, true);
+        uint64_t const apply_start = timerGetNanoTicks();
+        ap_item_batch_t batch = {};
+        uint32_t applied = ap_drain_item_queues(false, &batch);
+        ap_apply_item_batch(&batch);
+
+        ap_item_queue_stats.last_applied = applied;
+        ap_item_queue_stats.last_apply_time = timerGetNanoTicks() - apply_start;
+        if (ap_item_queue_stats.last_apply_time > ap_item_queue_stats.max_apply_time)
+            ap_item_queue_stats.max_apply_time = ap_item_queue_stats.last_apply_time;
     }
 
     // Check for outstanding or active traps
-    for (std::string trap_str : ap_game_state.dynamic_player["traps"].getMemberNames())
+    for (uint8_t i = 0; i < ap_num_traps; i++)
     {
-        // Fetch relevant trap information for this trap type
-        Json::Value& trap_state = ap_game_state.dynamic_player["traps"][trap_str];
-        ap_net_id_t trap_id = trap_state["id"].asUInt64();
-        Json::Value& trap_info = ap_item_info[trap_id];
-        if (!ap_game_settings["dynamic"][trap_str].isNull())
-            trap_info = ap_game_settings["dynamic"][trap_str];
+        ap_trap_state_t& trap_state = ap_traps[i];
 
         bool triggered = false;
         bool active = false;
-        uint32_t remaining = trap_state["remaining"].asUInt64();
-        if (remaining > 1)
+        if (trap_state.remaining > 1)
         {
-            remaining--;
-            trap_state["remaining"] = remaining;
+            trap_state.remaining--;
             active = true;
         }
-        else if (remaining == 1)
+        else if (trap_state.remaining == 1)
         {
             // Disable trap and set a grace period
-            trap_state["remaining"] = 0;
-            trap_state["grace"] = trap_info["grace"];
+            trap_state.remaining = 0;
+            trap_state.grace = trap_state.info->grace;
             active = false;
         }
-        
+
         if (!active)
         {
-            uint32_t grace = trap_state["grace"].asUInt64();
-            uint32_t count = trap_state["count"].asUInt64();
-            if (grace > 0)
+            if (trap_state.grace > 0)
             {
-                grace--;
-                trap_state["grace"] = grace;
+                trap_state.grace--;
             }
-            else if (count > 0)
+            else if (trap_state.count > 0)
             {
                 // Trigger new trap instance
-                trap_state["remaining"] = trap_info["duration"];
-                count--;
-                trap_state["count"] = count;
+                trap_state.remaining = (uint32_t)trap_state.info->duration;
+                trap_state.count--;
                 triggered = true;
                 active = true;
             }
@@ -979,7 +1290,7 @@ void ap_process_game_tic(void)
 
         if (active)
         {
-            ap_handle_trap(trap_info, triggered);
+            ap_handle_trap(trap_state.info, triggered);
         }
     }
 
@@ -1006,24 +1317,14 @@ bool ap_process_periodic(void)
     ud.screen_size = 4;
     ud.althud = 1;
 
-    // Peek item queue and process stuff we already can while not in game
-    if (!(ACTIVE_PLAYER->gm & MODE_GAME))
+    // Process the items we already can while not in game. Silent items, map and key unlocks
+    // and traps are queued separately on receive. Handling traps here ensures we don't lose
+    // them during sessions
+    if (!(ACTIVE_PLAYER->gm & MODE_GAME) && !ap_game_state.ap_item_queue_global.empty())
     {
-        for (auto iter = ap_game_state.ap_item_queue.begin(); iter != ap_game_state.ap_item_queue.end();)
-        {
-            Json::Value item_info = ap_item_info[iter->first];
-
-            // If it's a silent item or a map or key unlock or trap, process them outside the game
-            // already. Handling traps here ensures we don't lose them during sessions
-            std::string item_type = item_info["type"].asString();
-            if (!iter->second || item_type == "map" || item_type == "trap" || item_type == "key")
-            {
-                ap_get_item(iter->first, !iter->second, true);
-                // And then remove the entry from the queue
-                iter = ap_game_state.ap_item_queue.erase(iter);
-            }
-            else iter++;
-        }
+        ap_item_batch_t batch = {};
+        ap_drain_item_queues(true, &batch);
+        ap_apply_item_batch(&batch);
     }
 
     // Handle credits trap, as we can't count on in-game tics in the menu
@@ -1075,7 +1376,7 @@ bool ap_process_periodic(void)
     }
 
     // Sync our save status, this only does something if there are changes
-    // So it's save to call it every game tic
+    // and the last sync is long enough ago. So it's save to call it every game tic
     AP_SyncProgress();
 
     // Check if we have reached all goals
@@ -1222,6 +1523,7 @@ void ap_store_dynamic_player_data(void)
     new_player_data["time"] = Json::Int(ACTIVE_PLAYER->player_par);
 
     ap_game_state.dynamic_player["player"] = new_player_data;
+    ap_store_traps(ap_game_state.dynamic_player);
     // Mark our save state as to be synced
     ap_game_state.need_sync = true;
 }
@@ -1246,7 +1548,7 @@ void ap_sync_inventory()
 
 void ap_on_map_load(void)
 {
-    current_map = ap_format_map_id(ud.level_number, ud.volume_number);
+    ap_set_current_map();
 
 #ifdef AP_DEBUG_ON
     print_level_template();
@@ -1263,7 +1565,7 @@ void ap_on_map_load(void)
 
 void ap_on_save_load(void)
 {
-    current_map = ap_format_map_id(ud.level_number, ud.volume_number);
+    ap_set_current_map();
 
     ap_mark_known_secret_sectors(true);
     ap_sync_inventory();
@@ -1272,12 +1574,15 @@ void ap_on_save_load(void)
 
 void ap_check_secret(int16_t sectornum)
 {
-    AP_CheckLocation(safe_location_id(ap_game_config["locations"][current_map]["sectors"][std::to_string(sectornum)]["id"]));
+    if (current_map_locations == NULL) return;
+    AP_CheckLocation(AP_MapLocation(current_map_locations->sectors, sectornum));
 }
 
 void ap_level_end(void)
 {
     ap_store_dynamic_player_data();
+    // Don't wait for the next sync interval with the results of a finished level
+    AP_FlushProgress();
     // Return to menu after beating a level
     ACTIVE_PLAYER->gm = 0;
     Menu_Open(myconnectindex);
@@ -1287,10 +1592,11 @@ void ap_level_end(void)
 
 void ap_check_exit(int16_t exitnum)
 {
-    ap_location_t exit_location = safe_location_id(ap_game_config["locations"][current_map]["exits"][std::to_string(exitnum)]["id"]);
+    if (current_map_locations == NULL) return;
+    ap_location_t exit_location = AP_MapLocation(current_map_locations->exits, exitnum);
     // Might not have a secret exit defined, so in this case treat as regular exit
-    if (exit_location < 0)
-        exit_location = safe_location_id(ap_game_config["locations"][current_map]["exits"][std::to_string(0)]["id"]);
+    if (exit_location == AP_LOCATION_NONE)
+        exit_location = AP_MapLocation(current_map_locations->exits, 0);
     AP_CheckLocation(exit_location);
 }
 
@@ -1341,9 +1647,9 @@ bool ap_can_save()
 
 void ap_remaining_items(uint16_t* collected, uint16_t* total)
 {
-    for (std::string sprite_str : ap_game_config["locations"][current_map]["sprites"].getMemberNames())
+    if (current_map_locations == NULL) return;
+    for (ap_location_t pickup_loc : current_map_locations->sprites)
     {
-        ap_location_t pickup_loc = safe_location_id(ap_game_config["locations"][current_map]["sprites"][sprite_str]["id"]);
         if (pickup_loc > 0 && AP_LOCATION_CHECK_MASK(pickup_loc, (AP_LOC_PICKUP | AP_LOC_USED)))
         {
             (*total)++;
@@ -1352,6 +1658,159 @@ void ap_remaining_items(uint16_t* collected, uint16_t* total)
     }
 }
 
+/*
+  The ap_map_patch_sprites() from before the compiled location tables, kept for
+  ap_benchmark_map_patch. Copies the map's sprite locations out of the config,
+  then each sprite's entry again. Takes the config as a parameter, as the
+  non-const operator[] inserts null members on every miss.
+*/
+static void ap_map_patch_sprites_legacy(Json::Value& game_config)
+{
+    std::string map = current_map;
+    Json::Value sprite_locations = game_config["locations"][map]["sprites"];
+    int32_t i;
+    Json::Value sprite_info;
+    int32_t use_sprite;
+    int location_id;
+    ap_location_t sprite_location;
+    std::vector<int32_t> to_delete;
+    for (i = 0; i < Numsprites; i++)
+    {
+        sprite_info = sprite_locations[std::to_string(i)];
+        if (!sprite_info["id"].isInt()) continue;  // Not a sprite described in the AP Game Data, ignore it
+        location_id = sprite_info["id"].asInt();
+        if (location_id < 0)
+            use_sprite = 0;
+        else
+        {
+            sprite_location = AP_SHORT_LOCATION(location_id);
+            use_sprite  = AP_VALID_LOCATION(sprite_location);
+        }
+        if (use_sprite)
+        {
+            // Have a sprite that should become an AP Pickup
+            sprite[i].lotag  = sprite_location;
+            sprite[i].picnum = AP_LOCATION_PROGRESSION(sprite_location) ? AP_PROG__STATIC : AP_ITEM__STATIC;
+            bitmap_set(show2dsprite, i);
+        }
+        else
+        {
+            // Unused sprite, set it up for deletion
+            to_delete.push_back(i);
+        }
+    }
+
+    for (auto i: to_delete)
+        A_DeleteSprite(i);
+
+    // Inject an AP_PROCESSOR sprite into the map
+    ap_add_processor_sprite();
+}
+
+// The location lookup of the old ap_check_secret(), without sending the check
+static ap_location_t ap_secret_location_legacy(Json::Value& game_config, int16_t sectornum)
+{
+    Json::Value& val = game_config["locations"][current_map]["sectors"][std::to_string(sectornum)]["id"];
+    if (val.isInt())
+        return AP_SHORT_LOCATION(val.asInt());
+    return -1;
+}
+
+// Checksum of the patched board, so both versions can be compared
+static int32_t ap_benchmark_sprite_sum(void)
+{
+    int32_t sum = Numsprites;
+    for (int32_t i = 0; i < MAXSPRITES; i++)
+        if (sprite[i].statnum != MAXSTATUS)
+            sum += (i + 1) * (sprite[i].lotag + sprite[i].picnum);
+    return sum;
+}
+
+/*
+  Benchmark for the per map location lookups. For every map that has locations
+  defined, times ap_map_patch_sprites() and the ap_check_secret() lookup for
+  every secret sector against their versions from before the compiled location
+  tables. The board is reloaded before each patch, outside of the timed part.
+  Only valid outside of a running game, as it replaces the loaded board.
+*/
+void ap_benchmark_map_patch(int32_t repeats)
+{
+    // The legacy lookups insert null members, keep them out of the live config
+    Json::Value legacy_config = ap_game_config;
+    std::string const saved_map = current_map;
+    const ap_map_locations_t* const saved_map_locations = current_map_locations;
+
+    double total_json = 0, total_table = 0;
+    int32_t num_maps = 0, mismatches = 0;
+    double const ns_to_ms = 1000.0 / timerGetNanoTickRate();
+
+    for (int32_t volume = 0; volume < MAXVOLUMES; volume++)
+    {
+        for (int32_t level = 0; level < MAXLEVELS; level++)
+        {
+            std::string map = ap_format_map_id(level, volume);
+            const ap_map_locations_t* map_locations = AP_GetMapLocations(map);
+            map_t* const map_info = &g_mapInfo[(volume * MAXLEVELS) + level];
+            if (map_locations == NULL || map_info->filename == NULL)
+                continue;
+
+            vec3_t  pos;
+            int16_t ang, sect;
+            if (engineLoadBoard(map_info->filename, VOLUMEONE, &pos, &ang, &sect) < 0)
+                continue;
+
+            current_map = map;
+            current_map_locations = map_locations;
+
+            int32_t const num_sprites = Numsprites;
+            std::vector<int16_t> secrets;
+            for (int32_t i = 0; i < numsectors; i++)
+                if (sector[i].lotag == 32767)
+                    secrets.push_back(i);
+
+            // Secret sums keep the lookups from being optimized out, patch sums are compared. Sectors
+            // with a negative id differ between the two lookups, the old one masked the id instead.
+            uint64_t json_ticks = 0, table_ticks = 0;
+            int32_t json_sum = 0, table_sum = 0, json_patch = 0, table_patch = 0;
+
+            for (int32_t r = 0; r < repeats; r++)
+            {
+                engineLoadBoard(map_info->filename, VOLUMEONE, &pos, &ang, &sect);
+                uint64_t start = timerGetNanoTicks();
+                ap_map_patch_sprites_legacy(legacy_config);
+                for (int16_t i : secrets)
+                    json_sum += ap_secret_location_legacy(legacy_config, i);
+                json_ticks += timerGetNanoTicks() - start;
+                json_patch += ap_benchmark_sprite_sum();
+
+                engineLoadBoard(map_info->filename, VOLUMEONE, &pos, &ang, &sect);
+                start = timerGetNanoTicks();
+                ap_map_patch_sprites();
+                for (int16_t i : secrets)
+                    table_sum += AP_MapLocation(current_map_locations->sectors, i);
+                table_ticks += timerGetNanoTicks() - start;
+                table_patch += ap_benchmark_sprite_sum();
+            }
+
+            double const json_ms = json_ticks * ns_to_ms / repeats;
+            double const table_ms = table_ticks * ns_to_ms / repeats;
+            if (json_patch != table_patch)
+                mismatches++;
+
+            AP_Printf("%s: %d sprites, %d secrets, json %.4f ms, table %.4f ms (%d/%d)%s", map.c_str(), num_sprites, (int32_t)secrets.size(),
+                      json_ms, table_ms, json_sum, table_sum, (json_patch != table_patch) ? " PATCH MISMATCH" : "");
+            total_json += json_ms;
+            total_table += table_ms;
+            num_maps++;
+        }
+    }
+
+    current_map = saved_map;
+    current_map_locations = saved_map_locations;
+
+    AP_Printf("%d maps: json %.4f ms, table %.4f ms, %d mismatches", num_maps, total_json, total_table, mismatches);
+}
+
 void ap_con_hook(void)
 {
     const char* shrink_buf = "PSHRINKING";
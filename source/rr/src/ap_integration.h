@@ -12,6 +12,7 @@ extern void ap_store_dynamic_player_data(void);
 extern void ap_startup(void);
 extern void ap_shutdown(void);
 extern void ap_initialize(void);
+extern void ap_poll_initialize(bool wait);
 extern bool ap_process_periodic(void);
 extern void ap_process_game_tic(void);
 extern void ap_check_secret(int16_t sectornum);
@@ -21,6 +22,7 @@ extern void ap_select_level(uint8_t i);
 extern std::string ap_format_map_id(uint8_t level_number, uint8_t volume_number);
 extern void ap_remaining_items(uint16_t* collected, uint16_t* total);
 extern uint16_t ap_steroids_duration(void);
+extern void ap_benchmark_map_patch(int32_t repeats);
 
 // Conditional abilities
 extern bool ap_can_dive();
@@ -58,7 +58,7 @@ void G_ShowParameterHelp(void)
         "-mx [file.con]\tInclude an additional CON script module\n"
         "-m\t\tDisable enemies\n"
         "-rts [file.rts]\tLoad a custom Remote Ridicule sound bank\n"
-        "-r\t\tRecord demo\n"
+        "-r[#]\t\tRecord demo, with # quit after # gametics and print the diff timings\n"
         "-s#\t\tStart game on skill level #\n"
         "-server\t\tStart a multiplayer server\n"
 #ifdef STARTUP_SETUP_WINDOW
@@ -651,7 +651,17 @@ void G_CheckCommandLine(int32_t argc, char const * const * argv)
                     break;
                 case 'r':
                     ud.m_recstat = 1;
-                    initprintf("Demo record mode on.\n");
+                    if (Bisdigit(c[1]))
+                    {
+                        // benchmark: start the level right away, see -v and -l
+                        int32_t const tics = Batoi(c+1);
+                        Demo_RecordBenchmark(tics);
+                        ud.warp_on = 1;
+                        g_noLogo = 1;
+                        initprintf("Demo record benchmark: %d gametics.\n", tics);
+                    }
+                    else
+                        initprintf("Demo record mode on.\n");
                     break;
                 case 's':
                     c++;
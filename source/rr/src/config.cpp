@@ -25,6 +25,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #include "osdcmds.h"
 #include "renderlayer.h"
 #include "cmdline.h"
+#include "ap_integration.h"
 
 #ifdef __ANDROID__
 # include "android.h"
@@ -855,6 +856,15 @@ int32_t CONFIG_ReadSetup(void)
     SCRIPT_GetString(ud.config.scripthandle, "AP", "User", ud.setup.ap_user);
     SCRIPT_GetString(ud.config.scripthandle, "AP", "Password", ud.setup.ap_pass);
 
+    // [AP] The mock server settings are needed when the connect starts, before settings.cfg runs
+    {
+        int32_t latency = ap_mock_settings.latency, result = ap_mock_settings.result;
+        SCRIPT_GetNumber(ud.config.scripthandle, "AP", "MockLatency", &latency);
+        SCRIPT_GetNumber(ud.config.scripthandle, "AP", "MockResult", &result);
+        ap_mock_settings.latency = clamp(latency, 0, 60000);
+        ap_mock_settings.result = (ap_mock_result_t)clamp(result, AP_MOCK_OK, AP_MOCK_CHECKSUM_MISMATCH);
+    }
+
     ud.config.setupread = 1;
     return 0;
 }
@@ -953,6 +963,8 @@ void CONFIG_WriteSetup(uint32_t flags)
     SCRIPT_PutString(ud.config.scripthandle, "AP", "Server", ud.setup.ap_server);
     SCRIPT_PutString(ud.config.scripthandle, "AP", "User", ud.setup.ap_user);
     SCRIPT_PutString(ud.config.scripthandle, "AP", "Password", ud.setup.ap_pass);
+    SCRIPT_PutNumber(ud.config.scripthandle, "AP", "MockLatency", ap_mock_settings.latency, FALSE, FALSE);
+    SCRIPT_PutNumber(ud.config.scripthandle, "AP", "MockResult", ap_mock_settings.result, FALSE, FALSE);
 
     // exit early after only updating the values that can be changed from the startup window
     if (flags & 1)
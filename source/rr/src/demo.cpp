@@ -54,6 +54,14 @@ int32_t demoplay_showsync=1;
 
 static int32_t demo_synccompress=1, demorec_seeds=1, demo_hasseeds;
 
+// time spent writing diffs while recording, reported when recording stops
+static int32_t demorec_numdiffs;
+static double demorec_diffms;
+static uint64_t demorec_diffbytes;
+
+// -r#: gametics to record before quitting, 0 records until the game stops it
+static int32_t demorec_benchtics;
+
 char g_demo_legacy = 0;
 int32_t demo_reccnt_init = 0;
 
@@ -302,6 +310,13 @@ void G_OpenDemoWrite(void)
     if (g_demo_filePtr == NULL)
         return;
 
+    // the benchmark always diffs every other gametic, whatever the config says
+    if (demorec_benchtics > 0)
+    {
+        demorec_diffs_cvar = 1;
+        demorec_difftics_cvar = 2;
+    }
+
     i=sv_saveandmakesnapshot(g_demo_filePtr, nullptr, -1, demorec_diffs_cvar, demorec_diffcompress_cvar,
                              demorec_synccompress_cvar|(demorec_seeds_cvar<<1));
     if (i)
@@ -325,6 +340,10 @@ error_wopen_demo:
     ud.reccnt = 0;
     ud.recstat = ud.m_recstat = 1;  //
 
+    demorec_numdiffs = 0;
+    demorec_diffms = 0;
+    demorec_diffbytes = 0;
+
 # if KRANDDEBUG
     krd_enable(1);
 # endif
@@ -388,7 +407,12 @@ void G_DemoRecord(void)
 
     if (demorec_diffs && (g_demo_cnt%demorec_difftics == 1))
     {
-        sv_writediff(g_demo_filePtr);
+        double const t = timerGetFractionalTicks();
+
+        demorec_diffbytes += sv_writediff(g_demo_filePtr);
+        demorec_diffms += timerGetFractionalTicks() - t;
+        demorec_numdiffs++;
+
         demorec_difftics = demorec_difftics_cvar;
     }
 
@@ -403,6 +427,14 @@ void G_DemoRecord(void)
 
     if (ud.reccnt > RECSYNCBUFSIZ-MAXPLAYERS || (demorec_diffs && (g_demo_cnt%demorec_difftics == 0)))
         Demo_WriteSync();
+
+    if (demorec_benchtics > 0 && g_demo_cnt > demorec_benchtics)
+        G_CloseDemoWrite();
+}
+
+void Demo_RecordBenchmark(int32_t tics)
+{
+    demorec_benchtics = tics;
 }
 
 void G_CloseDemoWrite(void)
@@ -425,8 +457,20 @@ void G_CloseDemoWrite(void)
 
         sv_freemem();
 
+        if (demorec_numdiffs > 0)
+            OSD_Printf("Demo diffs: %d written, %.03f ms/diff, %.03f ms/gametic, %d bytes/diff\n", demorec_numdiffs,
+                       demorec_diffms / demorec_numdiffs, demorec_diffms / g_demo_cnt, (int32_t)(demorec_diffbytes / demorec_numdiffs));
+
         Bstrcpy(apStrings[QUOTE_RESERVED4], "DEMO RECORDING STOPPED");
         P_DoQuote(QUOTE_RESERVED4, g_player[myconnectindex].ps);
+
+        // the -r# benchmark is over when its recording stops, also when the player died early
+        if (demorec_benchtics > 0)
+        {
+            OSD_Printf("Demo benchmark: %d gametics recorded\n", g_demo_cnt);
+            demorec_benchtics = 0;
+            G_GameExit(" ");
+        }
     }
 #if KRANDDEBUG
     krd_print("krandrec.log");
@@ -641,7 +685,7 @@ RECHECK:
     renderFlushPerms();
 
     // [AP] Disable demo playback in AP mode
-    if (!AP && !g_netServer && ud.multimode < 2)
+    if (!AP && !APConnecting && !g_netServer && ud.multimode < 2)
         foundemo = G_OpenDemoRead(g_whichDemo);
 
     if (foundemo == 0)
@@ -1123,6 +1167,10 @@ nextdemo_nomenu:
         if (!Demo_IsProfiling())
             G_HandleAsync();
 
+        // [AP] Finish a pending connect, the seed dependent menus are set up once it completes
+        if (APConnecting)
+            ap_poll_initialize(false);
+
         // [AP] Periodic processing outside of game mode
         if (AP)
             ap_process_periodic();
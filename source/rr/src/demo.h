@@ -53,6 +53,7 @@ void Demo_PrepareWarp(void);
 void G_CloseDemoWrite(void);
 void G_DemoRecord(void);
 void G_OpenDemoWrite(void);
+void Demo_RecordBenchmark(int32_t tics);
 
 void Demo_PlayFirst(int32_t prof, int32_t exitafter);
 void Demo_SetFirst(const char *demostr);
@@ -406,7 +406,7 @@ void G_GameExit(const char *msg)
     // PK: modified from original
 
     // [AP] Cleanup and write state information
-    if (AP)
+    if (AP || APConnecting)
         ap_shutdown();
 
     if (!g_quickExit)
@@ -8352,6 +8352,10 @@ int app_main(int argc, char const * const * argv)
     if (!g_useCwd)
         G_CleanupSearchPaths();
 
+    // [AP] The groups are only mounted at this point, nothing is loaded from them yet. That is all the
+    // connect needs for the game config, so it runs in the background during CON, ART, DEF and cfg loading
+    ap_initialize();
+
     if (RR)
     {
         osdscale2 *= 0.5f;
@@ -8418,10 +8422,6 @@ int app_main(int argc, char const * const * argv)
 
     G_Startup(); // a bunch of stuff including compiling cons
 
-    // [AP] Game data is available now, time to initialize our archipelago settings
-    // and connect to the server
-    ap_initialize();
-
     g_player[0].playerquitflag = 1;
 
     g_player[myconnectindex].ps->palette = BASEPAL;
@@ -8667,7 +8667,7 @@ MAIN_LOOP_RESTART:
     if (ud.warp_on == 1)
     {
         // [AP] Disable loading levels from command line or startup options in AP mode
-        if (AP)
+        if (AP || APConnecting)
             ud.warp_on = 0;
         else
             G_NewGame_EnterLevel();
@@ -8875,6 +8875,10 @@ MAIN_LOOP_RESTART:
                 g_gameUpdateAndDrawTime = timerGetFractionalTicks()-gameUpdateStartTime;
             }
 
+            // [AP] Finish a pending connect, the seed dependent menus are set up once it completes
+            if (APConnecting)
+                ap_poll_initialize(false);
+
             // [AP] Periodic processing outside of game mode
             if (AP)
                 if (ap_process_periodic())
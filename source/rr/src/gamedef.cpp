@@ -31,6 +31,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 
 #include "osd.h"
 #include "crc32.h"
+#include "xxhash.h"
 #include "ap_integration.h"
 
 #define LINE_NUMBER (g_lineNumber << 12)
@@ -951,6 +952,90 @@ static int32_t C_CheckEmptyBranch(int32_t tw, intptr_t lastScriptPtr)
     return 0;
 }
 
+// Compiled script cache
+//
+// A successful compile saves the bytecode, the labels, the event and tile
+// tables and the source text of the top-level declarations that act outside
+// of the script image (gamevar, definequote, definesound, definelevelname and
+// so on) to g_scriptCacheFile. Compiling the same sources again loads the
+// image back and replays just those declarations. The cache is keyed by an
+// xxHash of every CON file that went into it and by the build.
+
+#define CONCACHE_MAGIC   "RedNukem compiled CON"
+#define CONCACHE_VERSION 1
+
+static char g_scriptCacheFile[BMAX_PATH];
+
+typedef struct
+{
+    char    *name;
+    int32_t  length;
+    uint64_t hash;
+} concachefile_t;
+
+static GrowArray<concachefile_t> g_scriptCacheFiles;
+static GrowArray<char *>         g_scriptCacheDecls;
+
+static int32_t     g_scriptCacheRecording;
+static char const *g_scriptCacheDeclStart;
+
+static void C_CacheAddFile(const char *fileName, char const *data, int32_t length)
+{
+    if (g_scriptCacheRecording)
+        g_scriptCacheFiles.append({ Xstrdup(fileName), length, XXH3_64bits(data, length) });
+}
+
+static int32_t C_IsCachedDeclaration(int32_t tw)
+{
+    switch (tw)
+    {
+    case CON_DEFINELEVELNAME:
+    case CON_DEFINEQUOTE:
+    case CON_DEFINESKILLNAME:
+    case CON_DEFINESOUND:
+    case CON_DEFINEVOLUMENAME:
+    case CON_GAMESTARTUP:
+    case CON_GAMEVAR:
+    case CON_MUSIC:
+        return 1;
+    }
+
+    return 0;
+}
+
+// called at the top of C_ParseCommand()'s loop: the previous command ends where the next one starts
+static void C_CacheDeclaration(int32_t tw)
+{
+    if (g_scriptCacheDeclStart && C_IsCachedDeclaration(tw))
+    {
+        int32_t const length = textptr - g_scriptCacheDeclStart;
+        char *decl = (char *)Xmalloc(length + 2);
+
+        Bmemcpy(decl, g_scriptCacheDeclStart, length);
+        decl[length]   = '\n';
+        decl[length+1] = '\0';
+
+        g_scriptCacheDecls.append(decl);
+    }
+
+    g_scriptCacheDeclStart = NULL;
+}
+
+static void C_FreeScriptCache(void)
+{
+    for (auto &file : g_scriptCacheFiles)
+        Xfree(file.name);
+
+    for (char *decl : g_scriptCacheDecls)
+        Xfree(decl);
+
+    g_scriptCacheFiles.clear();
+    g_scriptCacheDecls.clear();
+
+    g_scriptCacheRecording = 0;
+    g_scriptCacheDeclStart = NULL;
+}
+
 static void C_Include(const char *confile)
 {
     int32_t fp = kopen4loadfrommod(confile,g_loadFromGroupOnly);
@@ -973,6 +1058,8 @@ static void C_Include(const char *confile)
     g_scriptcrc = Bcrc32(mptr, j, g_scriptcrc);
     mptr[j] = 0;
 
+    C_CacheAddFile(confile, mptr, j);
+
     if (*textptr == '"') // skip past the closing quote if it's there so we don't screw up the next line
         textptr++;
 
@@ -1244,9 +1331,15 @@ static int32_t C_ParseCommand(int32_t loop)
 
     do
     {
+        if (g_scriptCacheRecording)
+            C_CacheDeclaration(g_lastKeyword);
+
         if (EDUKE32_PREDICT_FALSE(g_errorCnt > 63 || (*textptr == '\0') || (*(textptr+1) == '\0') || C_SkipComments()))
             return 1;
 
+        if (g_scriptCacheRecording && !g_processingState && !g_parsingActorPtr && !g_scriptEventOffset)
+            g_scriptCacheDeclStart = textptr;
+
         if (EDUKE32_PREDICT_FALSE(g_scriptDebug))
             C_ReportError(-1);
 
@@ -2819,7 +2912,7 @@ void C_PrintStats(void)
     initprintf("\n");
 }
 
-void C_Compile(const char *fileName)
+static void C_InitCompiler(void)
 {
     Bmemset(apScriptEvents, 0, sizeof(apScriptEvents));
     Bmemset(apScriptGameEventEnd, 0, sizeof(apScriptGameEventEnd));
@@ -2832,6 +2925,363 @@ void C_Compile(const char *fileName)
 
     C_InitHashes();
     Gv_Init();
+}
+
+static void C_FinishCompile(void)
+{
+    for (auto *i : tables_free)
+        hash_free(i);
+
+    //freehashnames();
+    freesoundhashnames();
+
+    if (g_scriptDebug)
+        C_PrintStats();
+
+    C_InitQuotes();
+}
+
+static uint64_t C_ScriptCacheKey(const char *fileName)
+{
+    int32_t const params[] = { CONCACHE_VERSION, (int32_t)sizeof(intptr_t), MAXTILES, MAXEVENTS, MAXGAMEVARS,
+                               g_scriptVersion, g_loadFromGroupOnly, g_gameType };
+
+    uint64_t key = XXH3_64bits(params, sizeof(params));
+
+    key = XXH3_64bits_withSeed(s_buildRev, Bstrlen(s_buildRev), key);
+    key = XXH3_64bits_withSeed(s_buildTimestamp, Bstrlen(s_buildTimestamp), key);
+    key = XXH3_64bits_withSeed(fileName, Bstrlen(fileName), key);
+
+    for (char const *m : g_scriptModules)
+        key = XXH3_64bits_withSeed(m, Bstrlen(m), key);
+
+    return key;
+}
+
+typedef struct
+{
+    int32_t  execPtr, loadPtr;
+    uint32_t flags;
+    int32_t  cacherange;
+} concachetile_t;
+
+enum
+{
+    CONCACHE_SCRIPTSIZE,
+    CONCACHE_SCRIPTLENGTH,
+    CONCACHE_LABELS,
+    CONCACHE_DECLS,
+    CONCACHE_DECLSIZE,
+    CONCACHE_SCRIPTVERSION,
+    CONCACHE_TOTALLINES,
+    CONCACHE_SCRIPTCRC,
+    CONCACHE_NUMINFO
+};
+
+static void C_WriteCacheBlock(buildvfs_FILE fil, void const *buf, int32_t size)
+{
+    if (size > 0)
+        dfwrite_LZ4(buf, size, 1, fil);
+}
+
+static int32_t C_ReadCacheBlock(buildvfs_kfd fil, void *buf, int32_t size)
+{
+    return size <= 0 || kdfread_LZ4(buf, size, 1, fil) == 1;
+}
+
+static void C_WriteScriptCache(uint64_t key)
+{
+    buildvfs_FILE fil = buildvfs_fopen_write(g_scriptCacheFile);
+
+    if (!fil)
+    {
+        initprintf("Unable to write compiled script cache %s.\n", g_scriptCacheFile);
+        return;
+    }
+
+    int32_t const numFiles = g_scriptCacheFiles.size();
+
+    buildvfs_fwrite(CONCACHE_MAGIC, sizeof(CONCACHE_MAGIC), 1, fil);
+    buildvfs_fwrite(&key, sizeof(key), 1, fil);
+    buildvfs_fwrite(&numFiles, sizeof(numFiles), 1, fil);
+
+    for (auto const &file : g_scriptCacheFiles)
+    {
+        int32_t const nameLength = Bstrlen(file.name);
+
+        buildvfs_fwrite(&nameLength, sizeof(nameLength), 1, fil);
+        buildvfs_fwrite(file.name, nameLength, 1, fil);
+        buildvfs_fwrite(&file.length, sizeof(file.length), 1, fil);
+        buildvfs_fwrite(&file.hash, sizeof(file.hash), 1, fil);
+    }
+
+    int32_t info[CONCACHE_NUMINFO] = {};
+
+    for (char const *decl : g_scriptCacheDecls)
+        info[CONCACHE_DECLSIZE] += Bstrlen(decl) + 1;
+
+    info[CONCACHE_SCRIPTSIZE]    = g_scriptSize;
+    info[CONCACHE_SCRIPTLENGTH]  = g_scriptPtr - apScript;
+    info[CONCACHE_LABELS]        = g_labelCnt;
+    info[CONCACHE_DECLS]         = g_scriptCacheDecls.size();
+    info[CONCACHE_SCRIPTVERSION] = g_scriptVersion;
+    info[CONCACHE_TOTALLINES]    = g_totalLines;
+    info[CONCACHE_SCRIPTCRC]     = g_scriptcrc;
+
+    buildvfs_fwrite(info, sizeof(info), 1, fil);
+
+    // pointers within the script are stored as offsets
+    intptr_t *script = (intptr_t *)Xmalloc(g_scriptSize * sizeof(intptr_t));
+
+    for (int i=0; i<g_scriptSize; i++)
+        script[i] = BITPTR_IS_POINTER(i) ? apScript[i] - (intptr_t)apScript : apScript[i];
+
+    C_WriteCacheBlock(fil, script, g_scriptSize * sizeof(intptr_t));
+    C_WriteCacheBlock(fil, bitptr, ((g_scriptSize + 7) >> 3) + 1);
+
+    Xfree(script);
+
+    C_WriteCacheBlock(fil, label, g_labelCnt << 6);
+    C_WriteCacheBlock(fil, labelcode, g_labelCnt * sizeof(int32_t));
+    C_WriteCacheBlock(fil, labeltype, g_labelCnt * sizeof(int32_t));
+    C_WriteCacheBlock(fil, apScriptEvents, sizeof(apScriptEvents));
+
+    concachetile_t *tiles = (concachetile_t *)Xmalloc(MAXTILES * sizeof(concachetile_t));
+
+    for (int i=0; i<MAXTILES; i++)
+    {
+        tiledata_t const &tile = g_tile[i];
+        tiles[i] = { tile.execPtr ? (int32_t)(tile.execPtr - apScript) : 0, tile.loadPtr ? (int32_t)(tile.loadPtr - apScript) : 0,
+                     tile.flags, tile.cacherange };
+    }
+
+    C_WriteCacheBlock(fil, tiles, MAXTILES * sizeof(concachetile_t));
+    Xfree(tiles);
+
+    char *decls = (char *)Xmalloc(max(info[CONCACHE_DECLSIZE], 1));
+    char *declptr = decls;
+
+    for (char const *decl : g_scriptCacheDecls)
+    {
+        int32_t const len = Bstrlen(decl) + 1;
+        Bmemcpy(declptr, decl, len);
+        declptr += len;
+    }
+
+    C_WriteCacheBlock(fil, decls, info[CONCACHE_DECLSIZE]);
+    Xfree(decls);
+
+    buildvfs_fclose(fil);
+}
+
+static int32_t C_CheckCachedFile(const char *fileName, int32_t length, uint64_t hash)
+{
+    int32_t kFile = kopen4loadfrommod(fileName, g_loadFromGroupOnly);
+
+    if (kFile == -1)
+        return 0;
+
+    int32_t match = 0;
+
+    if (kfilelength(kFile) == length)
+    {
+        char *buf = (char *)Xmalloc(max(length, 1));
+        match = kread(kFile, buf, length) == length && XXH3_64bits(buf, length) == hash;
+        Xfree(buf);
+    }
+
+    kclose(kFile);
+
+    return match;
+}
+
+// Returns 1 if the cache matched and the compiled script was loaded from it. Nothing is
+// changed unless the whole cache reads back, except when replaying its declarations fails,
+// in which case the compiler is reset for a regular compile.
+static int32_t C_LoadScriptCache(uint64_t key)
+{
+    int32_t fil = kopen4load(g_scriptCacheFile, 0);
+
+    if (fil == -1)
+        return 0;
+
+    char     magic[sizeof(CONCACHE_MAGIC)];
+    uint64_t fileKey;
+    int32_t  numFiles;
+
+    if (kread_and_test(fil, magic, sizeof(magic)) || Bmemcmp(magic, CONCACHE_MAGIC, sizeof(magic))
+        || kread_and_test(fil, &fileKey, sizeof(fileKey)) || fileKey != key || kread_and_test(fil, &numFiles, sizeof(numFiles)))
+    {
+        kclose(fil);
+        return 0;
+    }
+
+    // every file that went into the cache has to read back the same
+    for (int i=0; i<numFiles; i++)
+    {
+        char     name[BMAX_PATH];
+        int32_t  nameLength, length;
+        uint64_t hash;
+
+        if (kread_and_test(fil, &nameLength, sizeof(nameLength)) || (unsigned)nameLength >= BMAX_PATH
+            || kread_and_test(fil, name, nameLength) || kread_and_test(fil, &length, sizeof(length))
+            || kread_and_test(fil, &hash, sizeof(hash)))
+        {
+            kclose(fil);
+            return 0;
+        }
+
+        name[nameLength] = '\0';
+
+        if (!C_CheckCachedFile(name, length, hash))
+        {
+            initprintf("%s has changed, recompiling.\n", name);
+            kclose(fil);
+            return 0;
+        }
+    }
+
+    // see the arithmetic in G_CompileScripts()
+    uint32_t const maxLabels = min(MAXSECTORS * sizeof(sectortype) / sizeof(int32_t), MAXSPRITES * sizeof(spritetype) / 64);
+    int32_t info[CONCACHE_NUMINFO];
+
+    if (kread_and_test(fil, info, sizeof(info)) || info[CONCACHE_SCRIPTSIZE] <= 0
+        || (unsigned)info[CONCACHE_SCRIPTLENGTH] > (unsigned)info[CONCACHE_SCRIPTSIZE] || (unsigned)info[CONCACHE_LABELS] > maxLabels
+        || info[CONCACHE_DECLS] < 0 || info[CONCACHE_DECLSIZE] < 0)
+    {
+        kclose(fil);
+        return 0;
+    }
+
+    int32_t const scriptSize = info[CONCACHE_SCRIPTSIZE];
+    int32_t const labelCnt   = info[CONCACHE_LABELS];
+
+    intptr_t       *script    = (intptr_t *)Xmalloc(scriptSize * sizeof(intptr_t));
+    char           *scriptbit = (char *)Xcalloc(1, ((scriptSize + 7) >> 3) + 1);
+    char           *labels    = (char *)Xmalloc((labelCnt << 6) + 1);
+    int32_t        *codes     = (int32_t *)Xmalloc(labelCnt * sizeof(int32_t) + 1);
+    int32_t        *types     = (int32_t *)Xmalloc(labelCnt * sizeof(int32_t) + 1);
+    concachetile_t *tiles     = (concachetile_t *)Xmalloc(MAXTILES * sizeof(concachetile_t));
+    char           *decls     = (char *)Xmalloc(info[CONCACHE_DECLSIZE] + 1);
+
+    intptr_t events[MAXEVENTS];
+
+    int32_t const ok = C_ReadCacheBlock(fil, script, scriptSize * sizeof(intptr_t))
+                       && C_ReadCacheBlock(fil, scriptbit, ((scriptSize + 7) >> 3) + 1)
+                       && C_ReadCacheBlock(fil, labels, labelCnt << 6)
+                       && C_ReadCacheBlock(fil, codes, labelCnt * sizeof(int32_t))
+                       && C_ReadCacheBlock(fil, types, labelCnt * sizeof(int32_t))
+                       && C_ReadCacheBlock(fil, events, sizeof(events))
+                       && C_ReadCacheBlock(fil, tiles, MAXTILES * sizeof(concachetile_t))
+                       && C_ReadCacheBlock(fil, decls, info[CONCACHE_DECLSIZE]);
+
+    kclose(fil);
+
+    auto const freeBuffers = [&]() {
+        Xfree(script);
+        Xfree(scriptbit);
+        Xfree(labels);
+        Xfree(codes);
+        Xfree(types);
+        Xfree(tiles);
+        Xfree(decls);
+    };
+
+    if (!ok)
+    {
+        initprintf("Compiled script cache %s is damaged, recompiling.\n", g_scriptCacheFile);
+        freeBuffers();
+        return 0;
+    }
+
+    // labels go first: the declarations refer to them
+    Bmemcpy(label, labels, labelCnt << 6);
+    Bmemcpy(labelcode, codes, labelCnt * sizeof(int32_t));
+    Bmemcpy(labeltype, types, labelCnt * sizeof(int32_t));
+
+    for (g_labelCnt=0; g_labelCnt<labelCnt; g_labelCnt++)
+        hash_add(&h_labels, label + (g_labelCnt << 6), g_labelCnt, 0);
+
+    // replay the declarations into the scratch script C_Compile() allocated
+    char * const     origTextPtr       = textptr;
+    intptr_t * const origScriptPtr     = g_scriptPtr;
+    int32_t const    origScriptVersion = g_scriptVersion;
+    int32_t const    origGameVarCount  = g_gameVarCount;
+    char *decl = decls;
+
+    for (int i=0; i<info[CONCACHE_DECLS] && !g_errorCnt; i++)
+    {
+        textptr      = decl;
+        g_scriptPtr  = apScript + 3;
+        g_lineNumber = 1;
+
+        C_ParseCommand(0);
+
+        decl += Bstrlen(decl) + 1;
+    }
+
+    if (g_errorCnt)
+    {
+        initprintf("Replaying the declarations in compiled script cache %s failed, recompiling.\n", g_scriptCacheFile);
+        freeBuffers();
+
+        Bmemset(apScript, 0, g_scriptSize * sizeof(intptr_t));
+        Bmemset(bitptr, 0, ((g_scriptSize + 7) >> 3) + 1);
+
+        textptr         = origTextPtr;
+        g_scriptPtr     = origScriptPtr;
+        g_scriptVersion = origScriptVersion;
+        g_lineNumber    = 1;
+
+        // Gv_Init() only runs once, so take back the gamevars the replay defined
+        for (int i=origGameVarCount; i<g_gameVarCount; i++)
+            hash_delete(&h_gamevars, aGameVars[i].szLabel);
+
+        g_gameVarCount = origGameVarCount;
+        g_labelCnt = g_errorCnt = g_warningCnt = 0;
+        C_InitCompiler();
+
+        return 0;
+    }
+
+    Xfree(apScript);
+    Xfree(bitptr);
+
+    apScript     = script;
+    bitptr       = scriptbit;
+    g_scriptSize = scriptSize;
+    g_scriptPtr  = apScript + info[CONCACHE_SCRIPTLENGTH];
+
+    for (int i=0; i<g_scriptSize; i++)
+        if (BITPTR_IS_POINTER(i))
+            apScript[i] += (intptr_t)apScript;
+
+    Bmemcpy(apScriptEvents, events, sizeof(apScriptEvents));
+
+    for (int i=0; i<MAXTILES; i++)
+    {
+        tiledata_t &tile = g_tile[i];
+
+        tile.execPtr    = tiles[i].execPtr ? apScript + tiles[i].execPtr : NULL;
+        tile.loadPtr    = tiles[i].loadPtr ? apScript + tiles[i].loadPtr : NULL;
+        tile.flags      = tiles[i].flags;
+        tile.cacherange = tiles[i].cacherange;
+    }
+
+    g_scriptVersion = info[CONCACHE_SCRIPTVERSION];
+    g_totalLines    = info[CONCACHE_TOTALLINES];
+    g_scriptcrc     = info[CONCACHE_SCRIPTCRC];
+
+    script    = NULL;
+    scriptbit = NULL;
+    freeBuffers();
+
+    return 1;
+}
+
+void C_Compile(const char *fileName)
+{
+    C_InitCompiler();
 
 #ifdef USE_OPENGL
     if (REALITY)
@@ -2895,6 +3345,30 @@ void C_Compile(const char *fileName)
 
     Bstrcpy(g_scriptFileName, fileName);
 
+    G_ModDirSnprintfLite(g_scriptCacheFile, sizeof(g_scriptCacheFile), "concache");
+
+    uint64_t const cacheKey = C_ScriptCacheKey(fileName);
+
+    if (C_LoadScriptCache(cacheKey))
+    {
+        DO_FREE_AND_NULL(mptr);
+
+        for (char * m : g_scriptModules)
+            Xfree(m);
+        g_scriptModules.clear();
+
+        ap_con_hook();
+
+        initprintf("Script loaded from %s in %dms, %ld bytes%s\n", g_scriptCacheFile, timerGetTicks() - startcompiletime,
+                    (unsigned long)(g_scriptPtr-apScript), C_ScriptVersionString(g_scriptVersion));
+
+        C_FinishCompile();
+        return;
+    }
+
+    g_scriptCacheRecording = 1;
+    C_CacheAddFile(fileName, mptr, kFileLen);
+
     C_ParseCommand(1);
 
     for (char * m : g_scriptModules)
@@ -2916,6 +3390,7 @@ void C_Compile(const char *fileName)
 
     if (g_errorCnt)
     {
+        C_FreeScriptCache();
         Bsprintf(buf, "Error compiling CON files.");
         G_GameExit(buf);
     }
@@ -2924,21 +3399,15 @@ void C_Compile(const char *fileName)
 
     C_SetScriptSize(g_scriptPtr-apScript+8);
 
+    C_WriteScriptCache(cacheKey);
+    C_FreeScriptCache();
+
     ap_con_hook();
 
     initprintf("Script compiled in %dms, %ld bytes%s\n", timerGetTicks() - startcompiletime,
                 (unsigned long)(g_scriptPtr-apScript), C_ScriptVersionString(g_scriptVersion));
 
-    for (auto *i : tables_free)
-        hash_free(i);
-
-    //freehashnames();
-    freesoundhashnames();
-
-    if (g_scriptDebug)
-        C_PrintStats();
-
-    C_InitQuotes();
+    C_FinishCompile();
 }
 
 void C_ReportError(int32_t iError)
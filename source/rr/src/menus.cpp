@@ -2092,13 +2092,6 @@ void Menu_Init(void)
     {
         M_EPISODE.numEntries = 3;
     }
-    // [AP] Disable user map selection
-    else if (!AP)
-    {
-        M_EPISODE.numEntries = g_volumeCnt+2;
-        MEL_EPISODE[g_volumeCnt] = &ME_Space4_Redfont;
-        MEL_EPISODE[g_volumeCnt+1] = &ME_EPISODE_USERMAP;
-    }
     MEOSN_NetEpisodes[k] = MenuUserMap;
     MEOSV_NetEpisodes[k] = MAXVOLUMES;
     MEOS_NETOPTIONS_EPISODE.numOptions = k + 1;
@@ -2384,9 +2377,24 @@ void Menu_Init(void)
         }
     }
 
-    // [AP] And now do all of the archipelago modifications to the menu structure!
+    // [AP] A connect still in progress sets up the rest of the menu once it completes
+    if (!APConnecting)
+        Menu_SetupAP();
+}
+
+// [AP] Archipelago modifications to the menu structure. They depend on the seed, so they are applied
+// once the connect has finished rather than holding up Menu_Init
+void Menu_SetupAP(void)
+{
     if (AP)
         ap_init_menu();
+    // [AP] User map selection is only offered outside of archipelago games
+    else if (!REALITY)
+    {
+        M_EPISODE.numEntries = g_volumeCnt+2;
+        MEL_EPISODE[g_volumeCnt] = &ME_Space4_Redfont;
+        MEL_EPISODE[g_volumeCnt+1] = &ME_EPISODE_USERMAP;
+    }
 }
 
 static void Menu_Run(Menu_t *cm, vec2_t origin);
@@ -2412,8 +2420,9 @@ static void Menu_Pre(MenuID_t cm)
         MenuEntry_DisableOnCondition(&ME_MAIN_QUITTOTITLE, g_netServer || numplayers > 1);
         fallthrough__;
     case MENU_MAIN:
-        // [AP] Disable save menus when it is disabled anyway
-        MenuEntry_DisableOnCondition(&ME_MAIN_LOADGAME, AP && !ap_can_save());
+        // [AP] Disable save menus when it is disabled anyway, and starting a game until the connect is done
+        MenuEntry_DisableOnCondition(&ME_MAIN_NEWGAME, APConnecting);
+        MenuEntry_DisableOnCondition(&ME_MAIN_LOADGAME, (AP && !ap_can_save()) || APConnecting);
         MenuEntry_DisableOnCondition(&ME_MAIN_SAVEGAME, AP && !ap_can_save());
         if ((g_netServer || ud.multimode > 1) && ud.recstat != 2)
         {
@@ -3958,18 +3967,21 @@ static void Menu_PreDraw(MenuID_t cm, MenuEntry_t *entry, const vec2_t origin)
             bool goal_exit = ap_goals.count("Exit") && ap_goals["Exit"].second > 0;
             bool goal_secret = ap_goals.count("Secret") && ap_goals["Secret"].second > 0;
 
-            for (std::string sprite_str : ap_game_config["locations"][level_id]["sprites"].getMemberNames())
+            const ap_map_locations_t* level_locations = AP_GetMapLocations(level_id);
+            static const ap_map_locations_t no_locations;
+            if (level_locations == NULL)
+                level_locations = &no_locations;
+
+            for (ap_location_t pickup_loc : level_locations->sprites)
             {
-                ap_location_t pickup_loc = ap_game_config["locations"][level_id]["sprites"][sprite_str]["id"].asInt();
                 if (pickup_loc > 0 && AP_LOCATION_CHECK_MASK(pickup_loc, (AP_LOC_PICKUP | AP_LOC_USED)))
                 {
                     items_max++;
                     if (AP_LOCATION_CHECKED(pickup_loc)) items_collected++;
                 }
             }
-            for (std::string sector_str : ap_game_config["locations"][level_id]["sectors"].getMemberNames())
+            for (ap_location_t secret_loc : level_locations->sectors)
             {
-                ap_location_t secret_loc = ap_game_config["locations"][level_id]["sectors"][sector_str]["id"].asInt();
                 if (secret_loc > 0 && AP_LOCATION_CHECK_MASK(secret_loc, (AP_LOC_SECRET | AP_LOC_USED)))
                 {
                     // Always count secrets so the numbers reflect checks, not pickup locations
@@ -3982,9 +3994,8 @@ static void Menu_PreDraw(MenuID_t cm, MenuEntry_t *entry, const vec2_t origin)
                     }
                 }
             }
-            for (std::string exit_str : ap_game_config["locations"][level_id]["exits"].getMemberNames())
+            for (ap_location_t exit_loc : level_locations->exits)
             {
-                ap_location_t exit_loc = ap_game_config["locations"][level_id]["exits"][exit_str]["id"].asInt();
                 if (exit_loc > 0 && AP_LOCATION_CHECK_MASK(exit_loc, (AP_LOC_EXIT | AP_LOC_USED)))
                 {
                     // Always count exits so the numbers reflect checks, not pickup locations
@@ -505,6 +505,7 @@ void Menu_AnimateChange(int32_t cm, MenuAnimationType_t animtype);
 int32_t Menu_IsTextInput(Menu_t *cm);
 int G_CheckPlayerColor(int color);
 void Menu_Init(void);
+void Menu_SetupAP(void);
 void Menu_Open(uint8_t playerID);
 void Menu_Close(uint8_t playerID);
 void M_DisplayMenus(void);
@@ -1481,14 +1481,13 @@ static int osdcmd_ap_missing(osdcmdptr_t parm)
     std::string map = ap_format_map_id(ud.level_number, ud.volume_number);
     AP_Printf("Missing locations for " + map + ":");
 
-    Json::Value& cur_map_data = ap_game_config["locations"][map];
-    for (std::string category : cur_map_data.getMemberNames())
+    const ap_map_locations_t* cur_map_data = AP_GetMapLocations(map);
+    if (cur_map_data == NULL)
+        return OSDCMD_OK;
+    for (auto category : { &cur_map_data->sprites, &cur_map_data->sectors, &cur_map_data->exits })
     {
-        for (std::string entry_str : cur_map_data[category].getMemberNames())
+        for (ap_location_t loc : *category)
         {
-            if (!cur_map_data[category][entry_str]["id"].isInt())
-                continue;
-            ap_location_t loc = cur_map_data[category][entry_str]["id"].asInt();
             if (AP_VALID_LOCATION(loc) && !AP_LOCATION_CHECKED(loc))
             {
                 AP_Printf(AP_GetLocationName(AP_NET_ID(loc)));
@@ -1499,11 +1498,53 @@ static int osdcmd_ap_missing(osdcmdptr_t parm)
     return OSDCMD_OK;
 }
 
+static int osdcmd_ap_queuestats(osdcmdptr_t UNUSED(parm))
+{
+    double const ns_to_us = 1000000.0 / timerGetNanoTickRate();
+
+    AP_Printf("Item queue: %u in game, %u global, %u max", (uint32_t)ap_game_state.ap_item_queue.size(),
+              (uint32_t)ap_game_state.ap_item_queue_global.size(), ap_item_queue_stats.max_depth);
+    AP_Printf("Last apply: %u items in %.1f us, max %.1f us", ap_item_queue_stats.last_applied,
+              ap_item_queue_stats.last_apply_time * ns_to_us, ap_item_queue_stats.max_apply_time * ns_to_us);
+
+    return OSDCMD_OK;
+}
+
+static int osdcmd_ap_syncstats(osdcmdptr_t UNUSED(parm))
+{
+    AP_Printf("Save syncs: %u (%u full rewrites), last %u bytes, total %u bytes", ap_sync_stats.syncs, ap_sync_stats.rewrites,
+              ap_sync_stats.last_bytes, (uint32_t)ap_sync_stats.total_bytes);
+
+    return OSDCMD_OK;
+}
+
+static int osdcmd_ap_benchpatch(osdcmdptr_t parm)
+{
+    if (!AP)
+    {
+        AP_Errorf("No Archipelago game data loaded.\n");
+        return OSDCMD_OK;
+    }
+    if (g_player[myconnectindex].ps->gm & MODE_GAME)
+    {
+        AP_Errorf("Can't benchmark while in a level.\n");
+        return OSDCMD_OK;
+    }
+
+    int32_t repeats = (parm->numparms > 0) ? Batol(parm->parms[0]) : 100;
+    ap_benchmark_map_patch(max(repeats, 1));
+
+    return OSDCMD_OK;
+}
+
 int32_t registerosdcommands(void)
 {
     FX_InitCvars();
     static osdcvardata_t cvars_game[] =
     {
+        { "ap_mock_latency", "simulated connect latency of the mock AP server in ms", (void *)&ap_mock_settings.latency, CVAR_UINT|CVAR_NOSAVE, 0, 60000 },
+        { "ap_mock_result", "mock AP server outcome: 0: connect, 1: time out, 2: checksum mismatch", (void *)&ap_mock_settings.result, CVAR_INT|CVAR_NOSAVE, 0, 2 },
+
         { "crosshair", "enable/disable crosshair", (void *)&ud.crosshair, CVAR_BOOL, 0, 1 },
 
         { "cl_autoaim", "enable/disable weapon autoaim", (void *)&ud.config.AutoAim, CVAR_INT|CVAR_MULTI, 0, 3 },
@@ -1761,6 +1802,9 @@ int32_t registerosdcommands(void)
     OSD_RegisterFunction("ap_unlock_all","ap_unlock_all: Gives access to all levels", osdcmd_ap_unlock_all);
 #endif
     OSD_RegisterFunction("ap_missing","ap_missing: Lists missing checks in current level", osdcmd_ap_missing);
+    OSD_RegisterFunction("ap_queuestats","ap_queuestats: shows AP item queue depth and apply times", osdcmd_ap_queuestats);
+    OSD_RegisterFunction("ap_syncstats","ap_syncstats: shows the amount of save data synced to the AP server", osdcmd_ap_syncstats);
+    OSD_RegisterFunction("ap_benchpatch","ap_benchpatch [repeats]: times location lookups on every AP map", osdcmd_ap_benchpatch);
 #ifdef USE_OPENGL
     baselayer_osdcmd_vidmode_func = osdcmd_vidmode;
 #endif
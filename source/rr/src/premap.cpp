@@ -608,6 +608,14 @@ void G_CacheMapData(void)
                 G_CacheSpriteNum(j);
     }
 
+#ifdef USE_OPENGL
+    if (ud.config.useprecache && videoGetRenderMode() != REND_CLASSIC)
+    {
+        for (int type = 0; type <= 1; type++)
+            polymost_prefetch(precachehightile[type], type);
+    }
+#endif
+
     tc = (int32_t) totalclock;
     j = 0;
 
@@ -627,10 +635,12 @@ void G_CacheMapData(void)
 
 #ifdef USE_OPENGL
 // PRECACHE
-            if (ud.config.useprecache && bpp > 8)
+            if (ud.config.useprecache && videoGetRenderMode() != REND_CLASSIC)
             {
                 int32_t k,type;
 
+                polymost_prefetchnext(i);
+
                 for (type=0; type<=1; type++)
                     if (precachehightile[type][i>>3] & pow2char[i&7])
                     {
@@ -698,6 +708,10 @@ void G_CacheMapData(void)
         }
     }
 
+#ifdef USE_OPENGL
+    polymost_prefetchfree();
+#endif
+
     Bmemset(gotpic, 0, sizeof(gotpic));
 
     endtime = timerGetTicks();
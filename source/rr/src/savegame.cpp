@@ -27,6 +27,8 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #include "ap_integration.h"
 #include "Archipelago.h"
 
+#include "libasync_config.h"
+
 static OutputFileCounter savecounter;
 
 // For storing pointers in files.
@@ -844,6 +846,117 @@ static int32_t readspecdata(const dataspec_t *spec, int32_t fil, uint8_t **dumpv
 #define VAL(bits,p) (*(UINT(bits) const *)(p))
 #define WVAL(bits,p) (*(UINT(bits) *)(p))
 
+// unchanged state is skipped this many bytes at a time
+#define SV_DIFFBLOCK 64
+// arrays larger than this are diffed in chunks of this many bytes on the worker threads
+#define SV_DIFFCHUNK 65536
+
+// returns how many leading bytes of a and b, in whole SV_DIFFBLOCK blocks, are the same
+static FORCE_INLINE uint32_t sv_skipsame(uint8_t const *a, uint8_t const *b, uint32_t const len)
+{
+    uint32_t ofs = 0;
+
+    for (; ofs + SV_DIFFBLOCK <= len; ofs += SV_DIFFBLOCK)
+    {
+#if defined BITNESS64 && (defined __SSE2__ || defined _MSC_VER) && !defined(_M_ARM64)
+        __m128i x = _mm_setzero_si128();
+
+        for (int i = 0; i < SV_DIFFBLOCK; i += 16)
+            x = _mm_or_si128(x, _mm_xor_si128(_mm_loadu_si128((__m128i const *)(a + ofs + i)), _mm_loadu_si128((__m128i const *)(b + ofs + i))));
+
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(x, _mm_setzero_si128())) != 0xffff)
+            break;
+#else
+        uint64_t x[SV_DIFFBLOCK / 8], y[SV_DIFFBLOCK / 8], d = 0;
+
+        Bmemcpy(x, a + ofs, SV_DIFFBLOCK);
+        Bmemcpy(y, b + ofs, SV_DIFFBLOCK);
+
+        for (int i = 0; i < SV_DIFFBLOCK / 8; i++)
+            d |= x[i] ^ y[i];
+
+        if (d)
+            break;
+#endif
+    }
+
+    return ofs;
+}
+
+// writes an (index, value) pair for every element in [first, last) that differs from the dump
+// and updates the dump, skipping over unchanged blocks without looking at single elements
+template <typename Idx, typename Dat>
+static uint8_t *sv_diffelts(Dat const *p, Dat *op, int i, int const last, uint8_t *diff)
+{
+    while (i < last)
+    {
+        i += sv_skipsame((uint8_t const *)(p + i), (uint8_t const *)(op + i), (last - i) * sizeof(Dat)) / sizeof(Dat);
+
+        for (int const end = min<int>(i + SV_DIFFBLOCK / sizeof(Dat), last); i < end; i++)
+        {
+            if (p[i] != op[i])
+            {
+                op[i] = p[i];
+                *(Idx *)diff = (Idx)i;
+                diff += sizeof(Idx);
+                *(Dat *)diff = p[i];
+                diff += sizeof(Dat);
+            }
+        }
+    }
+
+    return diff;
+}
+
+// width of the values an array of size-byte elements is diffed as
+static inline int sv_diffdatsize(uint32_t const size)
+{
+    if (size == 8)
+        return 8;
+    else if ((size & 3) == 0)
+        return 4;
+    else if ((size & 1) == 0)
+        return 2;
+
+    return 1;
+}
+
+static inline int sv_diffidxsize(int const nelts) { return nelts > 65536 ? 4 : (nelts > 256 ? 2 : 1); }
+
+static uint8_t *sv_diffrange(const void *ptr, void *dump, int const datsiz, int const nelts, int const first, int const last, uint8_t *diff)
+{
+#define DIFFRANGE(Datbits)                                                                                                   \
+    do                                                                                                                       \
+    {                                                                                                                        \
+        auto p  = (UINT(Datbits) const *)ptr;                                                                                \
+        auto op = (UINT(Datbits) *)dump;                                                                                     \
+        switch (sv_diffidxsize(nelts))                                                                                       \
+        {                                                                                                                    \
+            case 4: return sv_diffelts<uint32_t>(p, op, first, last, diff);                                                  \
+            case 2: return sv_diffelts<uint16_t>(p, op, first, last, diff);                                                  \
+            default: return sv_diffelts<uint8_t>(p, op, first, last, diff);                                                 \
+        }                                                                                                                    \
+    } while (0)
+
+    switch (datsiz)
+    {
+        case 8: DIFFRANGE(64);
+        case 4: DIFFRANGE(32);
+        case 2: DIFFRANGE(16);
+        default: DIFFRANGE(8);
+    }
+
+#undef DIFFRANGE
+}
+
+// an index of all bits set ends the list of changed elements
+static inline uint8_t *sv_diffend(uint8_t *diff, int const nelts)
+{
+    int const idxsiz = sv_diffidxsize(nelts);
+    Bmemset(diff, 0xff, idxsiz);
+    return diff + idxsiz;
+}
+
 static void docmpsd(const void *ptr, void *dump, uint32_t size, uint32_t cnt, uint8_t **diffvar)
 {
     uint8_t *retdiff = *diffvar;
@@ -865,54 +978,104 @@ static void docmpsd(const void *ptr, void *dump, uint32_t size, uint32_t cnt, ui
         case 1: CPSINGLEVAL(8); return;
         }
 
-#define CPELTS(Idxbits, Datbits)             \
-    do                                       \
-    {                                        \
-        for (int i = 0; i < nelts; i++)      \
-        {                                    \
-            if (*p != *op)                   \
-            {                                \
-                *op = *p;                    \
-                WVAL(Idxbits, retdiff) = i;  \
-                retdiff += BYTES(Idxbits);   \
-                WVAL(Datbits, retdiff) = *p; \
-                retdiff += BYTES(Datbits);   \
-            }                                \
-            p++;                             \
-            op++;                            \
-        }                                    \
-        WVAL(Idxbits, retdiff) = -1;         \
-        retdiff += BYTES(Idxbits);           \
-    } while (0)
+    int const datsiz = sv_diffdatsize(size);
+    int const nelts  = tabledivide32_noinline(size * cnt, datsiz);
 
-#define CPDATA(Datbits)                                                  \
-    do                                                                   \
-    {                                                                    \
-        auto p     = (UINT(Datbits) const *)ptr;                         \
-        auto op    = (UINT(Datbits) *)dump;                              \
-        int  nelts = tabledivide32_noinline(size * cnt, BYTES(Datbits)); \
-        if (nelts > 65536)                                               \
-            CPELTS(32, Datbits);                                         \
-        else if (nelts > 256)                                            \
-            CPELTS(16, Datbits);                                         \
-        else                                                             \
-            CPELTS(8, Datbits);                                          \
-    } while (0)
+    *diffvar = sv_diffend(sv_diffrange(ptr, dump, datsiz, nelts, 0, nelts, retdiff), nelts);
 
-    if (size == 8)
-        CPDATA(64);
-    else if ((size & 3) == 0)
-        CPDATA(32);
-    else if ((size & 1) == 0)
-        CPDATA(16);
-    else
-        CPDATA(8);
+#undef CPSINGLEVAL
+}
 
-    *diffvar = retdiff;
+// part of a large array that is diffed on a worker thread into svdiffscratch
+typedef struct
+{
+    const dataspec_t *spec;
+    const void *ptr;
+    void *dump;
+    int datsiz, nelts, first, last;
+    uint8_t *diff, *diffend;
+} svdiffchunk_t;
+
+static svdiffchunk_t *svdiffchunks;
+static int svdiffnumchunks, svdiffmaxchunks;
+static uint8_t *svdiffscratch;
+static size_t svdiffscratchsiz;
+
+// Diffs the large arrays from spec up to the next save/load function (which may change
+// what gets compared) in parallel. cmpspecdata() then copies their diffs into place.
+static void sv_prediffsegment(const dataspec_t *spec, uint8_t *dump)
+{
+    size_t scratchsiz = 0;
 
-#undef CPELTS
-#undef CPSINGLEVAL
-#undef CPDATA
+    svdiffnumchunks = 0;
+
+    for (; spec->flags != DS_END; spec++)
+    {
+        if ((spec->flags & (DS_NOCHK|DS_STRING|DS_CMP)))
+            continue;
+
+        if (spec->flags & (DS_LOADFN|DS_SAVEFN))
+        {
+            if ((spec->flags & DS_PROTECTFN) == 0)
+                break;
+            continue;
+        }
+
+        void *  ptr;
+        int32_t cnt;
+
+        ds_get(spec, &ptr, &cnt);
+
+        if (cnt < 0)
+            continue;
+
+        uint32_t const bytes = spec->size * cnt;
+
+        if (bytes > SV_DIFFCHUNK)
+        {
+            int const datsiz    = sv_diffdatsize(spec->size);
+            int const nelts     = tabledivide32_noinline(bytes, datsiz);
+            int const chunkelts = SV_DIFFCHUNK / datsiz;
+
+            for (int first = 0; first < nelts; first += chunkelts)
+            {
+                if (svdiffnumchunks == svdiffmaxchunks)
+                {
+                    svdiffmaxchunks = max(svdiffmaxchunks << 1, 64);
+                    svdiffchunks = (svdiffchunk_t *)Xrealloc(svdiffchunks, svdiffmaxchunks * sizeof(svdiffchunk_t));
+                }
+
+                int const last = min(first + chunkelts, nelts);
+
+                svdiffchunks[svdiffnumchunks++] = { spec, ptr, dump, datsiz, nelts, first, last, (uint8_t *)scratchsiz, nullptr };
+                scratchsiz += (last - first) * (sv_diffidxsize(nelts) + datsiz);
+            }
+        }
+
+        dump += bytes;
+    }
+
+    if (svdiffnumchunks == 0)
+        return;
+
+    if (scratchsiz > svdiffscratchsiz)
+    {
+        svdiffscratchsiz = scratchsiz;
+        svdiffscratch = (uint8_t *)Xrealloc(svdiffscratch, svdiffscratchsiz);
+    }
+
+    for (int i = 0; i < svdiffnumchunks; i++)
+        svdiffchunks[i].diff = svdiffscratch + (intptr_t)svdiffchunks[i].diff;
+
+    auto const diffchunk = [](int32_t i) {
+        auto &c = svdiffchunks[i];
+        c.diffend = sv_diffrange(c.ptr, c.dump, c.datsiz, c.nelts, c.first, c.last, c.diff);
+    };
+
+    if (svdiffnumchunks > 1)
+        async::parallel_for(async::irange(0, svdiffnumchunks), diffchunk);
+    else
+        diffchunk(0);
 }
 
 // get the number of elements to be monitored for changes
@@ -939,7 +1102,9 @@ static void cmpspecdata(const dataspec_t *spec, uint8_t **dumpvar, uint8_t **dif
     while (nbytes--)
         *(diff++) = 0;  // the bitmap of indices which elements of spec have changed go here
 
-    int eltnum = 0;
+    int  eltnum   = 0;
+    int  chunknum = 0;
+    bool prediff  = true;
 
     for (spec++; spec->flags!=DS_END; spec++)
     {
@@ -949,10 +1114,20 @@ static void cmpspecdata(const dataspec_t *spec, uint8_t **dumpvar, uint8_t **dif
         if (spec->flags&(DS_LOADFN|DS_SAVEFN))
         {
             if ((spec->flags&(DS_PROTECTFN))==0)
+            {
                 (*(void (*)())spec->ptr)();
+                prediff = true;
+            }
             continue;
         }
 
+        if (prediff)
+        {
+            sv_prediffsegment(spec, dump);
+            chunknum = 0;
+            prediff  = false;
+        }
+
         void *  ptr;
         int32_t cnt;
 
@@ -966,7 +1141,21 @@ static void cmpspecdata(const dataspec_t *spec, uint8_t **dumpvar, uint8_t **dif
 
         uint8_t * const tmptr = diff;
 
-        docmpsd(ptr, dump, spec->size, cnt, &diff);
+        if (chunknum < svdiffnumchunks && svdiffchunks[chunknum].spec == spec)
+        {
+            int const nelts = svdiffchunks[chunknum].nelts;
+
+            for (; chunknum < svdiffnumchunks && svdiffchunks[chunknum].spec == spec; chunknum++)
+            {
+                auto const &c = svdiffchunks[chunknum];
+                Bmemcpy(diff, c.diff, c.diffend - c.diff);
+                diff += c.diffend - c.diff;
+            }
+
+            diff = sv_diffend(diff, nelts);
+        }
+        else
+            docmpsd(ptr, dump, spec->size, cnt, &diff);
 
         if (diff != tmptr)
             (*diffvar + slen)[eltnum>>3] |= 1<<(eltnum&7);
@@ -1433,6 +1622,10 @@ void sv_freemem()
     DO_FREE_AND_NULL(svsnapshot);
     DO_FREE_AND_NULL(svinitsnap);
     DO_FREE_AND_NULL(svdiff);
+    DO_FREE_AND_NULL(svdiffchunks);
+    DO_FREE_AND_NULL(svdiffscratch);
+    svdiffmaxchunks = 0;
+    svdiffscratchsiz = 0;
 }
 
 static void SV_AllocSnap(int32_t allocinit)
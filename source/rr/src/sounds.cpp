@@ -982,6 +982,10 @@ void S_Update(void)
     int       sndnum  = 0;
     int const highest = g_highestSoundIdx;
 
+    // positional updates are handed to the mixer in batches so it is locked once per batch rather than once per voice
+    MV_Pan3DUpdate pan[64];
+    int numPan = 0;
+
     do
     {
         if (g_sounds[sndnum].num == 0)
@@ -1002,11 +1006,20 @@ void S_Update(void)
                 g_numEnvSoundsPlaying++;
 
             // AMBIENT_SOUND
-            FX_Pan3D(voice.id, sndang >> 4, sndist >> 6);
+            pan[numPan++] = { voice.id, sndang >> 4, sndist >> 6 };
             voice.dist = sndist >> 6;
             voice.clock++;
+
+            if (numPan == ARRAY_SSIZE(pan))
+            {
+                FX_Pan3DBatch(pan, numPan);
+                numPan = 0;
+            }
         }
     } while (++sndnum <= highest);
+
+    if (numPan)
+        FX_Pan3DBatch(pan, numPan);
 }
 
 void S_Callback(intptr_t num)
@@ -2014,11 +2014,7 @@ PostDraw(void)
 
     TRAVERSE_SPRITE_STAT(headspritestat[STAT_FAF_COPY], i, nexti)
     {
-        if (User[i])
-        {
-            FreeMem(User[i]);
-            User[i] = NULL;
-        }
+        FreeUser(i);
 
 #if DEBUG
         SPRITEp sp = &sprite[i];
@@ -2130,8 +2126,7 @@ void PreDrawStackedWater(void)
                 if (New >= 0)
                 {
                     // spawn a user
-                    User[New] = nu = (USERp)CallocMem(sizeof(USER), 1);
-                    ASSERT(nu != NULL);
+                    nu = AllocUser(New);
 
                     nu->xchange = -989898;
 
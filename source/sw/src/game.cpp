@@ -1554,7 +1554,6 @@ TerminateLevel(void)
 {
     void pClearSpriteList(PLAYERp pp);
     int i, nexti, stat, pnum, ndx;
-    SECT_USERp *sectu;
 
 //HEAP_CHECK();
 
@@ -1604,22 +1603,11 @@ TerminateLevel(void)
         }
     }
 
-    // Free SectUser memory
-    for (sectu = &SectUser[0];
-         sectu < &SectUser[MAXSECTORS];
-         sectu++)
-    {
-        if (*sectu)
-        {
-            ////DSPRINTF(ds,"Sect User Free %d",sectu-SectUser);
-            //MONO_PRINT(ds);
-            FreeMem(*sectu);
-            *sectu = NULL;
-        }
-    }
+    // Free SectUser slots
+    for (i = 0; i < MAXSECTORS; i++)
+        FreeSectUser(i);
 
     //memset(&User[0], 0, sizeof(User));
-    memset(&SectUser[0], 0, sizeof(SectUser));
 
     TRAVERSE_CONNECT(pnum)
     {
@@ -2099,10 +2099,14 @@ int SetActorRotation(short SpriteNum,int,int);
 int NewStateGroup(short SpriteNum, STATEp SpriteGroup[]);
 void SectorMidPoint(short sectnum, int *xmid, int *ymid, int *zmid);
 USERp SpawnUser(short SpriteNum, short id, STATEp state);
+USERp AllocUser(short SpriteNum);
+void FreeUser(short SpriteNum);
 
 short ActorFindTrack(short SpriteNum, int8_t player_dir, int track_type, short *track_point_num, short *track_dir);
 
 SECT_USERp GetSectUser(short sectnum);
+SECT_USERp AllocSectUser(short sectnum);
+void FreeSectUser(short sectnum);
 
 short SoundDist(int x, int y, int z, int basedist);
 short SoundAngle(int x, int  y);
@@ -106,6 +106,7 @@ typedef struct
 extern uint8_t syncstat[MAXSYNCBYTES];
 extern SWBOOL PredictionOn;
 extern PLAYER PredictPlayer;
+extern USER PredictUser;
 extern PLAYERp ppp;
 extern short predictangpos[MOVEFIFOSIZ];
 extern unsigned int predictmovefifoplc;
@@ -8438,11 +8438,7 @@ InitMultiPlayerInfo(void)
 
         start0 = SpawnSprite(MultiStatList[stat], ST1, NULL, pp->cursectnum, pp->posx, pp->posy, pp->posz, fix16_to_int(pp->q16ang), 0);
         ASSERT(start0 >= 0);
-        if (User[start0])
-        {
-            FreeMem(User[start0]);
-            User[start0] = NULL;
-        }
+        FreeUser(start0);
         sprite[start0].picnum = ST1;
     }
 
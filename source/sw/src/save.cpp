@@ -881,7 +881,7 @@ int LoadGame(short save_num)
         MREAD(&sectnum,sizeof(sectnum),1,fil);
         if (sectnum != -1)
         {
-            SectUser[sectnum] = sectu = (SECT_USERp)CallocMem(sizeof(SECT_USER), 1);
+            sectu = AllocSectUser(sectnum);
             MREAD(sectu,sizeof(SECT_USER),1,fil);
         }
     }
@@ -912,7 +912,7 @@ int LoadGame(short save_num)
     MREAD(&SpriteNum, sizeof(SpriteNum),1,fil);
     while (SpriteNum != -1)
     {
-        User[SpriteNum] = u = (USERp)CallocMem(sizeof(USER), 1);
+        u = AllocUser(SpriteNum);
         MREAD(u,sizeof(USER),1,fil);
 
         if (u->WallShade)
@@ -78,9 +78,6 @@ int lavadropsiz[LAVAMAXDROPS], lavadropsizlookup[LAVAMAXDROPS];
 int lavaradx[32][128], lavarady[32][128], lavaradcnt[32];
 #endif
 
-SECT_USERp SectUser[MAXSECTORS];
-USERp User[MAXSPRITES];
-
 ANIM Anim[MAXANIM];
 short AnimCnt = 0;
 
@@ -485,6 +485,9 @@ int DoSlidorMoveWalls(short SpriteNum, int amt)
     }
     while (w != startwall);
 
+    // white walls were moved directly
+    sectorgrid_update(sprite[SpriteNum].sectnum);
+
     return 0;
 }
 
@@ -1763,6 +1763,10 @@ DoUpdateSounds3D(void)
     int i;
     static SWBOOL MoveSkip8 = 0;
 
+    // Pans are handed to the mixer in batches so it is locked once per batch rather than once per voice
+    MV_Pan3DUpdate PanArray[64];
+    int numpan = 0;
+
     if (UsingMenus) return;
 
     // This function is already only call 10x per sec, this widdles it down even more!
@@ -1873,9 +1877,15 @@ DoUpdateSounds3D(void)
                 {
                     // Handle Panning Left and Right
                     if (!(p->flags & v3df_dontpan))
-                        FX_Pan3D(p->handle, angle, dist);
+                        PanArray[numpan++] = { p->handle, angle, dist };
                     else
-                        FX_Pan3D(p->handle, 0, dist);
+                        PanArray[numpan++] = { p->handle, 0, dist };
+
+                    if (numpan == (int)SIZ(PanArray))
+                    {
+                        FX_Pan3DBatch(PanArray, numpan);
+                        numpan = 0;
+                    }
 
                     // Handle Doppler Effects
 #define DOPPLERMAX  400
@@ -1946,6 +1956,9 @@ DoUpdateSounds3D(void)
         p = p->next;
     }                               // while(p)
 
+    if (numpan)
+        FX_Pan3DBatch(PanArray, numpan);
+
 //  //DSPRINTF(ds,"Num vocs in list: %d, Sounds playing: %d\n",numelems,FX_SoundsPlaying());
 //  MONO_PRINT(ds);
 
@@ -755,8 +755,7 @@ KillSprite(int16_t SpriteNum)
             FreeMem(u->rotator);
         }
 
-        FreeMem(User[SpriteNum]);
-        User[SpriteNum] = 0;
+        FreeUser(SpriteNum);
     }
 
     deletesprite(SpriteNum);
@@ -835,9 +834,7 @@ SpawnUser(short SpriteNum, short id, STATEp state)
 
     ASSERT(!Prediction);
 
-    User[SpriteNum] = u = (USERp) CallocMem(sizeof(USER), 1);
-
-    PRODUCTION_ASSERT(u != NULL);
+    u = AllocUser(SpriteNum);
 
     // be careful State can be NULL
     u->State = u->StateStart = state;
@@ -901,9 +898,7 @@ GetSectUser(short sectnum)
     if (SectUser[sectnum])
         return SectUser[sectnum];
 
-    sectu = SectUser[sectnum] = (SECT_USERp) CallocMem(sizeof(SECT_USER), 1);
-
-    ASSERT(sectu != NULL);
+    sectu = AllocSectUser(sectnum);
 
     return sectu;
 }
@@ -1670,6 +1665,9 @@ void PreMapCombineFloors(void)
     {
         KillSprite(SpriteNum);
     }
+
+    // whole floors were moved, rebuild the sector grid from scratch
+    sectorgrid_invalidate();
 }
 
 #if 0
@@ -5149,11 +5147,7 @@ DoGrating(short SpriteNum)
     if (sp->hitag <= 0)
     {
         change_sprite_stat(SpriteNum, STAT_DEFAULT);
-        if (User[SpriteNum])
-        {
-            FreeMem(User[SpriteNum]);
-            User[SpriteNum] = 0;
-        }
+        FreeUser(SpriteNum);
     }
 
     setspritez(SpriteNum, &sp->xyz);
@@ -1759,6 +1759,8 @@ MovePoints(SECTOR_OBJECTp sop, short delta_ang, int nx, int ny)
             }
         }
 
+        sectorgrid_update(*sectp - sector);
+
 PlayerPart:
 
         TRAVERSE_CONNECT(pnum)
@@ -2163,6 +2165,8 @@ CollapseSectorObject(SECTOR_OBJECTp sop, int nx, int ny)
                     wp->y = ny;
                 }
             }
+
+            sectorgrid_update(*sectp - sector);
         }
     }
 }
@@ -0,0 +1,150 @@
+//-------------------------------------------------------------------------
+/*
+Copyright (C) 1997, 2005 - 3D Realms Entertainment
+
+This file is part of Shadow Warrior version 1.2
+
+Shadow Warrior is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+Original Source: 1997 - Frank Maddin and Jim Norwood
+Prepared for public release: 03/28/2005 - Charlie Wiederhold, 3D Realms
+*/
+//-------------------------------------------------------------------------
+#include "build.h"
+
+#include "game.h"
+#include "network.h"
+
+// The ebench side of -spawn: sprites are spawned and killed through the game's
+// own AllocUser()/FreeUser() in userpool.cpp, and once through individual heap
+// blocks the way SpawnUser() and KillSprite() used CallocMem()/FreeMem() before
+// the pool. Only this file and userpool.cpp are linked into ebench, so the few
+// game globals the pool touches are defined here.
+
+SWBOOL Prediction = FALSE;
+USER PredictUser;
+
+#if DEBUG || defined DEBUGGINGAIDS
+void
+_Assert(const char *expr, const char *strFile, unsigned uLine)
+{
+    LOG_F(ERROR, "Assertion failed: %s in file %s at line %d", expr, strFile, uLine);
+}
+#endif
+
+int
+benchUserSize(void)
+{
+    return sizeof(USER);
+}
+
+void
+benchUserSpawn(short SpriteNum, uint32_t seed, int heap)
+{
+    USERp u;
+
+    if (heap)
+        User[SpriteNum] = u = (USERp)CallocMem(sizeof(USER), 1);
+    else
+        u = AllocUser(SpriteNum);
+
+    u->Health = 100;
+    u->Tics = seed & 63;
+
+    // lights keep a heap block of wall shades, like SpawnUser()'s callers set up
+    if (((seed >> 6) & 7) == 0)
+    {
+        u->WallCount = 16 + ((seed >> 9) & 255);
+        u->WallShade = (int8_t*)CallocMem(u->WallCount * sizeof(*u->WallShade), 1);
+    }
+}
+
+void
+benchUserKill(short SpriteNum, int heap)
+{
+    USERp u = User[SpriteNum];
+
+    if (u->WallShade)
+    {
+        FreeMem(u->WallShade);
+        u->WallShade = NULL;
+    }
+
+    if (heap)
+    {
+        FreeMem(u);
+        User[SpriteNum] = NULL;
+    }
+    else
+        FreeUser(SpriteNum);
+}
+
+// the shape of the per-tic loops over User[] in the actor code
+uint32_t
+benchUserActors(void)
+{
+    uint32_t sum = 0;
+
+    for (int i = 0; i < MAXSPRITES; i++)
+    {
+        USERp u = User[i];
+
+        if (u == NULL)
+            continue;
+
+        if (--u->Tics < 0)
+        {
+            u->Tics = 63;
+            FLIP(u->Flags, SPR_ACTIVE);
+            u->Health--;
+        }
+
+        sum += u->Tics + u->Flags + u->Health;
+    }
+
+    return sum;
+}
+
+// FreeUser() during prediction must leave PredictUser in the table and the
+// sprite's real slot untouched; returns the number of violations
+int
+benchUserPrediction(short SpriteNum)
+{
+    int errors = 0;
+    USERp u = AllocUser(SpriteNum);
+
+    u->Health = 100;
+
+    Prediction = TRUE;
+    User[SpriteNum] = &PredictUser;
+    FreeUser(SpriteNum);
+
+    if (User[SpriteNum] != &PredictUser)
+        errors++;
+
+    Prediction = FALSE;
+    User[SpriteNum] = u;
+
+    if (u->Health != 100)
+        errors++;
+
+    FreeUser(SpriteNum);
+
+    if (User[SpriteNum] != NULL)
+        errors++;
+
+    return errors;
+}
@@ -0,0 +1,98 @@
+//-------------------------------------------------------------------------
+/*
+Copyright (C) 1997, 2005 - 3D Realms Entertainment
+
+This file is part of Shadow Warrior version 1.2
+
+Shadow Warrior is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+Original Source: 1997 - Frank Maddin and Jim Norwood
+Prepared for public release: 03/28/2005 - Charlie Wiederhold, 3D Realms
+*/
+//-------------------------------------------------------------------------
+#include "build.h"
+
+#include "game.h"
+#include "network.h"
+
+// User[] and SectUser[] are the tables the game reads; a non-null entry points
+// at its own slot in the pools below
+SECT_USERp SectUser[MAXSECTORS];
+USERp User[MAXSPRITES];
+
+// USER and SECT_USER storage - one slot per sprite and sector number, so
+// spawn/kill churn doesn't fragment the heap and the loops walking User[]
+// stay within one block
+static USER UserPool[MAXSPRITES];
+static SECT_USER SectUserPool[MAXSECTORS];
+
+// freed slots are filled with this in debug builds to catch stale pointers
+#define USER_POISON 0xCC
+
+USERp
+AllocUser(short SpriteNum)
+{
+    USERp u = &UserPool[SpriteNum];
+
+    memset(u, 0, sizeof(USER));
+    User[SpriteNum] = u;
+
+    return u;
+}
+
+void
+FreeUser(short SpriteNum)
+{
+    if (!User[SpriteNum])
+        return;
+
+    // DoPrediction() swaps the local player's entry for PredictUser and puts the real slot
+    // back afterwards, so a free during prediction must leave both alone
+    if (Prediction && User[SpriteNum] == &PredictUser)
+        return;
+
+    ASSERT(User[SpriteNum] == &UserPool[SpriteNum]);
+
+#if DEBUG
+    memset(&UserPool[SpriteNum], USER_POISON, sizeof(USER));
+#endif
+
+    User[SpriteNum] = NULL;
+}
+
+SECT_USERp
+AllocSectUser(short sectnum)
+{
+    SECT_USERp sectu = &SectUserPool[sectnum];
+
+    memset(sectu, 0, sizeof(SECT_USER));
+    SectUser[sectnum] = sectu;
+
+    return sectu;
+}
+
+void
+FreeSectUser(short sectnum)
+{
+    if (!SectUser[sectnum])
+        return;
+
+#if DEBUG
+    memset(&SectUserPool[sectnum], USER_POISON, sizeof(SECT_USER));
+#endif
+
+    SectUser[sectnum] = NULL;
+}
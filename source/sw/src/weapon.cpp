@@ -20596,11 +20596,7 @@ int QueueStar(short SpriteNum)
     if (StarQueue[StarQueueHead] == -1)
     {
         // new star
-        if (User[SpriteNum])
-        {
-            FreeMem(User[SpriteNum]);
-            User[SpriteNum] = NULL;
-        }
+        FreeUser(SpriteNum);
         change_sprite_stat(SpriteNum, STAT_STAR_QUEUE);
         StarQueue[StarQueueHead] = SpriteNum;
     }
@@ -21115,11 +21111,7 @@ int QueueGeneric(short SpriteNum, short pic)
     // can and should kill the user portion
     if (GenericQueue[GenericQueueHead] == -1)
     {
-        if (User[SpriteNum])
-        {
-            FreeMem(User[SpriteNum]);
-            User[SpriteNum] = NULL;
-        }
+        FreeUser(SpriteNum);
         change_sprite_stat(SpriteNum, STAT_GENERIC_QUEUE);
         GenericQueue[GenericQueueHead] = SpriteNum;
     }
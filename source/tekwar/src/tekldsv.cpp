@@ -126,6 +126,7 @@ loadgame(int loadno)
 
      read(fil,&numwalls,2);
      read(fil,wall,sizeof(walltype)*numwalls);
+     sectorgrid_invalidate();
 
      // Store all sprites (even holes) to preserve indeces
      read(fil,sprite,sizeof(spritetype)*MAXSPRITES);
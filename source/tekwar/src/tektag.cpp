@@ -610,6 +610,7 @@ tagcode()
                               if (wall[k].y < subwaytracky2[i])
                                    wall[k].x += (subwayvel[i]&0xfffffffc);
           }
+          sectorgrid_update(dasector);
 
           for(j=1;j<subwaynumsectors[i];j++)
           {
@@ -619,6 +620,7 @@ tagcode()
                endwall = startwall+sector[dasector].wallnum-1;
                for(k=startwall;k<=endwall;k++)
                     wall[k].x += (subwayvel[i]&0xfffffffc);
+               sectorgrid_update(dasector);
 
                s = headspritesect[dasector];
                while (s != -1)
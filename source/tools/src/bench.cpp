@@ -0,0 +1,1560 @@
+// Headless deterministic benchmark for the Build engine
+//
+// Boots the engine with an offscreen 8-bit software surface, then for every map
+// given on the command line replays a fixed camera path through
+// renderDrawRoomsQ16() + renderDrawMasks() and runs batches of clipmove(),
+// hitscan() and getzrange() queries from each camera position. Per-function
+// timings are written as JSON.
+//
+// The camera path is derived purely from the map data (player start, then the
+// centers of evenly spaced sectors), so two runs over the same data are
+// directly comparable.
+//
+// With -threads N every view is drawn a second time with r_classicthreads N,
+// timed as "drawrooms_mt", and the frame must match the single-threaded one.
+//
+// With -mix N no maps are needed: N synthetic voices with pseudo-random formats,
+// pitches and pans are mixed into stereo buffers with every available audiolib
+// kernel, without opening an audio device. Each kernel's output is checked
+// against the C kernel.
+//
+// With -pan N, N looping voices are started on SDL's dummy audio driver and
+// panned with one FX_Pan3D()/FX_SetPan() call per voice and then with the
+// batched calls. The per-voice pass must take the mixer lock once per voice and
+// the batch exactly once.
+//
+// With -net N a server and N clients on the loopback interface exchange
+// synthetic snapshots, shaped like the duke3d actor and wall arrays, as
+// LZ4-compressed byte deltas. Every client checks that its patched snapshot
+// matches the server's after each tic.
+//
+// With -kernels N, N random columns are drawn with every kernel of
+// mvlineasm4(), spritevline() and slopevlin(), covering both tile height modes
+// and vplc saturation. Each kernel's framebuffer and final texture coordinates
+// must match the C kernel's.
+//
+// With -eventq N, N Blood events are posted into the vanilla and the std event
+// queue while random evKill()s cancel some of them and due events are
+// dispatched. The dispatch order of each queue must match a copy of the queue
+// that kills with the original linear scan.
+//
+// With -precache the tiles of each map (every map in the search path if none are
+// given) are marked like the games' level precache marks them, then loaded in
+// tile order while hightile replacements are read ahead and decoded on worker
+// threads. The ART and hightile time for each map is written as JSON.
+//
+// With -spawn N, N Shadow Warrior sprites are killed and respawned an eighth at
+// a time every tic, the way explosions and shrapnel churn User[], and an actor
+// pass walks them after each tic. One run allocates each USER as its own heap
+// block and the other goes through the game's AllocUser()/FreeUser() pool
+// (sw/src/userpool.cpp, linked in with sw/src/userbench.cpp); both runs must
+// produce the same checksum, and a free during prediction must leave the
+// table alone.
+//
+// -mix, -pan, -net, -kernels, -eventq and -spawn can be combined in one run;
+// each writes its results as a member of a single JSON object.
+
+#include "compat.h"
+#include "a.h"
+#include "baselayer.h"
+#include "build.h"
+#include "clip.h"
+#include "common.h"
+#include "timer.h"
+#include "crc32.h"
+
+#include "_multivc.h"
+#include "drivers.h"
+#include "fx_man.h"
+
+#include "../../blood/src/eventq.h"
+#include "../../blood/src/pqueue.h"
+
+#ifndef NETCODE_DISABLE
+# include "enet.h"
+# include "lz4.h"
+# include "netdelta.h"
+#endif
+
+#ifdef RENDERTYPESDL
+# include "sdlayer.h"
+#endif
+
+#include <algorithm>
+#include <vector>
+
+#define BENCH_CACHESIZE (96 << 20)
+#define BENCH_CLIPMASK ((1 << 16) + 1)
+#define BENCH_WALLDIST 164
+#define BENCH_MAXWAYPOINTS 16
+#define BENCH_STEPSPERLEG 8
+#define BENCH_NUMDIRECTIONS 8
+#define BENCH_MIXRATE 44100
+#define BENCH_MIXFRAMES 65536
+#define BENCH_NETACTORS 4096
+#define BENCH_NETWALLS 8192
+#define BENCH_NETCHANGES 64
+#define BENCH_NETPORT 23514
+#define BENCH_SPAWNCHURN 8
+#define BENCH_KERNELBPL 64
+#define BENCH_KERNELROWS 256
+#define BENCH_KERNELTILE 65536
+#define BENCH_EVENTINDICES 512
+#define BENCH_EVENTTYPES 7
+
+enum
+{
+    BENCH_DRAWROOMS,
+    BENCH_DRAWMASKS,
+    BENCH_CLIPMOVE,
+    BENCH_HITSCAN,
+    BENCH_GETZRANGE,
+    BENCH_DRAWROOMS_MT,
+    BENCH_NUMFUNCS
+};
+
+static char const *const benchFuncNames[BENCH_NUMFUNCS] = { "drawrooms", "drawmasks", "clipmove", "hitscan", "getzrange", "drawrooms_mt" };
+
+typedef std::vector<uint64_t> benchsamples_t;
+
+static char const *benchDefFile = "";
+
+const char *G_DefaultDefFile(void) { return benchDefFile; }
+const char *G_DefFile(void) { return benchDefFile; }
+
+void faketimerhandler(void) { }
+void app_crashhandler(void) { }
+void __dassert(const char *pzExpr, const char *pzFile, int nLine) { LOG_F(ERROR, "Assertion failed: %s in file %s at line %d", pzExpr, pzFile, nLine); }
+
+#if defined STARTUP_SETUP_WINDOW
+int32_t startwin_open(void) { return 0; }
+int32_t startwin_close(void) { return 0; }
+int32_t startwin_puts(const char *s) { UNREFERENCED_PARAMETER(s); return 0; }
+int32_t startwin_idle(void *s) { UNREFERENCED_PARAMETER(s); return 0; }
+int32_t startwin_settitle(const char *s) { UNREFERENCED_PARAMETER(s); return 0; }
+int32_t startwin_run(void) { return 0; }
+bool startwin_isopen(void) { return false; }
+#endif
+
+#if defined RENDERTYPESDL && !defined __APPLE__ && !defined EDUKE32_TOUCH_DEVICES
+static Uint8 benchIconPixels[4];
+extern "C" struct sdlappicon sdlappicon;
+struct sdlappicon sdlappicon = { 1, 1, benchIconPixels };
+#endif
+
+template <typename Func>
+static inline void benchTime(benchsamples_t &samples, Func func)
+{
+    uint64_t const t = timerGetNanoTicks();
+    func();
+    samples.push_back(timerGetNanoTicks() - t);
+}
+
+static double benchPercentile(benchsamples_t const &sorted, int const pct)
+{
+    if (sorted.empty())
+        return 0.0;
+
+    size_t const idx = min<size_t>(sorted.size() - 1, sorted.size() * pct / 100);
+    return (double)sorted[idx] * 1000.0 / (double)timerGetNanoTickRate();
+}
+
+static void benchWriteFuncs(FILE *fp, benchsamples_t *samples, char const *indent)
+{
+    for (int i = 0; i < BENCH_NUMFUNCS; i++)
+    {
+        auto &s = samples[i];
+        std::sort(s.begin(), s.end());
+
+        fprintf(fp, "%s\"%s\": { \"count\": %d, \"p50\": %.4f, \"p90\": %.4f, \"p99\": %.4f, \"max\": %.4f }%s\n", indent,
+                benchFuncNames[i], (int)s.size(), benchPercentile(s, 50), benchPercentile(s, 90), benchPercentile(s, 99),
+                benchPercentile(s, 100), i == BENCH_NUMFUNCS - 1 ? "" : ",");
+    }
+}
+
+// Builds the waypoint list for the current map: the player start followed by
+// the centers of evenly spaced sectors that actually contain their center.
+static int benchBuildWaypoints(vec3_t const &startpos, int16_t const startsect, vec3_t *wp, int16_t *wpsect)
+{
+    int num = 0;
+
+    wp[num] = startpos;
+    wpsect[num++] = startsect;
+
+    for (int i = 0; i < BENCH_MAXWAYPOINTS - 1 && numsectors > 0; i++)
+    {
+        int16_t const sectnum = (int16_t)((int64_t)i * numsectors / (BENCH_MAXWAYPOINTS - 1));
+        auto const sec = (usectorptr_t)&sector[sectnum];
+
+        if (sec->wallnum <= 0)
+            continue;
+
+        vec2_t pos = {};
+
+        for (int w = sec->wallptr; w < sec->wallptr + sec->wallnum; w++)
+            pos.x += wall[w].x, pos.y += wall[w].y;
+
+        pos.x /= sec->wallnum;
+        pos.y /= sec->wallnum;
+
+        if (inside(pos.x, pos.y, sectnum) != 1)
+            continue;
+
+        wp[num] = { pos.x, pos.y, 0 };
+        wpsect[num++] = sectnum;
+    }
+
+    return num;
+}
+
+static void benchRunQueries(vec3_t const &pos, int16_t const sectnum, benchsamples_t *samples)
+{
+    int32_t ceilz, ceilhit, florz, florhit;
+
+    benchTime(samples[BENCH_GETZRANGE], [&] { getzrange(&pos, sectnum, &ceilz, &ceilhit, &florz, &florhit, BENCH_WALLDIST, BENCH_CLIPMASK); });
+
+    for (int d = 0; d < BENCH_NUMDIRECTIONS; d++)
+    {
+        int const ang = d * (2048 / BENCH_NUMDIRECTIONS);
+        int32_t const vx = sintable[(ang + 512) & 2047], vy = sintable[ang & 2047];
+
+        hitdata_t hit;
+        benchTime(samples[BENCH_HITSCAN], [&] { hitscan(&pos, sectnum, vx, vy, 0, &hit, BENCH_CLIPMASK); });
+
+        vec3_t movepos = pos;
+        int16_t movesect = sectnum;
+        benchTime(samples[BENCH_CLIPMOVE], [&] { clipmove(&movepos, &movesect, vx << 4, vy << 4, BENCH_WALLDIST, 4 << 8, 4 << 8, BENCH_CLIPMASK); });
+    }
+}
+
+static uint32_t benchFrameChecksum(void)
+{
+    uint32_t crc = 0;
+
+    videoBeginDrawing();
+    for (int y = 0; y < ydim; y++)
+        crc = Bcrc32((char *)frameplace + ylookup[y], xdim, crc);
+    videoEndDrawing();
+
+    return crc;
+}
+
+static int benchRunMap(char const *mapname, int const frames, int const threads, benchsamples_t *samples, int *mismatches)
+{
+    vec3_t startpos;
+    int16_t startang, startsect;
+
+    if (engineLoadBoard(mapname, 0, &startpos, &startang, &startsect) < 0)
+    {
+        LOG_F(ERROR, "Failed loading map \"%s\".", mapname);
+        return -1;
+    }
+
+    if ((unsigned)startsect >= (unsigned)numsectors)
+        updatesector(startpos.x, startpos.y, &startsect);
+
+    vec3_t wp[BENCH_MAXWAYPOINTS];
+    int16_t wpsect[BENCH_MAXWAYPOINTS];
+    int const numwp = benchBuildWaypoints(startpos, startsect, wp, wpsect);
+    int views = 0;
+
+    for (int i = 0; i < numwp; i++)
+    {
+        vec3_t const &a = wp[i], &b = wp[(i + 1) % numwp];
+        int16_t sectnum = wpsect[i];
+
+        for (int s = 0; s < BENCH_STEPSPERLEG; s++)
+        {
+            vec3_t pos = { a.x + (b.x - a.x) * s / BENCH_STEPSPERLEG, a.y + (b.y - a.y) * s / BENCH_STEPSPERLEG, 0 };
+
+            updatesector(pos.x, pos.y, &sectnum);
+            if (sectnum < 0)
+            {
+                sectnum = wpsect[i];
+                continue;
+            }
+
+            int32_t ceilz, florz;
+            getzsofslope(sectnum, pos.x, pos.y, &ceilz, &florz);
+            pos.z = (ceilz >> 1) + (florz >> 1);
+
+            fix16_t const ang = fix16_from_int((numwp > 1) ? getangle(b.x - a.x, b.y - a.y) : startang);
+
+            r_classicthreads = 1;
+
+            for (int f = 0; f < frames; f++)
+            {
+                benchTime(samples[BENCH_DRAWROOMS], [&] { renderDrawRoomsQ16(pos.x, pos.y, pos.z, ang, fix16_from_int(100), sectnum); });
+                benchTime(samples[BENCH_DRAWMASKS], [&] { renderDrawMasks(); });
+            }
+
+            if (threads > 1)
+            {
+                uint32_t const crc = benchFrameChecksum();
+
+                r_classicthreads = threads;
+
+                for (int f = 0; f < frames; f++)
+                {
+                    benchTime(samples[BENCH_DRAWROOMS_MT], [&] { renderDrawRoomsQ16(pos.x, pos.y, pos.z, ang, fix16_from_int(100), sectnum); });
+                    renderDrawMasks();
+                }
+
+                r_classicthreads = 1;
+
+                if (benchFrameChecksum() != crc)
+                {
+                    LOG_F(ERROR, "%s: view %d differs with %d threads.", mapname, views, threads);
+                    (*mismatches)++;
+                }
+            }
+
+            benchRunQueries(pos, sectnum, samples);
+            views++;
+        }
+    }
+
+    LOG_F(INFO, "%s: %d sectors, %d camera positions.", mapname, numsectors, views);
+    return views;
+}
+
+// The synthetic runs share one JSON object. Each run adds its member once it has results, so a
+// run that fails early can't leave a stray separator behind.
+static int benchNumObjects;
+
+static void benchOpenObject(FILE *fp, char const *name)
+{
+    fprintf(fp, "%s  \"%s\": {\n", benchNumObjects++ ? ",\n" : "", name);
+}
+
+static uint32_t benchRand(uint32_t &seed)
+{
+    seed = seed * 1664525 + 1013904223;
+    return seed >> 8;
+}
+
+static void benchSetupVoices(VoiceNode *voices, char *data, int const numvoices)
+{
+    uint32_t seed = 1;
+
+    for (int i = 0; i < numvoices; i++)
+    {
+        auto &v = voices[i];
+
+        v.bits     = (benchRand(seed) & 1) ? 16 : 8;
+        v.channels = (benchRand(seed) & 1) + 1;
+        v.sound    = data;
+        v.position = (benchRand(seed) % (BENCH_MIXFRAMES >> 1)) << 16;
+
+        // 0.5x to 2x pitch, with a few voices at exactly 1x
+        v.RateScale = (i & 3) ? 32768 + benchRand(seed) % 98304 : 65536;
+        v.volume    = fix16_one;
+
+        v.GoalVolume   = { (fix16_t)(benchRand(seed) % (fix16_one + 1)), (fix16_t)(benchRand(seed) % (fix16_one + 1)) };
+        v.PannedVolume = { (fix16_t)(benchRand(seed) % (fix16_one + 1)), (fix16_t)(benchRand(seed) % (fix16_one + 1)) };
+
+        MV_SetVoiceMixMode(&v);
+    }
+}
+
+static int benchRunMixer(FILE *fp, int const numvoices, int const buffers)
+{
+    static char const *const kernelNames[] = { "c", "sse2", "avx2" };
+
+    // one buffer of random 16-bit stereo frames, read as whatever format each voice claims to be
+    auto data = (char *)Xmalloc(BENCH_MIXFRAMES * 2 * sizeof(int16_t));
+    uint32_t seed = 2;
+
+    for (int i = 0; i < BENCH_MIXFRAMES * 2 * (int)sizeof(int16_t); i++)
+        data[i] = benchRand(seed);
+
+    auto voices = new VoiceNode[numvoices]();
+    auto acc    = (int32_t *)Xaligned_alloc(32, MV_MIXBUFFERSIZE * 2 * sizeof(int32_t));
+    auto out    = (int16_t *)Xaligned_alloc(32, MV_MIXBUFFERSIZE * 2 * sizeof(int16_t));
+
+    MV_Channels = 2;
+    MV_GlobalVolume = fix16_one;
+    MV_VolumeSmoothFactor = fix16_from_float(1.f-powf(0.1f, 30.f/BENCH_MIXRATE));
+
+    uint32_t reference = 0;
+    int errors = 0;
+
+    benchOpenObject(fp, "mix");
+    fprintf(fp, "    \"voices\": %d,\n    \"buffers\": %d,\n    \"kernels\": [\n", numvoices, buffers);
+
+    for (int k = MV_MIXKERNEL_C; k <= MV_MIXKERNEL_BEST; k++)
+    {
+        if (MV_SetMixKernel(k) != k)
+            continue;
+
+        benchSetupVoices(voices, data, numvoices);
+
+        uint32_t crc = 0;
+        uint64_t const t = timerGetNanoTicks();
+
+        for (int b = 0; b < buffers; b++)
+        {
+            Bmemset(acc, 0, MV_MIXBUFFERSIZE * 2 * sizeof(int32_t));
+
+            for (int i = 0; i < numvoices; i++)
+            {
+                auto &v = voices[i];
+
+                MV_MixDestination = acc;
+                v.position = v.mix(&v, MV_MIXBUFFERSIZE);
+
+                // keep two mix buffers' worth of frames at 2x pitch in range
+                if ((v.position >> 16) >= BENCH_MIXFRAMES - (MV_MIXBUFFERSIZE << 2))
+                    v.position &= 0xffff;
+            }
+
+            MV_SaturateAccumulator(out, acc, MV_MIXBUFFERSIZE * 2);
+            crc = Bcrc32(out, MV_MIXBUFFERSIZE * 2 * sizeof(int16_t), crc);
+        }
+
+        double const ms = (double)(timerGetNanoTicks() - t) * 1000.0 / (double)timerGetNanoTickRate();
+
+        if (k == MV_MIXKERNEL_C)
+            reference = crc;
+        else if (crc != reference)
+        {
+            LOG_F(ERROR, "%s mixer output does not match the C kernel.", kernelNames[k]);
+            errors++;
+        }
+
+        fprintf(fp, "%s      { \"name\": \"%s\", \"ms\": %.4f, \"per_buffer_us\": %.4f, \"crc\": \"%08x\", \"exact\": %s }",
+                k == MV_MIXKERNEL_C ? "" : ",\n", kernelNames[k], ms, ms * 1000.0 / buffers, crc, crc == reference ? "true" : "false");
+    }
+
+    fprintf(fp, "\n    ]\n  }");
+
+    MV_SetMixKernel(MV_MIXKERNEL_BEST);
+
+    Xaligned_free(out);
+    Xaligned_free(acc);
+    delete[] voices;
+    Xfree(data);
+
+    return errors;
+}
+
+// Pans N looping voices once with a call per voice and once with the batched call, for both the
+// 3D and the direct pan, and counts the mixer lock acquisitions each pass takes.
+static int benchRunPan(FILE *fp, int const numvoices)
+{
+    static char const *const passNames[] = { "pan3d", "setpan" };
+
+#ifdef RENDERTYPESDL
+    // SDL's dummy audio driver runs the mixer without opening a device
+# ifdef _WIN32
+    if (!Bgetenv("SDL_AUDIODRIVER"))
+        _putenv("SDL_AUDIODRIVER=dummy");
+# else
+    setenv("SDL_AUDIODRIVER", "dummy", 0);
+# endif
+#endif
+
+    if (FX_Init(numvoices, 2, BENCH_MIXRATE, nullptr) != FX_Ok)
+    {
+        LOG_F(ERROR, "Failed initializing sound: %s", FX_ErrorString(FX_Error));
+        return 1;
+    }
+
+    auto data = (char *)Xcalloc(BENCH_MIXFRAMES, 1);
+    std::vector<MV_Pan3DUpdate> pan3d;
+    std::vector<MV_PanUpdate> pan;
+    uint32_t seed = 5;
+    int errors = 0;
+
+    for (int i = 0; i < numvoices; i++)
+    {
+        int const handle = FX_PlayLoopedRaw(data, BENCH_MIXFRAMES, data, data + BENCH_MIXFRAMES - 1, BENCH_MIXRATE, 0, 255, 255, 255, 1, fix16_one, 0);
+
+        if (handle <= FX_Ok)
+        {
+            LOG_F(ERROR, "Failed starting voice %d of %d.", i, numvoices);
+            errors++;
+            break;
+        }
+
+        int const vol = benchRand(seed) & 255;
+
+        pan3d.push_back({ handle, (int)(benchRand(seed) & MV_MAXPANPOSITION), (int)(benchRand(seed) & 255) });
+        pan.push_back({ handle, vol, vol, (int)(benchRand(seed) & 255) });
+    }
+
+    benchOpenObject(fp, "pan");
+    fprintf(fp, "    \"voices\": %d,\n    \"passes\": [\n", (int)pan.size());
+
+    for (int p = 0; p < (int)ARRAY_SIZE(passNames); p++)
+    {
+        unsigned int locks[2];
+
+        for (int batch = 0; batch < 2; batch++)
+        {
+            unsigned int const base = SoundDriver_PCM_LockCount;
+            int status = FX_Ok;
+
+            if (batch)
+                status = p ? FX_SetPanBatch(pan.data(), pan.size()) : FX_Pan3DBatch(pan3d.data(), pan3d.size());
+            else
+            {
+                for (size_t i = 0; i < pan.size(); i++)
+                    if ((p ? FX_SetPan(pan[i].handle, pan[i].vol, pan[i].left, pan[i].right)
+                           : FX_Pan3D(pan3d[i].handle, pan3d[i].angle, pan3d[i].distance)) != FX_Ok)
+                        status = FX_Warning;
+            }
+
+            locks[batch] = SoundDriver_PCM_LockCount - base;
+
+            if (status != FX_Ok)
+            {
+                LOG_F(ERROR, "%s %s pass failed.", passNames[p], batch ? "batched" : "per-voice");
+                errors++;
+            }
+        }
+
+        // one acquisition per voice before, one per batch now
+        bool const match = locks[0] == pan.size() && locks[1] == (pan.empty() ? 0 : 1);
+
+        if (!match)
+        {
+            LOG_F(ERROR, "%s took %u locks per voice and %u batched for %d voices.", passNames[p], locks[0], locks[1], (int)pan.size());
+            errors++;
+        }
+
+        fprintf(fp, "%s      { \"name\": \"%s\", \"locks\": %u, \"batched_locks\": %u, \"match\": %s }", p ? ",\n" : "",
+                passNames[p], locks[0], locks[1], match ? "true" : "false");
+    }
+
+    fprintf(fp, "\n    ]\n  }");
+
+    FX_StopAllSounds();
+    FX_Shutdown();
+    Xfree(data);
+
+    return errors;
+}
+
+#ifndef NETCODE_DISABLE
+// sizes roughly match netactor_t and netWall_t
+struct benchnetstate
+{
+    int32_t actor[BENCH_NETACTORS][56];
+    int32_t wall[BENCH_NETWALLS][8];
+};
+
+// one tic of game state: every player actor moves, and a few other actors change a field or two
+static void benchNetTic(benchnetstate *state, int const numplayers, uint32_t &seed)
+{
+    for (int i = 0; i < numplayers; i++)
+    {
+        auto a = state->actor[i];
+        a[0] += (int32_t)(benchRand(seed) & 255) - 128;
+        a[1] += (int32_t)(benchRand(seed) & 255) - 128;
+        a[2] += (int32_t)(benchRand(seed) & 63) - 32;
+        a[3] = (a[3] + (benchRand(seed) & 31)) & 2047;
+    }
+
+    for (int i = 0; i < BENCH_NETCHANGES; i++)
+    {
+        auto a = state->actor[benchRand(seed) % BENCH_NETACTORS];
+        a[benchRand(seed) % 56] += benchRand(seed) & 15;
+    }
+
+    state->wall[benchRand(seed) % BENCH_NETWALLS][benchRand(seed) & 7]++;
+}
+
+static int32_t benchNetEncode(benchnetstate const *from, benchnetstate const *to, uint8_t *out)
+{
+    int32_t size = netDeltaEncode(from->wall, to->wall, sizeof(to->wall), out);
+    return size + netDeltaEncode(from->actor, to->actor, sizeof(to->actor), out + size);
+}
+
+static bool benchNetApply(benchnetstate *state, uint8_t const *delta, int32_t const size)
+{
+    int32_t const wallSize = netDeltaApply(state->wall, sizeof(state->wall), delta, size);
+    return wallSize >= 0 && netDeltaApply(state->actor, sizeof(state->actor), delta + wallSize, size - wallSize) == size - wallSize;
+}
+
+static int benchRunNet(FILE *fp, int const numclients, int const tics)
+{
+    if (enet_initialize() != 0)
+    {
+        LOG_F(ERROR, "Failed initializing ENet.");
+        return 1;
+    }
+
+    ENetAddress address = { ENET_HOST_ANY, BENCH_NETPORT, 0 };
+    ENetHost *server = enet_host_create(&address, numclients, 1, 0, 0);
+
+    if (server == nullptr)
+    {
+        LOG_F(ERROR, "Failed creating the ENet server host.");
+        enet_deinitialize();
+        return 1;
+    }
+
+    std::vector<ENetHost *> clients(numclients);
+    char host[] = "localhost";
+    enet_address_set_host(&address, host);
+
+    for (auto &c : clients)
+    {
+        c = enet_host_create(nullptr, 1, 1, 0, 0);
+        enet_host_connect(c, &address, 1, 0);
+    }
+
+    ENetEvent event;
+    int connected = 0;
+
+    for (int tries = 0; connected < numclients && tries < 1000; tries++)
+    {
+        while (enet_host_service(server, &event, 1) > 0)
+            connected += (event.type == ENET_EVENT_TYPE_CONNECT);
+
+        for (auto c : clients)
+            while (enet_host_service(c, &event, 0) > 0) { }
+    }
+
+    if (connected < numclients)
+    {
+        LOG_F(ERROR, "Only %d of %d loopback clients connected.", connected, numclients);
+
+        for (auto c : clients)
+            enet_host_destroy(c);
+
+        enet_host_destroy(server);
+        enet_deinitialize();
+        return 1;
+    }
+
+    auto states = (benchnetstate *)Xcalloc(2 + numclients, sizeof(benchnetstate));
+    auto delta  = (uint8_t *)Xmalloc(netDeltaBound(sizeof(states->wall)) + netDeltaBound(sizeof(states->actor)));
+    auto packed = (uint8_t *)Xmalloc(LZ4_COMPRESSBOUND(netDeltaBound(sizeof(states->wall)) + netDeltaBound(sizeof(states->actor))));
+    auto unpacked = (uint8_t *)Xmalloc(netDeltaBound(sizeof(states->wall)) + netDeltaBound(sizeof(states->actor)));
+
+    uint32_t seed = 3;
+
+    for (int i = 0; i < BENCH_NETACTORS; i++)
+        for (int j = 0; j < 56; j++)
+            states[0].actor[i][j] = (j < 8 || i < numclients) ? benchRand(seed) : 0;
+
+    for (int i = 0; i < numclients; i++)
+        states[2 + i] = states[0];
+
+    uint64_t deltaBytes = 0, packedBytes = 0, encodeTicks = 0, decodeTicks = 0;
+    int errors = 0;
+
+    for (int t = 0; t < tics; t++)
+    {
+        auto const from = &states[t & 1], to = &states[(t & 1) ^ 1];
+
+        *to = *from;
+        benchNetTic(to, numclients, seed);
+
+        // encoded once, every client acknowledged the same revision
+        uint64_t tick = timerGetNanoTicks();
+        int32_t const deltaSize = benchNetEncode(from, to, delta);
+        int32_t const packedSize = LZ4_compress_default((char const *)delta, (char *)packed, deltaSize, LZ4_COMPRESSBOUND(deltaSize));
+        encodeTicks += timerGetNanoTicks() - tick;
+
+        deltaBytes += deltaSize;
+        packedBytes += packedSize;
+
+        enet_host_broadcast(server, 0, enet_packet_create(packed, packedSize, ENET_PACKET_FLAG_RELIABLE));
+        enet_host_flush(server);
+
+        for (int i = 0; i < numclients; i++)
+        {
+            bool received = false;
+
+            for (int tries = 0; !received && tries < 1000; tries++)
+            {
+                enet_host_service(server, &event, 0);
+
+                while (!received && enet_host_service(clients[i], &event, 1) > 0)
+                {
+                    if (event.type != ENET_EVENT_TYPE_RECEIVE)
+                        continue;
+
+                    tick = timerGetNanoTicks();
+                    bool const ok = LZ4_decompress_safe((char const *)event.packet->data, (char *)unpacked, event.packet->dataLength, deltaSize) == deltaSize
+                                    && benchNetApply(&states[2 + i], unpacked, deltaSize);
+                    decodeTicks += timerGetNanoTicks() - tick;
+
+                    if (!ok || Bmemcmp(&states[2 + i], to, sizeof(benchnetstate)))
+                        errors++;
+
+                    enet_packet_destroy(event.packet);
+                    received = true;
+                }
+            }
+
+            if (!received)
+                errors++;
+        }
+    }
+
+    if (errors)
+        LOG_F(ERROR, "%d snapshots did not arrive or did not match the server's.", errors);
+
+    double const rate = (double)timerGetNanoTickRate();
+
+    benchOpenObject(fp, "net");
+    fprintf(fp, "    \"clients\": %d,\n    \"tics\": %d,\n    \"snapshot_bytes\": %d,\n", numclients, tics, (int)sizeof(benchnetstate));
+    fprintf(fp, "    \"delta_bytes_per_tic\": %.1f,\n    \"lz4_bytes_per_tic\": %.1f,\n", (double)deltaBytes / tics, (double)packedBytes / tics);
+    fprintf(fp, "    \"encode_us_per_tic\": %.2f,\n    \"decode_us_per_client_tic\": %.2f,\n    \"errors\": %d\n  }",
+            encodeTicks * 1000000.0 / rate / tics, decodeTicks * 1000000.0 / rate / ((double)tics * numclients), errors);
+
+    Xfree(unpacked);
+    Xfree(packed);
+    Xfree(delta);
+    Xfree(states);
+
+    for (auto c : clients)
+        enet_host_destroy(c);
+
+    enet_host_destroy(server);
+    enet_deinitialize();
+
+    return errors;
+}
+#endif
+
+static uint8_t benchPrecacheTiles[(MAXTILES+7)>>3];
+static uint8_t benchPrecacheHightile[2][(MAXTILES+7)>>3];
+
+static void benchMarkTile(int tilenum, int const type)
+{
+    if ((unsigned)tilenum >= MAXTILES)
+        return;
+
+    int lasttile = tilenum + picanm[tilenum].num;
+
+    if ((picanm[tilenum].sf & PICANM_ANIMTYPE_MASK) == PICANM_ANIMTYPE_BACK)
+    {
+        lasttile = tilenum;
+        tilenum -= picanm[tilenum].num;
+    }
+
+    for (int i = max(tilenum, 0); i <= min(lasttile, MAXTILES - 1); i++)
+    {
+        bitmap_set(benchPrecacheTiles, i);
+        bitmap_set(benchPrecacheHightile[type], i);
+    }
+}
+
+// Marks the map's tiles the way the games' G_CacheMapData() does, then times
+// the ART loads and the hightile prefetch pipeline over them in tile order.
+static int benchRunPrecache(FILE *fp, char const *mapname, bool const first)
+{
+    vec3_t startpos;
+    int16_t startang, startsect;
+
+    if (engineLoadBoard(mapname, 0, &startpos, &startang, &startsect) < 0)
+    {
+        LOG_F(ERROR, "Failed loading map \"%s\".", mapname);
+        return -1;
+    }
+
+    Bmemset(benchPrecacheTiles, 0, sizeof(benchPrecacheTiles));
+    Bmemset(benchPrecacheHightile, 0, sizeof(benchPrecacheHightile));
+
+    for (int i = 0; i < numwalls; i++)
+    {
+        benchMarkTile(wall[i].picnum, 0);
+        benchMarkTile(wall[i].overpicnum, 0);
+    }
+
+    for (int i = 0; i < numsectors; i++)
+    {
+        benchMarkTile(sector[i].floorpicnum, 0);
+        benchMarkTile(sector[i].ceilingpicnum, 0);
+    }
+
+    for (int i = 0; i < MAXSPRITES; i++)
+        if (sprite[i].statnum < MAXSTATUS)
+            benchMarkTile(sprite[i].picnum, 1);
+
+    int numtiles = 0;
+    uint64_t artTicks = 0;
+    auto const start = timerGetNanoTicks();
+
+#ifdef USE_OPENGL
+    polymost_prefetch(benchPrecacheHightile[0], 0);
+    polymost_prefetch(benchPrecacheHightile[1], 1);
+#endif
+
+    for (int i = 0; i < MAXTILES; i++)
+    {
+        if (!bitmap_test(benchPrecacheTiles, i))
+            continue;
+
+        auto const tick = timerGetNanoTicks();
+        tileLoad(i);
+        artTicks += timerGetNanoTicks() - tick;
+        numtiles++;
+
+#ifdef USE_OPENGL
+        // nothing uploads here, so each decoded replacement is dropped once the loop passes it
+        polymost_prefetchnext(i);
+#endif
+    }
+
+#ifdef USE_OPENGL
+    polymost_prefetchfree();
+#endif
+
+    double const rate = (double)timerGetNanoTickRate();
+    double const totalms = (timerGetNanoTicks() - start) * 1000.0 / rate;
+    double const artms = artTicks * 1000.0 / rate;
+
+    // the separator goes before each entry, so a map that fails to load can't leave a trailing comma
+    fprintf(fp, "%s    { \"name\": \"%s\", \"tiles\": %d, \"art_ms\": %.2f, \"hightile_ms\": %.2f, \"total_ms\": %.2f }",
+            first ? "" : ",\n", mapname, numtiles, artms, totalms - artms, totalms);
+
+    return numtiles;
+}
+
+#ifdef ENGINE_USING_A_C
+extern intptr_t asm1, asm3;
+extern intptr_t palookupoffse[4], bufplce[4];
+extern uint32_t vplce[4];
+extern int32_t vince[4];
+extern int32_t globaltilesizy, globalx3, globaly3, gpinc;
+
+enum
+{
+    BENCH_MVLINEASM4,
+    BENCH_SPRITEVLINE,
+    BENCH_SLOPEVLIN,
+    BENCH_NUMVLINES
+};
+
+struct benchkernelcase
+{
+    int32_t func, rows, x;
+    int32_t logy, tilesizy, saturate;
+    intptr_t pal[4], buf[4];
+    uint32_t vplc[4];
+    int32_t vinc[4];
+    int32_t bx, by, bxinc, byinc, ysiz;  // spritevline
+    int32_t logx, bz, bzinc;             // slopevlin, with bx and by
+};
+
+// Column kernel inputs: tile columns with a sprinkling of transparent (255) texels, palookups and the per-row
+// palookups of a slope
+struct benchkerneldata
+{
+    char *tile, *pals;
+    intptr_t slopal[BENCH_KERNELROWS];
+};
+
+static void benchSetupKernelCase(benchkernelcase &c, benchkerneldata const &d, uint32_t &seed)
+{
+    // half the cases use a non-power-of-two tile height, which the wall kernels take with logy == 0
+    int const logtilesizy = 1 + benchRand(seed) % 8;
+
+    c.func     = benchRand(seed) % BENCH_NUMVLINES;
+    c.rows     = 2 + benchRand(seed) % (BENCH_KERNELROWS - 1);
+    c.x        = benchRand(seed) % (BENCH_KERNELBPL - 4);
+    c.tilesizy = (benchRand(seed) & 1) ? (1 << logtilesizy) : 1 + benchRand(seed) % BENCH_KERNELROWS;
+    c.logy     = (c.tilesizy == (1 << logtilesizy)) ? 32 - logtilesizy : 0;
+    c.saturate = benchRand(seed) & 1;
+
+    for (int z = 0; z < 4; z++)
+    {
+        c.pal[z]  = (intptr_t)&d.pals[(benchRand(seed) & 3) << 8];
+        c.buf[z]  = (intptr_t)&d.tile[(benchRand(seed) % 4) * BENCH_KERNELROWS];
+        c.vplc[z] = benchRand(seed) << 8;
+        c.vinc[z] = (int32_t)(benchRand(seed) << 4) - (1 << 27);
+    }
+
+    // spritevline stays within 129 tile columns of 64 texels and 257 rows of its start
+    c.bx    = benchRand(seed) & 65535;
+    c.by    = benchRand(seed) & 65535;
+    c.bxinc = (int32_t)(benchRand(seed) & 65535) - 32768;
+    c.byinc = (int32_t)(benchRand(seed) & 131071) - 65536;
+    c.ysiz  = 1 + benchRand(seed) % 64;
+
+    // slopevlin keeps its sloptable index within (bz>>6)+HALFSLOPTABLESIZ +- 4096
+    c.logx  = 1 + benchRand(seed) % 8;
+    c.bz    = (int32_t)(benchRand(seed) & ((1 << 20) - 1)) - (1 << 19);
+    c.bzinc = (int32_t)(benchRand(seed) & 2047) - 1024;
+
+    if (c.func == BENCH_SLOPEVLIN)
+    {
+        c.logy = logtilesizy;
+        c.bx   = (int32_t)benchRand(seed) << 8;
+        c.by   = (int32_t)benchRand(seed) << 8;
+    }
+}
+
+// Draws one case with the current kernel. state gets the texture coordinates the kernel hands back, if any.
+static uint64_t benchRunKernelCase(benchkernelcase const &c, benchkerneldata const &d, char *frame, uint32_t *state)
+{
+    char *const p = frame + c.x;
+    uint64_t t;
+
+    globaltilesizy = c.tilesizy;
+    Bmemset(state, 0, sizeof(uint32_t) * 4);
+
+    switch (c.func)
+    {
+    case BENCH_MVLINEASM4:
+        Bmemcpy(palookupoffse, c.pal, sizeof(palookupoffse));
+        Bmemcpy(bufplce, c.buf, sizeof(bufplce));
+        Bmemcpy(vplce, c.vplc, sizeof(vplce));
+        Bmemcpy(vince, c.vinc, sizeof(vince));
+        setupmvlineasm(c.logy, c.saturate);
+
+        t = timerGetNanoTicks();
+        mvlineasm4(c.rows, p);
+        t = timerGetNanoTicks() - t;
+
+        Bmemcpy(state, vplce, sizeof(vplce));
+        break;
+
+    case BENCH_SPRITEVLINE:
+        setupspritevline(c.pal[0], c.bxinc, c.byinc, c.ysiz);
+
+        t = timerGetNanoTicks();
+        spritevline(c.bx, c.by, c.rows + 1, (intptr_t)&d.tile[BENCH_KERNELTILE / 2], (intptr_t)p);
+        t = timerGetNanoTicks() - t;
+        break;
+
+    default:
+        // drawn bottom up, the way the engine draws slopes
+        sethlinesizes(c.logx, c.logy, (intptr_t)d.tile);
+        gpinc = -BENCH_KERNELBPL;
+        asm1  = c.bzinc << 3;
+        asm3  = c.bz;
+
+        t = timerGetNanoTicks();
+        slopevlin((intptr_t)&p[(BENCH_KERNELROWS - 1) * BENCH_KERNELBPL], 0, (intptr_t)&d.slopal[BENCH_KERNELROWS - 1], c.rows, c.bx, c.by);
+        t = timerGetNanoTicks() - t;
+        break;
+    }
+
+    return t;
+}
+
+// Draws the same random cases of each column function with every kernel and
+// diffs the framebuffer and the texture coordinates handed back against the C kernel.
+static int benchRunKernels(FILE *fp, int const numcases)
+{
+    static char const *const kernelNames[] = { "c", "simd" };
+    static char const *const funcNames[] = { "mvlineasm4", "spritevline", "slopevlin" };
+    int constexpr framesize = BENCH_KERNELROWS * BENCH_KERNELBPL;
+
+    benchkerneldata d;
+
+    d.tile  = (char *)Xmalloc(BENCH_KERNELTILE);
+    d.pals  = (char *)Xmalloc(4 * 256);
+
+    auto frame = (char *)Xmalloc(framesize);
+    auto ref   = (char *)Xmalloc(framesize);
+
+    uint32_t seed = 4;
+
+    for (int i = 0; i < BENCH_KERNELTILE; i++)
+        d.tile[i] = (benchRand(seed) & 7) ? benchRand(seed) % 255 : 255;
+
+    for (int i = 0; i < 4 * 256; i++)
+        d.pals[i] = benchRand(seed);
+
+    for (auto &pal : d.slopal)
+        pal = (intptr_t)&d.pals[(benchRand(seed) & 3) << 8];
+
+    // only engineInit() fills sloptable, which the kernel cases run without
+    for (auto &slope : sloptable)
+        slope = (int32_t)benchRand(seed) - (1 << 23);
+
+    globalx3 = benchRand(seed) << 8;
+    globaly3 = benchRand(seed) << 8;
+
+    setvlinebpl(BENCH_KERNELBPL);
+
+    uint64_t ticks[BENCH_NUMVLINES][VLINE_KERNEL_BEST + 1] = {};
+    int mismatches[BENCH_NUMVLINES][VLINE_KERNEL_BEST + 1] = {};
+    int cases[BENCH_NUMVLINES] = {};
+    bool available[VLINE_KERNEL_BEST + 1] = {};
+
+    for (int k = VLINE_KERNEL_C; k <= VLINE_KERNEL_BEST; k++)
+        available[k] = setvlinekernel(k) == k;
+
+    for (int i = 0; i < numcases; i++)
+    {
+        benchkernelcase c;
+        uint32_t refstate[4];
+
+        benchSetupKernelCase(c, d, seed);
+        cases[c.func]++;
+
+        for (int k = VLINE_KERNEL_C; k <= VLINE_KERNEL_BEST; k++)
+        {
+            if (!available[k])
+                continue;
+
+            char *const out = (k == VLINE_KERNEL_C) ? ref : frame;
+            uint32_t state[4];
+
+            // a patterned background so that stray and missing writes both show up
+            for (int j = 0; j < framesize; j++)
+                out[j] = (char)(j * 7 + (j >> 6));
+
+            setvlinekernel(k);
+            ticks[c.func][k] += benchRunKernelCase(c, d, out, k == VLINE_KERNEL_C ? refstate : state);
+
+            if (k != VLINE_KERNEL_C && (Bmemcmp(refstate, state, sizeof(state)) || Bmemcmp(ref, frame, framesize)))
+                mismatches[c.func][k]++;
+        }
+    }
+
+    setvlinekernel(VLINE_KERNEL_BEST);
+
+    int errors = 0;
+
+    benchOpenObject(fp, "kernels");
+    fprintf(fp, "    \"cases\": %d,\n    \"functions\": [\n", numcases);
+
+    for (int f = 0; f < BENCH_NUMVLINES; f++)
+    {
+        fprintf(fp, "%s      { \"name\": \"%s\", \"cases\": %d, \"kernels\": [\n", f ? ",\n" : "", funcNames[f], cases[f]);
+
+        for (int k = VLINE_KERNEL_C; k <= VLINE_KERNEL_BEST; k++)
+        {
+            if (!available[k])
+                continue;
+
+            if (mismatches[f][k])
+            {
+                LOG_F(ERROR, "%s %s kernel differs from the C kernel in %d of %d cases.", kernelNames[k], funcNames[f], mismatches[f][k], cases[f]);
+                errors++;
+            }
+
+            fprintf(fp, "%s        { \"name\": \"%s\", \"ms\": %.3f, \"mismatches\": %d }", k == VLINE_KERNEL_C ? "" : ",\n", kernelNames[k],
+                    ticks[f][k] * 1000.0 / (double)timerGetNanoTickRate(), mismatches[f][k]);
+        }
+
+        fprintf(fp, "\n      ] }");
+    }
+
+    fprintf(fp, "\n    ]\n  }");
+
+    Xfree(ref);
+    Xfree(frame);
+    Xfree(d.pals);
+    Xfree(d.tile);
+
+    return errors;
+}
+#endif
+
+// sw/src/userbench.cpp
+int      benchUserSize(void);
+void     benchUserSpawn(short SpriteNum, uint32_t seed, int heap);
+void     benchUserKill(short SpriteNum, int heap);
+uint32_t benchUserActors(void);
+int      benchUserPrediction(short SpriteNum);
+
+static int benchRunSpawn(FILE *fp, int const numsprites, int const tics)
+{
+    static char const *const modeNames[] = { "heap", "pool" };
+
+    auto live     = (int16_t *)Xmalloc(MAXSPRITES * sizeof(int16_t));
+    auto freelist = (int16_t *)Xmalloc(MAXSPRITES * sizeof(int16_t));
+
+    int const churn = max(1, numsprites / BENCH_SPAWNCHURN);
+    double const rate = (double)timerGetNanoTickRate();
+
+    uint32_t reference = 0;
+    int errors = 0;
+
+    if (int const bad = benchUserPrediction(0))
+    {
+        LOG_F(ERROR, "FreeUser() during prediction changed the user table (%d checks failed).", bad);
+        errors++;
+    }
+
+    benchOpenObject(fp, "spawn");
+    fprintf(fp, "    \"sprites\": %d,\n    \"tics\": %d,\n    \"churn_per_tic\": %d,\n    \"user_bytes\": %d,\n    \"prediction_ok\": %s,\n    \"modes\": [\n",
+            numsprites, tics, churn, benchUserSize(), errors ? "false" : "true");
+
+    for (int mode = 0; mode < 2; mode++)
+    {
+        int const heap = (mode == 0);
+        uint32_t seed = 3;
+        int numlive = 0, numfree = MAXSPRITES;
+
+        // lowest sprite numbers first, like insertsprite() on a fresh map
+        for (int i = 0; i < MAXSPRITES; i++)
+            freelist[i] = MAXSPRITES - 1 - i;
+
+        auto spawn = [&]()
+        {
+            int16_t const s = freelist[--numfree];
+
+            benchUserSpawn(s, benchRand(seed), heap);
+            live[numlive++] = s;
+        };
+
+        auto kill = [&](int const idx)
+        {
+            int16_t const s = live[idx];
+
+            live[idx] = live[--numlive];
+            benchUserKill(s, heap);
+            freelist[numfree++] = s;
+        };
+
+        for (int i = 0; i < numsprites; i++)
+            spawn();
+
+        uint64_t spawnTicks = 0, actorTicks = 0;
+        uint32_t sum = 0;
+
+        for (int t = 0; t < tics; t++)
+        {
+            uint64_t const t0 = timerGetNanoTicks();
+
+            for (int i = 0; i < churn; i++)
+            {
+                kill(benchRand(seed) % numlive);
+                spawn();
+            }
+
+            uint64_t const t1 = timerGetNanoTicks();
+
+            sum += benchUserActors();
+
+            uint64_t const t2 = timerGetNanoTicks();
+
+            spawnTicks += t1 - t0;
+            actorTicks += t2 - t1;
+        }
+
+        while (numlive)
+            kill(numlive - 1);
+
+        if (mode == 0)
+            reference = sum;
+        else if (sum != reference)
+        {
+            LOG_F(ERROR, "%s actor pass does not match the heap run.", modeNames[mode]);
+            errors++;
+        }
+
+        fprintf(fp, "%s      { \"name\": \"%s\", \"spawnkill_us_per_tic\": %.2f, \"actors_us_per_tic\": %.2f, \"checksum\": \"%08x\" }",
+                mode ? ",\n" : "", modeNames[mode], spawnTicks * 1000000.0 / rate / tics, actorTicks * 1000000.0 / rate / tics, sum);
+    }
+
+    fprintf(fp, "\n    ]\n  }");
+
+    Xfree(freelist);
+    Xfree(live);
+
+    return errors;
+}
+
+// the vanilla queue with evKill()'s original whole-heap scan
+class benchVanillaScanQueue : public VanillaPriorityQueue<EVENT>
+{
+public:
+    void Kill(uint32_t nKey, std::function<bool(EVENT)> pMatch)
+    {
+        UNREFERENCED_PARAMETER(nKey);
+        for (unsigned int i = 1; i <= fNodeCount;)
+        {
+            if (pMatch(queueItems[i].at4))
+                Delete(i);
+            else
+                i++;
+        }
+    }
+};
+
+// the std queue as it was before kills were indexed
+class benchStdScanQueue : public PriorityQueue<EVENT>
+{
+public:
+    std::multiset<queueItem<EVENT>> stdQueue;
+    uint32_t Size(void) { return stdQueue.size(); }
+    void Clear(void) { stdQueue.clear(); }
+    void Insert(uint32_t nPriority, EVENT data) { stdQueue.insert({ nPriority, data }); }
+    EVENT Remove(void)
+    {
+        EVENT data = stdQueue.begin()->at4;
+        stdQueue.erase(stdQueue.begin());
+        return data;
+    }
+    uint32_t LowestPriority(void) { return stdQueue.begin()->at0; }
+    void Kill(uint32_t nKey, std::function<bool(EVENT)> pMatch)
+    {
+        UNREFERENCED_PARAMETER(nKey);
+        for (auto i = stdQueue.begin(); i != stdQueue.end();)
+        {
+            if (pMatch(i->at4))
+                i = stdQueue.erase(i);
+            else
+                i++;
+        }
+    }
+};
+
+// Posts numevents events a tic's worth at a time, kills a quarter as many
+// (index, type) pairs with the three evKill() flavors and dispatches every
+// event that is due. Returns the time spent and appends the dispatch order.
+static uint64_t benchRunEventQueue(PriorityQueue<EVENT> *queue, int const numevents, std::vector<EVENT> &dispatched)
+{
+    uint32_t seed = 5, now = 0;
+    uint64_t const t = timerGetNanoTicks();
+
+    for (int i = 0; i < numevents; i++)
+    {
+        EVENT ev = {};
+
+        ev.index  = benchRand(seed) % BENCH_EVENTINDICES;
+        ev.type   = benchRand(seed) % BENCH_EVENTTYPES;
+        ev.cmd    = (benchRand(seed) & 3) ? benchRand(seed) & 63 : (unsigned int)kCmdCallback;
+        ev.funcID = benchRand(seed) % kCallbackMax;
+        ev.causer = benchRand(seed) % kMaxSprites;
+
+        // small delays so that many events share a due time
+        queue->Insert(now + (benchRand(seed) & 127), ev);
+
+        if ((benchRand(seed) & 3) == 0)
+        {
+            int const idx = benchRand(seed) % BENCH_EVENTINDICES, type = benchRand(seed) % BENCH_EVENTTYPES;
+            int const causer = benchRand(seed) % kMaxSprites;
+            unsigned int const funcID = benchRand(seed) % kCallbackMax;
+
+            switch (benchRand(seed) % 3)
+            {
+            case 0:
+                queue->Kill(EVENT::Key(idx, type), [=](const EVENT &nItem)->bool { return nItem.index == idx && nItem.type == type; });
+                break;
+            case 1:
+                queue->Kill(EVENT::Key(idx, type), [=](const EVENT &nItem)->bool { return nItem.index == idx && nItem.type == type && nItem.causer == causer; });
+                break;
+            default:
+                queue->Kill(EVENT::Key(idx, type), [=](const EVENT &nItem)->bool { return nItem.index == idx && nItem.type == type && nItem.cmd == kCmdCallback && nItem.funcID == funcID; });
+                break;
+            }
+        }
+
+        if ((i & 15) == 15)
+        {
+            now += 4;
+
+            while (queue->Size() > 0 && now >= queue->LowestPriority())
+                dispatched.push_back(queue->Remove());
+        }
+    }
+
+    while (queue->Size() > 0)
+        dispatched.push_back(queue->Remove());
+
+    return timerGetNanoTicks() - t;
+}
+
+static bool benchSameEvents(std::vector<EVENT> const &a, std::vector<EVENT> const &b)
+{
+    if (a.size() != b.size())
+        return false;
+
+    for (size_t i = 0; i < a.size(); i++)
+    {
+        if (a[i].index != b[i].index || a[i].type != b[i].type || a[i].cmd != b[i].cmd ||
+            a[i].funcID != b[i].funcID || a[i].causer != b[i].causer)
+            return false;
+    }
+
+    return true;
+}
+
+static int benchRunEventQueues(FILE *fp, int const numevents)
+{
+    static char const *const queueNames[] = { "vanilla_scan", "vanilla", "std_scan", "std" };
+
+    PriorityQueue<EVENT> *queues[] = { new benchVanillaScanQueue, new VanillaPriorityQueue<EVENT>, new benchStdScanQueue, new StdPriorityQueue<EVENT> };
+    std::vector<EVENT> dispatched[ARRAY_SIZE(queues)];
+    double const rate = (double)timerGetNanoTickRate();
+    int errors = 0;
+
+    benchOpenObject(fp, "eventq");
+    fprintf(fp, "    \"events\": %d,\n    \"queues\": [\n", numevents);
+
+    for (int q = 0; q < (int)ARRAY_SIZE(queues); q++)
+    {
+        uint64_t const ticks = benchRunEventQueue(queues[q], numevents, dispatched[q]);
+
+        // each indexed queue is checked against the scanning one before it
+        bool const match = !(q & 1) || benchSameEvents(dispatched[q - 1], dispatched[q]);
+
+        if (!match)
+        {
+            LOG_F(ERROR, "%s event queue dispatch order differs from %s.", queueNames[q], queueNames[q - 1]);
+            errors++;
+        }
+
+        fprintf(fp, "%s      { \"name\": \"%s\", \"ms\": %.3f, \"dispatched\": %d, \"match\": %s }", q ? ",\n" : "", queueNames[q],
+                ticks * 1000.0 / rate, (int)dispatched[q].size(), match ? "true" : "false");
+
+        delete queues[q];
+    }
+
+    fprintf(fp, "\n    ]\n  }");
+
+    return errors;
+}
+
+static void benchUsage(void)
+{
+    LOG_F(INFO, "Usage: ebench [-grp file] [-def file] [-res WxH] [-frames N] [-threads N] [-o results.json] map [map ...]");
+    LOG_F(INFO, "       ebench -precache [-grp file] [-def file] [-o results.json] [map ...]");
+    LOG_F(INFO, "       ebench -mix voices [-buffers N] [-o results.json]");
+    LOG_F(INFO, "       ebench -pan voices [-o results.json]");
+    LOG_F(INFO, "       ebench -spawn sprites [-spawntics N] [-o results.json]");
+    LOG_F(INFO, "       ebench -eventq events [-o results.json]");
+#ifdef ENGINE_USING_A_C
+    LOG_F(INFO, "       ebench -kernels cases [-o results.json]");
+#endif
+#ifndef NETCODE_DISABLE
+    LOG_F(INFO, "       ebench -net clients [-tics N] [-o results.json]");
+#endif
+}
+
+int app_main(int argc, char const * const * argv)
+{
+    char const *grpfile = nullptr, *outfile = nullptr;
+    std::vector<char const *> maps;
+    int32_t xdimbench = 1920, ydimbench = 1080, frames = 4, threads = 1;
+    int32_t mixvoices = 0, mixbuffers = 4096, panvoices = 0;
+    int32_t netclients = 0, nettics = 1024;
+    int32_t spawnsprites = 0, spawntics = 1024;
+    int32_t kernelcases = 0;
+    int32_t eventqevents = 0;
+    bool precache = false;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (!Bstrcasecmp(argv[i], "-grp") && i + 1 < argc)
+            grpfile = argv[++i];
+        else if (!Bstrcasecmp(argv[i], "-def") && i + 1 < argc)
+            benchDefFile = argv[++i];
+        else if (!Bstrcasecmp(argv[i], "-res") && i + 1 < argc)
+            sscanf(argv[++i], "%dx%d", &xdimbench, &ydimbench);
+        else if (!Bstrcasecmp(argv[i], "-frames") && i + 1 < argc)
+            frames = max<int32_t>(1, Batol(argv[++i]));
+        else if (!Bstrcasecmp(argv[i], "-threads") && i + 1 < argc)
+            threads = clamp<int32_t>(Batol(argv[++i]), 1, 64);
+        else if (!Bstrcasecmp(argv[i], "-mix") && i + 1 < argc)
+            mixvoices = max<int32_t>(1, Batol(argv[++i]));
+        else if (!Bstrcasecmp(argv[i], "-pan") && i + 1 < argc)
+            panvoices = max<int32_t>(1, Batol(argv[++i]));
+        else if (!Bstrcasecmp(argv[i], "-buffers") && i + 1 < argc)
+            mixbuffers = max<int32_t>(1, Batol(argv[++i]));
+        else if (!Bstrcasecmp(argv[i], "-net") && i + 1 < argc)
+            netclients = max<int32_t>(1, Batol(argv[++i]));
+        else if (!Bstrcasecmp(argv[i], "-spawn") && i + 1 < argc)
+            spawnsprites = clamp<int32_t>(Batol(argv[++i]), 1, MAXSPRITES);
+        else if (!Bstrcasecmp(argv[i], "-spawntics") && i + 1 < argc)
+            spawntics = max<int32_t>(1, Batol(argv[++i]));
+        else if (!Bstrcasecmp(argv[i], "-eventq") && i + 1 < argc)
+            eventqevents = max<int32_t>(1, Batol(argv[++i]));
+        else if (!Bstrcasecmp(argv[i], "-kernels") && i + 1 < argc)
+            kernelcases = max<int32_t>(1, Batol(argv[++i]));
+        else if (!Bstrcasecmp(argv[i], "-tics") && i + 1 < argc)
+            nettics = max<int32_t>(1, Batol(argv[++i]));
+        else if (!Bstrcasecmp(argv[i], "-precache"))
+            precache = true;
+        else if (!Bstrcasecmp(argv[i], "-o") && i + 1 < argc)
+            outfile = argv[++i];
+        else if (argv[i][0] != '-')
+            maps.push_back(argv[i]);
+    }
+
+    if (maps.empty() && !mixvoices && !panvoices && !netclients && !spawnsprites && !kernelcases && !eventqevents && !precache)
+    {
+        benchUsage();
+        return 1;
+    }
+
+#ifdef RENDERTYPESDL
+    // Never open a visible window; the software renderer only needs a framebuffer.
+# ifdef _WIN32
+    if (!Bgetenv("SDL_VIDEODRIVER"))
+        _putenv("SDL_VIDEODRIVER=dummy");
+# else
+    setenv("SDL_VIDEODRIVER", "dummy", 0);
+# endif
+#endif
+
+    if (enginePreInit())
+    {
+        LOG_F(ERROR, "There was a problem initializing the engine: %s", engineerrstr);
+        return 1;
+    }
+
+    if (mixvoices || panvoices || netclients || spawnsprites || kernelcases || eventqevents)
+    {
+        FILE *fp = outfile ? Bfopen(outfile, "w") : stdout;
+
+        if (!fp)
+        {
+            LOG_F(ERROR, "Failed opening \"%s\" for writing.", outfile);
+            return 1;
+        }
+
+        initcrc32table();
+
+        int errors = 0;
+
+        fprintf(fp, "{\n");
+
+        if (mixvoices)
+            errors += benchRunMixer(fp, mixvoices, mixbuffers);
+        if (panvoices)
+            errors += benchRunPan(fp, panvoices);
+#ifndef NETCODE_DISABLE
+        if (netclients)
+            errors += benchRunNet(fp, netclients, nettics);
+#endif
+        if (spawnsprites)
+            errors += benchRunSpawn(fp, spawnsprites, spawntics);
+        if (eventqevents)
+            errors += benchRunEventQueues(fp, eventqevents);
+#ifdef ENGINE_USING_A_C
+        if (kernelcases)
+            errors += benchRunKernels(fp, kernelcases);
+#endif
+
+        fprintf(fp, "\n}\n");
+
+        if (fp != stdout)
+            Bfclose(fp);
+
+        return errors ? 2 : 0;
+    }
+
+    if (grpfile)
+        initgroupfile(grpfile);
+
+    if (engineInit())
+    {
+        LOG_F(ERROR, "There was a problem initializing the engine: %s", engineerrstr);
+        return 1;
+    }
+
+    artLoadFiles("tiles%03i.art", BENCH_CACHESIZE);
+
+    if (benchDefFile[0])
+        loaddefinitionsfile(benchDefFile);
+
+    if (enginePostInit())
+    {
+        LOG_F(ERROR, "There was a problem initializing the engine: %s", engineerrstr);
+        return 1;
+    }
+
+    palettePostLoadLookups();
+
+    if (precache)
+    {
+        // no video mode: the ART and hightile loads don't touch the renderer
+        std::vector<char *> found;
+
+        if (maps.empty())
+        {
+            auto const list = klistpath("/", "*.map", BUILDVFS_FIND_FILE);
+
+            for (auto rec = list; rec; rec = rec->next)
+                found.push_back(Xstrdup(rec->name));
+
+            klistfree(list);
+            std::sort(found.begin(), found.end(), [](char const *a, char const *b) { return Bstrcasecmp(a, b) < 0; });
+            maps.assign(found.begin(), found.end());
+        }
+
+        FILE *fp = outfile ? Bfopen(outfile, "w") : stdout;
+
+        if (!fp)
+        {
+            LOG_F(ERROR, "Failed opening \"%s\" for writing.", outfile);
+            return 1;
+        }
+
+        int errors = 0, loaded = 0;
+
+        fprintf(fp, "{\n  \"hightile\": %d,\n  \"maps\": [\n", usehightile);
+
+        for (auto mapname : maps)
+        {
+            if (benchRunPrecache(fp, mapname, !loaded) < 0)
+                errors++;
+            else
+                loaded++;
+        }
+
+        fprintf(fp, "\n  ]\n}\n");
+
+        if (fp != stdout)
+            Bfclose(fp);
+
+        for (auto name : found)
+            Xfree(name);
+
+        engineUnInit();
+        uninitgroupfile();
+
+        return errors ? 2 : 0;
+    }
+
+    if (videoSetGameMode(0, xdimbench, ydimbench, 8, 1) < 0)
+    {
+        LOG_F(ERROR, "Failed setting %dx%d 8-bit video mode.", xdimbench, ydimbench);
+        return 1;
+    }
+
+    FILE *fp = outfile ? Bfopen(outfile, "w") : stdout;
+
+    if (!fp)
+    {
+        LOG_F(ERROR, "Failed opening \"%s\" for writing.", outfile);
+        return 1;
+    }
+
+    benchsamples_t total[BENCH_NUMFUNCS];
+    int errors = 0;
+
+    fprintf(fp, "{\n  \"xdim\": %d,\n  \"ydim\": %d,\n  \"frames\": %d,\n  \"classicthreads\": %d,\n  \"maps\": [\n",
+            xdim, ydim, frames, threads);
+
+    for (size_t m = 0; m < maps.size(); m++)
+    {
+        benchsamples_t samples[BENCH_NUMFUNCS];
+
+        if (benchRunMap(maps[m], frames, threads, samples, &errors) <= 0)
+            errors++;
+
+        fprintf(fp, "    {\n      \"name\": \"%s\",\n", maps[m]);
+        for (int i = 0; i < BENCH_NUMFUNCS; i++)
+            total[i].insert(total[i].end(), samples[i].begin(), samples[i].end());
+        benchWriteFuncs(fp, samples, "      ");
+        fprintf(fp, "    }%s\n", m == maps.size() - 1 ? "" : ",");
+    }
+
+    fprintf(fp, "  ],\n  \"total\": {\n");
+    benchWriteFuncs(fp, total, "    ");
+    fprintf(fp, "  }\n}\n");
+
+    if (fp != stdout)
+        Bfclose(fp);
+
+    engineUnInit();
+    uninitgroupfile();
+
+    return errors ? 2 : 0;
+}